@@ -0,0 +1,17 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: the C library's header plus lwIP's reentrant inet_ntoa_r()
+ */
+
+#ifndef HOST_ARPA_INET_H
+#define HOST_ARPA_INET_H
+
+#include_next <arpa/inet.h>
+
+static inline char *inet_ntoa_r(struct in_addr addr, char *buf, int buflen)
+{
+    return (char *)inet_ntop(AF_INET, &addr, buf, buflen);
+}
+
+#endif // HOST_ARPA_INET_H
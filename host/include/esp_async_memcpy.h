@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: no DMA engine; installing fails so callers copy with memcpy
+ */
+
+#ifndef ESP_ASYNC_MEMCPY_H
+#define ESP_ASYNC_MEMCPY_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct async_memcpy_context_t *async_memcpy_handle_t;
+
+typedef struct {
+    void *data;
+} async_memcpy_event_t;
+
+typedef bool (*async_memcpy_isr_cb_t)(async_memcpy_handle_t mcp_hdl, async_memcpy_event_t *event, void *cb_args);
+
+typedef struct {
+    uint32_t backlog;
+    size_t sram_trans_align;
+    size_t psram_trans_align;
+    uint32_t flags;
+} async_memcpy_config_t;
+
+#define ASYNC_MEMCPY_DEFAULT_CONFIG() { .backlog = 8 }
+
+static inline esp_err_t esp_async_memcpy_install(const async_memcpy_config_t *config, async_memcpy_handle_t *mcp)
+{
+    (void)config;
+    (void)mcp;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t esp_async_memcpy(async_memcpy_handle_t mcp, void *dst, void *src, size_t n,
+                                         async_memcpy_isr_cb_t cb, void *cb_args)
+{
+    (void)mcp;
+    (void)dst;
+    (void)src;
+    (void)n;
+    (void)cb;
+    (void)cb_args;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // ESP_ASYNC_MEMCPY_H
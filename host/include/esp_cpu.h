@@ -0,0 +1,30 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: cycle counter
+ *
+ * This is the timing shim of the host runs: the device counts CPU cycles,
+ * the host counts nanoseconds of clock_gettime(CLOCK_MONOTONIC), i.e. the
+ * cycles of a nominal 1000 MHz clock (esp_rom_get_cpu_ticks_per_us() says
+ * 1000), so cycles, cycles_per_pixel and us_mean read the same way in both
+ * reports.
+ */
+
+#ifndef ESP_CPU_H
+#define ESP_CPU_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define HOST_CPU_MHZ    1000
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+#endif // ESP_CPU_H
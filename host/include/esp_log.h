@@ -0,0 +1,50 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: ESP_LOGx with the firmware's line format, written to stdout
+ * through a replaceable vprintf like on the device
+ */
+
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include "sdkconfig.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Level below which lines are not formatted (ESP_LOG_INFO by default,
+// HOST_LOG_LEVEL in the environment overrides it: 0 = none ... 5 = verbose)
+esp_log_level_t esp_log_host_level(void);
+
+#define ESP_LOG_LEVEL_LOCAL(level, letter, tag, format, ...) do {                      \
+        if (esp_log_host_level() >= level) {                                            \
+            esp_log_write(level, tag, #letter " (%" PRIu32 ") %s: " format "\n",        \
+                          esp_log_timestamp(), tag, ##__VA_ARGS__);                     \
+        }                                                                               \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, E, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, W, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, I, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, D, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, V, tag, format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: no PSRAM; nothing needs a cache sync
+ */
+
+#ifndef ESP_PSRAM_H
+#define ESP_PSRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+static inline bool esp_psram_is_initialized(void)
+{
+    return false;
+}
+
+static inline size_t esp_psram_get_size(void)
+{
+    return 0;
+}
+
+static inline bool esp_psram_check_ptr_addr(const void *p)
+{
+    (void)p;
+    return false;
+}
+
+#endif // ESP_PSRAM_H
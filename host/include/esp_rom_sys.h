@@ -0,0 +1,18 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: CPU clock of the cycle counter in esp_cpu.h
+ */
+
+#ifndef ESP_ROM_SYS_H
+#define ESP_ROM_SYS_H
+
+#include "esp_cpu.h"
+#include <stdint.h>
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return HOST_CPU_MHZ;
+}
+
+#endif // ESP_ROM_SYS_H
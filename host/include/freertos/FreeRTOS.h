@@ -0,0 +1,55 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: FreeRTOS on POSIX threads
+ *
+ * Tasks are threads, ticks are milliseconds and priorities and core
+ * affinity are recorded but not enforced. Critical sections take one
+ * process-wide recursive lock, whatever portMUX they name.
+ */
+
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  1
+#define pdFAIL                  0
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFF)
+#define configTICK_RATE_HZ      CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define configMAX_PRIORITIES    25
+#define portNUM_PROCESSORS      2
+#define tskIDLE_PRIORITY        0
+#define tskNO_AFFINITY          0x7FFFFFFF
+#define configRUN_TIME_COUNTER_TYPE uint32_t
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void host_enter_critical(portMUX_TYPE *mux);
+void host_exit_critical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)         host_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)          host_exit_critical(mux)
+#define taskENTER_CRITICAL(mux)         host_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)          host_exit_critical(mux)
+#define portENTER_CRITICAL_ISR(mux)     host_enter_critical(mux)
+#define portEXIT_CRITICAL_ISR(mux)      host_exit_critical(mux)
+#define portYIELD_FROM_ISR(x)           ((void)(x))
+
+#endif // FREERTOS_H
@@ -0,0 +1,28 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: esp32-camera image conversions on libjpeg
+ *
+ * RGB565 is big-endian, as the camera delivers it and the esp32-camera
+ * converters read and write it.
+ */
+
+#ifndef IMG_CONVERTERS_H
+#define IMG_CONVERTERS_H
+
+#include "esp_camera.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    JPG_SCALE_NONE,
+    JPG_SCALE_2X,
+    JPG_SCALE_4X,
+    JPG_SCALE_8X,
+} jpg_scale_t;
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale);
+
+#endif // IMG_CONVERTERS_H
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: no MQTT client; esp_mqtt_client_init() fails, so an enabled
+ * publisher reports that it could not start
+ */
+
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include <stddef.h>
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    struct {
+        struct {
+            const char *uri;
+        } address;
+    } broker;
+    struct {
+        int timeout_ms;
+    } network;
+} esp_mqtt_client_config_t;
+
+static inline esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    (void)config;
+    return NULL;
+}
+
+static inline esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client,
+                                                       esp_mqtt_event_id_t event,
+                                                       esp_event_handler_t handler, void *arg)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+static inline esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+static inline esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client)
+{
+    return ESP_ERR_INVALID_ARG;
+}
+
+static inline int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                                          const char *data, int len, int qos, int retain)
+{
+    return -1;
+}
+
+#endif // MQTT_CLIENT_H
@@ -0,0 +1,15 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: configuration of the Linux target
+ */
+
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#define CONFIG_IDF_TARGET           "linux"
+#define CONFIG_IDF_TARGET_LINUX     1
+#define CONFIG_FREERTOS_HZ          1000
+#define CONFIG_LOG_DEFAULT_LEVEL    3   // Info
+
+#endif // SDKCONFIG_H
@@ -0,0 +1,300 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Validation of the strip-parallel JPEG encoder against libjpeg
+ *
+ *     jpeg_check [iterations]
+ *
+ * Encodes generated RGB565 frames with jpeg_encode_rgb565() at several sizes
+ * (including one that is not a whole number of MCUs) and qualities, decodes
+ * them with libjpeg and checks that the decoder reports no error or warning,
+ * that the restart markers run RST0..RST7 once per MCU row and that the
+ * PSNR against the source is within PSNR_MARGIN_DB of libjpeg's own encode
+ * at the same quality. Then times both encoders at quality 80; on the host
+ * frame2jpg() is libjpeg-turbo (shim/img_converters.c), on the device
+ * GET /api/bench times esp32-camera's. Exits with status 1 on a failure.
+ */
+
+#include "jpeg_encoder.h"
+#include "img_converters.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_ITERATIONS  20
+#define PSNR_MARGIN_DB      1.5     // Allowed loss against libjpeg at the same quality
+#define MCU_SIZE            16
+#define BENCH_QUALITY       80      // Same as the pipeline
+
+static const struct {
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+} sizes[] = {
+    { "QVGA", 320, 240 },
+    { "VGA", 640, 480 },
+    { "SVGA", 800, 600 },
+    { "330x250", 330, 250 },     // Partial MCUs on the right and bottom edges
+};
+
+static const uint8_t qualities[] = { 50, 80, 95 };
+
+typedef enum {
+    PATTERN_SCENE,                  // Gradients, hard-edged bands and a checkerboard
+    PATTERN_NOISE,                  // Random pixels: the largest output per frame
+    PATTERN_COUNT,
+} pattern_t;
+
+static const char *pattern_names[PATTERN_COUNT] = { "scene", "noise" };
+
+// Big-endian RGB565 frame plus its exact RGB888 expansion for the PSNR
+static void fill_frame(pattern_t pattern, uint8_t *rgb565, uint8_t *rgb, uint16_t width, uint16_t height)
+{
+    uint32_t seed = 12345;
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            uint8_t r, g, b;
+            if (pattern == PATTERN_NOISE) {
+                seed = seed * 1103515245 + 12345;
+                r = seed >> 24;
+                g = seed >> 16;
+                b = seed >> 8;
+            } else if (y > height / 3 && y < height * 2 / 3 && x > width / 4 && x < width * 3 / 4) {
+                // Red, green and blue bands
+                int band = (x - width / 4) * 3 / (width / 2);
+                r = band == 0 ? 230 : 20;
+                g = band == 1 ? 230 : 20;
+                b = band == 2 ? 230 : 20;
+            } else {
+                r = x * 255 / width;
+                g = y * 255 / height;
+                b = ((x ^ y) & 32) ? 200 : 40;
+            }
+
+            uint16_t pixel = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+            size_t i = (size_t)y * width + x;
+            rgb565[i * 2] = pixel >> 8;
+            rgb565[i * 2 + 1] = pixel & 0xFF;
+            rgb[i * 3] = r & 0xF8;
+            rgb[i * 3 + 1] = g & 0xFC;
+            rgb[i * 3 + 2] = b & 0xF8;
+        }
+    }
+}
+
+typedef struct {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+} decode_error_t;
+
+static void decode_error_exit(j_common_ptr cinfo)
+{
+    decode_error_t *err = (decode_error_t *)cinfo->err;
+    err->mgr.format_message(cinfo, err->message);
+    longjmp(err->jump, 1);
+}
+
+static void decode_message(j_common_ptr cinfo)
+{
+    decode_error_t *err = (decode_error_t *)cinfo->err;
+    if (!err->message[0]) {
+        err->mgr.format_message(cinfo, err->message);
+    }
+}
+
+// Decode to RGB888; false with a message on an error or any warning
+static bool decode(const uint8_t *jpeg, size_t len, uint16_t width, uint16_t height, uint8_t *rgb,
+                   char *message, size_t message_size)
+{
+    struct jpeg_decompress_struct cinfo;
+    decode_error_t err = { 0 };
+
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = decode_error_exit;
+    err.mgr.output_message = decode_message;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        snprintf(message, message_size, "libjpeg: %s", err.message);
+        return false;
+    }
+
+    bool ok = false;
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpeg, len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+    if (cinfo.output_width != width || cinfo.output_height != height) {
+        snprintf(message, message_size, "decoded as %ux%u", cinfo.output_width, cinfo.output_height);
+    } else {
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = rgb + (size_t)cinfo.output_scanline * width * 3;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+        if (err.mgr.num_warnings) {
+            snprintf(message, message_size, "libjpeg warning: %s", err.message);
+        } else {
+            ok = true;
+        }
+    }
+    jpeg_destroy_decompress(&cinfo);
+    return ok;
+}
+
+// Restart markers in entropy-coded data: -1 unless they run RST0..RST7 in order
+static int count_restarts(const uint8_t *jpeg, size_t len)
+{
+    size_t i = 2;
+    // Skip the header segments up to and including SOS
+    while (i + 4 <= len && jpeg[i] == 0xFF) {
+        uint8_t marker = jpeg[i + 1];
+        size_t segment = (jpeg[i + 2] << 8) | jpeg[i + 3];
+        i += 2 + segment;
+        if (marker == 0xDA) {
+            break;
+        }
+    }
+
+    int count = 0;
+    for (; i + 1 < len; i++) {
+        if (jpeg[i] != 0xFF || jpeg[i + 1] == 0x00) {
+            continue;
+        }
+        uint8_t marker = jpeg[++i];
+        if (marker == 0xD9) {
+            return count;
+        }
+        if (marker != 0xD0 + (count & 7)) {
+            return -1;
+        }
+        count++;
+    }
+    return -1;
+}
+
+static double psnr(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    double se = 0;
+    for (size_t i = 0; i < n; i++) {
+        double d = (double)a[i] - b[i];
+        se += d * d;
+    }
+    return se == 0 ? 99.0 : 10 * log10(255.0 * 255.0 / (se / n));
+}
+
+// Mean time per encode in microseconds, or -1 if an encode failed
+typedef bool (*encode_fn_t)(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+
+static double time_encoder(encode_fn_t encode, camera_fb_t *fb, int iterations)
+{
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        uint8_t *jpeg = NULL;
+        size_t len = 0;
+        if (!encode(fb, BENCH_QUALITY, &jpeg, &len)) {
+            return -1;
+        }
+        free(jpeg);
+    }
+    return (double)(esp_timer_get_time() - start) / iterations;
+}
+
+static int log_to_stderr(const char *format, va_list args)
+{
+    return vfprintf(stderr, format, args);
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    int failures = 0;
+
+    esp_log_set_vprintf(log_to_stderr);
+    if (iterations < 1 || jpeg_encoder_init() != ESP_OK) {
+        fprintf(stderr, "usage: jpeg_check [iterations]\n");
+        return 1;
+    }
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint16_t width = sizes[s].width, height = sizes[s].height;
+        size_t pixels = (size_t)width * height;
+        uint8_t *rgb565 = malloc(pixels * 2);
+        uint8_t *source = malloc(pixels * 3);
+        uint8_t *decoded = malloc(pixels * 3);
+        if (!rgb565 || !source || !decoded) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        camera_fb_t fb = {
+            .buf = rgb565,
+            .len = pixels * 2,
+            .width = width,
+            .height = height,
+            .format = PIXFORMAT_RGB565,
+        };
+
+        for (int p = 0; p < PATTERN_COUNT; p++) {
+            fill_frame(p, rgb565, source, width, height);
+
+            for (size_t q = 0; q < sizeof(qualities); q++) {
+                uint8_t *ours = NULL, *reference = NULL;
+                size_t ours_len = 0, reference_len = 0;
+                char message[JMSG_LENGTH_MAX + 32] = "";
+                double ours_db = 0, reference_db = 0;
+                int restarts = -1;
+                int expected = (height + MCU_SIZE - 1) / MCU_SIZE - 1;
+
+                bool ok = jpeg_encode_rgb565(&fb, qualities[q], &ours, &ours_len);
+                if (!ok) {
+                    snprintf(message, sizeof(message), "encode failed");
+                } else if ((restarts = count_restarts(ours, ours_len)) != expected) {
+                    snprintf(message, sizeof(message), "%d restart markers in order, expected %d",
+                             restarts, expected);
+                    ok = false;
+                } else if ((ok = decode(ours, ours_len, width, height, decoded, message, sizeof(message)))) {
+                    ours_db = psnr(source, decoded, pixels * 3);
+                }
+
+                if (ok && frame2jpg(&fb, qualities[q], &reference, &reference_len) &&
+                    decode(reference, reference_len, width, height, decoded, message, sizeof(message))) {
+                    reference_db = psnr(source, decoded, pixels * 3);
+                    if (ours_db < reference_db - PSNR_MARGIN_DB) {
+                        snprintf(message, sizeof(message), "PSNR %.1f dB below libjpeg's", reference_db - ours_db);
+                        ok = false;
+                    }
+                }
+
+                printf("%-8s %-6s q%-3u %-4s  %6.2f dB (libjpeg %6.2f)  %7zu bytes (libjpeg %7zu)  %s\n",
+                       sizes[s].name, pattern_names[p], qualities[q], ok ? "ok" : "FAIL",
+                       ours_db, reference_db, ours_len, reference_len, message);
+                failures += !ok;
+                free(ours);
+                free(reference);
+            }
+        }
+
+        // Throughput on the scene
+        fill_frame(PATTERN_SCENE, rgb565, source, width, height);
+        double ours_us = time_encoder(jpeg_encode_rgb565, &fb, iterations);
+        double reference_us = time_encoder(frame2jpg, &fb, iterations);
+        printf("%-8s q%u  jpeg_encode_rgb565 %8.0f us  %6.1f Mpx/s   frame2jpg %8.0f us  %6.1f Mpx/s   x%.2f\n",
+               sizes[s].name, BENCH_QUALITY, ours_us, pixels / ours_us, reference_us, pixels / reference_us,
+               reference_us / ours_us);
+        failures += ours_us < 0 || reference_us < 0;
+
+        free(rgb565);
+        free(source);
+        free(decoded);
+    }
+
+    printf("%s\n", failures ? "FAILED" : "all ok");
+    return failures ? 1 : 0;
+}
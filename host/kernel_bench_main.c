@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host runner of the kernel benchmark: the firmware's kernels and JSON, timed
+ * with clock_gettime (see include/esp_cpu.h)
+ *
+ *     kernel_bench [iterations] > host.json
+ *
+ * The report has the fields of GET /api/bench; tools/bench_compare.py puts
+ * a device and a host report side by side.
+ */
+
+#include "kernel_bench.h"
+#include "jpeg_encoder.h"
+#include "esp_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEFAULT_ITERATIONS  5
+
+// Log lines go to stderr so stdout holds only the report
+static int log_to_stderr(const char *format, va_list args)
+{
+    return vfprintf(stderr, format, args);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_ITERATIONS;
+    esp_log_set_vprintf(log_to_stderr);
+    if (jpeg_encoder_init() != ESP_OK) {
+        fprintf(stderr, "kernel_bench: encoder init failed\n");
+        return 1;
+    }
+
+    static kernel_bench_report_t report;
+    esp_err_t err = kernel_bench_run(iterations, &report);
+    if (err != ESP_OK) {
+        fprintf(stderr, "kernel_bench: %s (iterations 1 to %d)\n", esp_err_to_name(err),
+                KERNEL_BENCH_MAX_ITERATIONS);
+        return 1;
+    }
+
+    char *json = kernel_bench_to_json(&report);
+    if (!json) {
+        fprintf(stderr, "kernel_bench: out of memory\n");
+        return 1;
+    }
+    fputs(json, stdout);
+    free(json);
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host runner of the firmware's services
+ *
+ *     host_server [port]
+ *
+ * Brings the modules up in the order app_main does, without Wi-Fi: the
+ * configuration (NVS in memory), the synthetic frame source in place of the
+ * camera, detection, the encoder, the pipeline, then the HTTP server on
+ * port (default 8080) and the RTSP server on RTSP_PORT. MQTT, the LED and
+ * the flash partitions are stubs (see include/). tools/load_gen.py and the
+ * web UI work against it as against a device.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "camera_driver.h"
+#include "frame_source.h"
+#include "ws2812_led.h"
+#include "config_store.h"
+#include "color_detect.h"
+#include "detect_profile.h"
+#include "jpeg_encoder.h"
+#include "motion_gate.h"
+#include "detection_log.h"
+#include "frame_pipeline.h"
+#include "http_server.h"
+#include "rtsp_server.h"
+#include "mqtt_publisher.h"
+#include "clip_recorder.h"
+#include "cpu_load.h"
+#include "log_sink.h"
+#include "boot_profile.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "main";
+
+#define DEFAULT_PORT    "8080"
+
+// Camera, detector and local outputs, as app_main's local_init_task
+static void local_init(const color_config_t *config)
+{
+    boot_profile_begin(BOOT_PHASE_CAMERA);
+    bool sensor_ok = camera_init() == ESP_OK;
+    ESP_ERROR_CHECK(frame_source_init(sensor_ok));
+    boot_profile_end(BOOT_PHASE_CAMERA);
+
+    boot_profile_begin(BOOT_PHASE_DETECTOR);
+    ESP_ERROR_CHECK(color_detect_init(config));
+    pattern_config_t pattern;
+    if (config_load_pattern(&pattern) == ESP_OK && color_detect_set_pattern(&pattern) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored band pattern invalid, using R-G-B");
+    }
+    motion_gate_configure(config->motion_threshold, config->refresh_interval);
+    if (detect_profile_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Detection profiles not available");
+    }
+    boot_profile_end(BOOT_PHASE_DETECTOR);
+
+    boot_profile_begin(BOOT_PHASE_ENCODER);
+    ESP_ERROR_CHECK(jpeg_encoder_init());
+    boot_profile_end(BOOT_PHASE_ENCODER);
+
+    boot_profile_begin(BOOT_PHASE_PIPELINE);
+    if (detection_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Detection log not available");
+    }
+    ESP_ERROR_CHECK(frame_pipeline_start());
+
+    clip_config_t clip_config;
+    if (config_load_clips(&clip_config) != ESP_OK) {
+        config_get_clip_defaults(&clip_config);
+    }
+    if (clip_recorder_start(&clip_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Clip recorder not available");
+    }
+    boot_profile_end(BOOT_PHASE_PIPELINE);
+}
+
+// As app_main's start_network_services
+static void start_network_services(void)
+{
+    boot_profile_begin(BOOT_PHASE_HTTP);
+    ESP_ERROR_CHECK(http_server_start());
+    boot_profile_end(BOOT_PHASE_HTTP);
+
+    boot_profile_begin(BOOT_PHASE_RTSP);
+    if (rtsp_server_start() != ESP_OK) {
+        ESP_LOGW(TAG, "RTSP server not available");
+    }
+    boot_profile_end(BOOT_PHASE_RTSP);
+
+    boot_profile_begin(BOOT_PHASE_MQTT);
+    mqtt_config_t mqtt_config;
+    if (config_load_mqtt(&mqtt_config) != ESP_OK) {
+        config_get_mqtt_defaults(&mqtt_config);
+    }
+    if (mqtt_publisher_start(&mqtt_config) != ESP_OK) {
+        ESP_LOGW(TAG, "MQTT publisher not available");
+    }
+    boot_profile_end(BOOT_PHASE_MQTT);
+}
+
+int main(int argc, char **argv)
+{
+    // The firmware's send() calls expect EPIPE from a closed peer, as lwIP
+    // gives, not a signal
+    signal(SIGPIPE, SIG_IGN);
+    // The log sink's task writes to stdout: keep it line by line, like a UART
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    setenv("HOST_HTTP_PORT", argc > 1 ? argv[1] : DEFAULT_PORT, 1);
+
+    boot_profile_mark(BOOT_PHASE_APP_MAIN);
+    if (log_sink_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Log sink unavailable, logging to the console directly");
+    }
+
+    boot_profile_begin(BOOT_PHASE_NVS);
+    ESP_ERROR_CHECK(config_store_init());
+    static color_config_t config;
+    if (config_load(&config) != ESP_OK) {
+        config_get_defaults(&config);
+        config_save(&config);
+    }
+    boot_profile_end(BOOT_PHASE_NVS);
+
+    boot_profile_begin(BOOT_PHASE_LED);
+    ESP_ERROR_CHECK(ws2812_init());
+    boot_profile_end(BOOT_PHASE_LED);
+
+    local_init(&config);
+    start_network_services();
+    ESP_LOGI(TAG, "Ready: http://localhost:%s/", getenv("HOST_HTTP_PORT"));
+    boot_profile_log();
+
+    if (cpu_load_init() != ESP_OK) {
+        ESP_LOGW(TAG, "CPU load statistics not available");
+    }
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        cpu_load_sample();
+    }
+}
@@ -0,0 +1,28 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: no camera sensor
+ */
+
+#include "esp_camera.h"
+
+esp_err_t esp_camera_init(const camera_config_t *config)
+{
+    (void)config;
+    return ESP_ERR_NOT_FOUND;
+}
+
+sensor_t *esp_camera_sensor_get(void)
+{
+    return NULL;
+}
+
+camera_fb_t *esp_camera_fb_get(void)
+{
+    return NULL;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+    (void)fb;
+}
@@ -0,0 +1,171 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: error names, logging, clock, heap and random numbers
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/random.h>
+
+static const struct {
+    esp_err_t code;
+    const char *name;
+} err_names[] = {
+    { ESP_OK, "ESP_OK" },
+    { ESP_FAIL, "ESP_FAIL" },
+    { ESP_ERR_NO_MEM, "ESP_ERR_NO_MEM" },
+    { ESP_ERR_INVALID_ARG, "ESP_ERR_INVALID_ARG" },
+    { ESP_ERR_INVALID_STATE, "ESP_ERR_INVALID_STATE" },
+    { ESP_ERR_INVALID_SIZE, "ESP_ERR_INVALID_SIZE" },
+    { ESP_ERR_NOT_FOUND, "ESP_ERR_NOT_FOUND" },
+    { ESP_ERR_NOT_SUPPORTED, "ESP_ERR_NOT_SUPPORTED" },
+    { ESP_ERR_TIMEOUT, "ESP_ERR_TIMEOUT" },
+    { ESP_ERR_INVALID_RESPONSE, "ESP_ERR_INVALID_RESPONSE" },
+    { ESP_ERR_INVALID_CRC, "ESP_ERR_INVALID_CRC" },
+    { ESP_ERR_INVALID_VERSION, "ESP_ERR_INVALID_VERSION" },
+    { ESP_ERR_INVALID_MAC, "ESP_ERR_INVALID_MAC" },
+    { ESP_ERR_NOT_FINISHED, "ESP_ERR_NOT_FINISHED" },
+    { ESP_ERR_NOT_ALLOWED, "ESP_ERR_NOT_ALLOWED" },
+};
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    for (size_t i = 0; i < sizeof(err_names) / sizeof(err_names[0]); i++) {
+        if (err_names[i].code == code) {
+            return err_names[i].name;
+        }
+    }
+    return "UNKNOWN ERROR";
+}
+
+// ---- Clock: microseconds since the first call, like time since boot
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t start = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    int64_t zero = 0;
+    __atomic_compare_exchange_n(&start, &zero, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return now - __atomic_load_n(&start, __ATOMIC_RELAXED);
+}
+
+// ---- Logging
+
+static vprintf_like_t log_vprintf = vprintf;
+static int log_level = -1;
+
+esp_log_level_t esp_log_host_level(void)
+{
+    int level = __atomic_load_n(&log_level, __ATOMIC_RELAXED);
+    if (level < 0) {
+        const char *env = getenv("HOST_LOG_LEVEL");
+        level = env ? atoi(env) : CONFIG_LOG_DEFAULT_LEVEL;
+        __atomic_store_n(&log_level, level, __ATOMIC_RELAXED);
+    }
+    return (esp_log_level_t)level;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    // One level for all tags
+    (void)tag;
+    __atomic_store_n(&log_level, (int)level, __ATOMIC_RELAXED);
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    return __atomic_exchange_n(&log_vprintf, func, __ATOMIC_ACQ_REL);
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    (void)level;
+    (void)tag;
+    va_list args;
+    va_start(args, format);
+    __atomic_load_n(&log_vprintf, __ATOMIC_ACQUIRE)(format, args);
+    va_end(args);
+    fflush(stdout);
+}
+
+// ---- Heap: one malloc heap for every capability; sizes are not tracked
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+// ---- Random numbers
+
+uint32_t esp_random(void)
+{
+    uint32_t value = 0;
+    getrandom(&value, sizeof(value), 0);
+    return value;
+}
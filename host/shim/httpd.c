@@ -0,0 +1,1122 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: esp_http_server on POSIX sockets
+ *
+ * One server task polls the listening socket and every open session and
+ * serves one request (or WebSocket frame) at a time, like the device's
+ * httpd task. Sessions are persistent unless the client asks otherwise; a
+ * detached (async) request takes its session out of the poll set until it
+ * completes, and closes requested by other tasks are carried out by the
+ * server task, which calls config.close_fn in place of close().
+ */
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "httpd";
+
+#define RECV_BUFFER_SIZE    2048    // Request line and headers
+#define RESP_HEADER_SIZE    1024
+#define WS_CONTROL_MAX      125
+#define WS_GUID             "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct {
+    int fd;                         // -1 when the slot is free
+    bool detached;                  // Async request outstanding: not polled
+    bool close_pending;             // Closed by the server task on its next pass
+    const httpd_uri_t *ws;          // Handler of a WebSocket session
+    char buf[RECV_BUFFER_SIZE];     // Received and not yet consumed
+    size_t buf_len;
+} session_t;
+
+typedef struct {
+    httpd_config_t config;
+    int listen_fd;
+    int wake[2];                    // Pipe that interrupts the poll
+    SemaphoreHandle_t lock;         // Session flags, shared with other tasks
+    SemaphoreHandle_t stopped;
+    volatile bool stop;
+    httpd_uri_t *handlers;
+    size_t handler_count;
+    session_t *sessions;
+    struct pollfd *pfds;
+} server_t;
+
+// Request state behind httpd_req_t.aux
+typedef struct {
+    server_t *server;
+    session_t *session;
+    size_t remaining;               // Body bytes not yet read
+    bool keep_alive;
+    const char *status;
+    const char *type;
+    const char *hdr_field[16];
+    const char *hdr_value[16];
+    size_t hdr_count;
+    bool headers_sent;              // Chunked response under way
+    // Frame being read, WebSocket sessions only
+    bool ws_frame;
+    httpd_ws_type_t ws_type;
+    bool ws_final;
+    uint8_t ws_mask[4];
+    size_t ws_len;
+    size_t ws_read;
+} req_aux_t;
+
+static const struct {
+    const char *status;
+    const char *msg;
+} err_text[HTTPD_ERR_CODE_MAX] = {
+    [HTTPD_500_INTERNAL_SERVER_ERROR] = { "500 Internal Server Error", "Server has encountered an unexpected error" },
+    [HTTPD_501_METHOD_NOT_IMPLEMENTED] = { "501 Method Not Implemented", "Request method is not supported by server" },
+    [HTTPD_505_VERSION_NOT_SUPPORTED] = { "505 Version Not Supported", "HTTP version not supported by server" },
+    [HTTPD_400_BAD_REQUEST] = { "400 Bad Request", "Bad request syntax" },
+    [HTTPD_401_UNAUTHORIZED] = { "401 Unauthorized", "No permission -- see authorization schemes" },
+    [HTTPD_403_FORBIDDEN] = { "403 Forbidden", "Request forbidden -- authorization will not help" },
+    [HTTPD_404_NOT_FOUND] = { "404 Not Found", "Nothing matches the given URI" },
+    [HTTPD_405_METHOD_NOT_ALLOWED] = { "405 Method Not Allowed", "Specified method is invalid for this resource" },
+    [HTTPD_408_REQ_TIMEOUT] = { "408 Request Timeout", "Server closed this connection" },
+    [HTTPD_411_LENGTH_REQUIRED] = { "411 Length Required", "Client must specify Content-Length" },
+    [HTTPD_414_URI_TOO_LONG] = { "414 URI Too Long", "URI is too long" },
+    [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = { "431 Request Header Fields Too Large", "Header fields are too long" },
+};
+
+static const struct {
+    const char *name;
+    httpd_method_t method;
+} methods[] = {
+    { "GET", HTTP_GET },
+    { "POST", HTTP_POST },
+    { "PUT", HTTP_PUT },
+    { "DELETE", HTTP_DELETE },
+    { "HEAD", HTTP_HEAD },
+    { "OPTIONS", HTTP_OPTIONS },
+    { "PATCH", HTTP_PATCH },
+};
+
+// ---- SHA-1 and base64, for Sec-WebSocket-Accept
+
+static uint32_t rol32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1(const uint8_t *data, size_t len, uint8_t digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t total = (len + 8) / 64 * 64 + 64;
+    uint8_t block[64];
+
+    for (size_t offset = 0; offset < total; offset += 64) {
+        // Message, 0x80, zeros and the bit length, one block at a time
+        for (size_t i = 0; i < 64; i++) {
+            size_t n = offset + i;
+            block[i] = n < len ? data[n] : n == len ? 0x80 : 0;
+        }
+        if (offset + 64 == total) {
+            uint64_t bits = (uint64_t)len * 8;
+            for (int i = 0; i < 8; i++) {
+                block[63 - i] = bits >> (8 * i);
+            }
+        }
+
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol32(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol32(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 20; i++) {
+        digest[i] = h[i / 4] >> (24 - 8 * (i % 4));
+    }
+}
+
+static void base64(const uint8_t *data, size_t len, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < len) {
+            v |= data[i + 1] << 8;
+        }
+        if (i + 2 < len) {
+            v |= data[i + 2];
+        }
+        *out++ = alphabet[(v >> 18) & 63];
+        *out++ = alphabet[(v >> 12) & 63];
+        *out++ = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        *out++ = i + 2 < len ? alphabet[v & 63] : '=';
+    }
+    *out = '\0';
+}
+
+// ---- Socket I/O
+
+static esp_err_t send_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+// Up to len bytes, buffered ones first; a result as for httpd_req_recv()
+static int session_recv(session_t *s, void *buf, size_t len)
+{
+    if (s->buf_len > 0) {
+        size_t n = len < s->buf_len ? len : s->buf_len;
+        memcpy(buf, s->buf, n);
+        memmove(s->buf, s->buf + n, s->buf_len - n);
+        s->buf_len -= n;
+        return n;
+    }
+
+    ssize_t n;
+    do {
+        n = recv(s->fd, buf, len, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    return n > 0 ? n : HTTPD_SOCK_ERR_FAIL;
+}
+
+static esp_err_t session_recv_all(session_t *s, void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    while (len > 0) {
+        int n = session_recv(s, p, len);
+        if (n <= 0) {
+            return n == HTTPD_SOCK_ERR_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t session_discard(session_t *s, size_t len)
+{
+    uint8_t buf[256];
+    while (len > 0) {
+        size_t n = len < sizeof(buf) ? len : sizeof(buf);
+        esp_err_t ret = session_recv_all(s, buf, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+// End of the header block in the buffered bytes, NULL if not yet received
+static char *header_end(session_t *s)
+{
+    for (size_t i = 0; i + 4 <= s->buf_len; i++) {
+        if (memcmp(s->buf + i, "\r\n\r\n", 4) == 0) {
+            return s->buf + i;
+        }
+    }
+    return NULL;
+}
+
+static void server_wake(server_t *server)
+{
+    char c = 0;
+    if (write(server->wake[1], &c, 1) < 0) {
+        ESP_LOGW(TAG, "Wake failed: %d", errno);
+    }
+}
+
+static session_t *session_find(server_t *server, int fd)
+{
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        if (server->sessions[i].fd == fd) {
+            return &server->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static void session_close(server_t *server, session_t *s)
+{
+    int fd = s->fd;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    s->fd = -1;
+    s->detached = false;
+    s->close_pending = false;
+    s->ws = NULL;
+    s->buf_len = 0;
+    xSemaphoreGive(server->lock);
+
+    if (server->config.close_fn) {
+        server->config.close_fn(server, fd);
+    } else {
+        close(fd);
+    }
+}
+
+// ---- Responses
+
+static void req_init(httpd_req_t *req, req_aux_t *aux, server_t *server, session_t *s)
+{
+    memset(req, 0, sizeof(*req));
+    memset(aux, 0, sizeof(*aux));
+    req->handle = server;
+    req->aux = aux;
+    aux->server = server;
+    aux->session = s;
+    aux->keep_alive = true;
+    aux->status = "200 OK";
+    aux->type = "text/html";
+}
+
+// Status line and headers; content_len < 0 for a chunked response
+static esp_err_t send_headers(httpd_req_t *req, ssize_t content_len)
+{
+    req_aux_t *aux = req->aux;
+    char buf[RESP_HEADER_SIZE];
+    int len = snprintf(buf, sizeof(buf), "HTTP/1.1 %s\r\nContent-Type: %s\r\n", aux->status, aux->type);
+    if (content_len >= 0) {
+        len += snprintf(buf + len, sizeof(buf) - len, "Content-Length: %zd\r\n", content_len);
+    } else {
+        len += snprintf(buf + len, sizeof(buf) - len, "Transfer-Encoding: chunked\r\n");
+    }
+    for (size_t i = 0; i < aux->hdr_count && len < (int)sizeof(buf); i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s: %s\r\n", aux->hdr_field[i], aux->hdr_value[i]);
+    }
+    if (!aux->keep_alive && len < (int)sizeof(buf)) {
+        len += snprintf(buf + len, sizeof(buf) - len, "Connection: close\r\n");
+    }
+    if (len + 2 >= (int)sizeof(buf)) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    memcpy(buf + len, "\r\n", 2);
+    return send_all(aux->session->fd, buf, len + 2);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    if (!req || !status) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((req_aux_t *)req->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    if (!req || !type) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ((req_aux_t *)req->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    if (!req || !field || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    req_aux_t *aux = req->aux;
+    size_t max = aux->server->config.max_resp_headers;
+    if (max > sizeof(aux->hdr_field) / sizeof(aux->hdr_field[0])) {
+        max = sizeof(aux->hdr_field) / sizeof(aux->hdr_field[0]);
+    }
+    if (aux->hdr_count >= max) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    aux->hdr_field[aux->hdr_count] = field;
+    aux->hdr_value[aux->hdr_count++] = value;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    if (!req) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? strlen(buf) : 0;
+    }
+    esp_err_t ret = send_headers(req, buf_len);
+    if (ret == ESP_OK && buf_len > 0) {
+        ret = send_all(((req_aux_t *)req->aux)->session->fd, buf, buf_len);
+    }
+    return ret;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    if (!req) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    req_aux_t *aux = req->aux;
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf ? strlen(buf) : 0;
+    }
+    if (!aux->headers_sent) {
+        esp_err_t ret = send_headers(req, -1);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        aux->headers_sent = true;
+    }
+
+    // A zero-length chunk ends the response
+    char size[16];
+    int len = snprintf(size, sizeof(size), "%zx\r\n", buf_len);
+    esp_err_t ret = send_all(aux->session->fd, size, len);
+    if (ret == ESP_OK && buf_len > 0) {
+        ret = send_all(aux->session->fd, buf, buf_len);
+    }
+    if (ret == ESP_OK) {
+        ret = send_all(aux->session->fd, "\r\n", 2);
+    }
+    return ret;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    if (!req || error < 0 || error >= HTTPD_ERR_CODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_resp_set_status(req, err_text[error].status);
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, msg ? msg : err_text[error].msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// ---- Requests
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    if (!req || !buf) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+    req_aux_t *aux = req->aux;
+    if (aux->remaining == 0) {
+        return 0;
+    }
+    int n = session_recv(aux->session, buf, buf_len < aux->remaining ? buf_len : aux->remaining);
+    if (n > 0) {
+        aux->remaining -= n;
+    }
+    return n;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req)
+{
+    return req ? ((req_aux_t *)req->aux)->session->fd : -1;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *req)
+{
+    const char *query = req ? strchr(req->uri, '?') : NULL;
+    return query ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    if (!req || !buf || buf_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *query = strchr(req->uri, '?');
+    if (!query) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return strlcpy(buf, query + 1, buf_len) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    if (!qry || !key || !val || val_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t key_len = strlen(key);
+
+    for (const char *p = qry; *p; ) {
+        const char *end = p + strcspn(p, "&");
+        if ((size_t)(end - p) > key_len && strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            const char *value = p + key_len + 1;
+            size_t len = end - value;
+            size_t copy = len < val_size - 1 ? len : val_size - 1;
+            memcpy(val, value, copy);
+            val[copy] = '\0';
+            return copy == len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    if (!r || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // The copy carries its own response state
+    httpd_req_t *copy = malloc(sizeof(httpd_req_t) + sizeof(req_aux_t));
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    req_aux_t *aux = (req_aux_t *)(copy + 1);
+    memcpy(copy, r, sizeof(*copy));
+    memcpy(aux, r->aux, sizeof(*aux));
+    copy->aux = aux;
+
+    xSemaphoreTake(aux->server->lock, portMAX_DELAY);
+    aux->session->detached = true;
+    xSemaphoreGive(aux->server->lock);
+
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    if (!r) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    req_aux_t *aux = r->aux;
+    server_t *server = aux->server;
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    aux->session->detached = false;
+    xSemaphoreGive(server->lock);
+
+    free(r);
+    server_wake(server);
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    server_t *server = handle;
+    if (!server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    session_t *s = session_find(server, sockfd);
+    if (s) {
+        s->close_pending = true;
+    }
+    xSemaphoreGive(server->lock);
+
+    if (!s) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    server_wake(server);
+    return ESP_OK;
+}
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    // A trailing '?' makes the character before it optional, a trailing '*'
+    // (before or after the '?') matches anything that follows
+    size_t len = strlen(uri_template);
+    char last = len > 0 ? uri_template[len - 1] : 0;
+    char prev = len > 1 ? uri_template[len - 2] : 0;
+    bool asterisk = last == '*' || (prev == '*' && last == '?');
+    bool quest = last == '?' || (prev == '?' && last == '*');
+    size_t special = asterisk + quest * 2;
+
+    if (len < special) {
+        return false;
+    }
+    size_t exact = len - special;
+    if (match_upto < exact || strncmp(uri_template, uri_to_match, exact) != 0) {
+        return false;
+    }
+    if (!quest) {
+        return asterisk || match_upto == exact;
+    }
+    if (match_upto > exact && uri_template[exact] != uri_to_match[exact]) {
+        return false;
+    }
+    return asterisk || match_upto <= exact + 1;
+}
+
+// ---- Server
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    server_t *server = handle;
+    if (!server || !uri_handler || !uri_handler->uri || !uri_handler->handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < server->handler_count; i++) {
+        if (server->handlers[i].method == uri_handler->method &&
+            strcmp(server->handlers[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->handler_count >= server->config.max_uri_handlers) {
+        ESP_LOGE(TAG, "No slot left for %s", uri_handler->uri);
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    server->handlers[server->handler_count++] = *uri_handler;
+    return ESP_OK;
+}
+
+static bool uri_matches(server_t *server, const httpd_uri_t *h, const char *uri, size_t len)
+{
+    if (server->config.uri_match_fn) {
+        return server->config.uri_match_fn(h->uri, uri, len);
+    }
+    return strlen(h->uri) == len && strncmp(h->uri, uri, len) == 0;
+}
+
+// Value of a header in the block at headers, NULL if absent; the value runs
+// to the next CR
+static const char *header_value(const char *headers, const char *name)
+{
+    size_t name_len = strlen(name);
+    for (const char *line = headers; line && *line; ) {
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *value = line + name_len + 1;
+            return value + strspn(value, " \t");
+        }
+        line = strstr(line, "\r\n");
+        line = line ? line + 2 : NULL;
+    }
+    return NULL;
+}
+
+static bool header_has(const char *headers, const char *name, const char *token)
+{
+    const char *value = header_value(headers, name);
+    if (!value) {
+        return false;
+    }
+    size_t len = strcspn(value, "\r");
+    size_t token_len = strlen(token);
+    for (size_t i = 0; i + token_len <= len; i++) {
+        if (strncasecmp(value + i, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t ws_handshake(httpd_req_t *req, const char *headers)
+{
+    const char *key = header_value(headers, "Sec-WebSocket-Key");
+    if (!header_has(headers, "Upgrade", "websocket") || !key) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    char material[128];
+    int len = snprintf(material, sizeof(material), "%.*s" WS_GUID, (int)strcspn(key, " \r"), key);
+    if (len >= (int)sizeof(material)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+    uint8_t digest[20];
+    char accept[32];
+    sha1((const uint8_t *)material, len, digest);
+    base64(digest, sizeof(digest), accept);
+
+    char response[256];
+    len = snprintf(response, sizeof(response),
+                   "HTTP/1.1 101 Switching Protocols\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    return send_all(((req_aux_t *)req->aux)->session->fd, response, len);
+}
+
+// Read one request's line and headers and run its handler; false if the
+// session is to be closed
+static bool serve_request(server_t *server, session_t *s)
+{
+    char *end;
+    while (!(end = header_end(s))) {
+        if (s->buf_len >= sizeof(s->buf) - 1) {
+            httpd_req_t req;
+            req_aux_t aux;
+            req_init(&req, &aux, server, s);
+            aux.keep_alive = false;
+            httpd_resp_send_err(&req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE, NULL);
+            return false;
+        }
+        ssize_t n = recv(s->fd, s->buf + s->buf_len, sizeof(s->buf) - 1 - s->buf_len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Closed, or an incomplete request for recv_wait_timeout
+            return false;
+        }
+        s->buf_len += n;
+    }
+
+    size_t header_len = end + 4 - s->buf;
+    char headers[RECV_BUFFER_SIZE];
+    memcpy(headers, s->buf, header_len);
+    headers[header_len] = '\0';
+    memmove(s->buf, s->buf + header_len, s->buf_len - header_len);
+    s->buf_len -= header_len;
+
+    httpd_req_t req;
+    req_aux_t aux;
+    req_init(&req, &aux, server, s);
+
+    // Request line
+    char method[8], version[16];
+    int uri_start = 0, uri_end = 0;
+    if (sscanf(headers, "%7s %n%*s%n %15s", method, &uri_start, &uri_end, version) != 2 ||
+        strncmp(version, "HTTP/1.", 7) != 0) {
+        aux.keep_alive = false;
+        httpd_resp_send_err(&req, HTTPD_400_BAD_REQUEST, NULL);
+        return false;
+    }
+    aux.keep_alive = strcmp(version, "HTTP/1.1") == 0 ? !header_has(headers, "Connection", "close")
+                                                      : header_has(headers, "Connection", "keep-alive");
+
+    req.method = -1;
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strcmp(method, methods[i].name) == 0) {
+            req.method = methods[i].method;
+        }
+    }
+    if (req.method < 0) {
+        aux.keep_alive = false;
+        httpd_resp_send_err(&req, HTTPD_501_METHOD_NOT_IMPLEMENTED, NULL);
+        return false;
+    }
+    if (uri_end - uri_start > HTTPD_MAX_URI_LEN) {
+        aux.keep_alive = false;
+        httpd_resp_send_err(&req, HTTPD_414_URI_TOO_LONG, NULL);
+        return false;
+    }
+    memcpy(req.uri, headers + uri_start, uri_end - uri_start);
+    req.uri[uri_end - uri_start] = '\0';
+
+    const char *length = header_value(headers, "Content-Length");
+    req.content_len = length ? strtoul(length, NULL, 10) : 0;
+    aux.remaining = req.content_len;
+
+    // Handler for the path without the query
+    size_t path_len = strcspn(req.uri, "?");
+    const httpd_uri_t *handler = NULL;
+    bool uri_known = false;
+    for (size_t i = 0; !handler && i < server->handler_count; i++) {
+        const httpd_uri_t *h = &server->handlers[i];
+        if (uri_matches(server, h, req.uri, path_len)) {
+            uri_known = true;
+            if ((int)h->method == req.method) {
+                handler = h;
+            }
+        }
+    }
+
+    esp_err_t ret;
+    if (!handler) {
+        ret = httpd_resp_send_err(&req, uri_known ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+    } else if (handler->is_websocket) {
+        ret = ws_handshake(&req, headers);
+        if (ret == ESP_ERR_HTTPD_INVALID_REQ) {
+            aux.keep_alive = false;
+            httpd_resp_send_err(&req, HTTPD_400_BAD_REQUEST, NULL);
+            return false;
+        }
+        if (ret == ESP_OK) {
+            s->ws = handler;
+            req.user_ctx = handler->user_ctx;
+            ret = handler->handler(&req);
+        }
+        return ret == ESP_OK;
+    } else {
+        req.user_ctx = handler->user_ctx;
+        ret = handler->handler(&req);
+    }
+
+    // Skip what the handler left of the body, unless a detached request
+    // still owns the socket
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    bool detached = s->detached;
+    xSemaphoreGive(server->lock);
+    if (ret == ESP_OK && !detached && aux.remaining > 0) {
+        ret = session_discard(s, aux.remaining);
+    }
+    return ret == ESP_OK && (aux.keep_alive || detached);
+}
+
+static esp_err_t ws_send_frame(int fd, httpd_ws_type_t type, const uint8_t *payload, size_t len)
+{
+    uint8_t header[2] = { 0x80 | type, len };
+    esp_err_t ret = send_all(fd, header, sizeof(header));
+    return ret == ESP_OK && len > 0 ? send_all(fd, payload, len) : ret;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    if (!req || !pkt) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    req_aux_t *aux = req->aux;
+    if (!aux->ws_frame) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // With max_len 0 only the frame's type and length
+    pkt->type = aux->ws_type;
+    pkt->final = aux->ws_final;
+    pkt->fragmented = !aux->ws_final || aux->ws_type == HTTPD_WS_TYPE_CONTINUE;
+    if (max_len == 0) {
+        pkt->len = aux->ws_len - aux->ws_read;
+        return ESP_OK;
+    }
+    if (!pkt->payload) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t n = aux->ws_len - aux->ws_read;
+    if (n > max_len) {
+        n = max_len;
+    }
+    esp_err_t ret = session_recv_all(aux->session, pkt->payload, n);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    for (size_t i = 0; i < n; i++) {
+        pkt->payload[i] ^= aux->ws_mask[(aux->ws_read + i) & 3];
+    }
+    aux->ws_read += n;
+    pkt->len = n;
+    return ESP_OK;
+}
+
+// Read one frame header from a WebSocket session and pass the frame to its
+// handler; false if the session is to be closed
+static bool serve_ws_frame(server_t *server, session_t *s)
+{
+    httpd_req_t req;
+    req_aux_t aux;
+    req_init(&req, &aux, server, s);
+    req.method = 0;
+    req.user_ctx = s->ws->user_ctx;
+    strlcpy(req.uri, s->ws->uri, sizeof(req.uri));
+
+    uint8_t header[8];
+    if (session_recv_all(s, header, 2) != ESP_OK) {
+        return false;
+    }
+    aux.ws_frame = true;
+    aux.ws_final = header[0] & 0x80;
+    aux.ws_type = header[0] & 0x0F;
+    aux.ws_len = header[1] & 0x7F;
+
+    // Client frames are always masked
+    if (!(header[1] & 0x80)) {
+        return false;
+    }
+    if (aux.ws_len == 126) {
+        if (session_recv_all(s, header, 2) != ESP_OK) {
+            return false;
+        }
+        aux.ws_len = (header[0] << 8) | header[1];
+    } else if (aux.ws_len == 127) {
+        if (session_recv_all(s, header, 8) != ESP_OK) {
+            return false;
+        }
+        aux.ws_len = 0;
+        for (int i = 0; i < 8; i++) {
+            aux.ws_len = (aux.ws_len << 8) | header[i];
+        }
+    }
+    if (session_recv_all(s, aux.ws_mask, 4) != ESP_OK) {
+        return false;
+    }
+
+    bool control = aux.ws_type & 0x8;
+    if (control && aux.ws_len > WS_CONTROL_MAX) {
+        return false;
+    }
+
+    if (control && !s->ws->handle_ws_control_frames) {
+        uint8_t payload[WS_CONTROL_MAX];
+        httpd_ws_frame_t frame = { .payload = payload };
+        if (httpd_ws_recv_frame(&req, &frame, sizeof(payload)) != ESP_OK) {
+            return false;
+        }
+        if (aux.ws_type == HTTPD_WS_TYPE_PING) {
+            return ws_send_frame(s->fd, HTTPD_WS_TYPE_PONG, payload, frame.len) == ESP_OK;
+        }
+        if (aux.ws_type == HTTPD_WS_TYPE_CLOSE) {
+            ws_send_frame(s->fd, HTTPD_WS_TYPE_CLOSE, NULL, 0);
+            return false;
+        }
+        return true;
+    }
+
+    if (s->ws->handler(&req) != ESP_OK) {
+        return false;
+    }
+    return session_discard(s, aux.ws_len - aux.ws_read) == ESP_OK;
+}
+
+static void accept_session(server_t *server)
+{
+    int fd = accept(server->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    session_t *s = NULL;
+    xSemaphoreTake(server->lock, portMAX_DELAY);
+    for (int i = 0; !s && i < server->config.max_open_sockets; i++) {
+        if (server->sessions[i].fd < 0) {
+            s = &server->sessions[i];
+            s->fd = fd;
+            s->buf_len = 0;
+        }
+    }
+    xSemaphoreGive(server->lock);
+
+    if (!s) {
+        // Only polled for with a free slot, so not expected
+        close(fd);
+        return;
+    }
+
+    struct timeval recv_timeout = { .tv_sec = server->config.recv_wait_timeout };
+    struct timeval send_timeout = { .tv_sec = server->config.send_wait_timeout };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+}
+
+static void server_task(void *arg)
+{
+    server_t *server = arg;
+    int max = server->config.max_open_sockets;
+    session_t *ready[max];
+
+    while (!server->stop) {
+        // Carry out requested closes, then poll what is not detached
+        int nready = 0, nfds = 2;
+        bool slot_free = false;
+        server->pfds[0] = (struct pollfd){ .fd = server->wake[0], .events = POLLIN };
+
+        for (int i = 0; i < max; i++) {
+            session_t *s = &server->sessions[i];
+            xSemaphoreTake(server->lock, portMAX_DELAY);
+            int fd = s->fd;
+            bool close_pending = s->close_pending;
+            bool detached = s->detached;
+            xSemaphoreGive(server->lock);
+
+            if (fd >= 0 && close_pending) {
+                session_close(server, s);
+                fd = -1;
+            }
+            if (fd < 0) {
+                slot_free = true;
+            } else if (!detached) {
+                // Bytes already buffered (a pipelined request) need no poll
+                if (s->buf_len > 0) {
+                    ready[nready++] = s;
+                }
+                server->pfds[nfds++] = (struct pollfd){ .fd = fd, .events = POLLIN };
+            }
+        }
+        server->pfds[1] = (struct pollfd){ .fd = slot_free ? server->listen_fd : -1, .events = POLLIN };
+
+        if (poll(server->pfds, nfds, nready ? 0 : -1) < 0 && errno != EINTR) {
+            ESP_LOGE(TAG, "poll failed: %d", errno);
+            break;
+        }
+
+        if (server->pfds[0].revents) {
+            char drain[16];
+            while (read(server->wake[0], drain, sizeof(drain)) == (ssize_t)sizeof(drain)) {
+            }
+        }
+        for (int i = 2; i < nfds; i++) {
+            if (server->pfds[i].revents) {
+                session_t *s = session_find(server, server->pfds[i].fd);
+                bool listed = false;
+                for (int j = 0; j < nready; j++) {
+                    listed |= ready[j] == s;
+                }
+                if (s && !listed) {
+                    ready[nready++] = s;
+                }
+            }
+        }
+
+        for (int i = 0; i < nready; i++) {
+            session_t *s = ready[i];
+            if (s->fd < 0 || s->close_pending) {
+                continue;
+            }
+            bool keep = s->ws ? serve_ws_frame(server, s) : serve_request(server, s);
+            if (!keep) {
+                session_close(server, s);
+            }
+        }
+
+        if (server->pfds[1].revents) {
+            accept_session(server);
+        }
+    }
+
+    for (int i = 0; i < max; i++) {
+        if (server->sessions[i].fd >= 0) {
+            session_close(server, &server->sessions[i]);
+        }
+    }
+    xSemaphoreGive(server->stopped);
+    vTaskDelete(NULL);
+}
+
+static void server_free(server_t *server)
+{
+    if (server->listen_fd >= 0) {
+        close(server->listen_fd);
+    }
+    if (server->wake[0] >= 0) {
+        close(server->wake[0]);
+        close(server->wake[1]);
+    }
+    if (server->lock) {
+        vSemaphoreDelete(server->lock);
+    }
+    if (server->stopped) {
+        vSemaphoreDelete(server->stopped);
+    }
+    free(server->handlers);
+    free(server->sessions);
+    free(server->pfds);
+    free(server);
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (!handle || !config || config->max_open_sockets == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    server_t *server = calloc(1, sizeof(server_t));
+    if (!server) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    server->config = *config;
+    server->listen_fd = -1;
+    server->wake[0] = server->wake[1] = -1;
+    server->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    server->sessions = calloc(config->max_open_sockets, sizeof(session_t));
+    server->pfds = calloc(config->max_open_sockets + 2, sizeof(struct pollfd));
+    server->lock = xSemaphoreCreateMutex();
+    server->stopped = xSemaphoreCreateBinary();
+    if (!server->handlers || !server->sessions || !server->pfds || !server->lock || !server->stopped ||
+        pipe(server->wake) != 0) {
+        server_free(server);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    for (int i = 0; i < config->max_open_sockets; i++) {
+        server->sessions[i].fd = -1;
+    }
+    // Neither draining nor waking may block
+    fcntl(server->wake[0], F_SETFL, O_NONBLOCK);
+    fcntl(server->wake[1], F_SETFL, O_NONBLOCK);
+
+    // Ports below 1024 need privileges on the host
+    const char *env = getenv("HOST_HTTP_PORT");
+    uint16_t port = env ? atoi(env) : config->server_port;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+        .sin_port = htons(port),
+    };
+    int opt = 1;
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listen_fd < 0 ||
+        setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) != 0 ||
+        bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listen_fd, config->backlog_conn) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %u: %s", port, strerror(errno));
+        server_free(server);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    if (xTaskCreate(server_task, "httpd", config->stack_size, server, config->task_priority, NULL) != pdPASS) {
+        server_free(server);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    ESP_LOGI(TAG, "Listening on port %u", port);
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    server_t *server = handle;
+    if (!server) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    server->stop = true;
+    server_wake(server);
+    xSemaphoreTake(server->stopped, portMAX_DELAY);
+    server_free(server);
+    return ESP_OK;
+}
@@ -0,0 +1,136 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: esp32-camera image conversions on libjpeg
+ */
+
+#include "img_converters.h"
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// libjpeg exits the process on errors by default: return to the caller
+typedef struct {
+    struct jpeg_error_mgr mgr;
+    jmp_buf jump;
+} jpeg_error_t;
+
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+    longjmp(((jpeg_error_t *)cinfo->err)->jump, 1);
+}
+
+static void jpeg_output_message(j_common_ptr cinfo)
+{
+    (void)cinfo;
+}
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len)
+{
+    if (!fb || !out || !out_len ||
+        (fb->format != PIXFORMAT_RGB565 && fb->format != PIXFORMAT_GRAYSCALE)) {
+        return false;
+    }
+
+    bool gray = fb->format == PIXFORMAT_GRAYSCALE;
+    JSAMPLE *row = malloc(fb->width * 3);
+    if (!row) {
+        return false;
+    }
+
+    struct jpeg_compress_struct cinfo;
+    jpeg_error_t err;
+    unsigned char *buf = NULL;
+    unsigned long len = 0;
+
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpeg_error_exit;
+    err.mgr.output_message = jpeg_output_message;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        free(buf);
+        free(row);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buf, &len);
+    cinfo.image_width = fb->width;
+    cinfo.image_height = fb->height;
+    cinfo.input_components = gray ? 1 : 3;
+    cinfo.in_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const uint8_t *src = fb->buf + cinfo.next_scanline * fb->width * (gray ? 1 : 2);
+        JSAMPROW rows[1] = { gray ? (JSAMPLE *)src : row };
+        if (!gray) {
+            for (size_t x = 0; x < fb->width; x++) {
+                uint16_t pixel = (src[x * 2] << 8) | src[x * 2 + 1];
+                row[x * 3] = (pixel >> 8) & 0xF8;
+                row[x * 3 + 1] = (pixel >> 3) & 0xFC;
+                row[x * 3 + 2] = (pixel << 3) & 0xF8;
+            }
+        }
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    free(row);
+
+    // The caller frees with free(), like esp32-camera's output
+    *out = buf;
+    *out_len = len;
+    return true;
+}
+
+bool jpg2rgb565(const uint8_t *src, size_t src_len, uint8_t *out, jpg_scale_t scale)
+{
+    struct jpeg_decompress_struct cinfo;
+    jpeg_error_t err;
+    JSAMPLE *volatile row = NULL;     // Freed after a longjmp
+
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpeg_error_exit;
+    err.mgr.output_message = jpeg_output_message;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(row);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, src, src_len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 1 << scale;
+    jpeg_start_decompress(&cinfo);
+
+    row = malloc(cinfo.output_width * 3);
+    if (!row) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        uint8_t *dst = out + cinfo.output_scanline * cinfo.output_width * 2;
+        JSAMPROW rows[1] = { row };
+        jpeg_read_scanlines(&cinfo, rows, 1);
+        for (JDIMENSION x = 0; x < cinfo.output_width; x++) {
+            uint16_t pixel = ((row[x * 3] & 0xF8) << 8) | ((row[x * 3 + 1] & 0xFC) << 3) | (row[x * 3 + 2] >> 3);
+            dst[x * 2] = pixel >> 8;
+            dst[x * 2 + 1] = pixel & 0xFF;
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    free(row);
+    return true;
+}
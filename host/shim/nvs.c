@@ -0,0 +1,302 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Host build: non-volatile storage in memory
+ */
+
+#include "nvs_flash.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HANDLES 32
+
+typedef struct nvs_entry {
+    struct nvs_entry *next;
+    char namespace_name[16];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+    size_t length;
+    uint8_t *value;
+} nvs_entry_t;
+
+struct nvs_opaque_iterator_t {
+    size_t count;
+    size_t index;
+    nvs_entry_info_t info[];
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static bool initialized = false;
+static nvs_entry_t *entries = NULL;
+
+// Handle n (1-based) is slot n - 1: its namespace and whether it may write
+static struct {
+    bool open;
+    bool writable;
+    char namespace_name[16];
+} handles[MAX_HANDLES];
+
+esp_err_t nvs_flash_init(void)
+{
+    pthread_mutex_lock(&lock);
+    initialized = true;
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&lock);
+    while (entries) {
+        nvs_entry_t *e = entries;
+        entries = e->next;
+        free(e->value);
+        free(e);
+    }
+    pthread_mutex_unlock(&lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!namespace_name || strlen(namespace_name) >= sizeof(handles[0].namespace_name) || !out_handle) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&lock);
+    if (!initialized) {
+        ret = ESP_ERR_NVS_NOT_INITIALIZED;
+    } else {
+        for (int i = 0; i < MAX_HANDLES; i++) {
+            if (!handles[i].open) {
+                handles[i].open = true;
+                handles[i].writable = open_mode == NVS_READWRITE;
+                strcpy(handles[i].namespace_name, namespace_name);
+                *out_handle = i + 1;
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&lock);
+    if (handle >= 1 && handle <= MAX_HANDLES) {
+        handles[handle - 1].open = false;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+// Call with lock held
+static bool handle_valid(nvs_handle_t handle)
+{
+    return handle >= 1 && handle <= MAX_HANDLES && handles[handle - 1].open;
+}
+
+// Call with lock held
+static nvs_entry_t *entry_find(nvs_handle_t handle, const char *key)
+{
+    for (nvs_entry_t *e = entries; e; e = e->next) {
+        if (strcmp(e->namespace_name, handles[handle - 1].namespace_name) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t entry_get(nvs_handle_t handle, const char *key, nvs_type_t type, void *out, size_t *length)
+{
+    if (!key || !length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&lock);
+    const nvs_entry_t *e = handle_valid(handle) ? entry_find(handle, key) : NULL;
+    if (!handle_valid(handle)) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!e) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (e->type != type) {
+        ret = ESP_ERR_NVS_TYPE_MISMATCH;
+    } else if (!out) {
+        *length = e->length;
+    } else if (*length < e->length) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, e->value, e->length);
+        *length = e->length;
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+static esp_err_t entry_set(nvs_handle_t handle, const char *key, nvs_type_t type, const void *value, size_t length)
+{
+    if (!key || strlen(key) >= NVS_KEY_NAME_MAX_SIZE || (!value && length)) {
+        return key ? ESP_ERR_NVS_INVALID_NAME : ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t *copy = malloc(length ? length : 1);
+    if (!copy) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, length);
+
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&lock);
+    if (!handle_valid(handle)) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!handles[handle - 1].writable) {
+        ret = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        nvs_entry_t *e = entry_find(handle, key);
+        if (!e) {
+            e = calloc(1, sizeof(nvs_entry_t));
+            if (e) {
+                strcpy(e->namespace_name, handles[handle - 1].namespace_name);
+                strcpy(e->key, key);
+                e->next = entries;
+                entries = e;
+            }
+        }
+        if (e) {
+            free(e->value);
+            e->type = type;
+            e->value = copy;
+            e->length = length;
+            copy = NULL;
+        } else {
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    free(copy);
+    return ret;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return entry_get(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return entry_set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return entry_get(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return entry_set(handle, key, NVS_TYPE_STR, value, value ? strlen(value) + 1 : 0);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&lock);
+    if (!handle_valid(handle)) {
+        ret = ESP_ERR_NVS_INVALID_HANDLE;
+    } else if (!handles[handle - 1].writable) {
+        ret = ESP_ERR_NVS_READ_ONLY;
+    } else {
+        for (nvs_entry_t **p = &entries; *p; p = &(*p)->next) {
+            nvs_entry_t *e = *p;
+            if (strcmp(e->namespace_name, handles[handle - 1].namespace_name) == 0 && strcmp(e->key, key) == 0) {
+                *p = e->next;
+                free(e->value);
+                free(e);
+                ret = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return ret;
+}
+
+esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type,
+                         nvs_iterator_t *output_iterator)
+{
+    (void)part_name;
+    if (!output_iterator) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *output_iterator = NULL;
+
+    // The iterator holds a copy of the matching entries, so keys may be
+    // written or erased while it is in use
+    pthread_mutex_lock(&lock);
+    size_t count = 0;
+    for (const nvs_entry_t *e = entries; e; e = e->next) {
+        count++;
+    }
+    struct nvs_opaque_iterator_t *it = calloc(1, sizeof(struct nvs_opaque_iterator_t) +
+                                              count * sizeof(nvs_entry_info_t));
+    if (it) {
+        for (const nvs_entry_t *e = entries; e; e = e->next) {
+            if ((!namespace_name || strcmp(e->namespace_name, namespace_name) == 0) &&
+                (type == NVS_TYPE_ANY || e->type == type)) {
+                nvs_entry_info_t *info = &it->info[it->count++];
+                strcpy(info->namespace_name, e->namespace_name);
+                strcpy(info->key, e->key);
+                info->type = e->type;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (!it) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (it->count == 0) {
+        free(it);
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = it;
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    if (!iterator || !*iterator) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (++(*iterator)->index == (*iterator)->count) {
+        free(*iterator);
+        *iterator = NULL;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    if (!iterator || !out_info) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_info = iterator->info[iterator->index];
+    return ESP_OK;
+}
+
+void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    free(iterator);
+}
@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -19,10 +20,22 @@
 #include "wifi_provisioning/scheme_softap.h"
 
 #include "camera_driver.h"
+#include "frame_source.h"
 #include "ws2812_led.h"
 #include "config_store.h"
 #include "color_detect.h"
+#include "detect_profile.h"
+#include "jpeg_encoder.h"
+#include "motion_gate.h"
+#include "detection_log.h"
+#include "frame_pipeline.h"
 #include "http_server.h"
+#include "rtsp_server.h"
+#include "mqtt_publisher.h"
+#include "clip_recorder.h"
+#include "cpu_load.h"
+#include "log_sink.h"
+#include "boot_profile.h"
 
 static const char *TAG = "main";
 
@@ -30,8 +43,15 @@ static const char *TAG = "main";
 #define PROV_TRANSPORT_SOFTAP   "softap"
 #define QRCODE_BASE_URL         "https://espressif.github.io/esp-jumpstart/qrcode.html"
 
+#define LOCAL_INIT_STACK_SIZE   8192
+#define LOCAL_INIT_PRIORITY     1
+
 static EventGroupHandle_t wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
+#define LOCAL_READY_BIT    BIT1     // Camera, detector, pipeline and clip recorder running
+
+// Configuration loaded at boot, read by the local init task
+static color_config_t boot_config;
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data)
@@ -77,6 +97,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base,
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "Connected with IP Address:" IPSTR, IP2STR(&event->ip_info.ip));
+        boot_profile_end(BOOT_PHASE_WIFI_CONNECT);
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -90,11 +111,12 @@ static void get_device_service_name(char *service_name, size_t max)
              ssid_prefix, eth_mac[3], eth_mac[4], eth_mac[5]);
 }
 
-static void wifi_init_sta(void)
+// Start Wi-Fi (or provisioning) and return; WIFI_CONNECTED_BIT is set once
+// an IP is obtained
+static void wifi_start_sta(void)
 {
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    wifi_event_group = xEventGroupCreate();
 
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_PROV_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
@@ -129,6 +151,7 @@ static void wifi_init_sta(void)
 
         wifi_prov_scheme_softap_set_httpd_handle(NULL);
 
+        boot_profile_begin(BOOT_PHASE_WIFI_CONNECT);
         ESP_ERROR_CHECK(wifi_prov_mgr_start_provisioning(security, pop, service_name, service_key));
 
         ESP_LOGI(TAG, "Provisioning started with SSID: %s, POP: %s", service_name, pop);
@@ -136,52 +159,154 @@ static void wifi_init_sta(void)
         ESP_LOGI(TAG, "Already provisioned, starting Wi-Fi STA");
         wifi_prov_mgr_deinit();
         ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+        boot_profile_begin(BOOT_PHASE_WIFI_CONNECT);
         ESP_ERROR_CHECK(esp_wifi_start());
     }
+}
+
+// Camera, detector and local outputs; runs while app_main brings up Wi-Fi
+static void local_init_task(void *arg)
+{
+    // Initialize camera
+    ESP_LOGI(TAG, "Initializing camera...");
+    boot_profile_begin(BOOT_PHASE_CAMERA);
+    bool sensor_ok = camera_init() == ESP_OK;
+    ESP_ERROR_CHECK(frame_source_init(sensor_ok));
+    boot_profile_end(BOOT_PHASE_CAMERA);
+
+    // Initialize color detection
+    boot_profile_begin(BOOT_PHASE_DETECTOR);
+    ESP_ERROR_CHECK(color_detect_init(&boot_config));
+    pattern_config_t pattern;
+    if (config_load_pattern(&pattern) == ESP_OK && color_detect_set_pattern(&pattern) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored band pattern invalid, using R-G-B");
+    }
+    motion_gate_configure(boot_config.motion_threshold, boot_config.refresh_interval);
+    // Profiles are optional: detection runs with the live configuration
+    if (detect_profile_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Detection profiles not available");
+    }
+    boot_profile_end(BOOT_PHASE_DETECTOR);
+
+    // Initialize dual-core JPEG encoder
+    boot_profile_begin(BOOT_PHASE_ENCODER);
+    ESP_ERROR_CHECK(jpeg_encoder_init());
+    boot_profile_end(BOOT_PHASE_ENCODER);
+
+    boot_profile_begin(BOOT_PHASE_PIPELINE);
+    // Detection history is optional: the pipeline runs without it
+    if (detection_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Detection log not available");
+    }
+
+    // Start capture/detection pipeline
+    ESP_ERROR_CHECK(frame_pipeline_start());
+
+    clip_config_t clip_config;
+    if (config_load_clips(&clip_config) != ESP_OK) {
+        config_get_clip_defaults(&clip_config);
+    }
+    if (clip_recorder_start(&clip_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Clip recorder not available");
+    }
+    boot_profile_end(BOOT_PHASE_PIPELINE);
+
+    xEventGroupSetBits(wifi_event_group, LOCAL_READY_BIT);
+    vTaskDelete(NULL);
+}
+
+// Services that need the network and the local modules
+static void start_network_services(void)
+{
+    // Start HTTP server
+    ESP_LOGI(TAG, "Starting HTTP server...");
+    boot_profile_begin(BOOT_PHASE_HTTP);
+    ESP_ERROR_CHECK(http_server_start());
+    boot_profile_end(BOOT_PHASE_HTTP);
+
+    ESP_LOGI(TAG, "Starting RTSP server...");
+    boot_profile_begin(BOOT_PHASE_RTSP);
+    if (rtsp_server_start() != ESP_OK) {
+        ESP_LOGW(TAG, "RTSP server not available");
+    }
+    boot_profile_end(BOOT_PHASE_RTSP);
 
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT, false, true, portMAX_DELAY);
+    boot_profile_begin(BOOT_PHASE_MQTT);
+    mqtt_config_t mqtt_config;
+    if (config_load_mqtt(&mqtt_config) != ESP_OK) {
+        config_get_mqtt_defaults(&mqtt_config);
+    }
+    if (mqtt_publisher_start(&mqtt_config) != ESP_OK) {
+        ESP_LOGW(TAG, "MQTT publisher not available");
+    }
+    boot_profile_end(BOOT_PHASE_MQTT);
 }
 
 void app_main(void)
 {
+    boot_profile_mark(BOOT_PHASE_APP_MAIN);
+
+    // Buffer logs before anything else logs at length
+    if (log_sink_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Log sink unavailable, logging to the console directly");
+    }
+
     ESP_LOGI(TAG, "ESP32-S3 Camera with Color Detection");
     ESP_LOGI(TAG, "Build: %s %s", __DATE__, __TIME__);
 
     // Initialize NVS
+    boot_profile_begin(BOOT_PHASE_NVS);
     ESP_ERROR_CHECK(config_store_init());
 
     // Load or initialize configuration
-    color_config_t config;
-    esp_err_t ret = config_load(&config);
-    if (ret == ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGI(TAG, "No configuration found, using defaults");
-        config_get_defaults(&config);
-        config_save(&config);
+    esp_err_t ret = config_load(&boot_config);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "No valid configuration found, using defaults");
+        config_get_defaults(&boot_config);
+        config_save(&boot_config);
     }
+    boot_profile_end(BOOT_PHASE_NVS);
 
     // Initialize WS2812B LED
+    boot_profile_begin(BOOT_PHASE_LED);
     ESP_ERROR_CHECK(ws2812_init());
-    ws2812_set_detection_status(false);
+    boot_profile_end(BOOT_PHASE_LED);
 
-    // Initialize camera
-    ESP_LOGI(TAG, "Initializing camera...");
-    ESP_ERROR_CHECK(camera_init());
-
-    // Initialize color detection
-    ESP_ERROR_CHECK(color_detect_init(&config));
+    // Camera, detection and the LED come up without waiting for Wi-Fi
+    wifi_event_group = xEventGroupCreate();
+    if (!wifi_event_group ||
+        xTaskCreate(local_init_task, "local_init", LOCAL_INIT_STACK_SIZE, NULL,
+                    LOCAL_INIT_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create local init task");
+        abort();
+    }
 
     // Initialize Wi-Fi and provisioning
     ESP_LOGI(TAG, "Starting Wi-Fi provisioning...");
-    wifi_init_sta();
+    boot_profile_begin(BOOT_PHASE_WIFI_INIT);
+    wifi_start_sta();
+    boot_profile_end(BOOT_PHASE_WIFI_INIT);
 
-    // Start HTTP server
-    ESP_LOGI(TAG, "Starting HTTP server...");
-    ESP_ERROR_CHECK(http_server_start());
-
-    ESP_LOGI(TAG, "System ready! Access web UI at http://<device-ip>/");
+    if (cpu_load_init() != ESP_OK) {
+        ESP_LOGW(TAG, "CPU load statistics not available");
+    }
 
-    // Main loop
+    // Main loop: start the network services once an IP is obtained and the
+    // local modules they serve are up, and sample CPU load once a second
+    bool network_started = false;
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        if (!network_started) {
+            EventBits_t bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT | LOCAL_READY_BIT,
+                                                   false, true, pdMS_TO_TICKS(1000));
+            if ((bits & (WIFI_CONNECTED_BIT | LOCAL_READY_BIT)) == (WIFI_CONNECTED_BIT | LOCAL_READY_BIT)) {
+                start_network_services();
+                network_started = true;
+                ESP_LOGI(TAG, "System ready! Access web UI at http://<device-ip>/");
+                boot_profile_log();
+            }
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+        cpu_load_sample();
     }
 }
@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Per-class integral images and sliding-window band scorer
+ */
+
+#include "band_window.h"
+#include "esp_heap_caps.h"
+#include <sys/param.h>
+#include <string.h>
+#include <math.h>
+
+#define SEARCH_OFFSET       2       // Cells the window may move from the expected center
+#define PITCH_MIN_PCT       60      // Band widths tried, relative to the centroid pitch
+#define PITCH_MAX_PCT       140
+#define CROSS_MAX_RATIO     2       // Tag extent across the bands, relative to its length
+
+static bool grow(void **buf, size_t *size, size_t needed)
+{
+    if (*size >= needed) {
+        return true;
+    }
+    heap_caps_free(*buf);
+    *buf = heap_caps_malloc(needed, MALLOC_CAP_SPIRAM);
+    *size = *buf ? needed : 0;
+    return *buf != NULL;
+}
+
+esp_err_t class_grid_prepare(class_grid_t *grid, uint16_t width, uint16_t height, uint8_t classes)
+{
+    uint16_t cols = (width + BAND_WINDOW_CELL - 1) >> BAND_WINDOW_CELL_SHIFT;
+    uint16_t rows = (height + BAND_WINDOW_CELL - 1) >> BAND_WINDOW_CELL_SHIFT;
+    size_t counts_size = (size_t)classes * cols * rows;
+    size_t sums_size = (size_t)(classes + 1) * (cols + 1) * (rows + 1) * sizeof(uint32_t);
+
+    if (!grow((void **)&grid->counts, &grid->counts_size, counts_size) ||
+        !grow((void **)&grid->sums, &grid->sums_size, sums_size)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    grid->cols = cols;
+    grid->rows = rows;
+    grid->classes = classes;
+    memset(grid->counts, 0, counts_size);
+    return ESP_OK;
+}
+
+void class_grid_integrate(class_grid_t *grid)
+{
+    int stride = grid->cols + 1;
+    size_t plane_size = (size_t)stride * (grid->rows + 1);
+    uint32_t *total = grid->sums + grid->classes * plane_size;
+
+    memset(total, 0, plane_size * sizeof(uint32_t));
+    for (int c = 0; c < grid->classes; c++) {
+        const uint8_t *counts = grid->counts + (size_t)c * grid->cols * grid->rows;
+        uint32_t *s = grid->sums + c * plane_size;
+
+        memset(s, 0, stride * sizeof(uint32_t));
+        for (int r = 0; r < grid->rows; r++) {
+            uint32_t *above = s + r * stride;
+            uint32_t *row = above + stride;
+            uint32_t run = 0;
+            row[0] = 0;
+            for (int col = 0; col < grid->cols; col++) {
+                run += counts[r * grid->cols + col];
+                row[col + 1] = above[col + 1] + run;
+            }
+        }
+
+        // Summed-area tables add up, so the all-classes plane is their sum
+        for (size_t i = 0; i < plane_size; i++) {
+            total[i] += s[i];
+        }
+    }
+}
+
+void class_grid_free(class_grid_t *grid)
+{
+    heap_caps_free(grid->counts);
+    heap_caps_free(grid->sums);
+    memset(grid, 0, sizeof(class_grid_t));
+}
+
+// Rectangle sum with coordinates along and across the band axis
+static inline uint32_t band_sum(const class_grid_t *grid, bool vertical, int plane,
+                                int a0, int c0, int a1, int c1)
+{
+    return vertical ? class_grid_sum(grid, plane, c0, a0, c1, a1)
+                    : class_grid_sum(grid, plane, a0, c0, a1, c1);
+}
+
+bool band_window_search(const class_grid_t *grid, const band_sequence_t *seq, bool vertical,
+                        float cx, float cy, float pitch, band_window_t *window)
+{
+    int len = seq->length;
+    int along_cells = vertical ? grid->rows : grid->cols;
+    int cross_cells = vertical ? grid->cols : grid->rows;
+    float center_along = (vertical ? cy : cx) / BAND_WINDOW_CELL;
+    float center_cross = (vertical ? cx : cy) / BAND_WINDOW_CELL;
+    float pitch_cells = pitch / BAND_WINDOW_CELL;
+    int bw_min = MAX(1, (int)(pitch_cells * PITCH_MIN_PCT / 100));
+    int bw_max = MAX(bw_min, (int)ceilf(pitch_cells * PITCH_MAX_PCT / 100));
+    int bh_max = MIN(cross_cells, CROSS_MAX_RATIO * len * bw_max);
+
+    int64_t best = 0;
+    int best_a = 0, best_c = 0, best_bw = 0, best_bh = 0;
+    memset(window, 0, sizeof(band_window_t));
+
+    for (int bw = bw_min; bw <= bw_max && bw * len <= along_cells; bw++) {
+        for (int bh = 1; bh <= bh_max; bh++) {
+            int64_t area = (int64_t)bw * bh * BAND_WINDOW_CELL * BAND_WINDOW_CELL;
+            int a_base = lroundf(center_along - bw * len / 2.0f);
+            int c_base = lroundf(center_cross - bh / 2.0f);
+
+            for (int da = -SEARCH_OFFSET; da <= SEARCH_OFFSET; da++) {
+                int a0 = a_base + da;
+                if (a0 < 0 || a0 + bw * len > along_cells) {
+                    continue;
+                }
+                for (int dc = -SEARCH_OFFSET; dc <= SEARCH_OFFSET; dc++) {
+                    int c0 = c_base + dc;
+                    if (c0 < 0 || c0 + bh > cross_cells) {
+                        continue;
+                    }
+
+                    // Matching pixels count once for the window, empty and
+                    // other-class pixels once against it
+                    int64_t score = 0;
+                    for (int b = 0; b < len; b++) {
+                        int a = a0 + b * bw;
+                        int64_t match = band_sum(grid, vertical, seq->classes[b], a, c0, a + bw, c0 + bh);
+                        int64_t all = band_sum(grid, vertical, grid->classes, a, c0, a + bw, c0 + bh);
+                        score += 2 * match - area - (all - match);
+                    }
+                    window->windows++;
+
+                    if (score > best) {
+                        best = score;
+                        best_a = a0;
+                        best_c = c0;
+                        best_bw = bw;
+                        best_bh = bh;
+                    }
+                }
+            }
+        }
+    }
+
+    if (best <= 0) {
+        return false;
+    }
+
+    // Fill and purity of the weakest band of the best window
+    uint32_t area = best_bw * best_bh * BAND_WINDOW_CELL * BAND_WINDOW_CELL;
+    window->fill = 100;
+    window->purity = 100;
+    for (int b = 0; b < len; b++) {
+        int a = best_a + b * best_bw;
+        uint32_t match = band_sum(grid, vertical, seq->classes[b], a, best_c, a + best_bw, best_c + best_bh);
+        uint32_t all = band_sum(grid, vertical, grid->classes, a, best_c, a + best_bw, best_c + best_bh);
+        window->fill = MIN(window->fill, match * 100 / area);
+        if (all > 0) {
+            window->purity = MIN(window->purity, match * 100 / all);
+        }
+    }
+
+    uint16_t along0 = best_a * BAND_WINDOW_CELL, along_len = best_bw * len * BAND_WINDOW_CELL;
+    uint16_t cross0 = best_c * BAND_WINDOW_CELL, cross_len = best_bh * BAND_WINDOW_CELL;
+    window->x = vertical ? cross0 : along0;
+    window->y = vertical ? along0 : cross0;
+    window->w = vertical ? cross_len : along_len;
+    window->h = vertical ? along_len : cross_len;
+    return true;
+}
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Per-class integral images and sliding-window band scorer
+ */
+
+#ifndef BAND_WINDOW_H
+#define BAND_WINDOW_H
+
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Grid cells are 8x8 pixels (80x60 cells at VGA)
+#define BAND_WINDOW_CELL_SHIFT  3
+#define BAND_WINDOW_CELL        (1 << BAND_WINDOW_CELL_SHIFT)
+
+// Class pixel counts per cell, filled by the classify loop, and their
+// summed-area tables. Plane c holds class c; the extra plane after the last
+// class holds all classes together.
+typedef struct {
+    uint8_t *counts;        // [class][row][col], 0..64
+    uint32_t *sums;         // [plane][row + 1][col + 1]
+    uint16_t cols;
+    uint16_t rows;
+    uint8_t classes;
+    size_t counts_size;     // Allocated bytes
+    size_t sums_size;
+} class_grid_t;
+
+// Best window found for a band sequence
+typedef struct {
+    uint16_t x;             // Window in pixels
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint8_t fill;           // Share of the emptiest band covered by its class (0-100)
+    uint8_t purity;         // Share of the least pure band's classified pixels in its class (0-100)
+    uint32_t windows;       // Candidate windows scored
+} band_window_t;
+
+/**
+ * @brief Size the grid for a frame and clear its counts
+ *
+ * Buffers live in PSRAM and only grow.
+ *
+ * @param grid Grid
+ * @param width Frame width
+ * @param height Frame height
+ * @param classes Number of color classes
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the buffers cannot be allocated
+ */
+esp_err_t class_grid_prepare(class_grid_t *grid, uint16_t width, uint16_t height, uint8_t classes);
+
+/**
+ * @brief Build the summed-area tables from the cell counts
+ *
+ * @param grid Grid whose counts are complete
+ */
+void class_grid_integrate(class_grid_t *grid);
+
+/**
+ * @brief Release the buffers of a grid
+ *
+ * @param grid Grid
+ */
+void class_grid_free(class_grid_t *grid);
+
+/**
+ * @brief Count the pixels of a plane in a rectangle of cells
+ *
+ * @param grid Integrated grid
+ * @param plane Class index, or grid->classes for all classes
+ * @param col0 First column
+ * @param row0 First row
+ * @param col1 Column past the last one
+ * @param row1 Row past the last one
+ * @return Pixel count
+ */
+static inline uint32_t class_grid_sum(const class_grid_t *grid, int plane,
+                                      int col0, int row0, int col1, int row1)
+{
+    int stride = grid->cols + 1;
+    const uint32_t *s = grid->sums + (size_t)plane * stride * (grid->rows + 1);
+    return s[row1 * stride + col1] - s[row0 * stride + col1] -
+           s[row1 * stride + col0] + s[row0 * stride + col0];
+}
+
+/**
+ * @brief Find the window that best fits a band sequence
+ *
+ * Slides equal-width, adjacent band rectangles around the expected tag
+ * position and size. Each window is scored from four lookups per band and
+ * plane: matching pixels count for it, empty and other-class pixels
+ * against it.
+ *
+ * @param grid Integrated grid
+ * @param seq Band sequence
+ * @param vertical Bands follow each other top to bottom
+ * @param cx Expected tag center X in pixels (mean of the band centroids)
+ * @param cy Expected tag center Y in pixels
+ * @param pitch Expected distance between band centers in pixels
+ * @param window Best window found
+ * @return true if a window covers more matching pixels than it misses
+ */
+bool band_window_search(const class_grid_t *grid, const band_sequence_t *seq, bool vertical,
+                        float cx, float cy, float pitch, band_window_t *window);
+
+#endif // BAND_WINDOW_H
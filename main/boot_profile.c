@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Boot profile implementation
+ */
+
+#include "boot_profile.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "boot";
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_APP_MAIN] = "app_main",
+    [BOOT_PHASE_NVS] = "nvs",
+    [BOOT_PHASE_LED] = "led",
+    [BOOT_PHASE_CAMERA] = "camera",
+    [BOOT_PHASE_DETECTOR] = "detector",
+    [BOOT_PHASE_ENCODER] = "encoder",
+    [BOOT_PHASE_PIPELINE] = "pipeline",
+    [BOOT_PHASE_WIFI_INIT] = "wifi_init",
+    [BOOT_PHASE_WIFI_CONNECT] = "wifi_connect",
+    [BOOT_PHASE_HTTP] = "http",
+    [BOOT_PHASE_RTSP] = "rtsp",
+    [BOOT_PHASE_MQTT] = "mqtt",
+    [BOOT_PHASE_FIRST_FRAME] = "first_frame",
+    [BOOT_PHASE_FIRST_SCAN] = "first_scan",
+    [BOOT_PHASE_FIRST_DETECTION] = "first_detection",
+};
+
+// 64-bit timestamps are not written atomically on this core
+static portMUX_TYPE phase_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t start_us[BOOT_PHASE_COUNT];
+static int64_t end_us[BOOT_PHASE_COUNT];
+static bool marked[BOOT_PHASE_COUNT];
+
+void boot_profile_begin(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&phase_lock);
+    start_us[phase] = now;
+    end_us[phase] = 0;
+    taskEXIT_CRITICAL(&phase_lock);
+}
+
+void boot_profile_end(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&phase_lock);
+    if (start_us[phase] && !end_us[phase]) {
+        end_us[phase] = now;
+    }
+    taskEXIT_CRITICAL(&phase_lock);
+}
+
+void boot_profile_mark(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT || __atomic_load_n(&marked[phase], __ATOMIC_RELAXED)) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&phase_lock);
+    if (!marked[phase]) {
+        start_us[phase] = now;
+        end_us[phase] = now;
+        marked[phase] = true;
+    }
+    taskEXIT_CRITICAL(&phase_lock);
+}
+
+void boot_profile_get(boot_phase_t phase, boot_phase_info_t *info)
+{
+    if (phase >= BOOT_PHASE_COUNT || !info) {
+        return;
+    }
+    info->name = phase_names[phase];
+    taskENTER_CRITICAL(&phase_lock);
+    info->start_us = start_us[phase];
+    info->end_us = end_us[phase];
+    taskEXIT_CRITICAL(&phase_lock);
+}
+
+void boot_profile_log(void)
+{
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        boot_phase_info_t info;
+        boot_profile_get(i, &info);
+        if (!info.start_us) {
+            continue;
+        }
+        if (!info.end_us) {
+            ESP_LOGI(TAG, "%-16s %7lld ms  running", info.name, (long long)(info.start_us / 1000));
+        } else if (info.end_us == info.start_us) {
+            ESP_LOGI(TAG, "%-16s %7lld ms", info.name, (long long)(info.start_us / 1000));
+        } else {
+            ESP_LOGI(TAG, "%-16s %7lld ms  +%lld ms", info.name, (long long)(info.start_us / 1000),
+                     (long long)((info.end_us - info.start_us) / 1000));
+        }
+    }
+}
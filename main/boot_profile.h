@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Boot phase timestamps for startup profiling
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Boot phases and milestones, in the order they are reported
+typedef enum {
+    BOOT_PHASE_APP_MAIN = 0,    // app_main entered (milestone)
+    BOOT_PHASE_NVS,
+    BOOT_PHASE_LED,
+    BOOT_PHASE_CAMERA,          // Sensor probe and frame source
+    BOOT_PHASE_DETECTOR,
+    BOOT_PHASE_ENCODER,
+    BOOT_PHASE_PIPELINE,        // Detection log, pipeline and clip recorder
+    BOOT_PHASE_WIFI_INIT,       // Netif, driver and provisioning manager
+    BOOT_PHASE_WIFI_CONNECT,    // Wi-Fi started until an IP is obtained
+    BOOT_PHASE_HTTP,
+    BOOT_PHASE_RTSP,
+    BOOT_PHASE_MQTT,
+    BOOT_PHASE_FIRST_FRAME,     // First frame captured (milestone)
+    BOOT_PHASE_FIRST_SCAN,      // First detection pass completed (milestone)
+    BOOT_PHASE_FIRST_DETECTION, // First frame with the bands detected (milestone)
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+
+typedef struct {
+    const char *name;
+    int64_t start_us;           // esp_timer time, 0 if not started
+    int64_t end_us;             // esp_timer time, 0 if not finished
+} boot_phase_info_t;
+
+/**
+ * @brief Mark the start of a phase
+ *
+ * Phases may overlap; each one is begun and ended by a single task.
+ *
+ * @param phase Boot phase
+ */
+void boot_profile_begin(boot_phase_t phase);
+
+/**
+ * @brief Mark the end of a phase
+ *
+ * Only the first end after boot_profile_begin() counts (a reconnect does
+ * not move the end of wifi_connect).
+ *
+ * @param phase Boot phase
+ */
+void boot_profile_end(boot_phase_t phase);
+
+/**
+ * @brief Record a milestone (start and end at the same time)
+ *
+ * Only the first call per milestone counts; later calls return after one
+ * load, so it can sit on the per-frame path.
+ *
+ * @param phase Boot phase
+ */
+void boot_profile_mark(boot_phase_t phase);
+
+/**
+ * @brief Get a phase's name and timestamps
+ *
+ * @param phase Boot phase
+ * @param info Pointer to structure to fill
+ */
+void boot_profile_get(boot_phase_t phase, boot_phase_info_t *info);
+
+/**
+ * @brief Log the phases recorded so far
+ */
+void boot_profile_log(void);
+
+#endif // BOOT_PROFILE_H
@@ -5,6 +5,7 @@
  */
 
 #include "camera_driver.h"
+#include "frame_source.h"
 #include "pin_config.h"
 #include "esp_log.h"
 #include <string.h>
@@ -67,12 +68,10 @@ esp_err_t camera_init(void)
 
 camera_fb_t* camera_get_fb(void)
 {
-    return esp_camera_fb_get();
+    return frame_source_get();
 }
 
 void camera_return_fb(camera_fb_t* fb)
 {
-    if (fb) {
-        esp_camera_fb_return(fb);
-    }
+    frame_source_return(fb);
 }
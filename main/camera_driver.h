@@ -18,14 +18,16 @@
 esp_err_t camera_init(void);
 
 /**
- * @brief Get a frame buffer from the camera
+ * @brief Get a frame buffer from the active frame source
+ * 
+ * The sensor by default; see frame_source.h for replay and synthetic frames.
  * 
  * @return Pointer to camera frame buffer or NULL on error
  */
 camera_fb_t* camera_get_fb(void);
 
 /**
- * @brief Return a frame buffer to the camera driver
+ * @brief Return a frame buffer to its frame source
  * 
  * @param fb Frame buffer to return
  */
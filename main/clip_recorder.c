@@ -0,0 +1,636 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Clip recorder implementation
+ */
+
+#include "clip_recorder.h"
+#include "frame_pipeline.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "clip_recorder";
+
+#define RECORDER_STACK_SIZE 4096
+#define RECORDER_PRIORITY   3
+#define FLUSH_STACK_SIZE    4096
+#define FLUSH_PRIORITY      1
+#define POLL_MS             10
+
+#define RING_ENTRIES        512         // Frame index entries per arena (power of two)
+#define FLASH_SECTOR        4096
+#define FLASH_BLOCK         65536
+#define CLIP_MAGIC          0x50494C43  // "CLIP"
+
+// Frame stored in an arena
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+    int64_t timestamp_us;
+} ring_frame_t;
+
+// Circular arena of variable-size frames. Frames are laid out in sequence
+// order, so the oldest frame is always the next one after the write position
+// and making room only ever evicts from the front.
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t write_pos;
+    uint32_t first;                 // Sequence of the oldest frame kept
+    uint32_t next;                  // Sequence of the next frame
+    ring_frame_t frames[RING_ENTRIES];
+} frame_ring_t;
+
+typedef struct {
+    uint32_t id;                    // 0 for an unused slot
+    int64_t trigger_us;
+    uint32_t first;                 // Store sequence of the first frame
+    uint32_t count;
+    uint32_t bytes;
+    bool flushed;
+} clip_t;
+
+// Flash layout: every clip starts on a sector boundary with this header,
+// followed by a flash_frame_header_t and the JPEG data of each frame. The
+// magic is written last, so a clip interrupted by a reset has none.
+typedef struct {
+    uint32_t magic;
+    uint32_t id;
+    uint32_t frames;
+    uint32_t bytes;                 // Bytes following the header
+    int64_t trigger_us;
+    uint32_t reserved[2];
+} flash_clip_header_t;
+
+typedef struct {
+    uint32_t len;
+    uint32_t reserved;
+    int64_t timestamp_us;
+} flash_frame_header_t;
+
+static frame_ring_t *rolling = NULL;        // Recorder task only
+static frame_ring_t *store = NULL;          // Written by the recorder task, guarded by store_mutex
+static clip_t clips[CLIP_RECORDER_MAX_CLIPS];
+static uint32_t last_clip_id = 0;
+static SemaphoreHandle_t store_mutex = NULL;
+
+static QueueHandle_t flush_queue = NULL;
+static const esp_partition_t *partition = NULL;
+static uint8_t *flush_chunk = NULL;         // Internal RAM staging buffer, one sector
+static size_t flash_pos = 0;                // Next free byte in the partition
+static size_t flash_erased = 0;             // Sectors below this offset are erased
+
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+static clip_config_t current;
+static int64_t trigger_us = 0;              // Detection waiting to be picked up
+static bool last_detected = false;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static clip_recorder_stats_t stats;
+
+static inline ring_frame_t *ring_frame(frame_ring_t *r, uint32_t seq)
+{
+    return &r->frames[seq & (RING_ENTRIES - 1)];
+}
+
+static size_t ring_used(frame_ring_t *r)
+{
+    if (r->first == r->next) {
+        return 0;
+    }
+    size_t start = ring_frame(r, r->first)->offset;
+    return start < r->write_pos ? r->write_pos - start : r->size - start + r->write_pos;
+}
+
+// Reserve space for a frame, evicting the oldest frames as needed
+static ring_frame_t *ring_alloc(frame_ring_t *r, size_t len, int64_t timestamp_us)
+{
+    size_t need = (len + 3) & ~3;
+    if (need > r->size) {
+        return NULL;
+    }
+
+    if (r->write_pos + need > r->size) {
+        // Frames between the write position and the end are the oldest ones
+        while (r->first != r->next && ring_frame(r, r->first)->offset >= r->write_pos) {
+            r->first++;
+        }
+        r->write_pos = 0;
+    }
+
+    while (r->first != r->next) {
+        ring_frame_t *f = ring_frame(r, r->first);
+        bool overlaps = f->offset < r->write_pos + need && f->offset + f->len > r->write_pos;
+        if (!overlaps && r->next - r->first < RING_ENTRIES) {
+            break;
+        }
+        r->first++;
+    }
+
+    ring_frame_t *f = ring_frame(r, r->next++);
+    f->offset = r->write_pos;
+    f->len = len;
+    f->timestamp_us = timestamp_us;
+    r->write_pos += need;
+    return f;
+}
+
+static frame_ring_t *ring_create(size_t size)
+{
+    frame_ring_t *r = heap_caps_calloc(1, sizeof(frame_ring_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!r) {
+        return NULL;
+    }
+    r->data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!r->data) {
+        free(r);
+        return NULL;
+    }
+    r->size = size;
+    return r;
+}
+
+// Clip with this id whose frames are all still in the store (store_mutex held)
+static clip_t *clip_find(uint32_t id)
+{
+    clip_t *c = &clips[id % CLIP_RECORDER_MAX_CLIPS];
+    if (id == 0 || c->id != id || c->count == 0 || (int32_t)(c->first - store->first) < 0) {
+        return NULL;
+    }
+    return c;
+}
+
+// Copy the frames around a trigger from the rolling arena into the store
+static void freeze(int64_t trigger, const clip_config_t *config)
+{
+    int64_t start = trigger - config->pre_trigger_s * 1000000LL;
+    int64_t end = trigger + config->post_trigger_s * 1000000LL;
+
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    uint32_t id = ++last_clip_id;
+    clip_t *clip = &clips[id % CLIP_RECORDER_MAX_CLIPS];
+    memset(clip, 0, sizeof(*clip));
+    clip->trigger_us = trigger;
+    clip->first = store->next;
+
+    for (uint32_t seq = rolling->first; seq != rolling->next; seq++) {
+        ring_frame_t *src = ring_frame(rolling, seq);
+        if (src->timestamp_us < start || src->timestamp_us > end) {
+            continue;
+        }
+        ring_frame_t *dst = ring_alloc(store, src->len, src->timestamp_us);
+        if (!dst) {
+            break;
+        }
+        memcpy(store->data + dst->offset, rolling->data + src->offset, src->len);
+        clip->count++;
+        clip->bytes += src->len;
+    }
+    clip->id = id;
+    uint32_t count = clip->count, bytes = clip->bytes;
+    xSemaphoreGive(store_mutex);
+
+    ESP_LOGI(TAG, "Clip %lu: %lu frames, %lu bytes", (unsigned long)id,
+             (unsigned long)count, (unsigned long)bytes);
+
+    taskENTER_CRITICAL(&stats_lock);
+    stats.clips_recorded++;
+    taskEXIT_CRITICAL(&stats_lock);
+
+    if (config->flush && partition && count > 0) {
+        xQueueSend(flush_queue, &id, 0);
+    }
+}
+
+static void update_stats(bool enabled)
+{
+    size_t rolling_used = ring_used(rolling);
+    uint32_t rolling_frames = rolling->next - rolling->first;
+    uint32_t rolling_ms = 0;
+    if (rolling_frames > 1) {
+        rolling_ms = (ring_frame(rolling, rolling->next - 1)->timestamp_us -
+                      ring_frame(rolling, rolling->first)->timestamp_us) / 1000;
+    }
+    size_t store_used = ring_used(store);
+
+    taskENTER_CRITICAL(&stats_lock);
+    stats.enabled = enabled;
+    stats.rolling_used = rolling_used;
+    stats.rolling_frames = rolling_frames;
+    stats.rolling_ms = rolling_ms;
+    stats.store_used = store_used;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+static void recorder_task(void *arg)
+{
+    bool consuming = false;
+    uint32_t seq = 0;
+    int64_t last_timestamp = 0;
+    int64_t pending = 0;            // Trigger waiting for its post-trigger frames
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+
+        clip_config_t config;
+        taskENTER_CRITICAL(&config_lock);
+        config = current;
+        int64_t trigger = trigger_us;
+        trigger_us = 0;
+        taskEXIT_CRITICAL(&config_lock);
+
+        if (config.enabled != consuming) {
+            if (config.enabled) {
+                frame_pipeline_add_consumer(PIPELINE_VIEW_COLOR);
+            } else {
+                frame_pipeline_remove_consumer(PIPELINE_VIEW_COLOR);
+            }
+            consuming = config.enabled;
+            pending = 0;
+        }
+        if (!consuming) {
+            update_stats(false);
+            continue;
+        }
+
+        pipeline_frame_t *frame = frame_pipeline_acquire(PIPELINE_VIEW_COLOR, &seq);
+        if (frame) {
+            // Frames repeated while the scene is static are already buffered
+            if (frame->timestamp_us != last_timestamp) {
+                ring_frame_t *f = ring_alloc(rolling, frame->jpeg_len, frame->timestamp_us);
+                if (f) {
+                    memcpy(rolling->data + f->offset, frame->jpeg, frame->jpeg_len);
+                }
+                taskENTER_CRITICAL(&stats_lock);
+                if (f) {
+                    stats.frames_recorded++;
+                } else {
+                    stats.frames_skipped++;
+                }
+                taskEXIT_CRITICAL(&stats_lock);
+                last_timestamp = frame->timestamp_us;
+            }
+            frame_pipeline_release(frame);
+        }
+
+        if (trigger && !pending) {
+            pending = trigger;
+        }
+        if (pending && esp_timer_get_time() >= pending + config.post_trigger_s * 1000000LL) {
+            freeze(pending, &config);
+            pending = 0;
+        }
+
+        update_stats(true);
+    }
+}
+
+// Write the staging buffer at pos, erasing ahead in whole blocks where possible
+static esp_err_t flash_write_chunk(size_t pos)
+{
+    if (flash_erased < pos) {
+        flash_erased = pos;
+    }
+    while (flash_erased < pos + FLASH_SECTOR) {
+        size_t len = FLASH_SECTOR;
+        if (flash_erased % FLASH_BLOCK == 0 && flash_erased + FLASH_BLOCK <= partition->size) {
+            len = FLASH_BLOCK;
+        }
+        esp_err_t ret = esp_partition_erase_range(partition, flash_erased, len);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        flash_erased += len;
+    }
+
+    esp_err_t ret = esp_partition_write(partition, pos, flush_chunk, FLASH_SECTOR);
+
+    // Bound the write rate so flushing never saturates the flash/PSRAM bus
+    vTaskDelay(pdMS_TO_TICKS(FLASH_SECTOR * 1000 / (CLIP_FLUSH_MAX_KBPS * 1024)));
+    return ret;
+}
+
+// Sequential writer through the one-sector staging buffer
+typedef struct {
+    size_t pos;                     // Flash offset of the staging buffer
+    size_t fill;                    // Bytes in the staging buffer
+} flash_writer_t;
+
+
+// Write the staging buffer out once it holds a full sector
+static esp_err_t writer_drain(flash_writer_t *w)
+{
+    if (w->fill < FLASH_SECTOR) {
+        return ESP_OK;
+    }
+    esp_err_t ret = flash_write_chunk(w->pos);
+    w->pos += FLASH_SECTOR;
+    w->fill = 0;
+    return ret;
+}
+
+static esp_err_t writer_put(flash_writer_t *w, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        size_t n = FLASH_SECTOR - w->fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(flush_chunk + w->fill, p, n);
+        w->fill += n;
+        p += n;
+        len -= n;
+        esp_err_t ret = writer_drain(w);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+// Write a clip sequentially from the next sector boundary, wrapping to the
+// start of the partition when it does not fit in the remaining space
+static esp_err_t flush_clip(uint32_t id)
+{
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    clip_t *clip = clip_find(id);
+    clip_t c = { 0 };
+    if (clip) {
+        c = *clip;
+    }
+    xSemaphoreGive(store_mutex);
+    if (!clip) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t total = sizeof(flash_clip_header_t) + c.count * sizeof(flash_frame_header_t) + c.bytes;
+    if (total > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t start = (flash_pos + FLASH_SECTOR - 1) & ~(FLASH_SECTOR - 1);
+    if (start + total > partition->size) {
+        start = 0;
+        flash_erased = 0;
+    }
+
+    flash_writer_t w = { .pos = start, .fill = 0 };
+    flash_clip_header_t header = {
+        .magic = 0xFFFFFFFF,
+        .id = c.id,
+        .frames = c.count,
+        .bytes = total - sizeof(flash_clip_header_t),
+        .trigger_us = c.trigger_us,
+        .reserved = { 0xFFFFFFFF, 0xFFFFFFFF },
+    };
+    esp_err_t ret = writer_put(&w, &header, sizeof(header));
+
+    for (uint32_t i = 0; i < c.count && ret == ESP_OK; i++) {
+        flash_frame_header_t fh = { .reserved = 0xFFFFFFFF };
+        uint32_t offset = 0;
+
+        xSemaphoreTake(store_mutex, portMAX_DELAY);
+        if (clip_find(id)) {
+            ring_frame_t *f = ring_frame(store, c.first + i);
+            fh.len = f->len;
+            fh.timestamp_us = f->timestamp_us;
+            offset = f->offset;
+        } else {
+            ret = ESP_ERR_NOT_FOUND;
+        }
+        xSemaphoreGive(store_mutex);
+
+        if (ret == ESP_OK) {
+            ret = writer_put(&w, &fh, sizeof(fh));
+        }
+
+        // Copy the frame a piece at a time under the store mutex, so a
+        // concurrent freeze waits for at most one sector's memcpy
+        uint32_t done = 0;
+        while (ret == ESP_OK && done < fh.len) {
+            size_t n = FLASH_SECTOR - w.fill;
+            if (n > fh.len - done) {
+                n = fh.len - done;
+            }
+            xSemaphoreTake(store_mutex, portMAX_DELAY);
+            if (clip_find(id)) {
+                memcpy(flush_chunk + w.fill, store->data + offset + done, n);
+            } else {
+                ret = ESP_ERR_NOT_FOUND;
+            }
+            xSemaphoreGive(store_mutex);
+
+            if (ret == ESP_OK) {
+                w.fill += n;
+                done += n;
+                ret = writer_drain(&w);
+            }
+        }
+    }
+
+    if (ret == ESP_OK && w.fill > 0) {
+        // Pad the last sector with the erased value
+        memset(flush_chunk + w.fill, 0xFF, FLASH_SECTOR - w.fill);
+        w.fill = FLASH_SECTOR;
+        ret = writer_drain(&w);
+    }
+
+    flash_pos = w.pos;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Mark the clip complete; this only clears bits of the erased word
+    uint32_t magic = CLIP_MAGIC;
+    return esp_partition_write(partition, start, &magic, sizeof(magic));
+}
+
+static void flush_task(void *arg)
+{
+    uint32_t id;
+
+    while (1) {
+        xQueueReceive(flush_queue, &id, portMAX_DELAY);
+
+        size_t pos = flash_pos;
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = flush_clip(id);
+        int64_t elapsed = esp_timer_get_time() - start;
+        // flash_pos may have wrapped; count what was actually written
+        size_t written = flash_pos >= pos ? flash_pos - pos : flash_pos;
+
+        if (ret == ESP_OK) {
+            xSemaphoreTake(store_mutex, portMAX_DELAY);
+            clip_t *clip = clip_find(id);
+            if (clip) {
+                clip->flushed = true;
+            }
+            xSemaphoreGive(store_mutex);
+            ESP_LOGI(TAG, "Clip %lu flushed: %u bytes in %lld ms", (unsigned long)id,
+                     (unsigned)written, (long long)(elapsed / 1000));
+        } else {
+            ESP_LOGW(TAG, "Clip %lu flush failed: %s", (unsigned long)id, esp_err_to_name(ret));
+        }
+
+        taskENTER_CRITICAL(&stats_lock);
+        if (ret == ESP_OK) {
+            stats.clips_flushed++;
+            if (elapsed > 0) {
+                stats.flush_kbps = (uint64_t)written * 1000000 / elapsed / 1024;
+            }
+        } else {
+            stats.flush_failed++;
+        }
+        stats.flush_bytes += written;
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+}
+
+void clip_recorder_configure(const clip_config_t *config)
+{
+    if (!config) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&config_lock);
+    memcpy(&current, config, sizeof(clip_config_t));
+    trigger_us = 0;
+    taskEXIT_CRITICAL(&config_lock);
+
+    ESP_LOGI(TAG, "Clips %s: %us before, %us after trigger%s", config->enabled ? "enabled" : "disabled",
+             config->pre_trigger_s, config->post_trigger_s,
+             config->flush && partition ? ", flushed to flash" : "");
+}
+
+esp_err_t clip_recorder_start(const clip_config_t *config)
+{
+    if (!rolling) {
+        rolling = ring_create(CLIP_ROLLING_SIZE);
+        store = ring_create(CLIP_STORE_SIZE);
+        store_mutex = xSemaphoreCreateMutex();
+        flush_queue = xQueueCreate(CLIP_RECORDER_MAX_CLIPS, sizeof(uint32_t));
+        flush_chunk = heap_caps_malloc(FLASH_SECTOR, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!rolling || !store || !store_mutex || !flush_queue || !flush_chunk) {
+            ESP_LOGE(TAG, "Failed to allocate clip buffers");
+            return ESP_ERR_NO_MEM;
+        }
+
+        stats.rolling_bytes = CLIP_ROLLING_SIZE;
+        stats.store_bytes = CLIP_STORE_SIZE;
+
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, CLIP_PARTITION_SUBTYPE,
+                                             CLIP_PARTITION_LABEL);
+        if (partition) {
+            ESP_LOGI(TAG, "Clip partition: %u KB at 0x%lx", (unsigned)(partition->size / 1024),
+                     (unsigned long)partition->address);
+        } else {
+            ESP_LOGI(TAG, "No '%s' partition, clips stay in PSRAM", CLIP_PARTITION_LABEL);
+        }
+
+        if (xTaskCreate(recorder_task, "clip_rec", RECORDER_STACK_SIZE, NULL,
+                        RECORDER_PRIORITY, NULL) != pdPASS ||
+            xTaskCreate(flush_task, "clip_flush", FLUSH_STACK_SIZE, NULL,
+                        FLUSH_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create recorder tasks");
+            return ESP_ERR_NO_MEM;
+        }
+
+        ESP_LOGI(TAG, "Clip recorder: %d KB rolling, %d KB store", CLIP_ROLLING_SIZE / 1024,
+                 CLIP_STORE_SIZE / 1024);
+    }
+
+    clip_recorder_configure(config);
+    return ESP_OK;
+}
+
+void clip_recorder_report(const detection_result_t *result, int64_t timestamp_us)
+{
+    if (!result) {
+        return;
+    }
+
+    bool rising = result->rgb_detected && !last_detected;
+    last_detected = result->rgb_detected;
+    if (!rising) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&config_lock);
+    if (current.enabled && trigger_us == 0) {
+        trigger_us = timestamp_us;
+    }
+    taskEXIT_CRITICAL(&config_lock);
+}
+
+size_t clip_recorder_list(clip_info_t *out, size_t max)
+{
+    if (!out || !store_mutex) {
+        return 0;
+    }
+
+    size_t n = 0;
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    for (uint32_t i = 0; i < CLIP_RECORDER_MAX_CLIPS && i < last_clip_id && n < max; i++) {
+        clip_t *c = clip_find(last_clip_id - i);
+        if (!c) {
+            continue;
+        }
+        clip_info_t *info = &out[n++];
+        info->id = c->id;
+        info->trigger_us = c->trigger_us;
+        info->frames = c->count;
+        info->bytes = c->bytes;
+        info->duration_ms = (ring_frame(store, c->first + c->count - 1)->timestamp_us -
+                             ring_frame(store, c->first)->timestamp_us) / 1000;
+        info->flushed = c->flushed;
+    }
+    xSemaphoreGive(store_mutex);
+    return n;
+}
+
+esp_err_t clip_recorder_read_frame(uint32_t id, uint32_t index, uint8_t **jpeg, size_t *len,
+                                   int64_t *timestamp_us)
+{
+    if (!jpeg || !len || !store_mutex) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(store_mutex, portMAX_DELAY);
+    clip_t *c = clip_find(id);
+    if (!c || index >= c->count) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else {
+        ring_frame_t *f = ring_frame(store, c->first + index);
+        *jpeg = heap_caps_malloc(f->len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (*jpeg) {
+            memcpy(*jpeg, store->data + f->offset, f->len);
+            *len = f->len;
+            if (timestamp_us) {
+                *timestamp_us = f->timestamp_us;
+            }
+        } else {
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreGive(store_mutex);
+    return ret;
+}
+
+void clip_recorder_get_stats(clip_recorder_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(out, &stats, sizeof(clip_recorder_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+}
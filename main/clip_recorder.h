@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Pre/post-trigger clip recorder: rolling JPEG buffer and frozen clips in PSRAM
+ */
+
+#ifndef CLIP_RECORDER_H
+#define CLIP_RECORDER_H
+
+#include "color_detect.h"
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// PSRAM arenas: rolling pre-trigger buffer and frozen clip store
+#define CLIP_ROLLING_SIZE       (1536 * 1024)
+#define CLIP_STORE_SIZE         (2048 * 1024)
+
+// Longest pre- or post-trigger window accepted
+#define CLIP_MAX_WINDOW_S       10
+
+// Frozen clips kept (older ones are evicted first)
+#define CLIP_RECORDER_MAX_CLIPS 8
+
+// Flash partition for flushed clips (data partition, custom subtype)
+#define CLIP_PARTITION_LABEL    "clips"
+#define CLIP_PARTITION_SUBTYPE  0x40
+
+// Upper bound on the flush write rate
+#define CLIP_FLUSH_MAX_KBPS     256
+
+// Frozen clip description
+typedef struct {
+    uint32_t id;                // Clip identifier (/api/clips/<id>.mjpeg)
+    int64_t trigger_us;         // Time of the detection that triggered the clip
+    uint32_t frames;            // Frames in the clip
+    uint32_t bytes;             // JPEG bytes in the clip
+    uint32_t duration_ms;       // Time between the first and last frame
+    bool flushed;               // Written to the clips partition
+} clip_info_t;
+
+// Recorder statistics
+typedef struct {
+    bool enabled;
+    uint32_t rolling_bytes;     // Rolling arena size
+    uint32_t rolling_used;      // Bytes held by buffered frames
+    uint32_t rolling_frames;    // Frames currently buffered
+    uint32_t rolling_ms;        // Time span currently buffered
+    uint32_t store_bytes;       // Clip store size
+    uint32_t store_used;        // Bytes held by frozen clips
+    uint32_t frames_recorded;   // Frames copied into the rolling arena
+    uint32_t frames_skipped;    // Frames too large for the arena
+    uint32_t clips_recorded;    // Clips frozen since boot
+    uint32_t clips_flushed;     // Clips written to flash
+    uint32_t flush_failed;      // Flushes aborted (flash error or clip evicted)
+    uint32_t flush_bytes;       // Bytes written to flash since boot
+    uint32_t flush_kbps;        // Write throughput of the last flush
+} clip_recorder_stats_t;
+
+/**
+ * @brief Allocate the arenas and start the recorder
+ *
+ * @param config Recorder configuration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t clip_recorder_start(const clip_config_t *config);
+
+/**
+ * @brief Apply a new configuration
+ *
+ * While enabled the recorder is a pipeline consumer, so frames are encoded
+ * even without viewers.
+ *
+ * @param config Recorder configuration
+ */
+void clip_recorder_configure(const clip_config_t *config);
+
+/**
+ * @brief Report the result of a processed frame
+ *
+ * Called from the detection path; a rising detection edge triggers a clip.
+ *
+ * @param result Detection result
+ * @param timestamp_us Capture time of the frame
+ */
+void clip_recorder_report(const detection_result_t *result, int64_t timestamp_us);
+
+/**
+ * @brief List the frozen clips, newest first
+ *
+ * @param out Destination array
+ * @param max Capacity of out
+ * @return Number of clips listed
+ */
+size_t clip_recorder_list(clip_info_t *out, size_t max);
+
+/**
+ * @brief Copy one frame of a clip
+ *
+ * @param id Clip identifier
+ * @param index Frame index within the clip
+ * @param jpeg Set to a malloc()ed copy of the frame, to be freed by the caller
+ * @param len Set to the frame length
+ * @param timestamp_us Set to the capture time of the frame (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the clip or frame does not
+ *         exist (anymore), ESP_ERR_NO_MEM if the copy cannot be allocated
+ */
+esp_err_t clip_recorder_read_frame(uint32_t id, uint32_t index, uint8_t **jpeg, size_t *len,
+                                   int64_t *timestamp_us);
+
+/**
+ * @brief Get recorder statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void clip_recorder_get_stats(clip_recorder_stats_t *stats);
+
+#endif // CLIP_RECORDER_H
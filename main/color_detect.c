@@ -5,71 +5,120 @@
  */
 
 #include "color_detect.h"
+#include "color_kernels.h"
+#include "parallel_worker.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_async_memcpy.h"
+#include "esp_cache.h"
+#include "esp_psram.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <sys/param.h>
 #include <string.h>
+#include <stdlib.h>
 #include <math.h>
 
 static const char *TAG = "color_detect";
 static color_config_t current_config;
 static uint32_t frame_counter = 0;
+static uint16_t config_version = 1;
+static bool parallel_enabled = true;
+static bool strips_enabled = true;
+static color_detect_stats_t detect_stats;
+static SemaphoreHandle_t scan_mutex = NULL;     // One scan at a time (shared line buffers)
 
-// Convert RGB565 to RGB888
-static inline void rgb565_to_rgb888(uint16_t rgb565, uint8_t *r, uint8_t *g, uint8_t *b)
-{
-    *r = ((rgb565 >> 11) & 0x1F) << 3;
-    *g = ((rgb565 >> 5) & 0x3F) << 2;
-    *b = (rgb565 & 0x1F) << 3;
-}
+// Compiled patterns: scans read patterns[active_pattern] and the standby
+// state owns patterns[standby_pattern]; a new pattern is compiled into the
+// third slot and swapped in under scan_mutex
+static pattern_config_t pattern_config;
+static color_pattern_t patterns[3];
+static int active_pattern = 0;
+static int standby_pattern = 1;
 
-// Convert RGB to simplified HSV (0-255 range for all channels)
-static void rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b, uint8_t *h, uint8_t *s, uint8_t *v)
-{
-    uint8_t max_val = (r > g) ? ((r > b) ? r : b) : ((g > b) ? g : b);
-    uint8_t min_val = (r < g) ? ((r < b) ? r : b) : ((g < b) ? g : b);
-    uint8_t delta = max_val - min_val;
+#define STRIP_ALIGN     16
+#define MAX_TILT_DEG    80      // Band axis tilt accepted from the pattern orientation
+#define WINDOW_TILT_DEG 20      // Band axis tilt up to which upright windows are scored
 
-    *v = max_val;
+// Matches of one class within a row, folded into color_stats_t at the row
+// end so the per-pixel work stays in 32 bits
+typedef struct {
+    uint32_t n;
+    uint32_t sum_x;
+    uint32_t sum_xx;
+    uint16_t x_min;
+    uint16_t x_max;
+} row_stats_t;
 
-    if (max_val == 0) {
-        *s = 0;
-        *h = 0;
-        return;
-    }
+// Double-buffered internal SRAM line buffers of one worker
+typedef struct {
+    uint16_t *buf[2];
+    size_t bytes;
+    SemaphoreHandle_t done;
+} strip_buffers_t;
 
-    *s = (uint8_t)(((uint16_t)delta * 255) / max_val);
+static strip_buffers_t strip_buffers[PARALLEL_WORKER_COUNT];
+static async_memcpy_handle_t dma_copy = NULL;
 
-    if (delta == 0) {
-        *h = 0;
-    } else {
-        int h_temp;
-        if (max_val == r) {
-            h_temp = (g - b) * 42 / delta;
-        } else if (max_val == g) {
-            h_temp = 85 + (b - r) * 42 / delta;
-        } else {
-            h_temp = 170 + (r - g) * 42 / delta;
-        }
-        
-        if (h_temp < 0) h_temp += 255;
-        *h = (uint8_t)h_temp;
-    }
-}
+// Regions of interest: the description is set with the configuration and
+// compiled for the frame size by the next scan (both under scan_mutex)
+static mask_config_t mask_config;
+static roi_mask_t roi_mask;
+static bool mask_dirty = true;
 
-// Check if HSV values match threshold
-static bool hsv_in_range(uint8_t h, uint8_t s, uint8_t v, const hsv_threshold_t *thresh)
-{
-    // Handle hue wraparound for red color
-    bool h_match;
-    if (thresh->h_min > thresh->h_max) {
-        h_match = (h >= thresh->h_min || h <= thresh->h_max);
-    } else {
-        h_match = (h >= thresh->h_min && h <= thresh->h_max);
-    }
+// Standby configuration, compiled ahead so that switching to it exchanges
+// it with the active one at the next frame boundary instead of rebuilding.
+// Built outside scan_mutex while not ready; swapped under it
+typedef struct {
+    bool ready;
+    color_config_t config;
+    pattern_config_t pattern_config;
+    roi_mask_t mask;            // Compiled for the last frame size
+    bool mask_dirty;            // Mask compiled by the first scan after the switch
+} standby_state_t;
 
-    return h_match && 
-           (s >= thresh->s_min && s <= thresh->s_max) &&
-           (v >= thresh->v_min && v <= thresh->v_max);
-}
+static standby_state_t standby;
+static uint16_t frame_width = 0;                // Size of the last scanned frame
+static uint16_t frame_height = 0;
+static bool switch_pending = false;
+static int64_t switch_requested_us = 0;
+static color_detect_switch_t last_switch;
+static SemaphoreHandle_t switch_done = NULL;
+
+// Cell counts and integral images for window scoring (PSRAM, under scan_mutex)
+static class_grid_t class_grid;
+static bool class_grid_failed = false;
+
+// Class map of the last processed frame (PSRAM, drawn under scan_mutex)
+static bool class_map_enabled = false;
+static bool class_map_ready = false;
+static uint16_t *class_map = NULL;
+static size_t class_map_size = 0;
+static uint16_t class_map_width = 0;
+static uint16_t class_map_height = 0;
+
+// Class map colors by class index; the default pattern's red, green and
+// blue classes come first
+static const uint8_t class_palette[PATTERN_MAX_CLASSES][3] = {
+    { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 }, { 255, 255, 0 },
+    { 255, 0, 255 }, { 0, 255, 255 }, { 255, 128, 0 }, { 128, 0, 255 },
+};
+
+// Row band assigned to each worker, with its partial statistics
+typedef struct {
+    const uint16_t *pixels;
+    uint16_t width;
+    uint16_t height;
+    const color_pattern_t *pattern;
+    const roi_mask_t *mask;
+    class_grid_t *grid;
+    bool use_strips;
+    frame_stats_t parts[PARALLEL_WORKER_COUNT];
+    uint32_t cycles[PARALLEL_WORKER_COUNT];
+} scan_job_t;
 
 esp_err_t color_detect_init(const color_config_t *config)
 {
@@ -78,7 +127,36 @@ esp_err_t color_detect_init(const color_config_t *config)
     }
 
     memcpy(&current_config, config, sizeof(color_config_t));
+    memcpy(&mask_config, &config->mask, sizeof(mask_config_t));
     frame_counter = 0;
+
+    // R-G-B until a stored pattern is set
+    config_get_pattern_defaults(&pattern_config, config);
+    esp_err_t ret = color_pattern_compile(&pattern_config, &patterns[active_pattern]);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // GDMA copies of frame strips from PSRAM into internal line buffers
+    async_memcpy_config_t mcp_config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    mcp_config.backlog = PARALLEL_WORKER_COUNT * 2;
+    if (esp_async_memcpy_install(&mcp_config, &dma_copy) != ESP_OK) {
+        ESP_LOGW(TAG, "Async memcpy unavailable, strips copied by CPU");
+        dma_copy = NULL;
+    }
+
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        strip_buffers[i].done = xSemaphoreCreateBinary();
+        if (!strip_buffers[i].done) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    scan_mutex = xSemaphoreCreateMutex();
+    switch_done = xSemaphoreCreateBinary();
+    if (!scan_mutex || !switch_done) {
+        return ESP_ERR_NO_MEM;
+    }
     
     ESP_LOGI(TAG, "Color detection initialized");
     ESP_LOGI(TAG, "Min area: %d, Min confidence: %d, Frame decimation: %d",
@@ -90,159 +168,568 @@ esp_err_t color_detect_init(const color_config_t *config)
 void color_detect_update_config(const color_config_t *config)
 {
     if (config) {
+        xSemaphoreTake(scan_mutex, portMAX_DELAY);
         memcpy(&current_config, config, sizeof(color_config_t));
-        ESP_LOGI(TAG, "Configuration updated");
+        memcpy(&mask_config, &config->mask, sizeof(mask_config_t));
+        mask_dirty = true;
+        xSemaphoreGive(scan_mutex);
+        config_version++;
+        ESP_LOGI(TAG, "Configuration updated (version %u)", config_version);
     }
 }
 
-esp_err_t color_detect_process(camera_fb_t *fb, detection_result_t *result)
+esp_err_t color_detect_set_pattern(const pattern_config_t *pattern)
 {
-    if (!fb || !result) {
+    if (color_pattern_validate(pattern) != ESP_OK) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    memset(result, 0, sizeof(detection_result_t));
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    int next = 3 - active_pattern - standby_pattern;
+    color_pattern_compile(pattern, &patterns[next]);
+    memcpy(&pattern_config, pattern, sizeof(pattern_config_t));
+    active_pattern = next;
+    config_version++;
+    xSemaphoreGive(scan_mutex);
 
-    // Frame decimation
-    frame_counter++;
-    if (frame_counter % current_config.frame_decimation != 0) {
-        return ESP_OK;
+    ESP_LOGI(TAG, "Pattern updated: %d classes, %d sequences, %s (version %u)",
+             pattern->class_count, pattern->sequence_count,
+             pattern->orientation == PATTERN_VERTICAL ? "vertical" : "horizontal", config_version);
+    return ESP_OK;
+}
+
+void color_detect_get_pattern(pattern_config_t *pattern)
+{
+    if (!pattern) {
+        return;
     }
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    memcpy(pattern, &pattern_config, sizeof(pattern_config_t));
+    xSemaphoreGive(scan_mutex);
+}
 
-    if (fb->format != PIXFORMAT_RGB565) {
-        ESP_LOGE(TAG, "Unsupported pixel format");
-        return ESP_ERR_NOT_SUPPORTED;
+esp_err_t color_detect_stage(const color_config_t *config, const pattern_config_t *pattern)
+{
+    if (!config || !pattern || color_pattern_validate(pattern) != ESP_OK ||
+        (config->mask.region_count > 0 && roi_mask_validate(&config->mask) != ESP_OK)) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    uint16_t width = fb->width;
-    uint16_t height = fb->height;
-    uint16_t *pixels = (uint16_t *)fb->buf;
+    // Take the standby out of use, then build it without holding up scans
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    if (switch_pending) {
+        xSemaphoreGive(scan_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    standby.ready = false;
+    uint16_t width = frame_width, height = frame_height;
+    xSemaphoreGive(scan_mutex);
 
-    // Simple blob detection: scan image for color regions
-    // Track bounding boxes for each color
-    uint16_t red_x_min = width, red_x_max = 0, red_y_min = height, red_y_max = 0;
-    uint16_t green_x_min = width, green_x_max = 0, green_y_min = height, green_y_max = 0;
-    uint16_t blue_x_min = width, blue_x_max = 0, blue_y_min = height, blue_y_max = 0;
-    
-    uint32_t red_pixels = 0, green_pixels = 0, blue_pixels = 0;
-
-    // Scan image
-    for (uint16_t y = 0; y < height; y++) {
-        for (uint16_t x = 0; x < width; x++) {
-            uint16_t pixel = pixels[y * width + x];
-            uint8_t r, g, b, h, s, v;
-            
-            rgb565_to_rgb888(pixel, &r, &g, &b);
-            rgb_to_hsv(r, g, b, &h, &s, &v);
-
-            if (hsv_in_range(h, s, v, &current_config.red)) {
-                red_pixels++;
-                if (x < red_x_min) red_x_min = x;
-                if (x > red_x_max) red_x_max = x;
-                if (y < red_y_min) red_y_min = y;
-                if (y > red_y_max) red_y_max = y;
-            } else if (hsv_in_range(h, s, v, &current_config.green)) {
-                green_pixels++;
-                if (x < green_x_min) green_x_min = x;
-                if (x > green_x_max) green_x_max = x;
-                if (y < green_y_min) green_y_min = y;
-                if (y > green_y_max) green_y_max = y;
-            } else if (hsv_in_range(h, s, v, &current_config.blue)) {
-                blue_pixels++;
-                if (x < blue_x_min) blue_x_min = x;
-                if (x > blue_x_max) blue_x_max = x;
-                if (y < blue_y_min) blue_y_min = y;
-                if (y > blue_y_max) blue_y_max = y;
+    memcpy(&standby.config, config, sizeof(color_config_t));
+    memcpy(&standby.pattern_config, pattern, sizeof(pattern_config_t));
+    color_pattern_compile(pattern, &patterns[standby_pattern]);
+    standby.mask_dirty = false;
+    if (config->mask.region_count == 0) {
+        roi_mask_free(&standby.mask);
+    } else if (width == 0 || roi_mask_compile(&config->mask, width, height, &standby.mask) != ESP_OK) {
+        // No frame yet, or no memory: leave it to the first scan
+        standby.mask_dirty = true;
+    }
+
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    standby.ready = true;
+    xSemaphoreGive(scan_mutex);
+    return ESP_OK;
+}
+
+// Exchange the active and standby states (under scan_mutex)
+static void swap_standby(void)
+{
+    int64_t start = esp_timer_get_time();
+
+    color_config_t config = current_config;
+    current_config = standby.config;
+    standby.config = config;
+
+    pattern_config_t pattern = pattern_config;
+    pattern_config = standby.pattern_config;
+    standby.pattern_config = pattern;
+
+    int slot = active_pattern;
+    active_pattern = standby_pattern;
+    standby_pattern = slot;
+
+    roi_mask_t mask = roi_mask;
+    roi_mask = standby.mask;
+    standby.mask = mask;
+    bool dirty = mask_dirty;
+    mask_dirty = standby.mask_dirty;
+    standby.mask_dirty = dirty;
+    memcpy(&mask_config, &current_config.mask, sizeof(mask_config_t));
+
+    // The frame scanned at the switch restarts the decimation
+    frame_counter = 0;
+    config_version++;
+
+    int64_t now = esp_timer_get_time();
+    last_switch.wait_us = (uint32_t)(start - switch_requested_us);
+    last_switch.swap_us = (uint32_t)(now - start);
+    switch_pending = false;
+    xSemaphoreGive(switch_done);
+}
+
+esp_err_t color_detect_switch(uint32_t timeout_ms, color_detect_switch_t *timing)
+{
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    if (!standby.ready || switch_pending) {
+        xSemaphoreGive(scan_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    // A switch applied after its requester gave up is not this one
+    xSemaphoreTake(switch_done, 0);
+    switch_requested_us = esp_timer_get_time();
+    switch_pending = true;
+    xSemaphoreGive(scan_mutex);
+
+    if (xSemaphoreTake(switch_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        xSemaphoreTake(scan_mutex, portMAX_DELAY);
+        bool applied = !switch_pending;
+        switch_pending = false;
+        xSemaphoreGive(scan_mutex);
+        if (!applied) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    ESP_LOGI(TAG, "Switched configuration after %lu us, swap %lu us (version %u)",
+             (unsigned long)last_switch.wait_us, (unsigned long)last_switch.swap_us, config_version);
+    if (timing) {
+        *timing = last_switch;
+    }
+    return ESP_OK;
+}
+
+bool color_detect_switch_pending(void)
+{
+    return __atomic_load_n(&switch_pending, __ATOMIC_RELAXED);
+}
+
+uint16_t color_detect_get_config_version(void)
+{
+    return config_version;
+}
+
+void color_detect_scan_rows(const uint16_t *rows, uint16_t width, uint16_t y_start, uint16_t y_end,
+                            const color_pattern_t *pattern, const roi_mask_t *mask,
+                            frame_stats_t *stats, class_grid_t *grid)
+{
+    row_stats_t acc[PATTERN_MAX_CLASSES];
+    size_t cell_plane = grid ? (size_t)grid->cols * grid->rows : 0;
+    uint8_t *cells = NULL;
+    const mask_span_t full_row = { .x0 = 0, .x1 = width };
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint16_t *row = rows + (y - y_start) * width;
+        const mask_span_t *span = &full_row, *span_end = &full_row + 1;
+        if (mask) {
+            span = mask->spans + mask->row_start[y];
+            span_end = mask->spans + mask->row_start[y + 1];
+        }
+        memset(acc, 0, sizeof(row_stats_t) * pattern->class_count);
+        if (grid) {
+            cells = grid->counts + (y >> BAND_WINDOW_CELL_SHIFT) * grid->cols;
+        }
+
+        // Only the active spans are read; they run left to right
+        for (; span < span_end; span++) {
+            for (uint16_t x = span->x0; x < span->x1; x++) {
+                uint16_t pixel = row[x];
+                uint8_t r, g, b, h, s, v;
+
+                rgb565_to_rgb888(pixel, &r, &g, &b);
+                rgb_to_hsv(r, g, b, &h, &s, &v);
+
+                int c = hsv_classify(h, s, v, pattern);
+                if (c >= 0) {
+                    // x only grows along the row: the first match is the minimum
+                    row_stats_t *a = &acc[c];
+                    if (a->n == 0) a->x_min = x;
+                    a->x_max = x;
+                    a->n++;
+                    a->sum_x += x;
+                    a->sum_xx += (uint32_t)x * x;
+                    if (cells) {
+                        cells[c * cell_plane + (x >> BAND_WINDOW_CELL_SHIFT)]++;
+                    }
+                }
+            }
+        }
+
+        for (int c = 0; c < pattern->class_count; c++) {
+            const row_stats_t *a = &acc[c];
+            if (a->n == 0) {
+                continue;
             }
+            color_stats_t *cs = &stats->color[c];
+            cs->pixels += a->n;
+            if (a->x_min < cs->x_min) cs->x_min = a->x_min;
+            if (a->x_max > cs->x_max) cs->x_max = a->x_max;
+            if (y < cs->y_min) cs->y_min = y;
+            if (y > cs->y_max) cs->y_max = y;
+            cs->sum_x += a->sum_x;
+            cs->sum_y += (uint64_t)y * a->n;
+            cs->sum_xx += a->sum_xx;
+            cs->sum_xy += (uint64_t)y * a->sum_x;
+            cs->sum_yy += (uint64_t)y * y * a->n;
         }
     }
+}
 
-    // Check if all three colors detected with minimum area
-    bool red_ok = red_pixels >= current_config.min_area;
-    bool green_ok = green_pixels >= current_config.min_area;
-    bool blue_ok = blue_pixels >= current_config.min_area;
+static IRAM_ATTR bool strip_copy_done(async_memcpy_handle_t mcp, async_memcpy_event_t *event, void *args)
+{
+    BaseType_t high_task_wakeup = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t)args, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
 
-    if (!red_ok || !green_ok || !blue_ok) {
-        return ESP_OK;
+// Start copying a strip of rows from PSRAM into an internal line buffer.
+// GDMA reads PSRAM behind the data cache, so lines written by the CPU
+// (synthetic and decoded replay frames, overlays) are written back first
+static void strip_copy_start(strip_buffers_t *sb, int index, const uint16_t *src, size_t bytes)
+{
+    if (dma_copy && esp_psram_check_ptr_addr(src) &&
+        esp_cache_msync((void *)src, bytes, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED) == ESP_OK &&
+        esp_async_memcpy(dma_copy, sb->buf[index], (void *)src, bytes,
+                         strip_copy_done, sb->done) == ESP_OK) {
+        return;
     }
 
-    // Calculate centroids
-    uint16_t red_cx = (red_x_min + red_x_max) / 2;
-    uint16_t green_cx = (green_x_min + green_x_max) / 2;
-    uint16_t blue_cx = (blue_x_min + blue_x_max) / 2;
+    // No GDMA channel, unaligned or flash-mapped frame (replay): copy on the CPU
+    memcpy(sb->buf[index], src, bytes);
+    xSemaphoreGive(sb->done);
+}
 
-    // Check if bands are in order R-G-B (left to right)
-    bool ordered = (red_cx < green_cx) && (green_cx < blue_cx);
-    
-    if (!ordered) {
-        return ESP_OK;
+static bool strip_buffers_alloc(strip_buffers_t *sb, size_t bytes)
+{
+    if (sb->bytes >= bytes) {
+        return true;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        heap_caps_free(sb->buf[i]);
+        sb->buf[i] = heap_caps_aligned_alloc(STRIP_ALIGN, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        if (!sb->buf[i]) {
+            sb->bytes = 0;
+            return false;
+        }
+    }
+    sb->bytes = bytes;
+    return true;
+}
+
+// Classify a band strip by strip: strip N+1 is copied into internal SRAM
+// by GDMA while strip N is classified from the other buffer.
+static void scan_band_strips(const uint16_t *pixels, uint16_t width, uint16_t y_start, uint16_t y_end,
+                             const color_pattern_t *pattern, const roi_mask_t *mask,
+                             frame_stats_t *stats, class_grid_t *grid, strip_buffers_t *sb)
+{
+    size_t row_bytes = width * sizeof(uint16_t);
+    int strips = (y_end - y_start + COLOR_DETECT_STRIP_ROWS - 1) / COLOR_DETECT_STRIP_ROWS;
+
+    if (strips == 0) {
+        return;
     }
 
-    // Calculate confidence based on color separation and alignment
-    uint16_t red_cy = (red_y_min + red_y_max) / 2;
-    uint16_t green_cy = (green_y_min + green_y_max) / 2;
-    uint16_t blue_cy = (blue_y_min + blue_y_max) / 2;
+    strip_copy_start(sb, 0, pixels + y_start * width,
+                     MIN(COLOR_DETECT_STRIP_ROWS, y_end - y_start) * row_bytes);
 
-    // Vertical alignment check (should be roughly on same horizontal line)
-    uint16_t max_cy = (red_cy > green_cy) ? ((red_cy > blue_cy) ? red_cy : blue_cy) : 
-                                            ((green_cy > blue_cy) ? green_cy : blue_cy);
-    uint16_t min_cy = (red_cy < green_cy) ? ((red_cy < blue_cy) ? red_cy : blue_cy) : 
-                                            ((green_cy < blue_cy) ? green_cy : blue_cy);
-    uint16_t vertical_diff = max_cy - min_cy;
+    for (int i = 0; i < strips; i++) {
+        uint16_t sy = y_start + i * COLOR_DETECT_STRIP_ROWS;
+        uint16_t ey = MIN(sy + COLOR_DETECT_STRIP_ROWS, y_end);
 
-    // Confidence calculation: better alignment = higher confidence
-    uint8_t alignment_score = (vertical_diff < height / 10) ? 100 : 
-                              (vertical_diff < height / 5) ? 70 : 40;
+        xSemaphoreTake(sb->done, portMAX_DELAY);
 
-    result->confidence = alignment_score;
+        if (i + 1 < strips) {
+            uint16_t ny = ey;
+            uint16_t nrows = MIN(COLOR_DETECT_STRIP_ROWS, y_end - ny);
+            strip_copy_start(sb, (i + 1) & 1, pixels + ny * width, nrows * row_bytes);
+        }
 
-    if (result->confidence >= current_config.min_confidence) {
-        result->rgb_detected = true;
+        color_detect_scan_rows(sb->buf[i & 1], width, sy, ey, pattern, mask, stats, grid);
+    }
+}
 
-        // Combined bounding box
-        result->bbox_x = red_x_min < green_x_min ? (red_x_min < blue_x_min ? red_x_min : blue_x_min) :
-                                                    (green_x_min < blue_x_min ? green_x_min : blue_x_min);
-        result->bbox_y = red_y_min < green_y_min ? (red_y_min < blue_y_min ? red_y_min : blue_y_min) :
-                                                    (green_y_min < blue_y_min ? green_y_min : blue_y_min);
-        
-        uint16_t max_x = red_x_max > green_x_max ? (red_x_max > blue_x_max ? red_x_max : blue_x_max) :
-                                                    (green_x_max > blue_x_max ? green_x_max : blue_x_max);
-        uint16_t max_y = red_y_max > green_y_max ? (red_y_max > blue_y_max ? red_y_max : blue_y_max) :
-                                                    (green_y_max > blue_y_max ? green_y_max : blue_y_max);
+static void scan_part(void *ctx, int part, int num_parts)
+{
+    scan_job_t *job = (scan_job_t *)ctx;
+    // Bands start on cell boundaries, so no two workers count into one cell
+    uint16_t cell_rows = (job->height + BAND_WINDOW_CELL - 1) >> BAND_WINDOW_CELL_SHIFT;
+    uint16_t y_start = MIN(job->height, (cell_rows * part / num_parts) << BAND_WINDOW_CELL_SHIFT);
+    uint16_t y_end = MIN(job->height, (cell_rows * (part + 1) / num_parts) << BAND_WINDOW_CELL_SHIFT);
+    strip_buffers_t *sb = &strip_buffers[part];
+    uint32_t start = esp_cpu_get_cycle_count();
 
-        result->bbox_w = max_x - result->bbox_x;
-        result->bbox_h = max_y - result->bbox_y;
+    frame_stats_init(&job->parts[part], job->width, job->height);
 
-        ESP_LOGI(TAG, "RGB detected! Confidence: %d%%, BBox: (%d,%d,%d,%d)",
-                 result->confidence, result->bbox_x, result->bbox_y, result->bbox_w, result->bbox_h);
+    // Rows above and below the mask are neither copied nor read
+    if (job->mask) {
+        y_start = MAX(y_start, job->mask->first_row);
+        y_end = MIN(y_end, job->mask->end_row);
+        if (y_start >= y_end) {
+            job->cycles[part] = esp_cpu_get_cycle_count() - start;
+            return;
+        }
     }
 
-    return ESP_OK;
+    if (job->use_strips && sb->done &&
+        strip_buffers_alloc(sb, COLOR_DETECT_STRIP_ROWS * job->width * sizeof(uint16_t))) {
+        scan_band_strips(job->pixels, job->width, y_start, y_end, job->pattern, job->mask,
+                         &job->parts[part], job->grid, sb);
+    } else {
+        color_detect_scan_rows(job->pixels + y_start * job->width, job->width, y_start, y_end,
+                               job->pattern, job->mask, &job->parts[part], job->grid);
+    }
+
+    job->cycles[part] = esp_cpu_get_cycle_count() - start;
 }
 
-void color_detect_draw_bbox(camera_fb_t *fb, const detection_result_t *result)
+void frame_stats_init(frame_stats_t *stats, uint16_t width, uint16_t height)
 {
-    if (!fb || !result || !result->rgb_detected) {
-        return;
+    for (int c = 0; c < PATTERN_MAX_CLASSES; c++) {
+        color_stats_t *cs = &stats->color[c];
+        cs->pixels = 0;
+        cs->x_min = width;
+        cs->x_max = 0;
+        cs->y_min = height;
+        cs->y_max = 0;
+        cs->sum_x = 0;
+        cs->sum_y = 0;
+        cs->sum_xx = 0;
+        cs->sum_xy = 0;
+        cs->sum_yy = 0;
     }
+}
 
-    if (fb->format != PIXFORMAT_RGB565) {
+void frame_stats_merge(frame_stats_t *dst, const frame_stats_t *src)
+{
+    for (int c = 0; c < PATTERN_MAX_CLASSES; c++) {
+        color_stats_t *d = &dst->color[c];
+        const color_stats_t *s = &src->color[c];
+        d->pixels += s->pixels;
+        if (s->x_min < d->x_min) d->x_min = s->x_min;
+        if (s->x_max > d->x_max) d->x_max = s->x_max;
+        if (s->y_min < d->y_min) d->y_min = s->y_min;
+        if (s->y_max > d->y_max) d->y_max = s->y_max;
+        d->sum_x += s->sum_x;
+        d->sum_y += s->sum_y;
+        d->sum_xx += s->sum_xx;
+        d->sum_xy += s->sum_xy;
+        d->sum_yy += s->sum_yy;
+    }
+}
+
+// Direction of the major axis and the variances along and across it, from
+// second central moments
+static void principal_axis(double mu20, double mu02, double mu11,
+                           double *theta, double *major, double *minor)
+{
+    double mean = (mu20 + mu02) / 2;
+    double diff = (mu20 - mu02) / 2;
+    double root = sqrt(diff * diff + mu11 * mu11);
+    *theta = atan2(2 * mu11, mu20 - mu02) / 2;
+    *major = mean + root;
+    *minor = mean - root;
+}
+
+bool color_stats_geometry(const color_stats_t *stats, blob_geometry_t *geometry)
+{
+    if (!stats || !geometry || stats->pixels == 0) {
+        return false;
+    }
+
+    double n = stats->pixels;
+    double cx = stats->sum_x / n;
+    double cy = stats->sum_y / n;
+    // Each pixel covers a unit square: add its own variance (1/12) so a
+    // one-pixel line still has a width
+    double mu20 = stats->sum_xx / n - cx * cx + 1.0 / 12;
+    double mu02 = stats->sum_yy / n - cy * cy + 1.0 / 12;
+    double mu11 = stats->sum_xy / n - cx * cy;
+
+    double theta, major, minor;
+    principal_axis(mu20, mu02, mu11, &theta, &major, &minor);
+
+    geometry->cx = cx;
+    geometry->cy = cy;
+    geometry->angle = theta * 180 / M_PI;
+    geometry->elongation = minor > 0 ? sqrt(major / minor) : INFINITY;
+    return true;
+}
+
+// Decide from the merged statistics whether the bands of a pattern sequence
+// are present. The band axis is the principal axis of the band centroids, so
+// a tilted tag is read along its own direction. With a grid, a tag close to
+// upright is scored by the fill of its best window, otherwise by how well
+// the centroids line up; the sequence with the best score wins, the longer
+// one on a tie (a sequence that contains another is the more specific match)
+static void evaluate(const frame_stats_t *stats, const color_pattern_t *pattern,
+                     const color_config_t *config, const class_grid_t *grid,
+                     uint16_t width, uint16_t height, detection_result_t *result, uint32_t *windows)
+{
+    bool vertical = pattern->orientation == PATTERN_VERTICAL;
+    uint16_t cross_size = vertical ? width : height;
+    float min_cos = cosf(MAX_TILT_DEG * M_PI / 180);
+    float window_cos = cosf(WINDOW_TILT_DEG * M_PI / 180);
+    int best = -1;
+    uint8_t best_score = 0;
+    float best_angle = 0;
+    bool best_windowed = false;
+    band_window_t best_window;
+
+    for (int i = 0; i < pattern->sequence_count; i++) {
+        const band_sequence_t *seq = &pattern->sequences[i];
+        blob_geometry_t bands[PATTERN_MAX_CLASSES];
+
+        // Check if all bands detected with minimum area
+        bool present = true;
+        float mx = 0, my = 0;
+        for (int b = 0; b < seq->length; b++) {
+            const color_stats_t *cs = &stats->color[seq->classes[b]];
+            if (cs->pixels < config->min_area) {
+                present = false;
+                break;
+            }
+            color_stats_geometry(cs, &bands[b]);
+            mx += bands[b].cx;
+            my += bands[b].cy;
+        }
+        if (!present) {
+            continue;
+        }
+
+        // Fit the band axis through the centroids and point it along the
+        // pattern orientation; a tag turned too far is not read
+        mx /= seq->length;
+        my /= seq->length;
+        double cxx = 0, cyy = 0, cxy = 0;
+        for (int b = 0; b < seq->length; b++) {
+            float dx = bands[b].cx - mx, dy = bands[b].cy - my;
+            cxx += dx * dx;
+            cyy += dy * dy;
+            cxy += dx * dy;
+        }
+        double theta, major, minor;
+        principal_axis(cxx, cyy, cxy, &theta, &major, &minor);
+        float ux = cos(theta), uy = sin(theta);
+        float along = vertical ? uy : ux;
+        if (along < 0) {
+            ux = -ux;
+            uy = -uy;
+            along = -along;
+        }
+        if (along < min_cos) {
+            continue;
+        }
+
+        // Band centroids must follow the sequence order along the axis, and
+        // lie roughly on it
+        bool ordered = true;
+        float first_pos = 0, prev_pos = -INFINITY;
+        float cross_min = INFINITY, cross_max = -INFINITY;
+        for (int b = 0; b < seq->length; b++) {
+            float dx = bands[b].cx - mx, dy = bands[b].cy - my;
+            float pos = dx * ux + dy * uy;
+            float cross = dy * ux - dx * uy;
+
+            if (pos <= prev_pos) {
+                ordered = false;
+                break;
+            }
+            if (b == 0) {
+                first_pos = pos;
+            }
+            prev_pos = pos;
+            cross_min = MIN(cross_min, cross);
+            cross_max = MAX(cross_max, cross);
+        }
+        if (!ordered) {
+            continue;
+        }
+
+        uint8_t score;
+        band_window_t window;
+        bool windowed = grid && along >= window_cos;
+        if (windowed) {
+            // Confidence from the fill of the emptiest band; bands too
+            // sparse to fill any window are not a tag
+            float pitch = (prev_pos - first_pos) / (seq->length - 1);
+            bool found = band_window_search(grid, seq, vertical, mx, my, pitch, &window);
+            *windows += window.windows;
+            if (!found) {
+                continue;
+            }
+            score = window.fill;
+        } else {
+            // Confidence calculation: better alignment = higher confidence
+            float cross_diff = cross_max - cross_min;
+            score = (cross_diff < cross_size / 10) ? 100 :
+                    (cross_diff < cross_size / 5) ? 70 : 40;
+        }
+
+        if (score > best_score ||
+            (score == best_score && best >= 0 && seq->length > pattern->sequences[best].length)) {
+            best = i;
+            best_score = score;
+            best_angle = atan2f(uy, ux) * 180 / M_PI;
+            best_windowed = windowed;
+            if (windowed) {
+                best_window = window;
+            }
+        }
+    }
+
+    if (best < 0) {
         return;
     }
 
-    uint16_t width = fb->width;
-    uint16_t height = fb->height;
-    uint16_t *pixels = (uint16_t *)fb->buf;
-    
-    // Yellow color in RGB565 (RGB 255,255,0 -> 0xFFE0)
-    uint16_t color = 0xFFE0;
-    
-    uint16_t x1 = result->bbox_x;
-    uint16_t y1 = result->bbox_y;
-    uint16_t x2 = result->bbox_x + result->bbox_w;
-    uint16_t y2 = result->bbox_y + result->bbox_h;
+    result->confidence = best_score;
+    result->sequence = best;
+    result->angle = lroundf(best_angle);
+
+    if (result->confidence >= config->min_confidence) {
+        result->rgb_detected = true;
+
+        if (best_windowed) {
+            // Window edges fall on cells, which may run past the frame
+            result->bbox_x = best_window.x;
+            result->bbox_y = best_window.y;
+            result->bbox_w = MIN(best_window.x + best_window.w, width) - 1 - best_window.x;
+            result->bbox_h = MIN(best_window.y + best_window.h, height) - 1 - best_window.y;
+            return;
+        }
+
+        // Combined bounding box
+        const band_sequence_t *seq = &pattern->sequences[best];
+        uint16_t min_x = width, min_y = height, max_x = 0, max_y = 0;
+        for (int b = 0; b < seq->length; b++) {
+            const color_stats_t *cs = &stats->color[seq->classes[b]];
+            min_x = MIN(min_x, cs->x_min);
+            min_y = MIN(min_y, cs->y_min);
+            max_x = MAX(max_x, cs->x_max);
+            max_y = MAX(max_y, cs->y_max);
+        }
 
-    // Clamp to frame boundaries
+        result->bbox_x = min_x;
+        result->bbox_y = min_y;
+        result->bbox_w = max_x - min_x;
+        result->bbox_h = max_y - min_y;
+    }
+}
+
+// Outline (x1, y1)-(x2, y2), clipped to the image
+static void draw_rect(uint16_t *pixels, uint16_t width, uint16_t height,
+                      uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
+{
     if (x2 >= width) x2 = width - 1;
     if (y2 >= height) y2 = height - 1;
 
@@ -258,3 +745,368 @@ void color_detect_draw_bbox(camera_fb_t *fb, const detection_result_t *result)
         if (x2 < width) pixels[y * width + x2] = color;
     }
 }
+
+// RGB565 in camera byte order
+static inline uint16_t map_color(uint8_t r, uint8_t g, uint8_t b)
+{
+    return __builtin_bswap16(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+// Draw the cell counts of a scan, with the class and detection boxes, into
+// the class map
+static bool render_class_map(const class_grid_t *grid, const frame_stats_t *stats,
+                             const color_config_t *config, const detection_result_t *result)
+{
+    const int scale = BAND_WINDOW_CELL >> COLOR_DETECT_MAP_SHIFT;
+    const int cell_pixels = BAND_WINDOW_CELL * BAND_WINDOW_CELL;
+    uint16_t width = grid->cols * scale;
+    uint16_t height = grid->rows * scale;
+    size_t plane = (size_t)grid->cols * grid->rows;
+    size_t needed = (size_t)width * height * sizeof(uint16_t);
+
+    if (class_map_size < needed) {
+        heap_caps_free(class_map);
+        class_map = heap_caps_malloc(needed, MALLOC_CAP_SPIRAM);
+        class_map_size = class_map ? needed : 0;
+        if (!class_map) {
+            return false;
+        }
+    }
+
+    // A pixel belongs to one class, so the blend of a cell never saturates
+    for (int row = 0; row < grid->rows; row++) {
+        for (int col = 0; col < grid->cols; col++) {
+            const uint8_t *counts = grid->counts + row * grid->cols + col;
+            uint32_t r = 0, g = 0, b = 0;
+            for (int c = 0; c < grid->classes; c++) {
+                uint32_t n = counts[c * plane];
+                r += class_palette[c][0] * n;
+                g += class_palette[c][1] * n;
+                b += class_palette[c][2] * n;
+            }
+            uint16_t color = map_color(r / cell_pixels, g / cell_pixels, b / cell_pixels);
+            uint16_t *p = class_map + row * scale * width + col * scale;
+            for (int dy = 0; dy < scale; dy++) {
+                for (int dx = 0; dx < scale; dx++) {
+                    p[dy * width + dx] = color;
+                }
+            }
+        }
+    }
+
+    for (int c = 0; c < grid->classes; c++) {
+        const color_stats_t *cs = &stats->color[c];
+        if (cs->pixels >= config->min_area) {
+            draw_rect(class_map, width, height,
+                      cs->x_min >> COLOR_DETECT_MAP_SHIFT, cs->y_min >> COLOR_DETECT_MAP_SHIFT,
+                      cs->x_max >> COLOR_DETECT_MAP_SHIFT, cs->y_max >> COLOR_DETECT_MAP_SHIFT,
+                      map_color(class_palette[c][0], class_palette[c][1], class_palette[c][2]));
+        }
+    }
+    if (result->rgb_detected) {
+        draw_rect(class_map, width, height,
+                  result->bbox_x >> COLOR_DETECT_MAP_SHIFT, result->bbox_y >> COLOR_DETECT_MAP_SHIFT,
+                  (result->bbox_x + result->bbox_w) >> COLOR_DETECT_MAP_SHIFT,
+                  (result->bbox_y + result->bbox_h) >> COLOR_DETECT_MAP_SHIFT,
+                  map_color(255, 255, 255));
+    }
+
+    class_map_width = width;
+    class_map_height = height;
+    return true;
+}
+
+// Cost of one frame scan; times do not include waiting for another scan to
+// finish
+typedef struct {
+    uint64_t cycles;        // CPU cycles of all workers
+    uint32_t scan_us;       // Classification pass
+    uint32_t window_us;     // Integral images and window search
+    uint32_t windows;       // Candidate windows scored
+    float mask_skip;        // Share of pixels outside the mask
+} scan_cost_t;
+
+// Scan a frame and evaluate it with the active pattern, drawing the class
+// map if asked to
+static void scan_frame(const camera_fb_t *fb, const color_config_t *config, bool parallel,
+                       bool strips, bool render_map, detection_result_t *result, scan_cost_t *cost)
+{
+    scan_job_t job = {
+        .pixels = (const uint16_t *)fb->buf,
+        .width = fb->width,
+        .height = fb->height,
+        .use_strips = strips,
+    };
+    frame_stats_t stats;
+
+    memset(cost, 0, sizeof(scan_cost_t));
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    job.pattern = &patterns[active_pattern];
+    frame_width = fb->width;
+    frame_height = fb->height;
+
+    if (mask_config.region_count > 0) {
+        if (mask_dirty || roi_mask.width != fb->width || roi_mask.height != fb->height) {
+            esp_err_t ret = roi_mask_compile(&mask_config, fb->width, fb->height, &roi_mask);
+            if (ret != ESP_OK) {
+                // Scan whole frames until the mask or the frame size changes
+                ESP_LOGW(TAG, "Mask not applied: %s", esp_err_to_name(ret));
+                roi_mask.width = fb->width;
+                roi_mask.height = fb->height;
+            }
+            mask_dirty = false;
+        }
+        if (roi_mask.spans) {
+            job.mask = &roi_mask;
+            cost->mask_skip = 1.0f - (float)roi_mask.active_pixels / ((uint32_t)fb->width * fb->height);
+        }
+    }
+
+    // The class map is drawn from the cell counts, so they are kept for it
+    // even when windows are not scored
+    if (config->window_scoring || render_map) {
+        esp_err_t ret = class_grid_prepare(&class_grid, fb->width, fb->height, job.pattern->class_count);
+        if (ret == ESP_OK) {
+            job.grid = &class_grid;
+            class_grid_failed = false;
+        } else if (!class_grid_failed) {
+            ESP_LOGW(TAG, "No memory for window scoring grid, using alignment score");
+            class_grid_failed = true;
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+    if (parallel) {
+        parallel_worker_run(scan_part, &job);
+    } else {
+        for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+            scan_part(&job, i, PARALLEL_WORKER_COUNT);
+        }
+    }
+    int64_t scanned = esp_timer_get_time();
+    cost->scan_us = (uint32_t)(scanned - start);
+
+    frame_stats_init(&stats, fb->width, fb->height);
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        frame_stats_merge(&stats, &job.parts[i]);
+        cost->cycles += job.cycles[i];
+    }
+    const class_grid_t *windows_grid = config->window_scoring ? job.grid : NULL;
+    if (windows_grid) {
+        class_grid_integrate(job.grid);
+    }
+    // Evaluate before the pattern can be swapped
+    evaluate(&stats, job.pattern, config, windows_grid, fb->width, fb->height, result, &cost->windows);
+    if (windows_grid) {
+        cost->window_us = (uint32_t)(esp_timer_get_time() - scanned);
+    }
+    if (render_map) {
+        class_map_ready = job.grid && render_class_map(job.grid, &stats, config, result);
+    }
+    xSemaphoreGive(scan_mutex);
+}
+
+bool color_detect_frame_due(void)
+{
+    frame_counter++;
+    return frame_counter % current_config.frame_decimation == 0;
+}
+
+esp_err_t color_detect_process(camera_fb_t *fb, detection_result_t *result)
+{
+    if (!fb || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(result, 0, sizeof(detection_result_t));
+
+    // A requested switch takes effect between two frames
+    if (__atomic_load_n(&switch_pending, __ATOMIC_RELAXED)) {
+        xSemaphoreTake(scan_mutex, portMAX_DELAY);
+        if (switch_pending) {
+            swap_standby();
+        }
+        xSemaphoreGive(scan_mutex);
+    }
+
+    if (fb->format != PIXFORMAT_RGB565) {
+        ESP_LOGE(TAG, "Unsupported pixel format");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint16_t width = fb->width;
+    uint16_t height = fb->height;
+
+    // Scan the frame in row bands (one per core), merge the partial
+    // statistics and match the pattern sequences
+    scan_cost_t cost;
+    bool render_map = __atomic_load_n(&class_map_enabled, __ATOMIC_RELAXED);
+    class_map_ready = false;
+    scan_frame(fb, &current_config, parallel_enabled, strips_enabled, render_map, result, &cost);
+    uint32_t elapsed = cost.scan_us + cost.window_us;
+
+    detect_stats.frames++;
+    detect_stats.last_us = elapsed;
+    detect_stats.avg_us = (detect_stats.frames == 1) ? elapsed : (detect_stats.avg_us * 7 + elapsed) / 8;
+    detect_stats.parallel = parallel_enabled;
+    detect_stats.strips = strips_enabled;
+    detect_stats.cycles_per_pixel = (float)cost.cycles / ((uint32_t)width * height);
+    detect_stats.windows = cost.windows;
+    detect_stats.window_us = cost.window_us;
+    detect_stats.mask_skip = cost.mask_skip;
+
+    if (result->rgb_detected) {
+        ESP_LOGI(TAG, "Bands detected (sequence %d)! Confidence: %d%%, BBox: (%d,%d,%d,%d), angle %d",
+                 result->sequence, result->confidence, result->bbox_x, result->bbox_y,
+                 result->bbox_w, result->bbox_h, result->angle);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t color_detect_run(const camera_fb_t *fb, bool parallel, bool strips,
+                           detection_result_t *result, uint32_t *elapsed_us)
+{
+    if (!fb || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (fb->format != PIXFORMAT_RGB565) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memset(result, 0, sizeof(detection_result_t));
+
+    color_config_t config;
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+    memcpy(&config, &current_config, sizeof(color_config_t));
+    xSemaphoreGive(scan_mutex);
+
+    scan_cost_t cost;
+    scan_frame(fb, &config, parallel, strips, false, result, &cost);
+
+    if (elapsed_us) {
+        *elapsed_us = cost.scan_us + cost.window_us;
+    }
+    return ESP_OK;
+}
+
+// Scan and evaluate a frame with a compiled candidate pattern, mask and grid
+static void preview_scan(const camera_fb_t *fb, const color_config_t *config, const color_pattern_t *pattern,
+                         const roi_mask_t *mask, class_grid_t *grid, color_detect_preview_t *preview)
+{
+    preview->class_count = pattern->class_count;
+    if (mask) {
+        preview->mask_skip = 1.0f - (float)mask->active_pixels / ((uint32_t)fb->width * fb->height);
+    }
+
+    // Straight from PSRAM on this core: the strip buffers and the other
+    // core's worker belong to the pipeline
+    int64_t start = esp_timer_get_time();
+    frame_stats_init(&preview->stats, fb->width, fb->height);
+    color_detect_scan_rows((const uint16_t *)fb->buf, fb->width, 0, fb->height, pattern, mask,
+                           &preview->stats, grid);
+    int64_t scanned = esp_timer_get_time();
+    preview->scan_us = (uint32_t)(scanned - start);
+
+    if (grid) {
+        class_grid_integrate(grid);
+    }
+    evaluate(&preview->stats, pattern, config, grid, fb->width, fb->height, &preview->result, &preview->windows);
+    if (grid) {
+        preview->window_us = (uint32_t)(esp_timer_get_time() - scanned);
+    }
+}
+
+esp_err_t color_detect_preview(const camera_fb_t *fb, const color_config_t *config,
+                               const pattern_config_t *pattern, color_detect_preview_t *preview)
+{
+    if (!fb || !config || !pattern || !preview) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (fb->format != PIXFORMAT_RGB565) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memset(preview, 0, sizeof(color_detect_preview_t));
+    color_pattern_t *compiled = malloc(sizeof(color_pattern_t));
+    if (!compiled) {
+        return ESP_ERR_NO_MEM;
+    }
+    roi_mask_t mask = {0};
+    class_grid_t grid = {0};
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = color_pattern_compile(pattern, compiled);
+    if (ret == ESP_OK && config->mask.region_count > 0) {
+        ret = roi_mask_compile(&config->mask, fb->width, fb->height, &mask);
+    }
+    if (ret == ESP_OK && config->window_scoring) {
+        ret = class_grid_prepare(&grid, fb->width, fb->height, compiled->class_count);
+    }
+    if (ret == ESP_OK) {
+        preview->compile_us = (uint32_t)(esp_timer_get_time() - start);
+        preview_scan(fb, config, compiled, mask.spans ? &mask : NULL, grid.counts ? &grid : NULL, preview);
+    }
+
+    class_grid_free(&grid);
+    roi_mask_free(&mask);
+    free(compiled);
+    return ret;
+}
+
+void color_detect_set_parallel(bool enable)
+{
+    parallel_enabled = enable;
+    ESP_LOGI(TAG, "Parallel scan %s", enable ? "enabled" : "disabled");
+}
+
+void color_detect_set_strips(bool enable)
+{
+    strips_enabled = enable;
+    ESP_LOGI(TAG, "Strip processing %s", enable ? "enabled" : "disabled");
+}
+
+void color_detect_set_class_map(bool enable)
+{
+    __atomic_store_n(&class_map_enabled, enable, __ATOMIC_RELAXED);
+}
+
+esp_err_t color_detect_get_class_map(camera_fb_t *map)
+{
+    if (!map) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!class_map_ready) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    memset(map, 0, sizeof(camera_fb_t));
+    map->buf = (uint8_t *)class_map;
+    map->len = (size_t)class_map_width * class_map_height * sizeof(uint16_t);
+    map->width = class_map_width;
+    map->height = class_map_height;
+    map->format = PIXFORMAT_RGB565;
+    return ESP_OK;
+}
+
+void color_detect_get_stats(color_detect_stats_t *stats)
+{
+    if (stats) {
+        memcpy(stats, &detect_stats, sizeof(color_detect_stats_t));
+    }
+}
+
+void color_detect_draw_bbox(camera_fb_t *fb, const detection_result_t *result)
+{
+    if (!fb || !result || !result->rgb_detected) {
+        return;
+    }
+
+    if (fb->format != PIXFORMAT_RGB565) {
+        return;
+    }
+
+    // Yellow color in RGB565 (RGB 255,255,0 -> 0xFFE0)
+    draw_rect((uint16_t *)fb->buf, fb->width, fb->height, result->bbox_x, result->bbox_y,
+              result->bbox_x + result->bbox_w, result->bbox_y + result->bbox_h, 0xFFE0);
+}
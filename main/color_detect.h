@@ -9,19 +9,88 @@
 
 #include "esp_camera.h"
 #include "config_store.h"
+#include "color_pattern.h"
+#include "band_window.h"
+#include "roi_mask.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+// Rows per strip copied from PSRAM into internal SRAM line buffers
+#define COLOR_DETECT_STRIP_ROWS 8
+
+// One class map pixel covers 4x4 frame pixels (160x120 at VGA)
+#define COLOR_DETECT_MAP_SHIFT  2
+
 // Detection result structure
 typedef struct {
-    bool rgb_detected;      // True if R-G-B bands detected in order
+    bool rgb_detected;      // True if the bands of a pattern sequence were detected in order
     uint8_t confidence;     // Detection confidence (0-100)
+    uint8_t sequence;       // Index of the detected pattern sequence
+    int16_t angle;          // Direction of the band sequence, degrees clockwise from +x
     uint16_t bbox_x;        // Bounding box top-left X
     uint16_t bbox_y;        // Bounding box top-left Y
     uint16_t bbox_w;        // Bounding box width
     uint16_t bbox_h;        // Bounding box height
 } detection_result_t;
 
+// Statistics of one color class over a set of rows
+typedef struct {
+    uint32_t pixels;        // Matching pixel count
+    uint16_t x_min;         // Bounding box of matching pixels
+    uint16_t x_max;
+    uint16_t y_min;
+    uint16_t y_max;
+    uint64_t sum_x;         // First moments (sum of x and y)
+    uint64_t sum_y;
+    uint64_t sum_xx;        // Second moments (sum of x*x, x*y and y*y)
+    uint64_t sum_xy;
+    uint64_t sum_yy;
+} color_stats_t;
+
+// Blob geometry derived from the moments of one color class
+typedef struct {
+    float cx;               // Centroid
+    float cy;
+    float angle;            // Major axis direction, degrees clockwise from +x (-90..90)
+    float elongation;       // Major to minor axis length ratio (1 = no preferred direction)
+} blob_geometry_t;
+
+// Partial statistics of a frame region; partials merge associatively
+typedef struct {
+    color_stats_t color[PATTERN_MAX_CLASSES];  // Indexed by pattern class
+} frame_stats_t;
+
+// Detector timing statistics
+typedef struct {
+    uint32_t frames;        // Frames scanned since boot
+    uint32_t last_us;       // Scan time of the last frame
+    uint32_t avg_us;        // Running average scan time
+    bool parallel;          // Last scan was split across both cores
+    bool strips;            // Last scan read through internal SRAM line buffers
+    float cycles_per_pixel; // CPU cycles per pixel summed over all workers
+    uint32_t windows;       // Candidate band windows scored in the last frame
+    uint32_t window_us;     // Integral images and window search time of the last frame
+    float mask_skip;        // Share of pixels outside the regions of interest (0-1)
+} color_detect_stats_t;
+
+// Outcome of a dry run of a candidate configuration
+typedef struct {
+    detection_result_t result;
+    frame_stats_t stats;    // Indexed by class of the candidate pattern
+    uint8_t class_count;
+    uint32_t compile_us;    // Pattern tables, mask spans and grid
+    uint32_t scan_us;
+    uint32_t window_us;     // Integral images and window search
+    uint32_t windows;       // Candidate band windows scored
+    float mask_skip;        // Share of pixels outside the regions of interest (0-1)
+} color_detect_preview_t;
+
+// Timing of a switch to the standby configuration
+typedef struct {
+    uint32_t wait_us;       // From the request to the next frame boundary
+    uint32_t swap_us;       // Exchange of the states, the only time scans wait
+} color_detect_switch_t;
+
 /**
  * @brief Initialize color detection module
  * 
@@ -37,15 +106,146 @@ esp_err_t color_detect_init(const color_config_t *config);
  */
 void color_detect_update_config(const color_config_t *config);
 
+/**
+ * @brief Compile and activate a band pattern
+ * 
+ * The compiled tables are swapped in between two scans.
+ * 
+ * @param pattern Pattern description
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the pattern is invalid
+ */
+esp_err_t color_detect_set_pattern(const pattern_config_t *pattern);
+
+/**
+ * @brief Get the active band pattern description
+ * 
+ * @param pattern Pointer to pattern structure to fill
+ */
+void color_detect_get_pattern(pattern_config_t *pattern);
+
+/**
+ * @brief Compile a configuration and pattern into the standby state
+ * 
+ * The classification tables and the mask (for the size of the last scanned
+ * frame) are built while scans go on with the active state, so that
+ * color_detect_switch() only exchanges the two. Replaces the previous
+ * standby state; one caller at a time.
+ * 
+ * @param config Detection configuration
+ * @param pattern Band pattern
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the pattern or mask is
+ *         invalid, ESP_ERR_INVALID_STATE while a switch is pending
+ */
+esp_err_t color_detect_stage(const color_config_t *config, const pattern_config_t *pattern);
+
+/**
+ * @brief Make the standby state active at the next frame boundary
+ * 
+ * The next color_detect_process() exchanges the active and standby states,
+ * so the state left stays compiled and switching back is as fast. The
+ * pipeline processes the next frame whatever the decimation and restarts
+ * the decimation from it. Waits for the exchange.
+ * 
+ * @param timeout_ms Longest wait for a frame; the switch is dropped after it
+ * @param timing Set to the switch timing (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if nothing is staged or a
+ *         switch is pending, ESP_ERR_TIMEOUT if no frame was processed in time
+ */
+esp_err_t color_detect_switch(uint32_t timeout_ms, color_detect_switch_t *timing);
+
+/**
+ * @brief Check whether a switch waits for the next frame
+ * 
+ * @return true while color_detect_switch() waits
+ */
+bool color_detect_switch_pending(void);
+
+/**
+ * @brief Get the version of the active configuration
+ * 
+ * Starts at 1 and is incremented by every color_detect_update_config() and
+ * color_detect_set_pattern().
+ * 
+ * @return Configuration version
+ */
+uint16_t color_detect_get_config_version(void);
+
+/**
+ * @brief Count a captured frame against the frame decimation
+ * 
+ * Called once per captured frame, whether it is processed or not, so the
+ * decimation follows the camera rate.
+ * 
+ * @return true if the frame is due for a scan (every frame_decimation-th)
+ */
+bool color_detect_frame_due(void);
+
 /**
  * @brief Process frame for color detection
  * 
+ * Scans every frame it is given; the caller applies the decimation with
+ * color_detect_frame_due().
+ * 
  * @param fb Camera frame buffer (RGB565 format)
  * @param result Pointer to store detection result
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t color_detect_process(camera_fb_t *fb, detection_result_t *result);
 
+/**
+ * @brief Run detection on one frame with an explicit scan engine
+ * 
+ * Uses the active configuration but ignores decimation and does not update
+ * the detector statistics; for benchmarks. Scans are serialized with the
+ * pipeline, so the elapsed time excludes waiting for it.
+ * 
+ * @param fb Frame buffer (RGB565 format), not modified
+ * @param parallel Split the scan across both cores
+ * @param strips Read through internal SRAM line buffers
+ * @param result Pointer to store detection result
+ * @param elapsed_us Set to the scan time (may be NULL)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t color_detect_run(const camera_fb_t *fb, bool parallel, bool strips,
+                           detection_result_t *result, uint32_t *elapsed_us);
+
+/**
+ * @brief Run detection on one frame with a candidate configuration
+ * 
+ * Compiles the pattern and mask into buffers of its own and scans the frame
+ * on the calling core, so neither the active configuration nor the
+ * pipeline's scan is touched or waited for. Reentrant; meant for a task of
+ * low priority.
+ * 
+ * @param fb Frame buffer (RGB565 format), not modified
+ * @param config Candidate detection configuration (decimation is ignored)
+ * @param pattern Candidate band pattern
+ * @param preview Pointer to store the outcome
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the pattern or mask is
+ *         invalid, ESP_ERR_NO_MEM if the buffers cannot be allocated
+ */
+esp_err_t color_detect_preview(const camera_fb_t *fb, const color_config_t *config,
+                               const pattern_config_t *pattern, color_detect_preview_t *preview);
+
+/**
+ * @brief Classify rows of RGB565 pixels and accumulate per-class statistics
+ * 
+ * The inner loop of every scan engine.
+ * 
+ * @param rows First pixel of row y_start
+ * @param width Frame width
+ * @param y_start First row
+ * @param y_end Row past the last one
+ * @param pattern Compiled band pattern
+ * @param mask Active pixel spans (NULL for whole rows)
+ * @param stats Statistics to accumulate into
+ * @param grid Cell counts to accumulate into (NULL to skip); y_start must be
+ *             a cell boundary when other rows of the cell are scanned concurrently
+ */
+void color_detect_scan_rows(const uint16_t *rows, uint16_t width, uint16_t y_start, uint16_t y_end,
+                            const color_pattern_t *pattern, const roi_mask_t *mask,
+                            frame_stats_t *stats, class_grid_t *grid);
+
 /**
  * @brief Draw bounding box on RGB565 frame buffer
  * 
@@ -54,4 +254,78 @@ esp_err_t color_detect_process(camera_fb_t *fb, detection_result_t *result);
  */
 void color_detect_draw_bbox(camera_fb_t *fb, const detection_result_t *result);
 
+/**
+ * @brief Reset frame statistics to the empty state
+ * 
+ * @param stats Statistics to reset
+ * @param width Frame width
+ * @param height Frame height
+ */
+void frame_stats_init(frame_stats_t *stats, uint16_t width, uint16_t height);
+
+/**
+ * @brief Merge partial statistics of another region into dst
+ * 
+ * @param dst Accumulated statistics
+ * @param src Partial statistics to add
+ */
+void frame_stats_merge(frame_stats_t *dst, const frame_stats_t *src);
+
+/**
+ * @brief Derive centroid, orientation and elongation from class statistics
+ * 
+ * @param stats Merged statistics of one color class
+ * @param geometry Pointer to geometry structure to fill
+ * @return true on success, false if the class has no pixels
+ */
+bool color_stats_geometry(const color_stats_t *stats, blob_geometry_t *geometry);
+
+/**
+ * @brief Enable or disable splitting the frame scan across both cores
+ * 
+ * @param enable true to scan on both cores (default), false for a single core
+ */
+void color_detect_set_parallel(bool enable);
+
+/**
+ * @brief Enable or disable strip processing through internal SRAM line buffers
+ * 
+ * @param enable true to copy row strips out of PSRAM before classifying them (default),
+ *               false to read the frame buffer in place
+ */
+void color_detect_set_strips(bool enable);
+
+/**
+ * @brief Render the class map of every processed frame
+ * 
+ * While enabled, color_detect_process() counts class pixels per grid cell
+ * even with window scoring off and draws the counts into a class map.
+ * 
+ * @param enable true while a class map is wanted
+ */
+void color_detect_set_class_map(bool enable);
+
+/**
+ * @brief Get the class map of the last processed frame
+ * 
+ * Each map pixel shows the classes of its grid cell in their palette colors
+ * (class 0 red, 1 green, 2 blue, then yellow, magenta, cyan, orange and
+ * violet), brighter the more of the cell they cover, with the bounding box
+ * of every class of at least min_area pixels in its color and the detection
+ * in white. The map belongs to the detector and is redrawn by the next
+ * color_detect_process(), so it is read by the task that processes frames.
+ * 
+ * @param map Filled with the map (RGB565, big-endian like camera frames)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the last processed frame
+ *         has no class map
+ */
+esp_err_t color_detect_get_class_map(camera_fb_t *map);
+
+/**
+ * @brief Get detector timing statistics
+ * 
+ * @param stats Pointer to stats structure to fill
+ */
+void color_detect_get_stats(color_detect_stats_t *stats);
+
 #endif // COLOR_DETECT_H
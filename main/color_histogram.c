@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Region histograms and threshold suggestion
+ */
+
+#include "color_histogram.h"
+#include "color_kernels.h"
+#include <sys/param.h>
+#include <string.h>
+
+#define PERCENTILE_MAX      25
+#define SAT_FLOOR           64      // Pixels less saturated than this have no reliable hue
+#define PEAK_WINDOW         16      // Hue window searched for the dominant color
+#define HUE_SPAN            32      // Hues kept on each side of the dominant one (45 degrees)
+
+esp_err_t color_histogram_compute(const camera_fb_t *fb, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                                  color_histogram_t *hist)
+{
+    if (!fb || !hist) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (fb->format != PIXFORMAT_RGB565) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (x >= fb->width || y >= fb->height || w == 0 || h == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(hist, 0, sizeof(color_histogram_t));
+    hist->x = x;
+    hist->y = y;
+    hist->w = MIN(w, fb->width - x);
+    hist->h = MIN(h, fb->height - y);
+    hist->pixels = (uint32_t)hist->w * hist->h;
+
+    const uint16_t *pixels = (const uint16_t *)fb->buf;
+    for (uint16_t row = y; row < y + hist->h; row++) {
+        const uint16_t *p = pixels + (size_t)row * fb->width + x;
+        for (uint16_t i = 0; i < hist->w; i++) {
+            uint8_t r, g, b, hue, sat, val;
+            rgb565_to_rgb888(p[i], &r, &g, &b);
+            rgb_to_hsv(r, g, b, &hue, &sat, &val);
+            hist->hue[hue]++;
+            hist->sat[sat]++;
+            hist->val[val]++;
+            hist->hs[hue][sat >> HISTOGRAM_S_SHIFT]++;
+        }
+    }
+    return ESP_OK;
+}
+
+// Narrowest range leaving at most cut pixels below it and cut above it
+static void percentile_bounds(const uint32_t *bins, int count, uint32_t cut, int *lo, int *hi)
+{
+    uint32_t sum = 0;
+    int i = 0;
+    while (i < count - 1 && sum + bins[i] <= cut) {
+        sum += bins[i++];
+    }
+    *lo = i;
+
+    sum = 0;
+    i = count - 1;
+    while (i > *lo && sum + bins[i] <= cut) {
+        sum += bins[i--];
+    }
+    *hi = i;
+}
+
+// Signed hue distance from center, on the 256-step hue circle
+static inline int hue_offset(uint8_t hue, uint8_t center)
+{
+    return (int8_t)(uint8_t)(hue - center);
+}
+
+esp_err_t color_histogram_suggest(const camera_fb_t *fb, const color_histogram_t *hist,
+                                  uint8_t percentile, hsv_threshold_t *thresh, uint32_t *matched)
+{
+    if (!fb || !hist || !thresh || percentile > PERCENTILE_MAX || hist->pixels == 0 ||
+        fb->format != PIXFORMAT_RGB565 || hist->x + hist->w > fb->width || hist->y + hist->h > fb->height) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Dominant hue of the saturated pixels: the center of the busiest
+    // window of the hue circle
+    uint32_t hue[256];
+    for (int i = 0; i < 256; i++) {
+        hue[i] = 0;
+        for (int s = SAT_FLOOR >> HISTOGRAM_S_SHIFT; s < HISTOGRAM_S_BINS; s++) {
+            hue[i] += hist->hs[i][s];
+        }
+    }
+    uint32_t window = 0, best = 0;
+    int center = 0;
+    for (int i = 0; i < PEAK_WINDOW; i++) {
+        window += hue[i];
+    }
+    for (int i = 0; i < 256; i++) {
+        if (window > best) {
+            best = window;
+            center = (i + PEAK_WINDOW / 2) & 255;
+        }
+        window += hue[(i + PEAK_WINDOW) & 255] - hue[i];
+    }
+    if (best == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Second pass over the pixels of that color only, so background and
+    // neighbouring bands inside the region do not widen the ranges
+    uint32_t hue_bins[2 * HUE_SPAN + 1], sat_bins[256], val_bins[256];
+    memset(hue_bins, 0, sizeof(hue_bins));
+    memset(sat_bins, 0, sizeof(sat_bins));
+    memset(val_bins, 0, sizeof(val_bins));
+    uint32_t count = 0;
+
+    const uint16_t *pixels = (const uint16_t *)fb->buf;
+    for (uint16_t row = hist->y; row < hist->y + hist->h; row++) {
+        const uint16_t *p = pixels + (size_t)row * fb->width + hist->x;
+        for (uint16_t i = 0; i < hist->w; i++) {
+            uint8_t r, g, b, h, s, v;
+            rgb565_to_rgb888(p[i], &r, &g, &b);
+            rgb_to_hsv(r, g, b, &h, &s, &v);
+            int d = hue_offset(h, center);
+            if (s >= SAT_FLOOR && d >= -HUE_SPAN && d <= HUE_SPAN) {
+                hue_bins[d + HUE_SPAN]++;
+                sat_bins[s]++;
+                val_bins[v]++;
+                count++;
+            }
+        }
+    }
+
+    uint32_t cut = (uint64_t)count * percentile / 100;
+    int lo, hi;
+    percentile_bounds(hue_bins, 2 * HUE_SPAN + 1, cut, &lo, &hi);
+    thresh->h_min = (center + lo - HUE_SPAN) & 255;
+    thresh->h_max = (center + hi - HUE_SPAN) & 255;
+    percentile_bounds(sat_bins, 256, cut, &lo, &hi);
+    thresh->s_min = lo;
+    thresh->s_max = hi;
+    percentile_bounds(val_bins, 256, cut, &lo, &hi);
+    thresh->v_min = lo;
+    thresh->v_max = hi;
+
+    if (matched) {
+        *matched = count;
+    }
+    return ESP_OK;
+}
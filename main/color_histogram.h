@@ -0,0 +1,72 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * HSV histograms of a frame region and threshold suggestions
+ */
+
+#ifndef COLOR_HISTOGRAM_H
+#define COLOR_HISTOGRAM_H
+
+#include "esp_camera.h"
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdint.h>
+
+// Saturation bins of the H x S histogram (8 saturation values each); hue
+// keeps its full resolution
+#define HISTOGRAM_S_BINS        32
+#define HISTOGRAM_S_SHIFT       3
+
+// Histograms of a region (about 35 KB, allocate on the heap)
+typedef struct {
+    uint16_t x;                 // Region actually used, clipped to the frame
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint32_t pixels;
+    uint32_t hue[256];
+    uint32_t sat[256];
+    uint32_t val[256];
+    uint32_t hs[256][HISTOGRAM_S_BINS];
+} color_histogram_t;
+
+/**
+ * @brief Build the H, S, V and H x S histograms of a frame region
+ *
+ * One pass over the region with the detector's own color conversion, so
+ * the values are those the classification tables see.
+ *
+ * @param fb RGB565 frame
+ * @param x Region left edge
+ * @param y Region top edge
+ * @param w Region width (clipped to the frame)
+ * @param h Region height (clipped to the frame)
+ * @param hist Histograms to fill
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the region is empty,
+ *         ESP_ERR_NOT_SUPPORTED if the frame is not RGB565
+ */
+esp_err_t color_histogram_compute(const camera_fb_t *fb, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                                  color_histogram_t *hist);
+
+/**
+ * @brief Propose class thresholds for the dominant color of a region
+ *
+ * The dominant color is the busiest hue of the pixels with a saturation
+ * of 64 or more. A second pass over the region keeps only the pixels
+ * within 45 degrees of that hue and cuts the given percentile from both
+ * ends of their hue, saturation and value ranges, so background and other
+ * bands caught in the region do not widen the proposal. The hue range
+ * wraps (h_min > h_max) for colors around red.
+ *
+ * @param fb Frame the histograms were built from
+ * @param hist Region histograms
+ * @param percentile Share of the pixels cut from each end of each channel (0-25)
+ * @param thresh Proposed thresholds
+ * @param matched Set to the number of pixels the proposal was taken from (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if an argument is out of
+ *         range, ESP_ERR_NOT_FOUND if the region has no saturated pixels
+ */
+esp_err_t color_histogram_suggest(const camera_fb_t *fb, const color_histogram_t *hist,
+                                  uint8_t percentile, hsv_threshold_t *thresh, uint32_t *matched);
+
+#endif // COLOR_HISTOGRAM_H
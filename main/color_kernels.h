@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Per-pixel kernels of the color detector, shared with the kernel benchmark
+ */
+
+#ifndef COLOR_KERNELS_H
+#define COLOR_KERNELS_H
+
+#include "color_pattern.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Convert RGB565 to RGB888. The pixel is read from the frame as a 16-bit
+// word, so on this little-endian CPU the camera's big-endian byte order
+// arrives swapped.
+static inline void rgb565_to_rgb888(uint16_t pixel, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    uint16_t rgb565 = __builtin_bswap16(pixel);
+    *r = ((rgb565 >> 11) & 0x1F) << 3;
+    *g = ((rgb565 >> 5) & 0x3F) << 2;
+    *b = (rgb565 & 0x1F) << 3;
+}
+
+// Convert RGB to simplified HSV (0-255 range for all channels)
+static inline void rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b, uint8_t *h, uint8_t *s, uint8_t *v)
+{
+    uint8_t max_val = (r > g) ? ((r > b) ? r : b) : ((g > b) ? g : b);
+    uint8_t min_val = (r < g) ? ((r < b) ? r : b) : ((g < b) ? g : b);
+    uint8_t delta = max_val - min_val;
+
+    *v = max_val;
+
+    if (max_val == 0) {
+        *s = 0;
+        *h = 0;
+        return;
+    }
+
+    *s = (uint8_t)(((uint16_t)delta * 255) / max_val);
+
+    if (delta == 0) {
+        *h = 0;
+    } else {
+        int h_temp;
+        if (max_val == r) {
+            h_temp = (g - b) * 42 / delta;
+        } else if (max_val == g) {
+            h_temp = 85 + (b - r) * 42 / delta;
+        } else {
+            h_temp = 170 + (r - g) * 42 / delta;
+        }
+        
+        if (h_temp < 0) h_temp += 255;
+        *h = (uint8_t)h_temp;
+    }
+}
+
+// Class of an HSV pixel: the lowest class whose ranges contain it, -1 if none
+static inline int hsv_classify(uint8_t h, uint8_t s, uint8_t v, const color_pattern_t *pattern)
+{
+    uint8_t match = pattern->h[h] & pattern->s[s] & pattern->v[v];
+    return match ? __builtin_ctz(match) : -1;
+}
+
+#endif // COLOR_KERNELS_H
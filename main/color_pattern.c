@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Band pattern compiler
+ */
+
+#include "color_pattern.h"
+#include <string.h>
+
+esp_err_t color_pattern_validate(const pattern_config_t *config)
+{
+    if (!config || config->class_count == 0 || config->class_count > PATTERN_MAX_CLASSES ||
+        config->sequence_count == 0 || config->sequence_count > PATTERN_MAX_SEQUENCES ||
+        config->orientation > PATTERN_VERTICAL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < config->class_count; i++) {
+        const char *name = config->classes[i].name;
+        if (name[0] == '\0' || memchr(name, '\0', PATTERN_NAME_LEN) == NULL) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int j = 0; j < i; j++) {
+            if (strcmp(name, config->classes[j].name) == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    for (int i = 0; i < config->sequence_count; i++) {
+        const band_sequence_t *seq = &config->sequences[i];
+        if (seq->length < 2 || seq->length > config->class_count) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        // Each class has one set of statistics, so it can appear only once
+        uint32_t used = 0;
+        for (int b = 0; b < seq->length; b++) {
+            uint8_t c = seq->classes[b];
+            if (c >= config->class_count || (used & (1u << c))) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            used |= 1u << c;
+        }
+    }
+    return ESP_OK;
+}
+
+// Set bit in table[lo..hi]; lo > hi wraps around (red hues)
+static void mark_range(uint8_t *table, uint8_t lo, uint8_t hi, uint8_t bit)
+{
+    for (int x = 0; x < 256; x++) {
+        bool in = lo <= hi ? (x >= lo && x <= hi) : (x >= lo || x <= hi);
+        if (in) {
+            table[x] |= bit;
+        }
+    }
+}
+
+esp_err_t color_pattern_compile(const pattern_config_t *config, color_pattern_t *pattern)
+{
+    esp_err_t ret = color_pattern_validate(config);
+    if (ret != ESP_OK || !pattern) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(pattern, 0, sizeof(color_pattern_t));
+    for (int c = 0; c < config->class_count; c++) {
+        const hsv_threshold_t *t = &config->classes[c].thresh;
+        uint8_t bit = 1u << c;
+        mark_range(pattern->h, t->h_min, t->h_max, bit);
+        // Saturation and value ranges never wrap
+        if (t->s_min <= t->s_max) {
+            mark_range(pattern->s, t->s_min, t->s_max, bit);
+        }
+        if (t->v_min <= t->v_max) {
+            mark_range(pattern->v, t->v_min, t->v_max, bit);
+        }
+    }
+
+    pattern->class_count = config->class_count;
+    pattern->sequence_count = config->sequence_count;
+    pattern->orientation = config->orientation;
+    memcpy(pattern->sequences, config->sequences, sizeof(pattern->sequences));
+    return ESP_OK;
+}
+
+int color_pattern_find_class(const pattern_config_t *config, const char *name)
+{
+    for (int i = 0; i < config->class_count; i++) {
+        if (strcmp(config->classes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Band patterns compiled into per-channel classification tables
+ */
+
+#ifndef COLOR_PATTERN_H
+#define COLOR_PATTERN_H
+
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Compiled band pattern. Bit c of h[h], s[s] and v[v] is set when the value
+// lies inside class c's range, so a pixel's classes are the AND of three
+// lookups whatever the number of classes; the lowest set bit wins.
+typedef struct {
+    uint8_t h[256];
+    uint8_t s[256];
+    uint8_t v[256];
+    uint8_t class_count;
+    uint8_t sequence_count;
+    uint8_t orientation;                    // pattern_orientation_t
+    band_sequence_t sequences[PATTERN_MAX_SEQUENCES];
+} color_pattern_t;
+
+/**
+ * @brief Check a pattern description
+ *
+ * Needs 1..PATTERN_MAX_CLASSES classes with distinct, non-empty names and
+ * 1..PATTERN_MAX_SEQUENCES sequences of 2 or more existing classes, none
+ * used twice in a sequence.
+ *
+ * @param config Pattern description
+ * @return ESP_OK if valid, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t color_pattern_validate(const pattern_config_t *config);
+
+/**
+ * @brief Compile a pattern description into classification tables
+ *
+ * @param config Pattern description
+ * @param pattern Compiled pattern to fill
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the description is invalid
+ */
+esp_err_t color_pattern_compile(const pattern_config_t *config, color_pattern_t *pattern);
+
+/**
+ * @brief Find a class by name
+ *
+ * @param config Pattern description
+ * @param name Class name
+ * @return Class index, or -1 if there is none
+ */
+int color_pattern_find_class(const pattern_config_t *config, const char *name);
+
+#endif // COLOR_PATTERN_H
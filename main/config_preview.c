@@ -0,0 +1,139 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Config preview implementation
+ */
+
+#include "config_preview.h"
+#include "frame_pipeline.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "config_preview";
+
+#define PREVIEW_STACK_SIZE  6144    // Compiled pattern and statistics on the stack
+#define PREVIEW_PRIORITY    1       // Below the pipeline, the workers and the web server
+#define PREVIEW_TIMEOUT_MS  3000    // Longest wait for a new frame
+#define PREVIEW_RUN_MS      5000    // Longest wait of the caller for the whole run
+
+// One run, shared by the caller and the task: the caller may give up on a
+// starved task, so whichever of the two lets go last frees it
+typedef struct {
+    color_config_t config;
+    pattern_config_t pattern;
+    bool refresh;
+    config_preview_report_t report;
+    esp_err_t err;
+    SemaphoreHandle_t done;
+    int refs;
+} preview_run_t;
+
+static portMUX_TYPE run_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool running = false;
+
+static void run_release(preview_run_t *run)
+{
+    taskENTER_CRITICAL(&run_lock);
+    bool last = (--run->refs == 0);
+    taskEXIT_CRITICAL(&run_lock);
+
+    if (last) {
+        vSemaphoreDelete(run->done);
+        free(run);
+    }
+}
+
+static void preview_task(void *arg)
+{
+    preview_run_t *run = arg;
+    config_preview_report_t *report = &run->report;
+    camera_fb_t fb;
+
+    int64_t start = esp_timer_get_time();
+    run->err = frame_pipeline_snapshot(&fb, run->refresh, PREVIEW_TIMEOUT_MS);
+    int64_t taken = esp_timer_get_time();
+
+    if (run->err == ESP_OK) {
+        report->width = fb.width;
+        report->height = fb.height;
+        report->timestamp_us = (int64_t)fb.timestamp.tv_sec * 1000000 + fb.timestamp.tv_usec;
+        run->err = color_detect_preview(&fb, &run->config, &run->pattern, &report->detect);
+        frame_pipeline_snapshot_release();
+    }
+    report->wait_us = (uint32_t)(taken - start);
+    report->total_us = (uint32_t)(esp_timer_get_time() - start);
+
+    // The next run may start once this one stops using the snapshot
+    xSemaphoreGive(run->done);
+    taskENTER_CRITICAL(&run_lock);
+    running = false;
+    taskEXIT_CRITICAL(&run_lock);
+    run_release(run);
+    vTaskDelete(NULL);
+}
+
+esp_err_t config_preview_run(const color_config_t *config, const pattern_config_t *pattern,
+                             bool refresh, config_preview_report_t *report)
+{
+    if (!config || !pattern || !report) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    preview_run_t *run = calloc(1, sizeof(preview_run_t));
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (!run || !done) {
+        free(run);
+        if (done) {
+            vSemaphoreDelete(done);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    run->config = *config;
+    run->pattern = *pattern;
+    run->refresh = refresh;
+    run->done = done;
+    run->refs = 2;
+
+    // A run the caller gave up on keeps the task busy until it finishes
+    taskENTER_CRITICAL(&run_lock);
+    bool busy = running;
+    running = true;
+    taskEXIT_CRITICAL(&run_lock);
+    if (busy) {
+        vSemaphoreDelete(done);
+        free(run);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xTaskCreate(preview_task, "config_preview", PREVIEW_STACK_SIZE, run,
+                    PREVIEW_PRIORITY, NULL) != pdPASS) {
+        taskENTER_CRITICAL(&run_lock);
+        running = false;
+        taskEXIT_CRITICAL(&run_lock);
+        vSemaphoreDelete(done);
+        free(run);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xSemaphoreTake(run->done, pdMS_TO_TICKS(PREVIEW_RUN_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Preview not done after %d ms", PREVIEW_RUN_MS);
+        run_release(run);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t err = run->err;
+    memcpy(report, &run->report, sizeof(config_preview_report_t));
+    run_release(run);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Preview on %ux%u: %s, scan %lu us", report->width, report->height,
+                 report->detect.result.rgb_detected ? "detected" : "nothing",
+                 (unsigned long)report->detect.scan_us);
+    }
+    return err;
+}
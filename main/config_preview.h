@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Dry runs of candidate detection configurations on a held frame
+ */
+
+#ifndef CONFIG_PREVIEW_H
+#define CONFIG_PREVIEW_H
+
+#include "color_detect.h"
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    color_detect_preview_t detect;
+    uint16_t width;             // Frame the candidate ran on
+    uint16_t height;
+    int64_t timestamp_us;       // Capture time of that frame
+    uint32_t wait_us;           // Waiting for the frame
+    uint32_t total_us;          // Whole run, waiting included
+} config_preview_report_t;
+
+/**
+ * @brief Run detection with a candidate configuration on a held frame
+ *
+ * Runs in a task below the pipeline's priority on the pipeline snapshot,
+ * which is held between previews so candidates are compared on the same
+ * frame; the active configuration is left alone. Blocks the caller until
+ * it is done or for at most 5 s; a run given up on finishes on its own and
+ * keeps further runs out until then. Only one run at a time.
+ *
+ * @param config Candidate detection configuration
+ * @param pattern Candidate band pattern
+ * @param refresh Copy a new frame instead of reusing the held one
+ * @param report Report to fill
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a run is in progress,
+ *         ESP_ERR_TIMEOUT if no frame was captured or the run did not finish
+ *         in time, ESP_ERR_INVALID_ARG
+ *         if the pattern or mask is invalid, ESP_ERR_NO_MEM
+ */
+esp_err_t config_preview_run(const color_config_t *config, const pattern_config_t *pattern,
+                             bool refresh, config_preview_report_t *report);
+
+#endif // CONFIG_PREVIEW_H
@@ -13,6 +13,11 @@
 static const char *TAG = "config";
 static const char *NVS_NAMESPACE = "color_cfg";
 static const char *NVS_KEY = "cfg";
+static const char *NVS_KEY_MQTT = "mqtt";
+static const char *NVS_KEY_CLIPS = "clips";
+static const char *NVS_KEY_PATTERN = "pattern";
+static const char *NVS_KEY_PROFILE = "profile";            // Name of the active profile
+static const char *NVS_NAMESPACE_PROFILES = "profiles";    // One blob per profile, keyed by name
 
 esp_err_t config_store_init(void)
 {
@@ -64,6 +69,13 @@ void config_get_defaults(color_config_t *config)
     config->min_area = 900;        // ~30x30 pixels
     config->min_confidence = 60;   // 60%
     config->frame_decimation = 15; // Process every 15th frame (~2 FPS at 30 FPS)
+
+    config->motion_threshold = 4;   // Mean luma change (0-255) that counts as motion
+    config->refresh_interval = 30;  // Force a full frame at least every 30 frames
+
+    config->window_scoring = true;  // Band fill confidence, 8x8 cell integral images
+
+    memset(&config->mask, 0, sizeof(mask_config_t));   // No regions: scan the whole frame
 }
 
 esp_err_t config_load(color_config_t *config)
@@ -79,8 +91,25 @@ esp_err_t config_load(color_config_t *config)
         return ret;
     }
 
-    size_t required_size = sizeof(color_config_t);
-    ret = nvs_get_blob(nvs_handle, NVS_KEY, config, &required_size);
+    // Blobs written by older firmware are a prefix of the current layout;
+    // fields they do not contain keep their default values.
+    size_t required_size = 0;
+    ret = nvs_get_blob(nvs_handle, NVS_KEY, NULL, &required_size);
+    if (ret == ESP_OK && required_size > sizeof(color_config_t)) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    if (ret == ESP_OK) {
+        uint8_t blob[sizeof(color_config_t)];
+        ret = nvs_get_blob(nvs_handle, NVS_KEY, blob, &required_size);
+        if (ret == ESP_OK) {
+            config_get_defaults(config);
+            memcpy(config, blob, required_size);
+            if (required_size < sizeof(color_config_t)) {
+                ESP_LOGI(TAG, "Upgraded stored configuration (%d -> %d bytes)",
+                         (int)required_size, (int)sizeof(color_config_t));
+            }
+        }
+    }
     
     nvs_close(nvs_handle);
 
@@ -126,3 +155,285 @@ esp_err_t config_save(const color_config_t *config)
 
     return ret;
 }
+
+// Fixed-size blob stored under its own key
+static esp_err_t load_blob(const char *ns, const char *key, void *data, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(ns, NVS_READONLY, &nvs_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    size_t required_size = size;
+    ret = nvs_get_blob(nvs_handle, key, data, &required_size);
+    if (ret == ESP_OK && required_size != size) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    nvs_close(nvs_handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Configuration '%s' loaded from NVS", key);
+    } else if (ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Failed to read '%s' from NVS: %s", key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+static esp_err_t save_blob(const char *ns, const char *key, const void *data, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(ns, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace for writing: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_blob(nvs_handle, key, data, size);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Configuration '%s' saved to NVS", key);
+    } else {
+        ESP_LOGE(TAG, "Failed to write '%s' to NVS: %s", key, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void config_get_mqtt_defaults(mqtt_config_t *config)
+{
+    if (!config) return;
+
+    memset(config, 0, sizeof(mqtt_config_t));
+    config->enabled = false;
+    strcpy(config->topic, "esp32cam");
+    config->summary_interval = 60;  // One summary per minute
+}
+
+esp_err_t config_load_mqtt(mqtt_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = load_blob(NVS_NAMESPACE, NVS_KEY_MQTT, config, sizeof(mqtt_config_t));
+    if (ret == ESP_OK) {
+        // Stored strings are always terminated
+        config->uri[sizeof(config->uri) - 1] = '\0';
+        config->topic[sizeof(config->topic) - 1] = '\0';
+    }
+    return ret;
+}
+
+esp_err_t config_save_mqtt(const mqtt_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return save_blob(NVS_NAMESPACE, NVS_KEY_MQTT, config, sizeof(mqtt_config_t));
+}
+
+void config_get_clip_defaults(clip_config_t *config)
+{
+    if (!config) return;
+
+    memset(config, 0, sizeof(clip_config_t));
+    config->enabled = false;
+    config->pre_trigger_s = 3;
+    config->post_trigger_s = 2;
+    config->flush = false;
+}
+
+esp_err_t config_load_clips(clip_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return load_blob(NVS_NAMESPACE, NVS_KEY_CLIPS, config, sizeof(clip_config_t));
+}
+
+esp_err_t config_save_clips(const clip_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return save_blob(NVS_NAMESPACE, NVS_KEY_CLIPS, config, sizeof(clip_config_t));
+}
+
+void config_get_pattern_defaults(pattern_config_t *pattern, const color_config_t *config)
+{
+    if (!pattern || !config) return;
+
+    memset(pattern, 0, sizeof(pattern_config_t));
+    pattern->class_count = 3;
+    strcpy(pattern->classes[0].name, "red");
+    pattern->classes[0].thresh = config->red;
+    strcpy(pattern->classes[1].name, "green");
+    pattern->classes[1].thresh = config->green;
+    strcpy(pattern->classes[2].name, "blue");
+    pattern->classes[2].thresh = config->blue;
+
+    pattern->sequence_count = 1;
+    pattern->sequences[0].length = 3;
+    pattern->sequences[0].classes[0] = 0;
+    pattern->sequences[0].classes[1] = 1;
+    pattern->sequences[0].classes[2] = 2;
+    pattern->orientation = PATTERN_HORIZONTAL;
+}
+
+esp_err_t config_load_pattern(pattern_config_t *pattern)
+{
+    if (!pattern) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = load_blob(NVS_NAMESPACE, NVS_KEY_PATTERN, pattern, sizeof(pattern_config_t));
+    if (ret == ESP_OK) {
+        for (int i = 0; i < PATTERN_MAX_CLASSES; i++) {
+            pattern->classes[i].name[PATTERN_NAME_LEN - 1] = '\0';
+        }
+    }
+    return ret;
+}
+
+esp_err_t config_save_pattern(const pattern_config_t *pattern)
+{
+    if (!pattern) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return save_blob(NVS_NAMESPACE, NVS_KEY_PATTERN, pattern, sizeof(pattern_config_t));
+}
+
+bool config_profile_name_valid(const char *name)
+{
+    size_t len = name ? strlen(name) : 0;
+    if (len == 0 || len >= PROFILE_NAME_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+              c == '_' || c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t config_load_profile(const char *name, detect_profile_t *profile)
+{
+    if (!config_profile_name_valid(name) || !profile) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = load_blob(NVS_NAMESPACE_PROFILES, name, profile, sizeof(detect_profile_t));
+    if (ret == ESP_OK) {
+        for (int i = 0; i < PATTERN_MAX_CLASSES; i++) {
+            profile->pattern.classes[i].name[PATTERN_NAME_LEN - 1] = '\0';
+        }
+    }
+    return ret;
+}
+
+esp_err_t config_save_profile(const char *name, const detect_profile_t *profile)
+{
+    if (!config_profile_name_valid(name) || !profile) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return save_blob(NVS_NAMESPACE_PROFILES, name, profile, sizeof(detect_profile_t));
+}
+
+esp_err_t config_delete_profile(const char *name)
+{
+    if (!config_profile_name_valid(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE_PROFILES, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_erase_key(nvs_handle, name);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Profile '%s' deleted", name);
+    }
+    return ret;
+}
+
+int config_list_profiles(char names[][PROFILE_NAME_LEN], int max)
+{
+    int count = 0;
+    nvs_iterator_t it = NULL;
+    esp_err_t ret = nvs_entry_find(NVS_DEFAULT_PART_NAME, NVS_NAMESPACE_PROFILES, NVS_TYPE_BLOB, &it);
+    while (ret == ESP_OK && count < max) {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+        // Sorted by name, so the listing does not depend on where NVS put them
+        int i = count++;
+        while (i > 0 && strcmp(names[i - 1], info.key) > 0) {
+            strcpy(names[i], names[i - 1]);
+            i--;
+        }
+        strlcpy(names[i], info.key, PROFILE_NAME_LEN);
+        ret = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    return count;
+}
+
+esp_err_t config_load_active_profile(char *name)
+{
+    if (!name) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t len = PROFILE_NAME_LEN;
+    ret = nvs_get_str(nvs_handle, NVS_KEY_PROFILE, name, &len);
+    nvs_close(nvs_handle);
+
+    if (ret != ESP_OK) {
+        name[0] = '\0';
+    }
+    return ret;
+}
+
+esp_err_t config_save_active_profile(const char *name)
+{
+    if (!name || (name[0] && !config_profile_name_valid(name))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace for writing: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (name[0]) {
+        ret = nvs_set_str(nvs_handle, NVS_KEY_PROFILE, name);
+    } else {
+        ret = nvs_erase_key(nvs_handle, NVS_KEY_PROFILE);
+        if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            ret = ESP_OK;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+    return ret;
+}
@@ -8,6 +8,7 @@
 #define CONFIG_STORE_H
 
 #include "esp_err.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 // HSV threshold structure for each color
@@ -20,7 +21,42 @@ typedef struct {
     uint8_t v_max;
 } hsv_threshold_t;
 
-// Complete color detection configuration
+// Region of interest mask limits
+#define MASK_MAX_REGIONS        8
+#define MASK_MAX_POINTS         8       // Polygon vertices
+#define MASK_SCALE              1000    // Mask coordinates run 0..MASK_SCALE across the frame
+
+typedef enum {
+    MASK_EXCLUDE = 0,           // Pixels inside are never scanned
+    MASK_INCLUDE,               // Only pixels inside an include region are scanned
+} mask_mode_t;
+
+typedef enum {
+    MASK_RECT = 0,              // Two opposite corners
+    MASK_POLYGON,               // 3..MASK_MAX_POINTS vertices
+} mask_shape_t;
+
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+} mask_point_t;
+
+typedef struct {
+    uint8_t shape;              // mask_shape_t
+    uint8_t mode;               // mask_mode_t
+    uint8_t point_count;
+    mask_point_t points[MASK_MAX_POINTS];
+} mask_region_t;
+
+// Regions of interest; without regions the whole frame is scanned
+typedef struct {
+    uint8_t region_count;
+    mask_region_t regions[MASK_MAX_REGIONS];
+} mask_config_t;
+
+// Complete color detection configuration. The red/green/blue thresholds
+// seed the default band pattern and follow the pattern classes of the same
+// name.
 typedef struct {
     hsv_threshold_t red;
     hsv_threshold_t green;
@@ -28,8 +64,70 @@ typedef struct {
     uint16_t min_area;          // Minimum area in pixels
     uint8_t min_confidence;     // Minimum confidence (0-100)
     uint8_t frame_decimation;   // Process every Nth frame
+    uint8_t motion_threshold;   // Mean thumbnail luma change to reprocess a frame (0 = always)
+    uint16_t refresh_interval;  // Reprocess at least every Nth frame even when static
+    bool window_scoring;        // Confidence from band fill in the best window (integral images)
+    mask_config_t mask;         // Regions of interest
 } color_config_t;
 
+// Band pattern limits
+#define PATTERN_MAX_CLASSES     8       // Color classes (one bit each in the classification tables)
+#define PATTERN_MAX_SEQUENCES   4       // Alternative band orders
+#define PATTERN_NAME_LEN        12
+
+// Direction in which a sequence's bands follow each other
+typedef enum {
+    PATTERN_HORIZONTAL = 0,     // Left to right
+    PATTERN_VERTICAL,           // Top to bottom
+} pattern_orientation_t;
+
+// Named color class
+typedef struct {
+    char name[PATTERN_NAME_LEN];
+    hsv_threshold_t thresh;
+} color_class_t;
+
+// Ordered bands of one tag code, as class indices
+typedef struct {
+    uint8_t length;                         // 2..PATTERN_MAX_CLASSES, each class at most once
+    uint8_t classes[PATTERN_MAX_CLASSES];
+} band_sequence_t;
+
+// Band pattern (stored separately from the detection config)
+typedef struct {
+    uint8_t class_count;
+    uint8_t sequence_count;
+    uint8_t orientation;                    // pattern_orientation_t
+    color_class_t classes[PATTERN_MAX_CLASSES];
+    band_sequence_t sequences[PATTERN_MAX_SEQUENCES];
+} pattern_config_t;
+
+// Named profiles; names are NVS keys, so up to 15 letters, digits, '_' or '-'
+#define PROFILE_NAME_LEN        16
+#define PROFILE_MAX             8
+
+// Detection configuration and band pattern of one station
+typedef struct {
+    color_config_t config;
+    pattern_config_t pattern;
+} detect_profile_t;
+
+// MQTT publisher configuration (stored separately from the detection config)
+typedef struct {
+    bool enabled;               // Publish detection events
+    char uri[128];              // Broker URI, e.g. mqtt://192.168.1.10
+    char topic[64];             // Topic prefix, messages go to <topic>/detection
+    uint16_t summary_interval;  // Seconds between summaries (0 = state changes only)
+} mqtt_config_t;
+
+// Clip recorder configuration (stored separately from the detection config)
+typedef struct {
+    bool enabled;               // Keep encoding and buffering frames for clips
+    uint8_t pre_trigger_s;      // Seconds kept before a detection
+    uint8_t post_trigger_s;     // Seconds recorded after a detection
+    bool flush;                 // Copy frozen clips to the clips flash partition
+} clip_config_t;
+
 /**
  * @brief Initialize configuration storage
  * 
@@ -41,6 +139,8 @@ esp_err_t config_store_init(void);
  * @brief Load configuration from NVS
  * 
  * @param config Pointer to config structure to fill
+ * Configurations saved by older firmware are upgraded, with missing fields set to defaults.
+ * 
  * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
  */
 esp_err_t config_load(color_config_t *config);
@@ -60,4 +160,133 @@ esp_err_t config_save(const color_config_t *config);
  */
 void config_get_defaults(color_config_t *config);
 
+/**
+ * @brief Load MQTT configuration from NVS
+ * 
+ * @param config Pointer to config structure to fill
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
+ */
+esp_err_t config_load_mqtt(mqtt_config_t *config);
+
+/**
+ * @brief Save MQTT configuration to NVS
+ * 
+ * @param config Pointer to config structure to save
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t config_save_mqtt(const mqtt_config_t *config);
+
+/**
+ * @brief Get default MQTT configuration (publisher disabled)
+ * 
+ * @param config Pointer to config structure to fill with defaults
+ */
+void config_get_mqtt_defaults(mqtt_config_t *config);
+
+/**
+ * @brief Load clip recorder configuration from NVS
+ * 
+ * @param config Pointer to config structure to fill
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
+ */
+esp_err_t config_load_clips(clip_config_t *config);
+
+/**
+ * @brief Save clip recorder configuration to NVS
+ * 
+ * @param config Pointer to config structure to save
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t config_save_clips(const clip_config_t *config);
+
+/**
+ * @brief Get default clip recorder configuration (recorder disabled)
+ * 
+ * @param config Pointer to config structure to fill with defaults
+ */
+void config_get_clip_defaults(clip_config_t *config);
+
+/**
+ * @brief Load band pattern from NVS
+ * 
+ * @param pattern Pointer to pattern structure to fill
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
+ */
+esp_err_t config_load_pattern(pattern_config_t *pattern);
+
+/**
+ * @brief Save band pattern to NVS
+ * 
+ * @param pattern Pointer to pattern structure to save
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t config_save_pattern(const pattern_config_t *pattern);
+
+/**
+ * @brief Get default band pattern: red, green and blue left to right
+ * 
+ * @param pattern Pointer to pattern structure to fill with defaults
+ * @param config Detection config whose red/green/blue thresholds are used
+ */
+void config_get_pattern_defaults(pattern_config_t *pattern, const color_config_t *config);
+
+/**
+ * @brief Check a profile name
+ * 
+ * @param name Profile name
+ * @return true if it has 1 to 15 letters, digits, '_' or '-'
+ */
+bool config_profile_name_valid(const char *name);
+
+/**
+ * @brief Load a named profile from NVS
+ * 
+ * @param name Profile name
+ * @param profile Pointer to profile structure to fill
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
+ */
+esp_err_t config_load_profile(const char *name, detect_profile_t *profile);
+
+/**
+ * @brief Save a named profile to NVS, replacing one of the same name
+ * 
+ * @param name Profile name
+ * @param profile Pointer to profile structure to save
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t config_save_profile(const char *name, const detect_profile_t *profile);
+
+/**
+ * @brief Delete a named profile from NVS
+ * 
+ * @param name Profile name
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if not found, other error codes
+ */
+esp_err_t config_delete_profile(const char *name);
+
+/**
+ * @brief List the stored profiles, sorted by name
+ * 
+ * @param names Filled with the profile names
+ * @param max Capacity of names
+ * @return Number of names filled in
+ */
+int config_list_profiles(char names[][PROFILE_NAME_LEN], int max);
+
+/**
+ * @brief Load the name of the active profile from NVS
+ * 
+ * @param name Filled with the name (PROFILE_NAME_LEN bytes), empty if none
+ * @return ESP_OK on success, ESP_ERR_NVS_NOT_FOUND if no profile is active, other error codes
+ */
+esp_err_t config_load_active_profile(char *name);
+
+/**
+ * @brief Save the name of the active profile to NVS
+ * 
+ * @param name Profile name, empty for none
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t config_save_active_profile(const char *name);
+
 #endif // CONFIG_STORE_H
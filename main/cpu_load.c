@@ -0,0 +1,140 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * CPU load sampling implementation
+ */
+
+#include "cpu_load.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "cpu_load";
+
+// Tasks tracked between samples
+#define MAX_TASKS   48
+
+typedef struct {
+    TaskHandle_t handle;
+    configRUN_TIME_COUNTER_TYPE counter;
+} task_counter_t;
+
+static TaskStatus_t *status = NULL;
+static task_counter_t *previous = NULL;
+static UBaseType_t previous_count = 0;
+static configRUN_TIME_COUNTER_TYPE previous_total = 0;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static cpu_load_stats_t stats;
+
+esp_err_t cpu_load_init(void)
+{
+    status = malloc(MAX_TASKS * sizeof(TaskStatus_t));
+    previous = calloc(MAX_TASKS, sizeof(task_counter_t));
+    if (!status || !previous) {
+        free(status);
+        free(previous);
+        status = NULL;
+        previous = NULL;
+        ESP_LOGE(TAG, "Out of memory");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static configRUN_TIME_COUNTER_TYPE previous_counter(TaskHandle_t handle, configRUN_TIME_COUNTER_TYPE current)
+{
+    for (UBaseType_t i = 0; i < previous_count; i++) {
+        if (previous[i].handle == handle) {
+            return previous[i].counter;
+        }
+    }
+    // New task: count it from now
+    return current;
+}
+
+void cpu_load_sample(void)
+{
+    if (!status) {
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE total;
+    UBaseType_t count = uxTaskGetSystemState(status, MAX_TASKS, &total);
+    if (count == 0) {
+        // More tasks than MAX_TASKS
+        return;
+    }
+
+    configRUN_TIME_COUNTER_TYPE elapsed = total - previous_total;
+    cpu_load_stats_t sample;
+    memset(&sample, 0, sizeof(sample));
+
+    if (previous_total != 0 && elapsed > 0) {
+        sample.interval_ms = elapsed / 1000;
+
+        TaskHandle_t idle[CPU_LOAD_CORES];
+        for (int c = 0; c < CPU_LOAD_CORES; c++) {
+            idle[c] = xTaskGetIdleTaskHandleForCore(c);
+            sample.core_load[c] = 100.0f;
+        }
+
+        for (UBaseType_t i = 0; i < count; i++) {
+            TaskStatus_t *t = &status[i];
+            float load = 100.0f * (t->ulRunTimeCounter - previous_counter(t->xHandle, t->ulRunTimeCounter)) / elapsed;
+
+            bool is_idle = false;
+            for (int c = 0; c < CPU_LOAD_CORES; c++) {
+                if (t->xHandle == idle[c]) {
+                    sample.core_load[c] = load < 100.0f ? 100.0f - load : 0.0f;
+                    is_idle = true;
+                }
+            }
+            if (is_idle || load <= 0.0f) {
+                continue;
+            }
+
+            // Insert into the busiest-first list
+            int pos = sample.tasks;
+            while (pos > 0 && sample.task[pos - 1].load < load) {
+                pos--;
+            }
+            if (pos >= CPU_LOAD_TOP_TASKS) {
+                continue;
+            }
+            int last = sample.tasks < CPU_LOAD_TOP_TASKS ? sample.tasks : CPU_LOAD_TOP_TASKS - 1;
+            memmove(&sample.task[pos + 1], &sample.task[pos], (last - pos) * sizeof(cpu_task_load_t));
+            if (sample.tasks < CPU_LOAD_TOP_TASKS) {
+                sample.tasks++;
+            }
+
+            cpu_task_load_t *entry = &sample.task[pos];
+            strlcpy(entry->name, t->pcTaskName, sizeof(entry->name));
+            BaseType_t core = xTaskGetCoreID(t->xHandle);
+            entry->core = core == tskNO_AFFINITY ? -1 : core;
+            entry->load = load;
+        }
+
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(&stats, &sample, sizeof(cpu_load_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        previous[i].handle = status[i].xHandle;
+        previous[i].counter = status[i].ulRunTimeCounter;
+    }
+    previous_count = count;
+    previous_total = total;
+}
+
+void cpu_load_get_stats(cpu_load_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(out, &stats, sizeof(cpu_load_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+}
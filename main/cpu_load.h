@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Per-core and per-task CPU load from FreeRTOS run time statistics
+ */
+
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define CPU_LOAD_CORES          2
+
+// Busiest tasks reported
+#define CPU_LOAD_TOP_TASKS      12
+
+typedef struct {
+    char name[16];
+    int8_t core;                // Pinned core, -1 if unpinned
+    float load;                 // Percent of one core
+} cpu_task_load_t;
+
+typedef struct {
+    uint32_t interval_ms;       // Length of the last sampling interval (0 before the first)
+    float core_load[CPU_LOAD_CORES];    // Percent busy (not in the idle task)
+    uint8_t tasks;
+    cpu_task_load_t task[CPU_LOAD_TOP_TASKS];   // Busiest first, idle tasks excluded
+} cpu_load_stats_t;
+
+/**
+ * @brief Allocate the sampling buffers
+ *
+ * Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS.
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM
+ */
+esp_err_t cpu_load_init(void);
+
+/**
+ * @brief Take a sample; loads cover the time since the previous one
+ *
+ * Called periodically (about once a second) from one task.
+ */
+void cpu_load_sample(void);
+
+/**
+ * @brief Get the loads of the last sampling interval
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void cpu_load_get_stats(cpu_load_stats_t *stats);
+
+#endif // CPU_LOAD_H
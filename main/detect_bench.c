@@ -0,0 +1,241 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Detection benchmark implementation
+ */
+
+#include "detect_bench.h"
+#include "color_detect.h"
+#include "frame_source.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <sys/param.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "detect_bench";
+
+#define BENCH_STACK_SIZE    4096
+#define BENCH_PRIORITY      1
+
+static const struct {
+    const char *name;
+    bool parallel;
+    bool strips;
+} engines[DETECT_BENCH_MAX_ENGINES] = {
+    { "parallel_strips", true, true },
+    { "parallel", true, false },
+    { "single_strips", false, true },
+    { "single", false, false },
+};
+
+static portMUX_TYPE report_lock = portMUX_INITIALIZER_UNLOCKED;
+static detect_bench_report_t report;
+static uint32_t run_mask;
+
+// Per-engine accumulators of a run
+typedef struct {
+    uint32_t *latency_us;       // One entry per labelled frame
+    uint64_t total_us;
+    float iou_sum;
+    uint32_t iou_count;
+} engine_run_t;
+
+static float bbox_iou(const detection_result_t *d, const replay_label_t *l)
+{
+    int x0 = MAX(d->bbox_x, l->bbox_x);
+    int y0 = MAX(d->bbox_y, l->bbox_y);
+    int x1 = MIN(d->bbox_x + d->bbox_w, l->bbox_x + l->bbox_w);
+    int y1 = MIN(d->bbox_y + d->bbox_h, l->bbox_y + l->bbox_h);
+    if (x1 <= x0 || y1 <= y0) {
+        return 0.0f;
+    }
+
+    float inter = (float)(x1 - x0) * (y1 - y0);
+    float uni = (float)d->bbox_w * d->bbox_h + (float)l->bbox_w * l->bbox_h - inter;
+    return uni > 0 ? inter / uni : 0.0f;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Score one engine's result against the label
+static void score(detect_bench_engine_t *e, engine_run_t *run, const detection_result_t *r,
+                  const replay_label_t *label)
+{
+    bool present = label->flags & REPLAY_LABEL_PRESENT;
+
+    if (present && r->rgb_detected) {
+        float iou = bbox_iou(r, label);
+        run->iou_sum += iou;
+        run->iou_count++;
+        if (iou * 100 >= DETECT_BENCH_IOU_MATCH) {
+            e->true_pos++;
+        } else {
+            // Wrong place: a false detection and a missed one
+            e->false_pos++;
+            e->false_neg++;
+        }
+    } else if (r->rgb_detected) {
+        e->false_pos++;
+    } else if (present) {
+        e->false_neg++;
+    } else {
+        e->true_neg++;
+    }
+}
+
+static void bench_task(void *arg)
+{
+    frame_source_stats_t source;
+    frame_source_get_stats(&source);
+
+    detect_bench_report_t result;
+    memset(&result, 0, sizeof(result));
+    result.state = DETECT_BENCH_FAILED;
+    result.frames = source.replay_frames;
+    result.config_version = color_detect_get_config_version();
+
+    engine_run_t runs[DETECT_BENCH_MAX_ENGINES];
+    memset(runs, 0, sizeof(runs));
+
+    uint8_t *buf = heap_caps_malloc((size_t)source.replay_width * source.replay_height * 2,
+                                    MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    bool ok = buf != NULL;
+    for (int e = 0; e < DETECT_BENCH_MAX_ENGINES && ok; e++) {
+        result.engine[e].name = engines[e].name;
+        if (run_mask & (1 << e)) {
+            runs[e].latency_us = heap_caps_malloc(source.replay_frames * sizeof(uint32_t),
+                                                  MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            ok = runs[e].latency_us != NULL;
+            result.engine[e].run = ok;
+        }
+    }
+    result.engines = DETECT_BENCH_MAX_ENGINES;
+
+    uint64_t decode_total = 0;
+    for (uint32_t i = 0; ok && i < source.replay_frames; i++) {
+        camera_fb_t fb;
+        replay_label_t label;
+
+        int64_t start = esp_timer_get_time();
+        if (frame_source_replay_read(i, buf, &fb, &label) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to read frame %lu", (unsigned long)i);
+            ok = false;
+            break;
+        }
+        decode_total += esp_timer_get_time() - start;
+
+        if (label.flags & REPLAY_LABEL_LABELLED) {
+            uint32_t n = result.labelled++;
+            for (int e = 0; e < DETECT_BENCH_MAX_ENGINES; e++) {
+                if (!runs[e].latency_us) {
+                    continue;
+                }
+                detection_result_t r;
+                uint32_t us;
+                color_detect_run(&fb, engines[e].parallel, engines[e].strips, &r, &us);
+                runs[e].latency_us[n] = us;
+                runs[e].total_us += us;
+                score(&result.engine[e], &runs[e], &r, &label);
+            }
+        }
+
+        taskENTER_CRITICAL(&report_lock);
+        report.progress = i + 1;
+        report.labelled = result.labelled;
+        taskEXIT_CRITICAL(&report_lock);
+
+        // Leave the idle task some time on this core
+        vTaskDelay(1);
+    }
+
+    if (ok) {
+        result.state = DETECT_BENCH_DONE;
+        result.progress = source.replay_frames;
+        result.decode_us = source.replay_frames ? decode_total / source.replay_frames : 0;
+
+        for (int e = 0; e < DETECT_BENCH_MAX_ENGINES; e++) {
+            detect_bench_engine_t *out = &result.engine[e];
+            uint32_t n = result.labelled;
+            if (!runs[e].latency_us || n == 0) {
+                continue;
+            }
+            qsort(runs[e].latency_us, n, sizeof(uint32_t), compare_u32);
+            out->p50_us = runs[e].latency_us[(n - 1) * 50 / 100];
+            out->p90_us = runs[e].latency_us[(n - 1) * 90 / 100];
+            out->p99_us = runs[e].latency_us[(n - 1) * 99 / 100];
+            out->max_us = runs[e].latency_us[n - 1];
+            out->mean_us = runs[e].total_us / n;
+            out->mean_iou = runs[e].iou_count ? runs[e].iou_sum / runs[e].iou_count : 0.0f;
+        }
+
+        ESP_LOGI(TAG, "Benchmark done: %lu labelled frames of %lu",
+                 (unsigned long)result.labelled, (unsigned long)result.frames);
+    }
+
+    for (int e = 0; e < DETECT_BENCH_MAX_ENGINES; e++) {
+        free(runs[e].latency_us);
+    }
+    free(buf);
+
+    taskENTER_CRITICAL(&report_lock);
+    memcpy(&report, &result, sizeof(detect_bench_report_t));
+    taskEXIT_CRITICAL(&report_lock);
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t detect_bench_start(uint32_t engine_mask)
+{
+    frame_source_stats_t source;
+    frame_source_get_stats(&source);
+    if (!source.replay || !source.replay_labels) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    taskENTER_CRITICAL(&report_lock);
+    bool running = report.state == DETECT_BENCH_RUNNING;
+    if (!running) {
+        memset(&report, 0, sizeof(report));
+        report.state = DETECT_BENCH_RUNNING;
+        report.frames = source.replay_frames;
+    }
+    taskEXIT_CRITICAL(&report_lock);
+
+    if (running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    run_mask = engine_mask ? engine_mask : (1 << DETECT_BENCH_MAX_ENGINES) - 1;
+    if (xTaskCreate(bench_task, "detect_bench", BENCH_STACK_SIZE, NULL,
+                    BENCH_PRIORITY, NULL) != pdPASS) {
+        taskENTER_CRITICAL(&report_lock);
+        report.state = DETECT_BENCH_FAILED;
+        taskEXIT_CRITICAL(&report_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Benchmark started over %lu frames", (unsigned long)source.replay_frames);
+    return ESP_OK;
+}
+
+const char *detect_bench_engine_name(int index)
+{
+    return index >= 0 && index < DETECT_BENCH_MAX_ENGINES ? engines[index].name : NULL;
+}
+
+void detect_bench_get_report(detect_bench_report_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&report_lock);
+        memcpy(out, &report, sizeof(detect_bench_report_t));
+        taskEXIT_CRITICAL(&report_lock);
+    }
+}
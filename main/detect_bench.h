@@ -0,0 +1,81 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Detection accuracy and speed benchmark over the labelled replay recording
+ */
+
+#ifndef DETECT_BENCH_H
+#define DETECT_BENCH_H
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scan engines compared by the benchmark
+#define DETECT_BENCH_MAX_ENGINES    4
+
+// A detection matches the ground truth at this IoU (percent) or above
+#define DETECT_BENCH_IOU_MATCH      50
+
+typedef enum {
+    DETECT_BENCH_IDLE = 0,
+    DETECT_BENCH_RUNNING,
+    DETECT_BENCH_DONE,
+    DETECT_BENCH_FAILED,
+} detect_bench_state_t;
+
+// Results of one engine over the labelled frames
+typedef struct {
+    const char *name;
+    bool run;                   // Selected for this run
+    uint32_t true_pos;          // Detected, matching the label
+    uint32_t false_pos;         // Detected without bands, or not matching the label
+    uint32_t false_neg;         // Bands labelled but not detected (or not matching)
+    uint32_t true_neg;          // No bands, none detected
+    float mean_iou;             // Mean IoU over frames with bands labelled and detected
+    uint32_t p50_us;            // Scan time percentiles
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t mean_us;
+} detect_bench_engine_t;
+
+typedef struct {
+    detect_bench_state_t state;
+    uint32_t frames;            // Frames in the recording
+    uint32_t labelled;          // Frames evaluated
+    uint32_t progress;          // Frames processed so far
+    uint32_t decode_us;         // Mean decode time per frame (0 for RGB565)
+    uint16_t config_version;    // Detector configuration benchmarked
+    uint8_t engines;
+    detect_bench_engine_t engine[DETECT_BENCH_MAX_ENGINES];
+} detect_bench_report_t;
+
+/**
+ * @brief Start a benchmark run in a background task
+ *
+ * Every labelled frame of the replay recording is scanned once per engine
+ * with the active detector configuration; unlabelled frames are skipped.
+ *
+ * @param engine_mask Engines to run (bit n = engine n), 0 for all
+ * @return ESP_OK if started, ESP_ERR_INVALID_STATE if a run is in progress,
+ *         ESP_ERR_NOT_FOUND without a labelled recording, ESP_ERR_NO_MEM
+ */
+esp_err_t detect_bench_start(uint32_t engine_mask);
+
+/**
+ * @brief Get the name of an engine
+ *
+ * @param index Engine index
+ * @return Engine name, NULL past the last engine
+ */
+const char *detect_bench_engine_name(int index);
+
+/**
+ * @brief Get the state of the current or last run
+ *
+ * @param report Pointer to report structure to fill
+ */
+void detect_bench_get_report(detect_bench_report_t *report);
+
+#endif // DETECT_BENCH_H
@@ -0,0 +1,259 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Detection profile implementation
+ */
+
+#include "detect_profile.h"
+#include "color_detect.h"
+#include "motion_gate.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include <string.h>
+
+static const char *TAG = "detect_profile";
+
+// Contents of the live configuration (profiles[active_slot]) and of the
+// standby state of the detector (the other one), all under profile_mutex
+static SemaphoreHandle_t profile_mutex = NULL;
+static detect_profile_t profiles[2];
+static int active_slot = 0;
+static detect_profile_state_t state;
+
+// Compile a stored profile into the detector's standby state
+static esp_err_t stage_profile(const char *name, detect_profile_switch_t *report)
+{
+    detect_profile_t *p = &profiles[active_slot ^ 1];
+    state.standby[0] = '\0';
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = config_load_profile(name, p);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    int64_t loaded = esp_timer_get_time();
+    if (ret == ESP_OK) {
+        ret = color_detect_stage(&p->config, &p->pattern);
+    }
+    if (ret == ESP_OK) {
+        strlcpy(state.standby, name, PROFILE_NAME_LEN);
+    }
+
+    if (report) {
+        report->load_us = (uint32_t)(loaded - start);
+        report->compile_us = (uint32_t)(esp_timer_get_time() - loaded);
+    }
+    return ret;
+}
+
+// Refresh the live profile contents from the detector and NVS
+static void load_live(detect_profile_t *p)
+{
+    if (config_load(&p->config) != ESP_OK) {
+        config_get_defaults(&p->config);
+    }
+    color_detect_get_pattern(&p->pattern);
+}
+
+esp_err_t detect_profile_init(void)
+{
+    profile_mutex = xSemaphoreCreateMutex();
+    if (!profile_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    load_live(&profiles[active_slot]);
+    if (config_load_active_profile(state.active) == ESP_OK) {
+        detect_profile_t stored;
+        if (config_load_profile(state.active, &stored) != ESP_OK) {
+            ESP_LOGW(TAG, "Active profile '%s' not found", state.active);
+            state.active[0] = '\0';
+            config_save_active_profile("");
+        }
+    }
+
+    // Preload the profile after the active one, in name order
+    char names[PROFILE_MAX][PROFILE_NAME_LEN];
+    int count = config_list_profiles(names, PROFILE_MAX);
+    int next = -1;
+    for (int i = 0; i < count && next < 0; i++) {
+        if (strcmp(names[i], state.active) > 0) {
+            next = i;
+        }
+    }
+    if (next < 0 && count > 0 && strcmp(names[0], state.active) != 0) {
+        next = 0;
+    }
+    if (next >= 0 && stage_profile(names[next], NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Profile '%s' not preloaded", names[next]);
+    }
+
+    ESP_LOGI(TAG, "%d profiles, active '%s', standby '%s'", count, state.active, state.standby);
+    return ESP_OK;
+}
+
+esp_err_t detect_profile_switch(const char *name, detect_profile_switch_t *report)
+{
+    if (!config_profile_name_valid(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    detect_profile_switch_t r;
+    memset(&r, 0, sizeof(r));
+    int64_t start = esp_timer_get_time();
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+
+    esp_err_t ret = ESP_OK;
+    if (strcmp(name, state.active) == 0) {
+        r.resident = true;
+        xSemaphoreGive(profile_mutex);
+        if (report) {
+            *report = r;
+        }
+        return ESP_OK;
+    }
+
+    r.resident = strcmp(name, state.standby) == 0;
+    if (!r.resident) {
+        ret = stage_profile(name, &r);
+    }
+    color_detect_switch_t timing;
+    if (ret == ESP_OK) {
+        ret = color_detect_switch(DETECT_PROFILE_SWITCH_TIMEOUT_MS, &timing);
+    }
+
+    if (ret == ESP_OK) {
+        r.wait_us = timing.wait_us;
+        r.swap_us = timing.swap_us;
+        r.total_us = (uint32_t)(esp_timer_get_time() - start);
+
+        // The profile left stays compiled in the standby state
+        active_slot ^= 1;
+        char left[PROFILE_NAME_LEN];
+        strlcpy(left, state.active, PROFILE_NAME_LEN);
+        strlcpy(state.active, name, PROFILE_NAME_LEN);
+        strlcpy(state.standby, left, PROFILE_NAME_LEN);
+        state.switches++;
+        state.last = r;
+
+        // The switch is done; the rest only keeps the other modules and the
+        // next boot in step
+        const detect_profile_t *p = &profiles[active_slot];
+        motion_gate_configure(p->config.motion_threshold, p->config.refresh_interval);
+        config_save(&p->config);
+        config_save_pattern(&p->pattern);
+        config_save_active_profile(name);
+
+        ESP_LOGI(TAG, "Switched to '%s' in %lu us (%s, wait %lu us, swap %lu us)", name,
+                 (unsigned long)r.total_us, r.resident ? "resident" : "compiled",
+                 (unsigned long)r.wait_us, (unsigned long)r.swap_us);
+    }
+    xSemaphoreGive(profile_mutex);
+
+    if (report) {
+        *report = r;
+    }
+    return ret;
+}
+
+esp_err_t detect_profile_preload(const char *name)
+{
+    if (!config_profile_name_valid(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+    if (strcmp(name, state.active) != 0) {
+        ret = stage_profile(name, NULL);
+    }
+    xSemaphoreGive(profile_mutex);
+    return ret;
+}
+
+esp_err_t detect_profile_save(const char *name)
+{
+    if (!config_profile_name_valid(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    detect_profile_t *p = &profiles[active_slot];
+    load_live(p);
+
+    char names[PROFILE_MAX][PROFILE_NAME_LEN];
+    int count = config_list_profiles(names, PROFILE_MAX);
+    bool exists = false;
+    for (int i = 0; i < count; i++) {
+        exists |= strcmp(names[i], name) == 0;
+    }
+
+    esp_err_t ret = (!exists && count >= PROFILE_MAX) ? ESP_ERR_NO_MEM : config_save_profile(name, p);
+    if (ret == ESP_OK) {
+        // The standby copy of this profile, if any, is now out of date
+        if (strcmp(state.standby, name) == 0) {
+            state.standby[0] = '\0';
+        }
+        strlcpy(state.active, name, PROFILE_NAME_LEN);
+        config_save_active_profile(name);
+    }
+    xSemaphoreGive(profile_mutex);
+    return ret;
+}
+
+esp_err_t detect_profile_delete(const char *name)
+{
+    if (!config_profile_name_valid(name)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    esp_err_t ret = config_delete_profile(name);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    if (ret == ESP_OK) {
+        if (strcmp(state.active, name) == 0) {
+            state.active[0] = '\0';
+            config_save_active_profile("");
+        }
+        if (strcmp(state.standby, name) == 0) {
+            state.standby[0] = '\0';
+        }
+    }
+    xSemaphoreGive(profile_mutex);
+    return ret;
+}
+
+void detect_profile_sync_active(void)
+{
+    if (!profile_mutex) {
+        return;
+    }
+
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    detect_profile_t *p = &profiles[active_slot];
+    load_live(p);
+    if (state.active[0]) {
+        config_save_profile(state.active, p);
+    }
+    xSemaphoreGive(profile_mutex);
+}
+
+void detect_profile_get_state(detect_profile_state_t *out)
+{
+    if (!out) {
+        return;
+    }
+    if (!profile_mutex) {
+        memset(out, 0, sizeof(detect_profile_state_t));
+        return;
+    }
+
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    memcpy(out, &state, sizeof(detect_profile_state_t));
+    xSemaphoreGive(profile_mutex);
+}
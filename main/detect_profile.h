@@ -0,0 +1,103 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Named detection profiles with a precompiled standby for instant switching
+ */
+
+#ifndef DETECT_PROFILE_H
+#define DETECT_PROFILE_H
+
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Longest wait for the frame a switch is applied on
+#define DETECT_PROFILE_SWITCH_TIMEOUT_MS    2000
+
+// Latency of a profile switch
+typedef struct {
+    bool resident;              // The profile was already compiled in the standby state
+    uint32_t load_us;           // Reading it from NVS (0 when resident)
+    uint32_t compile_us;        // Compiling tables and mask (0 when resident)
+    uint32_t wait_us;           // Waiting for the next frame boundary
+    uint32_t swap_us;           // Exchanging the states, the only time scans wait
+    uint32_t total_us;          // From the request to the switch, saving excluded
+} detect_profile_switch_t;
+
+// Profile state
+typedef struct {
+    char active[PROFILE_NAME_LEN];      // Empty when the live configuration is no profile
+    char standby[PROFILE_NAME_LEN];     // Compiled and ready to switch to (empty if none)
+    uint32_t switches;                  // Switches since boot
+    detect_profile_switch_t last;       // Last switch
+} detect_profile_state_t;
+
+/**
+ * @brief Restore the active profile name and preload the next profile
+ *
+ * Call once the detector runs with the stored configuration and pattern.
+ * The next profile is the one after the active one in name order.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t detect_profile_init(void);
+
+/**
+ * @brief Switch the detector to a profile
+ *
+ * A profile already in the standby state takes effect on the next frame
+ * without any compilation; any other one is loaded and compiled first
+ * while the detector keeps running. The profile left stays in standby, so
+ * switching back is as fast. The new configuration and pattern are then
+ * saved as the live ones.
+ *
+ * @param name Profile name
+ * @param report Set to the switch latency (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such profile,
+ *         ESP_ERR_INVALID_ARG if the name or the stored profile is invalid,
+ *         ESP_ERR_TIMEOUT if no frame was processed in time
+ */
+esp_err_t detect_profile_switch(const char *name, detect_profile_switch_t *report);
+
+/**
+ * @brief Compile a profile into the standby state without switching to it
+ *
+ * @param name Profile name
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such profile,
+ *         ESP_ERR_INVALID_ARG if the name or the stored profile is invalid
+ */
+esp_err_t detect_profile_preload(const char *name);
+
+/**
+ * @brief Save the live configuration and pattern as a profile and make it active
+ *
+ * @param name Profile name
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the name is invalid,
+ *         ESP_ERR_NO_MEM if PROFILE_MAX profiles exist already
+ */
+esp_err_t detect_profile_save(const char *name);
+
+/**
+ * @brief Delete a profile; the live configuration is kept
+ *
+ * @param name Profile name
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such profile
+ */
+esp_err_t detect_profile_delete(const char *name);
+
+/**
+ * @brief Store the live configuration and pattern into the active profile
+ *
+ * Call after they were changed, so the profile follows the edits.
+ */
+void detect_profile_sync_active(void);
+
+/**
+ * @brief Get the active and standby profiles and the switch statistics
+ *
+ * @param state Pointer to state structure to fill
+ */
+void detect_profile_get_state(detect_profile_state_t *state);
+
+#endif // DETECT_PROFILE_H
@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Detection event log implementation
+ */
+
+#include "detection_log.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "detection_log";
+
+#define RING_MASK   (DETECTION_LOG_SIZE - 1)
+
+// The producer owns head and publishes each record by storing its seq last;
+// readers check seq before and after copying a slot and skip records that
+// were overwritten meanwhile.
+static detection_record_t *ring = NULL;
+static uint32_t head = 0;                   // Sequence number of the newest record
+static bool last_detected = false;
+
+esp_err_t detection_log_init(void)
+{
+    if (ring) {
+        return ESP_OK;
+    }
+
+    ring = heap_caps_calloc(DETECTION_LOG_SIZE, sizeof(detection_record_t),
+                            MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) {
+        ESP_LOGE(TAG, "Failed to allocate %d records", DETECTION_LOG_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Detection log: %d records (%d bytes)", DETECTION_LOG_SIZE,
+             (int)(DETECTION_LOG_SIZE * sizeof(detection_record_t)));
+    return ESP_OK;
+}
+
+void detection_log_append(const detection_result_t *result, int64_t timestamp_us,
+                          uint16_t config_version)
+{
+    bool detected = result->rgb_detected;
+    bool transition = detected != last_detected;
+    last_detected = detected;
+
+    if (!ring || (!detected && !transition)) {
+        return;
+    }
+
+    uint32_t seq = head + 1;
+    detection_record_t *rec = &ring[(seq - 1) & RING_MASK];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    rec->flags = (detected ? DETECTION_LOG_DETECTED : 0) | (transition ? DETECTION_LOG_TRANSITION : 0);
+    rec->confidence = result->confidence;
+    rec->config_version = config_version;
+    rec->timestamp_us = timestamp_us;
+    rec->bbox_x = result->bbox_x;
+    rec->bbox_y = result->bbox_y;
+    rec->bbox_w = result->bbox_w;
+    rec->bbox_h = result->bbox_h;
+
+    __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&head, seq, __ATOMIC_RELEASE);
+}
+
+size_t detection_log_read(uint32_t since, detection_record_t *out, size_t max, uint32_t *last_seq)
+{
+    uint32_t newest = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    if (last_seq) {
+        *last_seq = newest;
+    }
+    if (!ring || since >= newest) {
+        return 0;
+    }
+
+    uint32_t first = since + 1;
+    if (newest - since > DETECTION_LOG_SIZE) {
+        first = newest - DETECTION_LOG_SIZE + 1;
+    }
+
+    size_t n = 0;
+    for (uint32_t seq = first; seq <= newest && n < max; seq++) {
+        const detection_record_t *rec = &ring[(seq - 1) & RING_MASK];
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq) {
+            continue;
+        }
+        memcpy(&out[n], rec, sizeof(detection_record_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        out[n].seq = seq;
+        n++;
+    }
+    return n;
+}
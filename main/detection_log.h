@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Detection event log: fixed-size single-producer ring in PSRAM
+ */
+
+#ifndef DETECTION_LOG_H
+#define DETECTION_LOG_H
+
+#include "color_detect.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Ring capacity in records (power of two)
+#define DETECTION_LOG_SIZE  4096
+
+// Record flags
+#define DETECTION_LOG_DETECTED      0x01    // Bands detected in this frame
+#define DETECTION_LOG_TRANSITION    0x02    // Detection state changed with this frame
+
+// One logged frame
+typedef struct {
+    uint32_t seq;               // Sequence number, starting at 1 (0 = slot being written)
+    uint8_t flags;              // DETECTION_LOG_* flags
+    uint8_t confidence;         // Detection confidence (0-100)
+    uint16_t config_version;    // Detector configuration in effect
+    int64_t timestamp_us;       // Capture time (esp_timer)
+    uint16_t bbox_x;
+    uint16_t bbox_y;
+    uint16_t bbox_w;
+    uint16_t bbox_h;
+} detection_record_t;
+
+/**
+ * @brief Allocate the ring
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM otherwise
+ */
+esp_err_t detection_log_init(void);
+
+/**
+ * @brief Log the result of a processed frame
+ *
+ * Frames with a detection and frames that change the detection state are
+ * recorded; others are ignored. Constant time, no allocation and no lock:
+ * must only be called from a single task (the detection path).
+ *
+ * @param result Detection result
+ * @param timestamp_us Capture time of the frame
+ * @param config_version Detector configuration version
+ */
+void detection_log_append(const detection_result_t *result, int64_t timestamp_us,
+                          uint16_t config_version);
+
+/**
+ * @brief Copy records newer than a sequence number
+ *
+ * If records after since have already been overwritten, the copy starts at
+ * the oldest record still in the ring.
+ *
+ * @param since Copy records with seq > since
+ * @param out Destination array
+ * @param max Capacity of out
+ * @param last_seq Set to the sequence number of the newest record logged
+ * @return Number of records copied
+ */
+size_t detection_log_read(uint32_t since, detection_record_t *out, size_t max, uint32_t *last_seq);
+
+#endif // DETECTION_LOG_H
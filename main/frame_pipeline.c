@@ -0,0 +1,387 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Frame pipeline implementation
+ */
+
+#include "frame_pipeline.h"
+#include "camera_driver.h"
+#include "frame_source.h"
+#include "jpeg_encoder.h"
+#include "motion_gate.h"
+#include "detection_log.h"
+#include "mqtt_publisher.h"
+#include "clip_recorder.h"
+#include "ws2812_led.h"
+#include "boot_profile.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Forward declaration (provided by esp32-camera component)
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+
+static const char *TAG = "pipeline";
+
+#define PIPELINE_STACK_SIZE     8192
+#define PIPELINE_PRIORITY       5
+#define JPEG_QUALITY            80
+
+static portMUX_TYPE frame_lock = portMUX_INITIALIZER_UNLOCKED;
+static pipeline_frame_t *latest[PIPELINE_VIEW_COUNT];
+static uint32_t latest_seq[PIPELINE_VIEW_COUNT];
+static uint32_t consumers[PIPELINE_VIEW_COUNT];
+static uint32_t clean_requests = 0;
+static frame_pipeline_stats_t stats;
+
+// Snapshot of a captured frame, requested by another task and copied by the
+// pipeline task. The owner holds snapshot_mutex from request to release; the
+// pipeline claims a request by clearing snapshot_requested, and a claimed
+// request is always waited for, so the buffer only changes under the mutex.
+static SemaphoreHandle_t snapshot_mutex = NULL;
+static SemaphoreHandle_t snapshot_done = NULL;
+static bool snapshot_requested = false;
+static esp_err_t snapshot_result = ESP_OK;
+static bool snapshot_held = false;             // snapshot_fb is a complete frame
+static camera_fb_t snapshot_fb;
+static uint8_t *snapshot_buf = NULL;
+static size_t snapshot_size = 0;
+
+static void frame_free(pipeline_frame_t *frame)
+{
+    free(frame->jpeg);
+    free(frame);
+}
+
+// Make frame the latest one of its view; NULL republishes the current frame
+// as a new sequence
+static void publish(pipeline_view_t view, pipeline_frame_t *frame)
+{
+    pipeline_frame_t *old = NULL;
+
+    taskENTER_CRITICAL(&frame_lock);
+    if (frame) {
+        old = latest[view];
+        frame->refs = 1;
+        latest[view] = frame;
+    }
+    if (latest[view]) {
+        if (++latest_seq[view] == 0) {
+            latest_seq[view] = 1;
+        }
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+
+    if (old) {
+        frame_pipeline_release(old);
+    }
+    if (view == PIPELINE_VIEW_COLOR) {
+        stats.published++;
+    }
+}
+
+static pipeline_frame_t *encode_frame(camera_fb_t *fb, const detection_result_t *detection)
+{
+    pipeline_frame_t *frame = calloc(1, sizeof(pipeline_frame_t));
+    if (!frame) {
+        return NULL;
+    }
+
+    bool ok;
+    if (fb->format == PIXFORMAT_RGB565) {
+        ok = jpeg_encode_rgb565(fb, JPEG_QUALITY, &frame->jpeg, &frame->jpeg_len);
+    } else if (fb->format == PIXFORMAT_JPEG) {
+        frame->jpeg = malloc(fb->len);
+        ok = frame->jpeg != NULL;
+        if (ok) {
+            memcpy(frame->jpeg, fb->buf, fb->len);
+            frame->jpeg_len = fb->len;
+        }
+    } else {
+        ok = frame2jpg(fb, JPEG_QUALITY, &frame->jpeg, &frame->jpeg_len);
+    }
+
+    if (!ok) {
+        ESP_LOGE(TAG, "JPEG compression failed");
+        free(frame);
+        return NULL;
+    }
+
+    frame->detection = *detection;
+    return frame;
+}
+
+// Copy a captured frame for the snapshot requester
+static void take_snapshot(const camera_fb_t *fb)
+{
+    snapshot_held = false;
+    snapshot_result = ESP_OK;
+    if (fb->format != PIXFORMAT_RGB565) {
+        snapshot_result = ESP_ERR_NOT_SUPPORTED;
+    } else if (snapshot_size < fb->len) {
+        heap_caps_free(snapshot_buf);
+        snapshot_buf = heap_caps_malloc(fb->len, MALLOC_CAP_SPIRAM);
+        snapshot_size = snapshot_buf ? fb->len : 0;
+        if (!snapshot_buf) {
+            snapshot_result = ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (snapshot_result == ESP_OK) {
+        memcpy(snapshot_buf, fb->buf, fb->len);
+        snapshot_fb = *fb;
+        snapshot_fb.buf = snapshot_buf;
+    }
+    snapshot_held = (snapshot_result == ESP_OK);
+    xSemaphoreGive(snapshot_done);
+}
+
+// Encode the class map of the frame just processed for the mask view
+static void publish_class_map(const detection_result_t *detection, int64_t timestamp)
+{
+    camera_fb_t map;
+    if (color_detect_get_class_map(&map) != ESP_OK) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    pipeline_frame_t *frame = encode_frame(&map, detection);
+    if (frame) {
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+        stats.mask_encoded++;
+        stats.mask_us = (stats.mask_encoded == 1) ? elapsed : (stats.mask_us * 7 + elapsed) / 8;
+        frame->timestamp_us = timestamp;
+        frame->overlay = true;
+        publish(PIPELINE_VIEW_MASK, frame);
+    }
+}
+
+static void pipeline_task(void *arg)
+{
+    motion_gate_t *gate = malloc(sizeof(motion_gate_t));
+    if (!gate) {
+        ESP_LOGE(TAG, "Out of memory");
+        vTaskDelete(NULL);
+        return;
+    }
+    motion_gate_init(gate);
+
+    detection_result_t detection;   // Result of the last scan
+    memset(&detection, 0, sizeof(detection));
+    bool scene_changed = true;      // scene changed since the last scan
+    bool jpeg_current = false;      // latest frame shows the current scene
+    bool jpeg_overlay = false;      // latest frame has the bounding box drawn
+    bool jpeg_clean = false;        // latest frame was drawn for a clean request
+
+    while (1) {
+        camera_fb_t *fb = camera_get_fb();
+        if (!fb) {
+            ESP_LOGE(TAG, "Camera capture failed");
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        int64_t timestamp = fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec;
+        stats.captured++;
+        boot_profile_mark(BOOT_PHASE_FIRST_FRAME);
+
+        if (__atomic_exchange_n(&snapshot_requested, false, __ATOMIC_ACQ_REL)) {
+            take_snapshot(fb);
+        }
+
+        // Decimation counts every captured frame; a due frame is only
+        // scanned if the scene changed since the last scan (or a profile
+        // switch waits for a frame). Other frames keep the last scanned
+        // result, and static ones repeat the previous JPEG. Frames drawn
+        // clean for /capture are always scanned, so they carry their own
+        // detection. The class map is only drawn while someone watches it
+        bool mask_view = consumers[PIPELINE_VIEW_MASK] > 0;
+        bool clean = clean_requests > 0;
+        color_detect_set_class_map(mask_view);
+        bool changed = motion_gate_check(gate, fb);
+        scene_changed |= changed;
+        bool due = color_detect_frame_due();
+        if ((due && scene_changed) || clean || color_detect_switch_pending()) {
+            detection_result_t scan;
+            if (color_detect_process(fb, &scan) == ESP_OK) {
+                // A moved bounding box needs a new JPEG
+                if (memcmp(&scan, &detection, sizeof(scan)) != 0) {
+                    jpeg_current = false;
+                }
+                detection = scan;
+                scene_changed = false;
+                boot_profile_mark(BOOT_PHASE_FIRST_SCAN);
+                if (detection.rgb_detected) {
+                    boot_profile_mark(BOOT_PHASE_FIRST_DETECTION);
+                }
+                detection_log_append(&detection, timestamp, color_detect_get_config_version());
+                mqtt_publisher_report(&detection, timestamp);
+                clip_recorder_report(&detection, timestamp);
+                ws2812_set_detection(detection.rgb_detected, detection.confidence);
+                if (mask_view) {
+                    publish_class_map(&detection, timestamp);
+                }
+            }
+        }
+        if (changed) {
+            jpeg_current = false;
+        }
+
+        if (consumers[PIPELINE_VIEW_COLOR] > 0) {
+            // Draw bounding box if detected, unless clean frames are requested
+            bool overlay = detection.rgb_detected && !clean;
+            if (!jpeg_current || overlay != jpeg_overlay || clean != jpeg_clean) {
+                if (overlay) {
+                    fb = frame_source_make_writable(fb);
+                    color_detect_draw_bbox(fb, &detection);
+                }
+
+                pipeline_frame_t *frame = encode_frame(fb, &detection);
+                if (frame) {
+                    frame->timestamp_us = timestamp;
+                    frame->overlay = overlay;
+                    frame->clean = clean;
+                    stats.encoded++;
+                    publish(PIPELINE_VIEW_COLOR, frame);
+                    jpeg_current = true;
+                    jpeg_overlay = overlay;
+                    jpeg_clean = clean;
+                }
+            } else {
+                publish(PIPELINE_VIEW_COLOR, NULL);
+            }
+        }
+
+        camera_return_fb(fb);
+    }
+}
+
+esp_err_t frame_pipeline_start(void)
+{
+    snapshot_mutex = xSemaphoreCreateMutex();
+    snapshot_done = xSemaphoreCreateBinary();
+    if (!snapshot_mutex || !snapshot_done) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(pipeline_task, "pipeline", PIPELINE_STACK_SIZE, NULL,
+                    PIPELINE_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create pipeline task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Frame pipeline started");
+    return ESP_OK;
+}
+
+void frame_pipeline_add_consumer(pipeline_view_t view)
+{
+    taskENTER_CRITICAL(&frame_lock);
+    consumers[view]++;
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+void frame_pipeline_remove_consumer(pipeline_view_t view)
+{
+    taskENTER_CRITICAL(&frame_lock);
+    if (consumers[view] > 0) {
+        consumers[view]--;
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+void frame_pipeline_request_clean(bool enable)
+{
+    taskENTER_CRITICAL(&frame_lock);
+    if (enable) {
+        clean_requests++;
+    } else if (clean_requests > 0) {
+        clean_requests--;
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+}
+
+pipeline_frame_t *frame_pipeline_acquire(pipeline_view_t view, uint32_t *seq)
+{
+    pipeline_frame_t *frame = NULL;
+
+    taskENTER_CRITICAL(&frame_lock);
+    if (latest[view] && latest_seq[view] != *seq) {
+        frame = latest[view];
+        frame->refs++;
+        *seq = latest_seq[view];
+    }
+    taskEXIT_CRITICAL(&frame_lock);
+
+    return frame;
+}
+
+void frame_pipeline_release(pipeline_frame_t *frame)
+{
+    if (!frame) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&frame_lock);
+    bool last = (--frame->refs == 0);
+    taskEXIT_CRITICAL(&frame_lock);
+
+    if (last) {
+        frame_free(frame);
+    }
+}
+
+esp_err_t frame_pipeline_snapshot(camera_fb_t *fb, bool refresh, uint32_t timeout_ms)
+{
+    if (!fb || !snapshot_mutex) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    if (xSemaphoreTake(snapshot_mutex, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (!refresh && snapshot_held) {
+        *fb = snapshot_fb;
+        return ESP_OK;
+    }
+
+    __atomic_store_n(&snapshot_requested, true, __ATOMIC_RELEASE);
+
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = (int32_t)(deadline - now) > 0 ? deadline - now : 0;
+    if (xSemaphoreTake(snapshot_done, wait) != pdTRUE) {
+        // Withdraw the request unless the pipeline already claimed it; a
+        // claimed copy is in progress and finishes within a frame
+        if (__atomic_exchange_n(&snapshot_requested, false, __ATOMIC_ACQ_REL)) {
+            xSemaphoreGive(snapshot_mutex);
+            return ESP_ERR_TIMEOUT;
+        }
+        xSemaphoreTake(snapshot_done, portMAX_DELAY);
+    }
+
+    if (snapshot_result != ESP_OK) {
+        xSemaphoreGive(snapshot_mutex);
+        return snapshot_result;
+    }
+    *fb = snapshot_fb;
+    return ESP_OK;
+}
+
+void frame_pipeline_snapshot_release(void)
+{
+    xSemaphoreGive(snapshot_mutex);
+}
+
+void frame_pipeline_get_stats(frame_pipeline_stats_t *out)
+{
+    if (out) {
+        memcpy(out, &stats, sizeof(frame_pipeline_stats_t));
+        out->consumers = consumers[PIPELINE_VIEW_COLOR];
+        out->mask_consumers = consumers[PIPELINE_VIEW_MASK];
+    }
+}
@@ -0,0 +1,132 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Capture, detection and encoding pipeline shared by all stream consumers
+ */
+
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include "color_detect.h"
+#include "esp_camera.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Image published by the pipeline; each view has its own consumers and
+// sequence numbers
+typedef enum {
+    PIPELINE_VIEW_COLOR = 0,        // Camera frame with the bounding box overlay
+    PIPELINE_VIEW_MASK,             // Class map of each processed frame
+    PIPELINE_VIEW_COUNT,
+} pipeline_view_t;
+
+// Encoded frame shared by all consumers (reference counted)
+typedef struct {
+    uint8_t *jpeg;                  // JPEG data
+    size_t jpeg_len;                // JPEG length
+    int64_t timestamp_us;           // Capture time (esp_timer)
+    detection_result_t detection;   // Result of the last scan
+    bool overlay;                   // Bounding box drawn into the image
+    bool clean;                     // Drawn for a clean request: no overlay, detection of this image
+    uint32_t refs;                  // Owned by the pipeline, do not modify
+} pipeline_frame_t;
+
+// Pipeline statistics
+typedef struct {
+    uint32_t captured;      // Frames captured
+    uint32_t encoded;       // Frames encoded
+    uint32_t published;     // Frames published (encoded or repeated while static)
+    uint32_t consumers;     // Registered JPEG consumers
+    uint32_t mask_encoded;  // Class maps encoded
+    uint32_t mask_consumers;// Registered class map consumers
+    uint32_t mask_us;       // Running average class map encode time
+} frame_pipeline_stats_t;
+
+/**
+ * @brief Start the capture task
+ *
+ * Detection and the LED run on every captured frame; frames are encoded
+ * only while at least one JPEG consumer of their view is registered.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t frame_pipeline_start(void);
+
+/**
+ * @brief Register a JPEG consumer
+ *
+ * @param view View the consumer reads
+ */
+void frame_pipeline_add_consumer(pipeline_view_t view);
+
+/**
+ * @brief Unregister a JPEG consumer
+ *
+ * @param view View the consumer was registered for
+ */
+void frame_pipeline_remove_consumer(pipeline_view_t view);
+
+/**
+ * @brief Request frames without the bounding box overlay
+ *
+ * Requests nest; frames are drawn on again once every request is withdrawn.
+ * Meanwhile every frame is scanned whatever the decimation and motion gate,
+ * so a clean frame's detection is that of its own pixels.
+ *
+ * @param enable true to add a request, false to withdraw one
+ */
+void frame_pipeline_request_clean(bool enable);
+
+/**
+ * @brief Get the latest frame of a view if it is newer than the one already seen
+ *
+ * Class maps are published once per processed frame, so the mask view runs
+ * at the detection rate.
+ *
+ * @param view View to read
+ * @param seq In: sequence number of the last frame seen by the caller (0 for none).
+ *            Out: sequence number of the returned frame.
+ * @return Referenced frame (release with frame_pipeline_release), or NULL if nothing newer
+ */
+pipeline_frame_t *frame_pipeline_acquire(pipeline_view_t view, uint32_t *seq);
+
+/**
+ * @brief Release a frame obtained from frame_pipeline_acquire
+ *
+ * @param frame Frame to release
+ */
+void frame_pipeline_release(pipeline_frame_t *frame);
+
+/**
+ * @brief Copy the next captured frame into the snapshot buffer
+ *
+ * The pipeline task copies the frame as captured, before the bounding box
+ * is drawn on it, into a PSRAM buffer that is reused and only grows. The
+ * copy is held after release, so later callers can look at the same frame
+ * again. One snapshot exists at a time: the caller owns it until
+ * frame_pipeline_snapshot_release(), and other callers wait meanwhile.
+ *
+ * @param fb Filled with the snapshot (RGB565)
+ * @param refresh Copy a new frame; false returns the held snapshot when there is one
+ * @param timeout_ms Longest wait for the snapshot
+ * @return ESP_OK on success (release the snapshot afterwards), ESP_ERR_TIMEOUT
+ *         if no frame was captured in time, ESP_ERR_NOT_SUPPORTED if the
+ *         frame is not RGB565, ESP_ERR_NO_MEM if the buffer cannot be allocated
+ */
+esp_err_t frame_pipeline_snapshot(camera_fb_t *fb, bool refresh, uint32_t timeout_ms);
+
+/**
+ * @brief Release the snapshot taken by frame_pipeline_snapshot
+ */
+void frame_pipeline_snapshot_release(void);
+
+/**
+ * @brief Get pipeline statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void frame_pipeline_get_stats(frame_pipeline_stats_t *stats);
+
+#endif // FRAME_PIPELINE_H
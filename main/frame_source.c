@@ -0,0 +1,517 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Frame source implementation
+ */
+
+#include "frame_source.h"
+#include "img_converters.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "frame_source";
+
+// Synthetic pattern: bands cross the frame, then leave it empty for a while
+#define SYNTH_CYCLE_FRAMES      80
+#define SYNTH_VISIBLE_FRAMES    60
+#define SYNTH_BACKGROUND        0x8410      // Mid gray
+#define SYNTH_MIN_SIZE          64
+#define SYNTH_MAX_WIDTH         1280
+#define SYNTH_MAX_HEIGHT        1024
+
+static portMUX_TYPE source_lock = portMUX_INITIALIZER_UNLOCKED;
+static frame_source_config_t active;        // Written by the capture task only, under source_lock
+static frame_source_config_t pending;
+static bool pending_valid = false;
+static frame_source_stats_t stats;
+
+static bool sensor_available = false;
+
+// Frame handed out by the replay and synthetic sources
+static camera_fb_t source_fb;
+static bool fb_read_only = false;           // source_fb.buf points into mapped flash
+static uint8_t *scratch = NULL;             // PSRAM frame for decoding, generating and drawing
+static size_t scratch_size = 0;
+
+// Pacing and timestamps of the active source
+static int64_t start_us = 0;
+static int64_t next_due_us = 0;
+
+// Replay recording mapped from flash
+static const uint8_t *replay = NULL;
+static replay_header_t replay_header;
+static int64_t replay_first_us = 0;         // Recorded time of the first frame
+static int64_t replay_span_us = 0;          // Recorded length of one pass
+static uint32_t *replay_index = NULL;       // Offset of each frame header
+static const replay_label_t *replay_labels = NULL;
+static int64_t replay_loop_us = 0;          // Added to recorded times after each loop
+
+static inline size_t align4(size_t n)
+{
+    return (n + 3) & ~3;
+}
+
+static inline uint16_t rgb565_be(uint8_t r, uint8_t g, uint8_t b)
+{
+    uint16_t c = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    return __builtin_bswap16(c);
+}
+
+// Map the replay partition and check every frame header once
+static void replay_map(void)
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                FRAME_SOURCE_REPLAY_SUBTYPE,
+                                                                FRAME_SOURCE_REPLAY_LABEL);
+    if (!partition) {
+        ESP_LOGI(TAG, "No '%s' partition", FRAME_SOURCE_REPLAY_LABEL);
+        return;
+    }
+
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA,
+                           &ptr, &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map '%s' partition", FRAME_SOURCE_REPLAY_LABEL);
+        return;
+    }
+
+    const uint8_t *base = ptr;
+    replay_header_t header;
+    memcpy(&header, base, sizeof(header));
+
+    size_t frame_bytes = (size_t)header.width * header.height * 2;
+    bool valid = header.magic == FRAME_SOURCE_REPLAY_MAGIC &&
+                 header.version == FRAME_SOURCE_REPLAY_VERSION &&
+                 (header.format == PIXFORMAT_RGB565 || header.format == PIXFORMAT_YUV422 ||
+                  header.format == PIXFORMAT_JPEG) &&
+                 header.width > 0 && header.height > 0 && header.frames > 0;
+
+    uint32_t *index = NULL;
+    if (valid) {
+        index = heap_caps_malloc(header.frames * sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        valid = index != NULL;
+    }
+
+    size_t offset = sizeof(header);
+    int64_t first_us = 0, last_us = 0;
+    for (uint32_t i = 0; valid && i < header.frames; i++) {
+        replay_frame_header_t fh;
+        index[i] = offset;
+        if (offset + sizeof(fh) > partition->size) {
+            valid = false;
+            break;
+        }
+        memcpy(&fh, base + offset, sizeof(fh));
+        offset += sizeof(fh);
+        if (fh.len == 0 || offset + fh.len > partition->size ||
+            (header.format != PIXFORMAT_JPEG && fh.len != frame_bytes)) {
+            valid = false;
+            break;
+        }
+        if (i == 0) {
+            first_us = fh.timestamp_us;
+        }
+        last_us = fh.timestamp_us;
+        offset += align4(fh.len);
+    }
+
+    // Optional label table, one entry per frame
+    if (valid && header.labels &&
+        (header.labels < offset || header.labels % 4 ||
+         header.labels + header.frames * sizeof(replay_label_t) > partition->size)) {
+        valid = false;
+    }
+
+    if (!valid) {
+        ESP_LOGW(TAG, "No valid recording in '%s' partition", FRAME_SOURCE_REPLAY_LABEL);
+        free(index);
+        esp_partition_munmap(handle);
+        return;
+    }
+
+    replay = base;
+    replay_index = index;
+    replay_labels = header.labels ? (const replay_label_t *)(base + header.labels) : NULL;
+    replay_header = header;
+    replay_first_us = first_us;
+    // One pass lasts its recorded span plus one average frame period
+    int64_t period = header.frames > 1 ? (last_us - first_us) / (header.frames - 1) : 0;
+    replay_span_us = last_us - first_us + (period > 0 ? period : 1000000 / FRAME_SOURCE_NOMINAL_FPS);
+
+    ESP_LOGI(TAG, "Replay: %lu frames %ux%u, format %u, %u KB%s",
+             (unsigned long)header.frames, header.width, header.height, header.format,
+             (unsigned)(offset / 1024), replay_labels ? ", labelled" : "");
+}
+
+// Switch to a new configuration (capture task, between frames)
+static void apply(const frame_source_config_t *config)
+{
+    size_t need = 0;
+    if (config->type == FRAME_SOURCE_SYNTHETIC) {
+        need = (size_t)config->width * config->height * 2;
+    } else if (config->type == FRAME_SOURCE_REPLAY) {
+        need = (size_t)replay_header.width * replay_header.height * 2;
+    }
+    if (need > scratch_size) {
+        free(scratch);
+        scratch = heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        scratch_size = scratch ? need : 0;
+        if (!scratch) {
+            ESP_LOGE(TAG, "Failed to allocate %u byte frame", (unsigned)need);
+        }
+    }
+
+    taskENTER_CRITICAL(&source_lock);
+    active = *config;
+    stats.type = config->type;
+    stats.frames = 0;
+    stats.copies = 0;
+    stats.replay_position = 0;
+    taskEXIT_CRITICAL(&source_lock);
+
+    start_us = esp_timer_get_time();
+    next_due_us = 0;
+    replay_loop_us = 0;
+
+    static const char *names[] = { "sensor", "replay", "synthetic" };
+    ESP_LOGI(TAG, "Source: %s, %u fps cap", names[config->type], config->fps);
+}
+
+// Wait for the next frame slot when the rate is capped
+static void pace(void)
+{
+    if (!active.fps) {
+        return;
+    }
+
+    int64_t period = 1000000 / active.fps;
+    int64_t now = esp_timer_get_time();
+    if (next_due_us > now) {
+        vTaskDelay(pdMS_TO_TICKS((next_due_us - now) / 1000));
+        now = esp_timer_get_time();
+    }
+    // After a stall, restart the schedule rather than catching up
+    next_due_us = next_due_us + period < now ? now + period : next_due_us + period;
+}
+
+static int64_t frame_timestamp(int64_t captured_us, int64_t recorded_us)
+{
+    uint32_t fps = active.fps ? active.fps : FRAME_SOURCE_NOMINAL_FPS;
+
+    switch (active.timestamps) {
+    case FRAME_TIMESTAMP_RECORDED:
+        if (active.type == FRAME_SOURCE_REPLAY) {
+            return start_us + replay_loop_us + recorded_us - replay_first_us;
+        }
+        // fall through
+    case FRAME_TIMESTAMP_FIXED:
+        return start_us + (int64_t)stats.frames * 1000000 / fps;
+    default:
+        return captured_us;
+    }
+}
+
+static void set_timestamp(camera_fb_t *fb, int64_t timestamp_us)
+{
+    fb->timestamp.tv_sec = timestamp_us / 1000000;
+    fb->timestamp.tv_usec = timestamp_us % 1000000;
+}
+
+// Convert YUYV to big-endian RGB565 (BT.601, integer)
+static void yuv422_to_rgb565(const uint8_t *src, uint16_t *dst, size_t pixels)
+{
+    for (size_t i = 0; i < pixels; i += 2, src += 4) {
+        int u = src[1] - 128;
+        int v = src[3] - 128;
+        int dr = (359 * v) >> 8;
+        int dg = (88 * u + 183 * v) >> 8;
+        int db = (454 * u) >> 8;
+
+        for (int k = 0; k < 2; k++) {
+            int y = src[k * 2];
+            int r = y + dr, g = y - dg, b = y + db;
+            r = r < 0 ? 0 : (r > 255 ? 255 : r);
+            g = g < 0 ? 0 : (g > 255 ? 255 : g);
+            b = b < 0 ? 0 : (b > 255 ? 255 : b);
+            dst[i + k] = rgb565_be(r, g, b);
+        }
+    }
+}
+
+// Decode replay frame index into fb; RGB565 frames are not copied and stay
+// read-only, other formats are converted into buf
+static esp_err_t replay_decode(uint32_t index, uint8_t *buf, camera_fb_t *fb, int64_t *recorded_us)
+{
+    replay_frame_header_t fh;
+    memcpy(&fh, replay + replay_index[index], sizeof(fh));
+    const uint8_t *data = replay + replay_index[index] + sizeof(fh);
+    size_t pixels = (size_t)replay_header.width * replay_header.height;
+
+    fb->width = replay_header.width;
+    fb->height = replay_header.height;
+    fb->format = PIXFORMAT_RGB565;
+    fb->len = pixels * 2;
+    if (recorded_us) {
+        *recorded_us = fh.timestamp_us;
+    }
+
+    switch (replay_header.format) {
+    case PIXFORMAT_RGB565:
+        fb->buf = (uint8_t *)data;
+        return ESP_OK;
+    case PIXFORMAT_YUV422:
+        yuv422_to_rgb565(data, (uint16_t *)buf, pixels);
+        fb->buf = buf;
+        return ESP_OK;
+    default:
+        if (!jpg2rgb565(data, fh.len, buf, JPG_SCALE_NONE)) {
+            ESP_LOGW(TAG, "Failed to decode replay frame %lu", (unsigned long)index);
+            return ESP_FAIL;
+        }
+        fb->buf = buf;
+        return ESP_OK;
+    }
+}
+
+static camera_fb_t *replay_get(void)
+{
+    if (!replay || !scratch) {
+        return NULL;
+    }
+
+    uint32_t index = stats.replay_position;
+    if (index >= replay_header.frames) {
+        if (active.loop) {
+            index = 0;
+            replay_loop_us += replay_span_us;
+        } else {
+            // Hold the last frame
+            index = replay_header.frames - 1;
+        }
+    }
+
+    taskENTER_CRITICAL(&source_lock);
+    stats.replay_position = index + 1;
+    taskEXIT_CRITICAL(&source_lock);
+
+    int64_t recorded_us;
+    if (replay_decode(index, scratch, &source_fb, &recorded_us) != ESP_OK) {
+        return NULL;
+    }
+    // Zero copy: RGB565 frames are read straight from mapped flash
+    fb_read_only = source_fb.buf != scratch;
+
+    set_timestamp(&source_fb, frame_timestamp(esp_timer_get_time(), recorded_us));
+    return &source_fb;
+}
+
+// Gray frame with red, green and blue vertical bands moving left to right,
+// big-endian like the sensor's frames
+static camera_fb_t *synthetic_get(void)
+{
+    if (!scratch) {
+        return NULL;
+    }
+
+    uint16_t width = active.width, height = active.height;
+    uint16_t *pixels = (uint16_t *)scratch;
+    uint16_t bg = __builtin_bswap16(SYNTH_BACKGROUND);
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        pixels[i] = bg;
+    }
+
+    uint32_t phase = stats.frames % SYNTH_CYCLE_FRAMES;
+    if (phase < SYNTH_VISIBLE_FRAMES) {
+        static const uint8_t colors[3][3] = { { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 } };
+        uint16_t band_w = width / 16;
+        uint16_t band_h = height / 3;
+        uint16_t x0 = (uint32_t)(width - 3 * band_w) * phase / (SYNTH_VISIBLE_FRAMES - 1);
+        uint16_t y0 = (height - band_h) / 2;
+
+        for (int c = 0; c < 3; c++) {
+            uint16_t color = rgb565_be(colors[c][0], colors[c][1], colors[c][2]);
+            for (uint16_t y = y0; y < y0 + band_h; y++) {
+                uint16_t *row = pixels + (size_t)y * width + x0 + c * band_w;
+                for (uint16_t x = 0; x < band_w; x++) {
+                    row[x] = color;
+                }
+            }
+        }
+    }
+
+    source_fb.buf = scratch;
+    source_fb.len = (size_t)width * height * 2;
+    source_fb.width = width;
+    source_fb.height = height;
+    source_fb.format = PIXFORMAT_RGB565;
+    fb_read_only = false;
+
+    set_timestamp(&source_fb, frame_timestamp(esp_timer_get_time(), 0));
+    return &source_fb;
+}
+
+esp_err_t frame_source_init(bool available)
+{
+    sensor_available = available;
+    replay_map();
+
+    frame_source_config_t config = {
+        .type = available ? FRAME_SOURCE_SENSOR : FRAME_SOURCE_SYNTHETIC,
+        .fps = 0,
+        .timestamps = FRAME_TIMESTAMP_CAPTURE,
+        .loop = true,
+        .width = 640,
+        .height = 480,
+    };
+
+    taskENTER_CRITICAL(&source_lock);
+    stats.sensor = available;
+    stats.replay = replay != NULL;
+    stats.replay_format = replay_header.format;
+    stats.replay_width = replay_header.width;
+    stats.replay_height = replay_header.height;
+    stats.replay_frames = replay ? replay_header.frames : 0;
+    stats.replay_labels = replay_labels != NULL;
+    active = config;
+    taskEXIT_CRITICAL(&source_lock);
+
+    if (!available) {
+        ESP_LOGW(TAG, "No camera sensor, using synthetic frames");
+    }
+
+    return frame_source_configure(&config);
+}
+
+esp_err_t frame_source_configure(const frame_source_config_t *config)
+{
+    if (!config || config->type > FRAME_SOURCE_SYNTHETIC ||
+        config->timestamps > FRAME_TIMESTAMP_RECORDED) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->type == FRAME_SOURCE_SENSOR && !sensor_available) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (config->type == FRAME_SOURCE_REPLAY && !replay) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (config->type == FRAME_SOURCE_SYNTHETIC &&
+        (config->width < SYNTH_MIN_SIZE || config->width > SYNTH_MAX_WIDTH ||
+         config->height < SYNTH_MIN_SIZE || config->height > SYNTH_MAX_HEIGHT)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&source_lock);
+    pending = *config;
+    pending_valid = true;
+    taskEXIT_CRITICAL(&source_lock);
+
+    return ESP_OK;
+}
+
+void frame_source_get_config(frame_source_config_t *config)
+{
+    if (config) {
+        taskENTER_CRITICAL(&source_lock);
+        *config = pending_valid ? pending : active;
+        taskEXIT_CRITICAL(&source_lock);
+    }
+}
+
+camera_fb_t *frame_source_get(void)
+{
+    frame_source_config_t config;
+    bool changed;
+
+    taskENTER_CRITICAL(&source_lock);
+    changed = pending_valid;
+    config = pending;
+    pending_valid = false;
+    taskEXIT_CRITICAL(&source_lock);
+
+    if (changed) {
+        apply(&config);
+    }
+
+    pace();
+
+    camera_fb_t *fb;
+    switch (active.type) {
+    case FRAME_SOURCE_REPLAY:
+        fb = replay_get();
+        break;
+    case FRAME_SOURCE_SYNTHETIC:
+        fb = synthetic_get();
+        break;
+    default:
+        fb = esp_camera_fb_get();
+        if (fb && active.timestamps != FRAME_TIMESTAMP_CAPTURE) {
+            set_timestamp(fb, frame_timestamp(0, 0));
+        }
+        break;
+    }
+
+    if (fb) {
+        taskENTER_CRITICAL(&source_lock);
+        stats.frames++;
+        taskEXIT_CRITICAL(&source_lock);
+    }
+    return fb;
+}
+
+void frame_source_return(camera_fb_t *fb)
+{
+    if (fb && fb != &source_fb) {
+        esp_camera_fb_return(fb);
+    }
+}
+
+camera_fb_t *frame_source_make_writable(camera_fb_t *fb)
+{
+    if (fb == &source_fb && fb_read_only && scratch) {
+        memcpy(scratch, fb->buf, fb->len);
+        fb->buf = scratch;
+        fb_read_only = false;
+
+        taskENTER_CRITICAL(&source_lock);
+        stats.copies++;
+        taskEXIT_CRITICAL(&source_lock);
+    }
+    return fb;
+}
+
+esp_err_t frame_source_replay_read(uint32_t index, uint8_t *buf, camera_fb_t *fb, replay_label_t *label)
+{
+    if (!fb || !buf) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!replay || index >= replay_header.frames) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (label) {
+        if (replay_labels) {
+            memcpy(label, &replay_labels[index], sizeof(replay_label_t));
+        } else {
+            memset(label, 0, sizeof(replay_label_t));
+        }
+    }
+
+    memset(fb, 0, sizeof(camera_fb_t));
+    return replay_decode(index, buf, fb, NULL);
+}
+
+void frame_source_get_stats(frame_source_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&source_lock);
+        memcpy(out, &stats, sizeof(frame_source_stats_t));
+        taskEXIT_CRITICAL(&source_lock);
+    }
+}
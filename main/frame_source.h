@@ -0,0 +1,172 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Frame sources behind camera_get_fb(): sensor, flash replay, synthetic pattern
+ */
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include "esp_camera.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Flash partition holding a replay recording (data partition, custom subtype)
+#define FRAME_SOURCE_REPLAY_LABEL   "replay"
+#define FRAME_SOURCE_REPLAY_SUBTYPE 0x41
+
+// Replay recording layout (little endian), written by tools/replay_pack.py:
+// a replay_header_t, then for each frame a replay_frame_header_t followed by
+// the frame data padded to a multiple of 4 bytes, then optionally the label
+// table (replay_label_t per frame)
+#define FRAME_SOURCE_REPLAY_MAGIC   0x594C5052  // "RPLY"
+#define FRAME_SOURCE_REPLAY_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t format;            // pixformat_t: RGB565 (big endian), YUV422 (YUYV) or JPEG
+    uint16_t width;
+    uint16_t height;
+    uint32_t frames;
+    uint32_t labels;            // Offset of the label table (0 = unlabelled)
+    uint32_t reserved[3];
+} replay_header_t;
+
+typedef struct {
+    uint32_t len;               // Frame data length
+    uint32_t reserved;
+    int64_t timestamp_us;       // Recorded capture time
+} replay_frame_header_t;
+
+// Ground truth of one frame; the label table holds one per frame, in order
+#define REPLAY_LABEL_LABELLED       0x01    // Frame has been labelled
+#define REPLAY_LABEL_PRESENT        0x02    // R-G-B bands visible, bbox holds them
+
+typedef struct {
+    uint16_t flags;             // REPLAY_LABEL_* flags
+    uint16_t bbox_x;
+    uint16_t bbox_y;
+    uint16_t bbox_w;
+    uint16_t bbox_h;
+    uint16_t reserved;
+} replay_label_t;
+
+// Frame rate used for fixed timestamps when the rate is not capped
+#define FRAME_SOURCE_NOMINAL_FPS    25
+
+typedef enum {
+    FRAME_SOURCE_SENSOR = 0,    // OV2640
+    FRAME_SOURCE_REPLAY,        // Recording in the replay partition
+    FRAME_SOURCE_SYNTHETIC,     // Generated moving R-G-B bands
+} frame_source_type_t;
+
+typedef enum {
+    FRAME_TIMESTAMP_CAPTURE = 0,    // Time the frame was captured or produced
+    FRAME_TIMESTAMP_FIXED,          // Start time + frame number / fps (deterministic)
+    FRAME_TIMESTAMP_RECORDED,       // Replay: start time + recorded offset
+} frame_timestamp_mode_t;
+
+typedef struct {
+    frame_source_type_t type;
+    uint8_t fps;                        // Frame rate cap (0 = as fast as frames are requested)
+    frame_timestamp_mode_t timestamps;
+    bool loop;                          // Replay: restart at the end, otherwise repeat the last frame
+    uint16_t width;                     // Synthetic frame size
+    uint16_t height;
+} frame_source_config_t;
+
+typedef struct {
+    frame_source_type_t type;
+    uint32_t frames;            // Frames delivered by the current source
+    uint32_t copies;            // Zero-copy frames copied to be drawn on
+    bool sensor;                // Sensor initialized
+    bool replay;                // Valid recording found
+    uint16_t replay_format;     // pixformat_t of the recording
+    uint16_t replay_width;
+    uint16_t replay_height;
+    uint32_t replay_frames;     // Frames in the recording
+    uint32_t replay_position;   // Index of the next frame to replay
+    bool replay_labels;         // Recording carries a label table
+} frame_source_stats_t;
+
+/**
+ * @brief Initialize the frame sources
+ *
+ * Maps the replay partition if it holds a valid recording. Without a sensor
+ * the synthetic source is selected.
+ *
+ * @param sensor_available camera_init() succeeded
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t frame_source_init(bool sensor_available);
+
+/**
+ * @brief Select a source and its timing
+ *
+ * The change takes effect at the next frame boundary.
+ *
+ * @param config Source configuration
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the sensor is not
+ *         available, ESP_ERR_NOT_FOUND if there is no recording to replay,
+ *         ESP_ERR_INVALID_ARG for an invalid configuration
+ */
+esp_err_t frame_source_configure(const frame_source_config_t *config);
+
+/**
+ * @brief Get the configuration in effect (or pending)
+ *
+ * @param config Pointer to config structure to fill
+ */
+void frame_source_get_config(frame_source_config_t *config);
+
+/**
+ * @brief Get a frame from the active source
+ *
+ * Blocks to honour the frame rate cap. Only one frame may be held at a time.
+ *
+ * @return Frame buffer or NULL on error
+ */
+camera_fb_t *frame_source_get(void);
+
+/**
+ * @brief Return a frame obtained with frame_source_get()
+ *
+ * @param fb Frame buffer to return
+ */
+void frame_source_return(camera_fb_t *fb);
+
+/**
+ * @brief Make a frame safe to draw on
+ *
+ * Replayed RGB565 frames point straight into memory-mapped flash; they are
+ * copied to a PSRAM buffer the first time this is called. Other frames are
+ * returned unchanged.
+ *
+ * @param fb Frame buffer held by the caller
+ * @return fb, now writable
+ */
+camera_fb_t *frame_source_make_writable(camera_fb_t *fb);
+
+/**
+ * @brief Read one frame of the replay recording, independently of the active source
+ *
+ * @param index Frame index
+ * @param buf Buffer of width * height * 2 bytes for converted frames
+ * @param fb Filled with the RGB565 frame; for RGB565 recordings it points into
+ *           mapped flash and must not be written
+ * @param label Filled with the frame's ground truth (flags 0 if unlabelled), may be NULL
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND past the end or without a
+ *         recording, ESP_FAIL if the frame cannot be decoded
+ */
+esp_err_t frame_source_replay_read(uint32_t index, uint8_t *buf, camera_fb_t *fb, replay_label_t *label);
+
+/**
+ * @brief Get frame source statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void frame_source_get_stats(frame_source_stats_t *stats);
+
+#endif // FRAME_SOURCE_H
@@ -6,27 +6,41 @@
 
 #include "http_server.h"
 #include "web_ui.h"
-#include "camera_driver.h"
 #include "color_detect.h"
+#include "color_histogram.h"
+#include "config_preview.h"
 #include "config_store.h"
+#include "jpeg_encoder.h"
+#include "motion_gate.h"
+#include "frame_pipeline.h"
+#include "stream_sender.h"
+#include "rtsp_server.h"
+#include "mqtt_publisher.h"
+#include "detection_log.h"
 #include "ws2812_led.h"
+#include "clip_recorder.h"
+#include "frame_source.h"
+#include "detect_bench.h"
+#include "detect_profile.h"
+#include "kernel_bench.h"
+#include "cpu_load.h"
+#include "log_sink.h"
+#include "boot_profile.h"
 #include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
-#include "esp_camera.h"
+#include "esp_timer.h"
 #include "cJSON.h"
 #include <string.h>
-
-// Forward declaration (provided by esp32-camera component)
-bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/param.h>
 
 static const char *TAG = "http_server";
 static httpd_handle_t server = NULL;
 
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char* _STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char* _STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char* _STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
-
 // Handler for root path (web UI)
 static esp_err_t root_handler(httpd_req_t *req)
 {
@@ -35,81 +49,236 @@ static esp_err_t root_handler(httpd_req_t *req)
     return httpd_resp_send(req, web_ui_html, strlen(web_ui_html));
 }
 
-// Handler for MJPEG stream
+// Handler for MJPEG stream: the socket is handed over to the sender task.
+// ?view=mask streams the detector's class map instead of the camera frames
 static esp_err_t stream_handler(httpd_req_t *req)
 {
-    camera_fb_t *fb = NULL;
-    esp_err_t res = ESP_OK;
-    size_t _jpg_buf_len = 0;
-    uint8_t *_jpg_buf = NULL;
-    char part_buf[64];
-    detection_result_t detection;
+    pipeline_view_t view = PIPELINE_VIEW_COLOR;
+    char query[32], value[8];
 
-    res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
-    if (res != ESP_OK) {
-        return res;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "view", value, sizeof(value)) == ESP_OK) {
+        if (strcmp(value, "mask") == 0) {
+            view = PIPELINE_VIEW_MASK;
+        } else if (strcmp(value, "color") != 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown view");
+            return ESP_OK;
+        }
     }
 
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    esp_err_t ret = stream_sender_add(req, view);
+    if (ret != ESP_OK) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "Too many streams");
+        return ESP_OK;
+    }
+    return ESP_OK;
+}
 
-    while (true) {
-        fb = camera_get_fb();
-        if (!fb) {
-            ESP_LOGE(TAG, "Camera capture failed");
-            res = ESP_FAIL;
-            break;
-        }
+// Largest message accepted from a WebSocket client
+#define WS_MAX_MESSAGE 128
 
-        // Process for color detection
-        color_detect_process(fb, &detection);
-        
-        // Update LED based on detection
-        ws2812_set_detection_status(detection.rgb_detected);
+// Handler for /ws: frames are pushed by the sender task, the client only
+// sends credit grants ({"credit":N}) and control frames
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    int fd = httpd_req_to_sockfd(req);
 
-        // Draw bounding box if detected
-        if (detection.rgb_detected) {
-            color_detect_draw_bbox(fb, &detection);
+    if (req->method == HTTP_GET) {
+        // Handshake completed
+        if (stream_sender_add_ws(req->handle, fd) != ESP_OK) {
+            return ESP_FAIL;
         }
+        return ESP_OK;
+    }
 
-        // Convert RGB565 to JPEG
-        if (fb->format != PIXFORMAT_JPEG) {
-            bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-            if (!jpeg_converted) {
-                ESP_LOGE(TAG, "JPEG compression failed");
-                camera_return_fb(fb);
-                res = ESP_FAIL;
-                break;
-            }
-        } else {
-            _jpg_buf_len = fb->len;
-            _jpg_buf = fb->buf;
+    uint8_t buf[WS_MAX_MESSAGE + 1];
+    httpd_ws_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len > WS_MAX_MESSAGE) {
+        ESP_LOGW(TAG, "WebSocket message too long (%u bytes)", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+    if (frame.len) {
+        frame.payload = buf;
+        ret = httpd_ws_recv_frame(req, &frame, frame.len);
+        if (ret != ESP_OK) {
+            return ret;
         }
+    }
+    buf[frame.len] = '\0';
 
-        // Send JPEG frame
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+    switch (frame.type) {
+    case HTTPD_WS_TYPE_TEXT: {
+        cJSON *root = cJSON_Parse((const char *)buf);
+        cJSON *credit = root ? cJSON_GetObjectItem(root, "credit") : NULL;
+        if (credit && cJSON_IsNumber(credit) && credit->valueint > 0) {
+            stream_sender_ws_credit(fd, credit->valueint);
         }
-        if (res == ESP_OK) {
-            size_t hlen = snprintf(part_buf, sizeof(part_buf), _STREAM_PART, _jpg_buf_len);
-            res = httpd_resp_send_chunk(req, part_buf, hlen);
+        cJSON_Delete(root);
+        break;
+    }
+    case HTTPD_WS_TYPE_PING:
+        stream_sender_ws_ping(fd, buf, frame.len);
+        break;
+    case HTTPD_WS_TYPE_CLOSE:
+        httpd_sess_trigger_close(req->handle, fd);
+        break;
+    default:
+        break;
+    }
+
+    return ESP_OK;
+}
+
+// Session close callback: detach the socket from the sender before closing it
+static void session_close(httpd_handle_t hd, int sockfd)
+{
+    stream_sender_socket_closed(sockfd);
+    close(sockfd);
+}
+
+// The red/green/blue thresholds of /api/config are those of the pattern
+// classes with these names; keep both sides in step.
+static const char *const legacy_classes[3] = { "red", "green", "blue" };
+
+static hsv_threshold_t *legacy_threshold(color_config_t *config, int i)
+{
+    return i == 0 ? &config->red : i == 1 ? &config->green : &config->blue;
+}
+
+// Copy the red/green/blue thresholds into the pattern classes of that name
+static bool apply_legacy_thresholds(color_config_t *config, pattern_config_t *pattern)
+{
+    bool changed = false;
+    for (int i = 0; i < 3; i++) {
+        int c = color_pattern_find_class(pattern, legacy_classes[i]);
+        const hsv_threshold_t *t = legacy_threshold(config, i);
+        if (c >= 0 && memcmp(&pattern->classes[c].thresh, t, sizeof(hsv_threshold_t)) != 0) {
+            pattern->classes[c].thresh = *t;
+            changed = true;
         }
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
+    }
+    return changed;
+}
+
+static void sync_pattern_thresholds(color_config_t *config)
+{
+    pattern_config_t pattern;
+    color_detect_get_pattern(&pattern);
+
+    if (apply_legacy_thresholds(config, &pattern) && color_detect_set_pattern(&pattern) == ESP_OK) {
+        config_save_pattern(&pattern);
+    }
+}
+
+static void sync_config_thresholds(const pattern_config_t *pattern)
+{
+    color_config_t config;
+    if (config_load(&config) != ESP_OK) {
+        config_get_defaults(&config);
+    }
+
+    bool changed = false;
+    for (int i = 0; i < 3; i++) {
+        int c = color_pattern_find_class(pattern, legacy_classes[i]);
+        hsv_threshold_t *t = legacy_threshold(&config, i);
+        if (c >= 0 && memcmp(&pattern->classes[c].thresh, t, sizeof(hsv_threshold_t)) != 0) {
+            *t = pattern->classes[c].thresh;
+            changed = true;
         }
+    }
+    if (changed) {
+        config_save(&config);
+    }
+}
 
-        if (fb->format != PIXFORMAT_JPEG) {
-            free(_jpg_buf);
-            _jpg_buf = NULL;
+// Regions of interest as [{"mode": "exclude", "rect": [x0, y0, x1, y1]},
+// {"mode": "include", "polygon": [[x, y], ...]}], coordinates 0..MASK_SCALE
+static cJSON *masks_to_json(const mask_config_t *mask)
+{
+    cJSON *regions = cJSON_CreateArray();
+    for (int i = 0; i < mask->region_count; i++) {
+        const mask_region_t *r = &mask->regions[i];
+        cJSON *region = cJSON_CreateObject();
+        cJSON_AddStringToObject(region, "mode", r->mode == MASK_INCLUDE ? "include" : "exclude");
+        if (r->shape == MASK_RECT) {
+            int corners[4] = { r->points[0].x, r->points[0].y, r->points[1].x, r->points[1].y };
+            cJSON_AddItemToObject(region, "rect", cJSON_CreateIntArray(corners, 4));
+        } else {
+            cJSON *polygon = cJSON_CreateArray();
+            for (int p = 0; p < r->point_count; p++) {
+                int point[2] = { r->points[p].x, r->points[p].y };
+                cJSON_AddItemToArray(polygon, cJSON_CreateIntArray(point, 2));
+            }
+            cJSON_AddItemToObject(region, "polygon", polygon);
         }
+        cJSON_AddItemToArray(regions, region);
+    }
+    return regions;
+}
+
+// Read x from item and y from the item after it
+static bool parse_mask_point(const cJSON *item, mask_point_t *point)
+{
+    if (!cJSON_IsNumber(item) || !cJSON_IsNumber(item->next) ||
+        item->valueint < 0 || item->valueint > MASK_SCALE ||
+        item->next->valueint < 0 || item->next->valueint > MASK_SCALE) {
+        return false;
+    }
+    point->x = item->valueint;
+    point->y = item->next->valueint;
+    return true;
+}
 
-        camera_return_fb(fb);
+// Parse a regions array; returns an error message, or NULL on success
+static const char *parse_masks(const cJSON *regions, mask_config_t *mask)
+{
+    memset(mask, 0, sizeof(mask_config_t));
+    if (!cJSON_IsArray(regions) || cJSON_GetArraySize(regions) > MASK_MAX_REGIONS) {
+        return "masks: up to 8 regions";
+    }
 
-        if (res != ESP_OK) {
-            break;
+    cJSON *region;
+    cJSON_ArrayForEach(region, regions) {
+        mask_region_t *r = &mask->regions[mask->region_count++];
+        cJSON *mode = cJSON_GetObjectItem(region, "mode");
+        if (!cJSON_IsString(mode) ||
+            (strcmp(mode->valuestring, "include") != 0 && strcmp(mode->valuestring, "exclude") != 0)) {
+            return "masks: mode must be include or exclude";
         }
-    }
+        r->mode = strcmp(mode->valuestring, "include") == 0 ? MASK_INCLUDE : MASK_EXCLUDE;
 
-    return res;
+        cJSON *rect = cJSON_GetObjectItem(region, "rect");
+        cJSON *polygon = cJSON_GetObjectItem(region, "polygon");
+        if (rect) {
+            r->shape = MASK_RECT;
+            r->point_count = 2;
+            if (!cJSON_IsArray(rect) || cJSON_GetArraySize(rect) != 4 ||
+                !parse_mask_point(rect->child, &r->points[0]) ||
+                !parse_mask_point(rect->child->next->next, &r->points[1])) {
+                return "masks: rect is [x0, y0, x1, y1], 0-1000";
+            }
+        } else if (cJSON_IsArray(polygon) && cJSON_GetArraySize(polygon) >= 3 &&
+                   cJSON_GetArraySize(polygon) <= MASK_MAX_POINTS) {
+            r->shape = MASK_POLYGON;
+            cJSON *point;
+            cJSON_ArrayForEach(point, polygon) {
+                if (!cJSON_IsArray(point) || cJSON_GetArraySize(point) != 2 ||
+                    !parse_mask_point(point->child, &r->points[r->point_count++])) {
+                    return "masks: polygon points are [x, y], 0-1000";
+                }
+            }
+        } else {
+            return "masks: each region needs a rect or a polygon of 3 to 8 points";
+        }
+    }
+    return NULL;
 }
 
 // Handler for GET /api/config
@@ -118,7 +287,7 @@ static esp_err_t config_get_handler(httpd_req_t *req)
     color_config_t config;
     esp_err_t ret = config_load(&config);
     
-    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+    if (ret != ESP_OK) {
         config_get_defaults(&config);
     }
 
@@ -154,6 +323,10 @@ static esp_err_t config_get_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(root, "min_area", config.min_area);
     cJSON_AddNumberToObject(root, "min_confidence", config.min_confidence);
     cJSON_AddNumberToObject(root, "frame_decimation", config.frame_decimation);
+    cJSON_AddNumberToObject(root, "motion_threshold", config.motion_threshold);
+    cJSON_AddNumberToObject(root, "refresh_interval", config.refresh_interval);
+    cJSON_AddBoolToObject(root, "window_scoring", config.window_scoring);
+    cJSON_AddItemToObject(root, "masks", masks_to_json(&config.mask));
 
     char *json_str = cJSON_Print(root);
     httpd_resp_set_type(req, "application/json");
@@ -165,10 +338,52 @@ static esp_err_t config_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Apply the fields of a /api/config body to config; fields not given keep
+// their value
+static const char *parse_config(const cJSON *root, color_config_t *config)
+{
+    static const char *const keys[6] = { "h_min", "h_max", "s_min", "s_max", "v_min", "v_max" };
+
+    for (int i = 0; i < 3; i++) {
+        cJSON *color = cJSON_GetObjectItem(root, legacy_classes[i]);
+        if (color && cJSON_IsObject(color)) {
+            uint8_t *limits = &legacy_threshold(config, i)->h_min;
+            for (int k = 0; k < 6; k++) {
+                cJSON *item = cJSON_GetObjectItem(color, keys[k]);
+                if (item && cJSON_IsNumber(item)) limits[k] = item->valueint;
+            }
+        }
+    }
+
+    cJSON *min_area = cJSON_GetObjectItem(root, "min_area");
+    if (min_area && cJSON_IsNumber(min_area)) config->min_area = min_area->valueint;
+
+    cJSON *min_confidence = cJSON_GetObjectItem(root, "min_confidence");
+    if (min_confidence && cJSON_IsNumber(min_confidence)) config->min_confidence = min_confidence->valueint;
+
+    cJSON *frame_decimation = cJSON_GetObjectItem(root, "frame_decimation");
+    if (frame_decimation && cJSON_IsNumber(frame_decimation)) config->frame_decimation = frame_decimation->valueint;
+
+    cJSON *motion_threshold = cJSON_GetObjectItem(root, "motion_threshold");
+    if (motion_threshold && cJSON_IsNumber(motion_threshold)) config->motion_threshold = motion_threshold->valueint;
+
+    cJSON *refresh_interval = cJSON_GetObjectItem(root, "refresh_interval");
+    if (refresh_interval && cJSON_IsNumber(refresh_interval)) config->refresh_interval = refresh_interval->valueint;
+
+    cJSON *window_scoring = cJSON_GetObjectItem(root, "window_scoring");
+    if (window_scoring && cJSON_IsBool(window_scoring)) config->window_scoring = cJSON_IsTrue(window_scoring);
+
+    cJSON *masks = cJSON_GetObjectItem(root, "masks");
+    if (masks) {
+        return parse_masks(masks, &config->mask);
+    }
+    return NULL;
+}
+
 // Handler for POST /api/config
 static esp_err_t config_post_handler(httpd_req_t *req)
 {
-    char buf[1024];
+    char buf[2048];
     int ret, remaining = req->content_len;
 
     if (remaining >= sizeof(buf)) {
@@ -194,47 +409,18 @@ static esp_err_t config_post_handler(httpd_req_t *req)
     color_config_t config;
     config_get_defaults(&config);
 
-    cJSON *red = cJSON_GetObjectItem(root, "red");
-    if (red && cJSON_IsObject(red)) {
-        cJSON *item;
-        if ((item = cJSON_GetObjectItem(red, "h_min")) && cJSON_IsNumber(item)) config.red.h_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(red, "h_max")) && cJSON_IsNumber(item)) config.red.h_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(red, "s_min")) && cJSON_IsNumber(item)) config.red.s_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(red, "s_max")) && cJSON_IsNumber(item)) config.red.s_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(red, "v_min")) && cJSON_IsNumber(item)) config.red.v_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(red, "v_max")) && cJSON_IsNumber(item)) config.red.v_max = item->valueint;
-    }
-
-    cJSON *green = cJSON_GetObjectItem(root, "green");
-    if (green && cJSON_IsObject(green)) {
-        cJSON *item;
-        if ((item = cJSON_GetObjectItem(green, "h_min")) && cJSON_IsNumber(item)) config.green.h_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(green, "h_max")) && cJSON_IsNumber(item)) config.green.h_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(green, "s_min")) && cJSON_IsNumber(item)) config.green.s_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(green, "s_max")) && cJSON_IsNumber(item)) config.green.s_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(green, "v_min")) && cJSON_IsNumber(item)) config.green.v_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(green, "v_max")) && cJSON_IsNumber(item)) config.green.v_max = item->valueint;
-    }
-
-    cJSON *blue = cJSON_GetObjectItem(root, "blue");
-    if (blue && cJSON_IsObject(blue)) {
-        cJSON *item;
-        if ((item = cJSON_GetObjectItem(blue, "h_min")) && cJSON_IsNumber(item)) config.blue.h_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(blue, "h_max")) && cJSON_IsNumber(item)) config.blue.h_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(blue, "s_min")) && cJSON_IsNumber(item)) config.blue.s_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(blue, "s_max")) && cJSON_IsNumber(item)) config.blue.s_max = item->valueint;
-        if ((item = cJSON_GetObjectItem(blue, "v_min")) && cJSON_IsNumber(item)) config.blue.v_min = item->valueint;
-        if ((item = cJSON_GetObjectItem(blue, "v_max")) && cJSON_IsNumber(item)) config.blue.v_max = item->valueint;
+    // Masks are kept unless given, so saving thresholds does not drop them
+    color_config_t stored;
+    if (config_load(&stored) == ESP_OK) {
+        config.mask = stored.mask;
     }
 
-    cJSON *min_area = cJSON_GetObjectItem(root, "min_area");
-    if (min_area && cJSON_IsNumber(min_area)) config.min_area = min_area->valueint;
-
-    cJSON *min_confidence = cJSON_GetObjectItem(root, "min_confidence");
-    if (min_confidence && cJSON_IsNumber(min_confidence)) config.min_confidence = min_confidence->valueint;
-
-    cJSON *frame_decimation = cJSON_GetObjectItem(root, "frame_decimation");
-    if (frame_decimation && cJSON_IsNumber(frame_decimation)) config.frame_decimation = frame_decimation->valueint;
+    const char *error = parse_config(root, &config);
+    if (error) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
 
     cJSON_Delete(root);
 
@@ -247,6 +433,9 @@ static esp_err_t config_post_handler(httpd_req_t *req)
 
     // Update runtime config
     color_detect_update_config(&config);
+    motion_gate_configure(config.motion_threshold, config.refresh_interval);
+    sync_pattern_thresholds(&config);
+    detect_profile_sync_active();
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
@@ -254,49 +443,1961 @@ static esp_err_t config_post_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-esp_err_t http_server_start(void)
+// Handler for GET /api/pattern
+static esp_err_t pattern_get_handler(httpd_req_t *req)
 {
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port = 80;
-    config.ctrl_port = 32768;
-    config.max_uri_handlers = 8;
-    config.max_resp_headers = 8;
-    config.stack_size = 8192;
+    pattern_config_t pattern;
+    color_detect_get_pattern(&pattern);
 
-    ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "version", color_detect_get_config_version());
+    cJSON_AddStringToObject(root, "orientation",
+                            pattern.orientation == PATTERN_VERTICAL ? "vertical" : "horizontal");
 
-    if (httpd_start(&server, &config) == ESP_OK) {
-        httpd_uri_t root_uri = {
-            .uri = "/",
-            .method = HTTP_GET,
-            .handler = root_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &root_uri);
+    cJSON *classes = cJSON_CreateArray();
+    for (int i = 0; i < pattern.class_count; i++) {
+        const hsv_threshold_t *t = &pattern.classes[i].thresh;
+        cJSON *c = cJSON_CreateObject();
+        cJSON_AddStringToObject(c, "name", pattern.classes[i].name);
+        cJSON_AddNumberToObject(c, "h_min", t->h_min);
+        cJSON_AddNumberToObject(c, "h_max", t->h_max);
+        cJSON_AddNumberToObject(c, "s_min", t->s_min);
+        cJSON_AddNumberToObject(c, "s_max", t->s_max);
+        cJSON_AddNumberToObject(c, "v_min", t->v_min);
+        cJSON_AddNumberToObject(c, "v_max", t->v_max);
+        cJSON_AddItemToArray(classes, c);
+    }
+    cJSON_AddItemToObject(root, "classes", classes);
 
-        httpd_uri_t stream_uri = {
-            .uri = "/stream",
-            .method = HTTP_GET,
-            .handler = stream_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &stream_uri);
+    cJSON *sequences = cJSON_CreateArray();
+    for (int i = 0; i < pattern.sequence_count; i++) {
+        const band_sequence_t *seq = &pattern.sequences[i];
+        cJSON *bands = cJSON_CreateArray();
+        for (int b = 0; b < seq->length; b++) {
+            cJSON_AddItemToArray(bands, cJSON_CreateString(pattern.classes[seq->classes[b]].name));
+        }
+        cJSON_AddItemToArray(sequences, bands);
+    }
+    cJSON_AddItemToObject(root, "sequences", sequences);
 
-        httpd_uri_t config_get_uri = {
-            .uri = "/api/config",
-            .method = HTTP_GET,
-            .handler = config_get_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &config_get_uri);
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
 
-        httpd_uri_t config_post_uri = {
-            .uri = "/api/config",
-            .method = HTTP_POST,
-            .handler = config_post_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(server, &config_post_uri);
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Parse a pattern description; returns an error message or NULL
+static const char *parse_pattern(const cJSON *root, pattern_config_t *pattern)
+{
+    static const char *const keys[6] = { "h_min", "h_max", "s_min", "s_max", "v_min", "v_max" };
+
+    memset(pattern, 0, sizeof(pattern_config_t));
+
+    cJSON *orientation = cJSON_GetObjectItem(root, "orientation");
+    if (orientation) {
+        if (!cJSON_IsString(orientation)) {
+            return "Invalid orientation";
+        }
+        if (strcmp(orientation->valuestring, "vertical") == 0) {
+            pattern->orientation = PATTERN_VERTICAL;
+        } else if (strcmp(orientation->valuestring, "horizontal") != 0) {
+            return "Invalid orientation";
+        }
+    }
+
+    cJSON *classes = cJSON_GetObjectItem(root, "classes");
+    if (!cJSON_IsArray(classes) || cJSON_GetArraySize(classes) < 1 ||
+        cJSON_GetArraySize(classes) > PATTERN_MAX_CLASSES) {
+        return "1 to 8 classes required";
+    }
+    cJSON *c;
+    cJSON_ArrayForEach(c, classes) {
+        color_class_t *cls = &pattern->classes[pattern->class_count++];
+        cJSON *name = cJSON_GetObjectItem(c, "name");
+        if (!cJSON_IsString(name) || name->valuestring[0] == '\0' ||
+            strlen(name->valuestring) >= PATTERN_NAME_LEN) {
+            return "Class name required (up to 11 characters)";
+        }
+        strcpy(cls->name, name->valuestring);
+
+        // Missing limits leave the channel unrestricted
+        uint8_t *limits = &cls->thresh.h_min;
+        for (int k = 0; k < 6; k++) {
+            cJSON *item = cJSON_GetObjectItem(c, keys[k]);
+            if (!item) {
+                limits[k] = k % 2 ? 255 : 0;
+            } else if (!cJSON_IsNumber(item) || item->valueint < 0 || item->valueint > 255) {
+                return "Thresholds must be 0-255";
+            } else {
+                limits[k] = item->valueint;
+            }
+        }
+    }
+
+    cJSON *sequences = cJSON_GetObjectItem(root, "sequences");
+    if (!cJSON_IsArray(sequences) || cJSON_GetArraySize(sequences) < 1 ||
+        cJSON_GetArraySize(sequences) > PATTERN_MAX_SEQUENCES) {
+        return "1 to 4 sequences required";
+    }
+    cJSON *s;
+    cJSON_ArrayForEach(s, sequences) {
+        band_sequence_t *seq = &pattern->sequences[pattern->sequence_count++];
+        if (!cJSON_IsArray(s) || cJSON_GetArraySize(s) > PATTERN_MAX_CLASSES) {
+            return "Sequences are arrays of class names";
+        }
+        cJSON *band;
+        cJSON_ArrayForEach(band, s) {
+            int index = cJSON_IsString(band) ? color_pattern_find_class(pattern, band->valuestring) : -1;
+            if (index < 0) {
+                return "Unknown class in sequence";
+            }
+            seq->classes[seq->length++] = index;
+        }
+    }
+
+    if (color_pattern_validate(pattern) != ESP_OK) {
+        return "Class names must differ; sequences need 2 or more classes, each at most once";
+    }
+    return NULL;
+}
+
+// Handler for POST /api/pattern
+static esp_err_t pattern_post_handler(httpd_req_t *req)
+{
+    char buf[2048];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    pattern_config_t pattern;
+    const char *error = parse_pattern(root, &pattern);
+    cJSON_Delete(root);
+    if (error) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
+
+    if (color_detect_set_pattern(&pattern) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid pattern");
+        return ESP_FAIL;
+    }
+    if (config_save_pattern(&pattern) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save pattern");
+        return ESP_FAIL;
+    }
+    sync_config_thresholds(&pattern);
+    detect_profile_sync_active();
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+    return ESP_OK;
+}
+
+static cJSON *switch_to_json(const detect_profile_switch_t *r)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "resident", r->resident);
+    cJSON_AddNumberToObject(json, "load_us", r->load_us);
+    cJSON_AddNumberToObject(json, "compile_us", r->compile_us);
+    cJSON_AddNumberToObject(json, "wait_us", r->wait_us);
+    cJSON_AddNumberToObject(json, "swap_us", r->swap_us);
+    cJSON_AddNumberToObject(json, "total_us", r->total_us);
+    return json;
+}
+
+// Handler for GET /api/profiles
+static esp_err_t profiles_get_handler(httpd_req_t *req)
+{
+    char names[PROFILE_MAX][PROFILE_NAME_LEN];
+    int count = config_list_profiles(names, PROFILE_MAX);
+    detect_profile_state_t state;
+    detect_profile_get_state(&state);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *profiles = cJSON_CreateArray();
+    for (int i = 0; i < count; i++) {
+        cJSON_AddItemToArray(profiles, cJSON_CreateString(names[i]));
+    }
+    cJSON_AddItemToObject(root, "profiles", profiles);
+    cJSON_AddStringToObject(root, "active", state.active);
+    cJSON_AddStringToObject(root, "standby", state.standby);
+    cJSON_AddNumberToObject(root, "switches", state.switches);
+    if (state.switches > 0) {
+        cJSON_AddItemToObject(root, "last_switch", switch_to_json(&state.last));
+    }
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Profile name from /api/profile/<name>, without the query
+static bool profile_name(httpd_req_t *req, char *name)
+{
+    const char *start = req->uri + strlen("/api/profile/");
+    size_t len = strcspn(start, "?");
+    if (len == 0 || len >= PROFILE_NAME_LEN) {
+        return false;
+    }
+    memcpy(name, start, len);
+    name[len] = '\0';
+    return config_profile_name_valid(name);
+}
+
+// Send the outcome of a profile operation that failed
+static esp_err_t profile_error(httpd_req_t *req, esp_err_t err)
+{
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_404(req);
+    } else if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid profile");
+    } else if (err == ESP_ERR_NO_MEM) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many profiles");
+    } else if (err == ESP_ERR_TIMEOUT) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "No frame");
+        return ESP_OK;
+    } else {
+        httpd_resp_send_500(req);
+    }
+    return ESP_FAIL;
+}
+
+// Handler for POST /api/profile/<name>
+// Switches to the profile on the next frame; {"preload": true} only
+// compiles it into the standby state so that a later switch is instant.
+static esp_err_t profile_post_handler(httpd_req_t *req)
+{
+    char name[PROFILE_NAME_LEN];
+    if (!profile_name(req, name)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid profile name");
+        return ESP_FAIL;
+    }
+
+    bool preload = false;
+    char buf[64];
+    int remaining = req->content_len;
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+    if (remaining > 0) {
+        int ret = httpd_req_recv(req, buf, remaining);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+            }
+            return ESP_FAIL;
+        }
+        buf[ret] = '\0';
+
+        cJSON *root = cJSON_Parse(buf);
+        if (root == NULL) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+            return ESP_FAIL;
+        }
+        preload = cJSON_IsTrue(cJSON_GetObjectItem(root, "preload"));
+        cJSON_Delete(root);
+    }
+
+    if (preload) {
+        esp_err_t err = detect_profile_preload(name);
+        if (err != ESP_OK) {
+            return profile_error(req, err);
+        }
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+        return ESP_OK;
+    }
+
+    detect_profile_switch_t report;
+    esp_err_t err = detect_profile_switch(name, &report);
+    if (err != ESP_OK) {
+        return profile_error(req, err);
+    }
+
+    cJSON *root = switch_to_json(&report);
+    cJSON_AddStringToObject(root, "active", name);
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for PUT /api/profile/<name> (save the live configuration and
+// pattern under that name and make it the active profile)
+static esp_err_t profile_put_handler(httpd_req_t *req)
+{
+    char name[PROFILE_NAME_LEN];
+    if (!profile_name(req, name)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid profile name");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = detect_profile_save(name);
+    if (err != ESP_OK) {
+        return profile_error(req, err);
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+// Handler for DELETE /api/profile/<name>
+static esp_err_t profile_delete_handler(httpd_req_t *req)
+{
+    char name[PROFILE_NAME_LEN];
+    if (!profile_name(req, name)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid profile name");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = detect_profile_delete(name);
+    if (err != ESP_OK) {
+        return profile_error(req, err);
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+// Handler for GET /api/mqtt
+static esp_err_t mqtt_get_handler(httpd_req_t *req)
+{
+    mqtt_config_t config;
+    if (config_load_mqtt(&config) != ESP_OK) {
+        config_get_mqtt_defaults(&config);
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", config.enabled);
+    cJSON_AddStringToObject(root, "uri", config.uri);
+    cJSON_AddStringToObject(root, "topic", config.topic);
+    cJSON_AddNumberToObject(root, "summary_interval", config.summary_interval);
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for POST /api/mqtt (fields not present keep their stored value)
+static esp_err_t mqtt_post_handler(httpd_req_t *req)
+{
+    char buf[512];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    mqtt_config_t config;
+    if (config_load_mqtt(&config) != ESP_OK) {
+        config_get_mqtt_defaults(&config);
+    }
+
+    cJSON *item;
+    if ((item = cJSON_GetObjectItem(root, "enabled")) && cJSON_IsBool(item)) config.enabled = cJSON_IsTrue(item);
+    if ((item = cJSON_GetObjectItem(root, "uri")) && cJSON_IsString(item)) {
+        strlcpy(config.uri, item->valuestring, sizeof(config.uri));
+    }
+    if ((item = cJSON_GetObjectItem(root, "topic")) && cJSON_IsString(item)) {
+        strlcpy(config.topic, item->valuestring, sizeof(config.topic));
+    }
+    bool valid = true;
+    if ((item = cJSON_GetObjectItem(root, "summary_interval")) && cJSON_IsNumber(item)) {
+        if (item->valueint >= 0 && item->valueint <= UINT16_MAX) {
+            config.summary_interval = item->valueint;
+        } else {
+            valid = false;
+        }
+    }
+
+    cJSON_Delete(root);
+
+    if (!valid) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "summary_interval is 0-65535 s");
+        return ESP_FAIL;
+    }
+
+    if (config_save_mqtt(&config) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save config");
+        return ESP_FAIL;
+    }
+
+    if (mqtt_publisher_configure(&config) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start MQTT client");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+    return ESP_OK;
+}
+
+// Handler for GET /api/clips (configuration and frozen clips, newest first)
+static esp_err_t clips_get_handler(httpd_req_t *req)
+{
+    clip_config_t config;
+    if (config_load_clips(&config) != ESP_OK) {
+        config_get_clip_defaults(&config);
+    }
+
+    clip_info_t clips[CLIP_RECORDER_MAX_CLIPS];
+    size_t count = clip_recorder_list(clips, CLIP_RECORDER_MAX_CLIPS);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", config.enabled);
+    cJSON_AddNumberToObject(root, "pre_trigger_s", config.pre_trigger_s);
+    cJSON_AddNumberToObject(root, "post_trigger_s", config.post_trigger_s);
+    cJSON_AddBoolToObject(root, "flush", config.flush);
+
+    cJSON *list = cJSON_CreateArray();
+    for (size_t i = 0; i < count; i++) {
+        char url[48];
+        snprintf(url, sizeof(url), "/api/clips/%lu.mjpeg", (unsigned long)clips[i].id);
+
+        cJSON *c = cJSON_CreateObject();
+        cJSON_AddNumberToObject(c, "id", clips[i].id);
+        cJSON_AddNumberToObject(c, "trigger_ms", (double)(clips[i].trigger_us / 1000));
+        cJSON_AddNumberToObject(c, "frames", clips[i].frames);
+        cJSON_AddNumberToObject(c, "bytes", clips[i].bytes);
+        cJSON_AddNumberToObject(c, "duration_ms", clips[i].duration_ms);
+        cJSON_AddBoolToObject(c, "flushed", clips[i].flushed);
+        cJSON_AddStringToObject(c, "url", url);
+        cJSON_AddItemToArray(list, c);
+    }
+    cJSON_AddItemToObject(root, "clips", list);
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for POST /api/clips (fields not present keep their stored value)
+static esp_err_t clips_post_handler(httpd_req_t *req)
+{
+    char buf[256];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    clip_config_t config;
+    if (config_load_clips(&config) != ESP_OK) {
+        config_get_clip_defaults(&config);
+    }
+
+    // Ranges are checked before values are narrowed to their fields
+    bool valid = true;
+    cJSON *item;
+    if ((item = cJSON_GetObjectItem(root, "enabled")) && cJSON_IsBool(item)) config.enabled = cJSON_IsTrue(item);
+    if ((item = cJSON_GetObjectItem(root, "pre_trigger_s")) && cJSON_IsNumber(item)) {
+        if (item->valueint >= 0 && item->valueint <= CLIP_MAX_WINDOW_S) {
+            config.pre_trigger_s = item->valueint;
+        } else {
+            valid = false;
+        }
+    }
+    if ((item = cJSON_GetObjectItem(root, "post_trigger_s")) && cJSON_IsNumber(item)) {
+        if (item->valueint >= 0 && item->valueint <= CLIP_MAX_WINDOW_S) {
+            config.post_trigger_s = item->valueint;
+        } else {
+            valid = false;
+        }
+    }
+    if ((item = cJSON_GetObjectItem(root, "flush")) && cJSON_IsBool(item)) config.flush = cJSON_IsTrue(item);
+
+    cJSON_Delete(root);
+
+    if (!valid) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Trigger windows are 0-10 s");
+        return ESP_FAIL;
+    }
+
+    if (config_save_clips(&config) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save config");
+        return ESP_FAIL;
+    }
+
+    clip_recorder_configure(&config);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+    return ESP_OK;
+}
+
+#define CLIP_PART_BOUNDARY "123456789000000000000987654321"
+
+// Handler for GET /api/clips/<id>.mjpeg
+// Frames are sent as fast as the connection allows; each part carries its
+// capture time in X-Timestamp (ms) so players can restore the timing.
+static esp_err_t clip_stream_handler(httpd_req_t *req)
+{
+    const char *name = req->uri + strlen("/api/clips/");
+    char *end;
+    uint32_t id = strtoul(name, &end, 10);
+    if (end == name || strncmp(end, ".mjpeg", 6) != 0 || (end[6] && end[6] != '?')) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    uint8_t *jpeg;
+    size_t len;
+    int64_t timestamp_us;
+    esp_err_t ret = clip_recorder_read_frame(id, 0, &jpeg, &len, &timestamp_us);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "multipart/x-mixed-replace;boundary=" CLIP_PART_BOUNDARY);
+
+    for (uint32_t i = 1; ret == ESP_OK; i++) {
+        char part[128];
+        int part_len = snprintf(part, sizeof(part),
+                                "\r\n--" CLIP_PART_BOUNDARY "\r\nContent-Type: image/jpeg\r\n"
+                                "Content-Length: %u\r\nX-Timestamp: %lld\r\n\r\n",
+                                (unsigned)len, (long long)(timestamp_us / 1000));
+        ret = httpd_resp_send_chunk(req, part, part_len);
+        if (ret == ESP_OK) {
+            ret = httpd_resp_send_chunk(req, (const char *)jpeg, len);
+        }
+        free(jpeg);
+        if (ret != ESP_OK) {
+            return ESP_FAIL;
+        }
+        ret = clip_recorder_read_frame(id, i, &jpeg, &len, &timestamp_us);
+    }
+
+    // ESP_ERR_NOT_FOUND past the last frame; anything else cut the clip short
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static const char *source_names[] = { "sensor", "replay", "synthetic" };
+static const char *timestamp_names[] = { "capture", "fixed", "recorded" };
+
+static int name_index(const char *name, const char **names, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Handler for GET /api/source (frame source selection and replay recording)
+static esp_err_t source_get_handler(httpd_req_t *req)
+{
+    frame_source_config_t config;
+    frame_source_get_config(&config);
+
+    frame_source_stats_t stats;
+    frame_source_get_stats(&stats);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "type", source_names[config.type]);
+    cJSON_AddNumberToObject(root, "fps", config.fps);
+    cJSON_AddStringToObject(root, "timestamps", timestamp_names[config.timestamps]);
+    cJSON_AddBoolToObject(root, "loop", config.loop);
+    cJSON_AddNumberToObject(root, "width", config.width);
+    cJSON_AddNumberToObject(root, "height", config.height);
+
+    cJSON_AddNumberToObject(root, "frames", stats.frames);
+    cJSON_AddNumberToObject(root, "copies", stats.copies);
+    cJSON_AddBoolToObject(root, "sensor", stats.sensor);
+
+    if (stats.replay) {
+        cJSON *replay = cJSON_CreateObject();
+        cJSON_AddStringToObject(replay, "format", stats.replay_format == PIXFORMAT_JPEG ? "jpeg" :
+                                stats.replay_format == PIXFORMAT_YUV422 ? "yuv422" : "rgb565");
+        cJSON_AddNumberToObject(replay, "width", stats.replay_width);
+        cJSON_AddNumberToObject(replay, "height", stats.replay_height);
+        cJSON_AddNumberToObject(replay, "frames", stats.replay_frames);
+        cJSON_AddNumberToObject(replay, "position", stats.replay_position);
+        cJSON_AddBoolToObject(replay, "labels", stats.replay_labels);
+        cJSON_AddItemToObject(root, "replay", replay);
+    }
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for POST /api/source (fields not present keep their current value;
+// not persisted, the sensor is selected again at boot)
+static esp_err_t source_post_handler(httpd_req_t *req)
+{
+    char buf[256];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    frame_source_config_t config;
+    frame_source_get_config(&config);
+
+    bool valid = true;
+    cJSON *item;
+    if ((item = cJSON_GetObjectItem(root, "type")) && cJSON_IsString(item)) {
+        int type = name_index(item->valuestring, source_names, 3);
+        valid &= type >= 0;
+        config.type = type;
+    }
+    if ((item = cJSON_GetObjectItem(root, "timestamps")) && cJSON_IsString(item)) {
+        int mode = name_index(item->valuestring, timestamp_names, 3);
+        valid &= mode >= 0;
+        config.timestamps = mode;
+    }
+    if ((item = cJSON_GetObjectItem(root, "fps")) && cJSON_IsNumber(item)) config.fps = item->valueint;
+    if ((item = cJSON_GetObjectItem(root, "loop")) && cJSON_IsBool(item)) config.loop = cJSON_IsTrue(item);
+    if ((item = cJSON_GetObjectItem(root, "width")) && cJSON_IsNumber(item)) config.width = item->valueint;
+    if ((item = cJSON_GetObjectItem(root, "height")) && cJSON_IsNumber(item)) config.height = item->valueint;
+
+    cJSON_Delete(root);
+
+    esp_err_t err = valid ? frame_source_configure(&config) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No camera sensor");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No replay recording");
+        return ESP_FAIL;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid source");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+    return ESP_OK;
+}
+
+// Longest wait of /capture for a frame without the bounding box
+#define CAPTURE_TIMEOUT_MS  3000
+
+// Handler for GET /capture: one JPEG captured after the request, without the
+// bounding box overlay. The frame is scanned whatever the decimation and its
+// detection result is sent in X-Detection ("x,y,w,h,confidence" or "none")
+// as a labelling proposal.
+static esp_err_t capture_handler(httpd_req_t *req)
+{
+    frame_pipeline_add_consumer(PIPELINE_VIEW_COLOR);
+    frame_pipeline_request_clean(true);
+
+    // Skip the frame already published, it may predate the request
+    uint32_t seq = 0;
+    pipeline_frame_t *frame = frame_pipeline_acquire(PIPELINE_VIEW_COLOR, &seq);
+    if (frame) {
+        frame_pipeline_release(frame);
+        frame = NULL;
+    }
+
+    for (int waited = 0; waited < CAPTURE_TIMEOUT_MS; waited += 10) {
+        frame = frame_pipeline_acquire(PIPELINE_VIEW_COLOR, &seq);
+        if (frame && frame->clean) {
+            break;
+        }
+        if (frame) {
+            frame_pipeline_release(frame);
+            frame = NULL;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    frame_pipeline_request_clean(false);
+    frame_pipeline_remove_consumer(PIPELINE_VIEW_COLOR);
+
+    if (!frame) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "No frame");
+        return ESP_OK;
+    }
+
+    char timestamp[24], detection[48];
+    snprintf(timestamp, sizeof(timestamp), "%lld", (long long)(frame->timestamp_us / 1000));
+    if (frame->detection.rgb_detected) {
+        snprintf(detection, sizeof(detection), "%u,%u,%u,%u,%u",
+                 frame->detection.bbox_x, frame->detection.bbox_y,
+                 frame->detection.bbox_w, frame->detection.bbox_h,
+                 frame->detection.confidence);
+    } else {
+        strcpy(detection, "none");
+    }
+
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "X-Timestamp", timestamp);
+    httpd_resp_set_hdr(req, "X-Detection", detection);
+    esp_err_t ret = httpd_resp_send(req, (const char *)frame->jpeg, frame->jpeg_len);
+
+    frame_pipeline_release(frame);
+    return ret;
+}
+
+static const char *bench_state_names[] = { "idle", "running", "done", "failed" };
+
+// Share of pixels cut from each end of each channel by threshold proposals
+#define HISTOGRAM_DEFAULT_PERCENTILE    2
+// Hue bins of the H x S histogram in the response
+#define HISTOGRAM_JSON_H_BINS           32
+
+static cJSON *counts_to_json(const uint32_t *counts, int n)
+{
+    cJSON *array = cJSON_CreateArray();
+    for (int i = 0; i < n; i++) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(counts[i]));
+    }
+    return array;
+}
+
+static cJSON *thresholds_to_json(const hsv_threshold_t *t)
+{
+    cJSON *obj = cJSON_CreateObject();
+    cJSON_AddNumberToObject(obj, "h_min", t->h_min);
+    cJSON_AddNumberToObject(obj, "h_max", t->h_max);
+    cJSON_AddNumberToObject(obj, "s_min", t->s_min);
+    cJSON_AddNumberToObject(obj, "s_max", t->s_max);
+    cJSON_AddNumberToObject(obj, "v_min", t->v_min);
+    cJSON_AddNumberToObject(obj, "v_max", t->v_max);
+    return obj;
+}
+
+// Handler for GET /api/histogram?x=&y=&w=&h=&class=<name>&percentile=<p>
+// H, S and V histograms and an H x S histogram (hue in 32 bins of 8, then
+// saturation in 32 bins of 8) of a region of the next captured frame, with
+// thresholds proposed for its dominant color. The region defaults to the
+// whole frame; class adds that pattern class's current thresholds.
+static esp_err_t histogram_handler(httpd_req_t *req)
+{
+    char query[128], value[PATTERN_NAME_LEN];
+    char class_name[PATTERN_NAME_LEN] = "";
+    uint32_t region[4] = { 0, 0, UINT16_MAX, UINT16_MAX };
+    static const char *const region_keys[4] = { "x", "y", "w", "h" };
+    uint32_t percentile = HISTOGRAM_DEFAULT_PERCENTILE;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        for (int i = 0; i < 4; i++) {
+            if (httpd_query_key_value(query, region_keys[i], value, sizeof(value)) == ESP_OK) {
+                region[i] = MIN(strtoul(value, NULL, 10), UINT16_MAX);
+            }
+        }
+        if (httpd_query_key_value(query, "percentile", value, sizeof(value)) == ESP_OK) {
+            percentile = strtoul(value, NULL, 10);
+        }
+        httpd_query_key_value(query, "class", class_name, sizeof(class_name));
+    }
+
+    pattern_config_t pattern;
+    int class_index = -1;
+    if (class_name[0]) {
+        color_detect_get_pattern(&pattern);
+        class_index = color_pattern_find_class(&pattern, class_name);
+        if (class_index < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown class");
+            return ESP_FAIL;
+        }
+    }
+
+    color_histogram_t *hist = malloc(sizeof(color_histogram_t));
+    if (!hist) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    camera_fb_t fb;
+    esp_err_t err = frame_pipeline_snapshot(&fb, true, CAPTURE_TIMEOUT_MS);
+    if (err != ESP_OK) {
+        free(hist);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, err == ESP_ERR_NOT_SUPPORTED ? "Frames are not RGB565" : "No frame");
+        return ESP_OK;
+    }
+
+    int64_t start = esp_timer_get_time();
+    hsv_threshold_t suggestion;
+    uint32_t matched = 0;
+    err = color_histogram_compute(&fb, region[0], region[1], region[2], region[3], hist);
+    esp_err_t suggested = ESP_FAIL;
+    if (err == ESP_OK) {
+        suggested = color_histogram_suggest(&fb, hist, percentile, &suggestion, &matched);
+    }
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    frame_pipeline_snapshot_release();
+
+    if (err != ESP_OK || suggested == ESP_ERR_INVALID_ARG) {
+        free(hist);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, err != ESP_OK ? "Invalid region" : "Invalid percentile");
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *r = cJSON_CreateArray();
+    cJSON_AddItemToArray(r, cJSON_CreateNumber(hist->x));
+    cJSON_AddItemToArray(r, cJSON_CreateNumber(hist->y));
+    cJSON_AddItemToArray(r, cJSON_CreateNumber(hist->w));
+    cJSON_AddItemToArray(r, cJSON_CreateNumber(hist->h));
+    cJSON_AddItemToObject(root, "region", r);
+    cJSON_AddNumberToObject(root, "frame_width", fb.width);
+    cJSON_AddNumberToObject(root, "frame_height", fb.height);
+    cJSON_AddNumberToObject(root, "pixels", hist->pixels);
+    cJSON_AddNumberToObject(root, "compute_us", elapsed);
+    cJSON_AddItemToObject(root, "h", counts_to_json(hist->hue, 256));
+    cJSON_AddItemToObject(root, "s", counts_to_json(hist->sat, 256));
+    cJSON_AddItemToObject(root, "v", counts_to_json(hist->val, 256));
+
+    // Hue merged into wider bins to keep the response small
+    const int merge = 256 / HISTOGRAM_JSON_H_BINS;
+    cJSON *hs = cJSON_CreateArray();
+    for (int hb = 0; hb < HISTOGRAM_JSON_H_BINS; hb++) {
+        uint32_t row[HISTOGRAM_S_BINS] = { 0 };
+        for (int h = hb * merge; h < (hb + 1) * merge; h++) {
+            for (int sb = 0; sb < HISTOGRAM_S_BINS; sb++) {
+                row[sb] += hist->hs[h][sb];
+            }
+        }
+        cJSON_AddItemToArray(hs, counts_to_json(row, HISTOGRAM_S_BINS));
+    }
+    cJSON_AddItemToObject(root, "hs", hs);
+    free(hist);
+
+    if (suggested == ESP_OK) {
+        cJSON *s = thresholds_to_json(&suggestion);
+        cJSON_AddNumberToObject(s, "percentile", percentile);
+        cJSON_AddNumberToObject(s, "pixels", matched);
+        cJSON_AddItemToObject(root, "suggestion", s);
+    }
+    if (class_index >= 0) {
+        cJSON_AddStringToObject(root, "class", class_name);
+        cJSON_AddItemToObject(root, "current", thresholds_to_json(&pattern.classes[class_index].thresh));
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+static cJSON *bbox_to_json(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    cJSON *bbox = cJSON_CreateArray();
+    cJSON_AddItemToArray(bbox, cJSON_CreateNumber(x));
+    cJSON_AddItemToArray(bbox, cJSON_CreateNumber(y));
+    cJSON_AddItemToArray(bbox, cJSON_CreateNumber(w));
+    cJSON_AddItemToArray(bbox, cJSON_CreateNumber(h));
+    return bbox;
+}
+
+// Handler for POST /api/config/preview
+// Takes a /api/config body, optionally with "pattern" (a /api/pattern body)
+// and "refresh": true for a new frame, and runs detection with it on the
+// held pipeline snapshot. Fields not given keep their live value; without a
+// pattern the live one is used with the candidate's red/green/blue
+// thresholds. Nothing is applied or saved.
+static esp_err_t config_preview_handler(httpd_req_t *req)
+{
+    char buf[2048];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    color_config_t config;
+    if (config_load(&config) != ESP_OK) {
+        config_get_defaults(&config);
+    }
+    pattern_config_t pattern;
+    const char *error = parse_config(root, &config);
+    cJSON *pattern_json = cJSON_GetObjectItem(root, "pattern");
+    if (!error && pattern_json) {
+        error = cJSON_IsObject(pattern_json) ? parse_pattern(pattern_json, &pattern) : "Invalid pattern";
+    } else if (!error) {
+        color_detect_get_pattern(&pattern);
+        apply_legacy_thresholds(&config, &pattern);
+    }
+    bool refresh = cJSON_IsTrue(cJSON_GetObjectItem(root, "refresh"));
+    cJSON_Delete(root);
+    if (error) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        return ESP_FAIL;
+    }
+
+    config_preview_report_t *report = malloc(sizeof(config_preview_report_t));
+    if (!report) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = config_preview_run(&config, &pattern, refresh, report);
+    if (err != ESP_OK) {
+        free(report);
+        if (err == ESP_ERR_INVALID_STATE) {
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "Preview running");
+            return ESP_OK;
+        } else if (err == ESP_ERR_TIMEOUT || err == ESP_ERR_NOT_SUPPORTED) {
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            httpd_resp_sendstr(req, err == ESP_ERR_NOT_SUPPORTED ? "Frames are not RGB565" : "Timed out");
+            return ESP_OK;
+        } else if (err == ESP_ERR_INVALID_ARG) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid pattern or masks");
+        } else {
+            httpd_resp_send_500(req);
+        }
+        return ESP_FAIL;
+    }
+
+    const color_detect_preview_t *p = &report->detect;
+    cJSON *json = cJSON_CreateObject();
+
+    cJSON *frame = cJSON_CreateObject();
+    cJSON_AddNumberToObject(frame, "width", report->width);
+    cJSON_AddNumberToObject(frame, "height", report->height);
+    cJSON_AddNumberToObject(frame, "timestamp_us", (double)report->timestamp_us);
+    cJSON_AddItemToObject(json, "frame", frame);
+
+    cJSON *detection = cJSON_CreateObject();
+    cJSON_AddBoolToObject(detection, "detected", p->result.rgb_detected);
+    cJSON_AddNumberToObject(detection, "confidence", p->result.confidence);
+    if (p->result.rgb_detected) {
+        cJSON_AddItemToObject(detection, "bbox", bbox_to_json(p->result.bbox_x, p->result.bbox_y,
+                                                              p->result.bbox_w, p->result.bbox_h));
+        cJSON_AddNumberToObject(detection, "sequence", p->result.sequence);
+        cJSON_AddNumberToObject(detection, "angle", p->result.angle);
+    }
+    cJSON_AddItemToObject(json, "detection", detection);
+
+    // Pixel count of every class, and the blob of each class that has pixels
+    cJSON *classes = cJSON_CreateArray();
+    cJSON *blobs = cJSON_CreateArray();
+    for (int c = 0; c < p->class_count; c++) {
+        const color_stats_t *cs = &p->stats.color[c];
+        cJSON *cls = cJSON_CreateObject();
+        cJSON_AddStringToObject(cls, "name", pattern.classes[c].name);
+        cJSON_AddNumberToObject(cls, "pixels", cs->pixels);
+        cJSON_AddItemToArray(classes, cls);
+
+        blob_geometry_t g;
+        if (!color_stats_geometry(cs, &g)) {
+            continue;
+        }
+        cJSON *blob = cJSON_CreateObject();
+        cJSON_AddStringToObject(blob, "class", pattern.classes[c].name);
+        cJSON_AddNumberToObject(blob, "pixels", cs->pixels);
+        cJSON_AddBoolToObject(blob, "min_area", cs->pixels >= config.min_area);
+        cJSON_AddItemToObject(blob, "bbox", bbox_to_json(cs->x_min, cs->y_min, cs->x_max - cs->x_min + 1,
+                                                         cs->y_max - cs->y_min + 1));
+        cJSON_AddNumberToObject(blob, "cx", g.cx);
+        cJSON_AddNumberToObject(blob, "cy", g.cy);
+        cJSON_AddNumberToObject(blob, "angle", g.angle);
+        cJSON_AddNumberToObject(blob, "elongation", g.elongation);
+        cJSON_AddItemToArray(blobs, blob);
+    }
+    cJSON_AddItemToObject(json, "classes", classes);
+    cJSON_AddItemToObject(json, "blobs", blobs);
+    cJSON_AddNumberToObject(json, "mask_skip", p->mask_skip);
+
+    cJSON *timing = cJSON_CreateObject();
+    cJSON_AddNumberToObject(timing, "wait_us", report->wait_us);
+    cJSON_AddNumberToObject(timing, "compile_us", p->compile_us);
+    cJSON_AddNumberToObject(timing, "scan_us", p->scan_us);
+    cJSON_AddNumberToObject(timing, "window_us", p->window_us);
+    cJSON_AddNumberToObject(timing, "windows", p->windows);
+    cJSON_AddNumberToObject(timing, "total_us", report->total_us);
+    cJSON_AddItemToObject(json, "timing", timing);
+    free(report);
+
+    char *json_str = cJSON_Print(json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(json);
+
+    return ESP_OK;
+}
+
+// Handler for GET /api/benchmark (state or results of the last run)
+static esp_err_t benchmark_get_handler(httpd_req_t *req)
+{
+    detect_bench_report_t report;
+    detect_bench_get_report(&report);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "state", bench_state_names[report.state]);
+    cJSON_AddNumberToObject(root, "frames", report.frames);
+    cJSON_AddNumberToObject(root, "labelled", report.labelled);
+    cJSON_AddNumberToObject(root, "progress", report.progress);
+
+    if (report.state == DETECT_BENCH_DONE) {
+        cJSON_AddNumberToObject(root, "config_version", report.config_version);
+        cJSON_AddNumberToObject(root, "decode_us", report.decode_us);
+        cJSON_AddNumberToObject(root, "iou_match", DETECT_BENCH_IOU_MATCH / 100.0);
+
+        cJSON *engines = cJSON_CreateArray();
+        for (int i = 0; i < report.engines; i++) {
+            const detect_bench_engine_t *e = &report.engine[i];
+            if (!e->run) {
+                continue;
+            }
+            uint32_t detected = e->true_pos + e->false_pos;
+            uint32_t present = e->true_pos + e->false_neg;
+
+            cJSON *engine = cJSON_CreateObject();
+            cJSON_AddStringToObject(engine, "name", e->name);
+            cJSON_AddNumberToObject(engine, "true_pos", e->true_pos);
+            cJSON_AddNumberToObject(engine, "false_pos", e->false_pos);
+            cJSON_AddNumberToObject(engine, "false_neg", e->false_neg);
+            cJSON_AddNumberToObject(engine, "true_neg", e->true_neg);
+            cJSON_AddNumberToObject(engine, "precision", detected ? (double)e->true_pos / detected : 1.0);
+            cJSON_AddNumberToObject(engine, "recall", present ? (double)e->true_pos / present : 1.0);
+            cJSON_AddNumberToObject(engine, "mean_iou", e->mean_iou);
+
+            cJSON *latency = cJSON_CreateObject();
+            cJSON_AddNumberToObject(latency, "p50", e->p50_us);
+            cJSON_AddNumberToObject(latency, "p90", e->p90_us);
+            cJSON_AddNumberToObject(latency, "p99", e->p99_us);
+            cJSON_AddNumberToObject(latency, "max", e->max_us);
+            cJSON_AddNumberToObject(latency, "mean", e->mean_us);
+            cJSON_AddItemToObject(engine, "latency_us", latency);
+
+            cJSON_AddItemToArray(engines, engine);
+        }
+        cJSON_AddItemToObject(root, "engines", engines);
+    }
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for POST /api/benchmark ({"engines":[names]}, empty body for all)
+static esp_err_t benchmark_post_handler(httpd_req_t *req)
+{
+    char buf[256];
+    int ret, remaining = req->content_len;
+    uint32_t mask = 0;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    if (remaining > 0) {
+        ret = httpd_req_recv(req, buf, remaining);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+            }
+            return ESP_FAIL;
+        }
+        buf[ret] = '\0';
+
+        cJSON *root = cJSON_Parse(buf);
+        if (root == NULL) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+            return ESP_FAIL;
+        }
+
+        bool valid = true;
+        cJSON *item, *name;
+        if ((item = cJSON_GetObjectItem(root, "engines")) && cJSON_IsArray(item)) {
+            cJSON_ArrayForEach(name, item) {
+                int index = -1;
+                for (int i = 0; cJSON_IsString(name) && detect_bench_engine_name(i); i++) {
+                    if (strcmp(name->valuestring, detect_bench_engine_name(i)) == 0) {
+                        index = i;
+                    }
+                }
+                valid &= index >= 0;
+                if (index >= 0) {
+                    mask |= 1 << index;
+                }
+            }
+        }
+
+        cJSON_Delete(root);
+
+        if (!valid) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown engine");
+            return ESP_FAIL;
+        }
+    }
+
+    esp_err_t err = detect_bench_start(mask);
+    if (err == ESP_ERR_NOT_FOUND) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No labelled replay recording");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_INVALID_STATE) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "Benchmark running");
+        return ESP_OK;
+    } else if (err != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"started\"}");
+
+    return ESP_OK;
+}
+
+#define KERNEL_BENCH_DEFAULT_ITERATIONS 5
+
+// Handler for GET /api/bench?iterations=<n>: times the pixel kernels at
+// QVGA/VGA/SVGA; blocks for a few seconds, detection stalls meanwhile
+static esp_err_t kernel_bench_handler(httpd_req_t *req)
+{
+    uint32_t iterations = KERNEL_BENCH_DEFAULT_ITERATIONS;
+    char query[32], value[8];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "iterations", value, sizeof(value)) == ESP_OK) {
+        iterations = strtoul(value, NULL, 10);
+    }
+
+    kernel_bench_report_t *report = malloc(sizeof(kernel_bench_report_t));
+    if (!report) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = kernel_bench_run(iterations, report);
+    if (err != ESP_OK) {
+        free(report);
+        if (err == ESP_ERR_INVALID_STATE) {
+            httpd_resp_set_status(req, "409 Conflict");
+            httpd_resp_sendstr(req, "Benchmark running");
+            return ESP_OK;
+        } else if (err == ESP_ERR_INVALID_ARG) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid iterations");
+        } else {
+            httpd_resp_send_500(req);
+        }
+        return ESP_FAIL;
+    }
+
+    char *json_str = kernel_bench_to_json(report);
+    free(report);
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+    free(json_str);
+
+    return ESP_OK;
+}
+
+// Records per /api/detections page
+#define DETECTIONS_DEFAULT_LIMIT    50
+#define DETECTIONS_MAX_LIMIT        200
+
+// Handler for GET /api/detections?since=<seq>&limit=<n>
+// Records are sent as compact arrays in the order given by "fields"; pass
+// "next" as since to fetch the following page.
+static esp_err_t detections_handler(httpd_req_t *req)
+{
+    uint32_t since = 0;
+    int limit = DETECTIONS_DEFAULT_LIMIT;
+    char query[64], value[16];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            since = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+            limit = atoi(value);
+        }
+    }
+    if (limit < 1 || limit > DETECTIONS_MAX_LIMIT) {
+        limit = DETECTIONS_MAX_LIMIT;
+    }
+
+    detection_record_t *records = malloc(limit * sizeof(detection_record_t));
+    if (!records) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    uint32_t last_seq;
+    size_t count = detection_log_read(since, records, limit, &last_seq);
+    uint32_t next = count ? records[count - 1].seq : (since < last_seq ? since : last_seq);
+
+    httpd_resp_set_type(req, "application/json");
+
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"last\":%lu,\"next\":%lu,\"more\":%s,"
+                       "\"fields\":[\"seq\",\"ts_ms\",\"flags\",\"confidence\",\"x\",\"y\",\"w\",\"h\",\"config\"],"
+                       "\"records\":[",
+                       (unsigned long)last_seq, (unsigned long)next, next < last_seq ? "true" : "false");
+
+    for (size_t i = 0; i < count; i++) {
+        const detection_record_t *r = &records[i];
+        if (len > sizeof(buf) - 96) {
+            httpd_resp_send_chunk(req, buf, len);
+            len = 0;
+        }
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%lu,%lld,%u,%u,%u,%u,%u,%u,%u]",
+                        i ? "," : "", (unsigned long)r->seq, (long long)(r->timestamp_us / 1000),
+                        r->flags, r->confidence, r->bbox_x, r->bbox_y, r->bbox_w, r->bbox_h,
+                        r->config_version);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    httpd_resp_send_chunk(req, buf, len);
+    httpd_resp_send_chunk(req, NULL, 0);
+
+    free(records);
+    return ESP_OK;
+}
+
+// Lines per /api/logs page
+#define LOGS_DEFAULT_LIMIT  100
+
+// Handler for GET /api/logs?since=<seq>&limit=<n>
+// Records are [seq, level, text, more]; more is true when a long line
+// continues in the next record. Pass "next" as since to fetch the following
+// page. Color escapes are removed from the text.
+static esp_err_t logs_handler(httpd_req_t *req)
+{
+    uint32_t since = 0;
+    int limit = LOGS_DEFAULT_LIMIT;
+    char query[64], value[16];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+            since = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "limit", value, sizeof(value)) == ESP_OK) {
+            limit = atoi(value);
+        }
+    }
+    if (limit < 1 || limit > LOG_SINK_SIZE) {
+        limit = LOG_SINK_SIZE;
+    }
+
+    log_record_t *records = malloc(limit * sizeof(log_record_t));
+    if (!records) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    uint32_t last_seq;
+    size_t count = log_sink_read(since, records, limit, &last_seq);
+    uint32_t next = count ? records[count - 1].seq : (since < last_seq ? since : last_seq);
+
+    log_sink_stats_t log_stats;
+    log_sink_get_stats(&log_stats);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "last", last_seq);
+    cJSON_AddNumberToObject(root, "next", next);
+    cJSON_AddBoolToObject(root, "more", next < last_seq);
+    cJSON_AddNumberToObject(root, "dropped", log_stats.dropped);
+    cJSON_AddNumberToObject(root, "limited", log_stats.limited);
+
+    cJSON *lines = cJSON_CreateArray();
+    for (size_t i = 0; i < count; i++) {
+        const log_record_t *r = &records[i];
+        char text[LOG_SINK_LINE + 1];
+        size_t len = 0;
+        for (size_t j = 0; j < r->len; j++) {
+            if (r->text[j] == '\033') {
+                // Skip "\033[0;32m"-style color codes
+                while (j < r->len && r->text[j] != 'm') {
+                    j++;
+                }
+                continue;
+            }
+            text[len++] = r->text[j];
+        }
+        text[len] = '\0';
+
+        char level[2] = { r->level, '\0' };
+        cJSON *line = cJSON_CreateArray();
+        cJSON_AddItemToArray(line, cJSON_CreateNumber(r->seq));
+        cJSON_AddItemToArray(line, cJSON_CreateString(level));
+        cJSON_AddItemToArray(line, cJSON_CreateString(text));
+        cJSON_AddItemToArray(line, cJSON_CreateBool(r->flags & LOG_SINK_MORE));
+        cJSON_AddItemToArray(lines, line);
+    }
+    cJSON_AddItemToObject(root, "records", lines);
+    free(records);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+    free(json_str);
+
+    return ESP_OK;
+}
+
+// Handler for GET /api/stats
+static esp_err_t stats_handler(httpd_req_t *req)
+{
+    jpeg_encoder_stats_t jpeg_stats;
+    jpeg_encoder_get_stats(&jpeg_stats);
+
+    color_detect_stats_t detect_stats;
+    color_detect_get_stats(&detect_stats);
+
+    motion_gate_stats_t motion_stats;
+    motion_gate_get_stats(&motion_stats);
+
+    frame_pipeline_stats_t pipeline_stats;
+    frame_pipeline_get_stats(&pipeline_stats);
+
+    stream_sender_stats_t stream_stats;
+    stream_sender_get_stats(&stream_stats);
+
+    rtsp_server_stats_t rtsp_stats;
+    rtsp_server_get_stats(&rtsp_stats);
+
+    mqtt_publisher_stats_t mqtt_stats;
+    mqtt_publisher_get_stats(&mqtt_stats);
+
+    clip_recorder_stats_t clip_stats;
+    clip_recorder_get_stats(&clip_stats);
+
+    cpu_load_stats_t cpu_stats;
+    cpu_load_get_stats(&cpu_stats);
+
+    log_sink_stats_t log_stats;
+    log_sink_get_stats(&log_stats);
+
+    ws2812_stats_t led_stats;
+    ws2812_get_stats(&led_stats);
+
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON *detect = cJSON_CreateObject();
+    cJSON_AddNumberToObject(detect, "frames", detect_stats.frames);
+    cJSON_AddNumberToObject(detect, "last_us", detect_stats.last_us);
+    cJSON_AddNumberToObject(detect, "avg_us", detect_stats.avg_us);
+    cJSON_AddBoolToObject(detect, "parallel", detect_stats.parallel);
+    cJSON_AddBoolToObject(detect, "strips", detect_stats.strips);
+    cJSON_AddNumberToObject(detect, "cycles_per_pixel", detect_stats.cycles_per_pixel);
+    cJSON_AddNumberToObject(detect, "windows", detect_stats.windows);
+    cJSON_AddNumberToObject(detect, "window_us", detect_stats.window_us);
+    cJSON_AddNumberToObject(detect, "mask_skip", detect_stats.mask_skip);
+    cJSON_AddItemToObject(root, "detect", detect);
+
+    cJSON *motion = cJSON_CreateObject();
+    cJSON_AddNumberToObject(motion, "frames", motion_stats.frames);
+    cJSON_AddNumberToObject(motion, "skipped", motion_stats.skipped);
+    cJSON_AddNumberToObject(motion, "skip_ratio",
+                            motion_stats.frames ? (double)motion_stats.skipped / motion_stats.frames : 0.0);
+    cJSON_AddNumberToObject(motion, "last_diff", motion_stats.last_diff);
+    cJSON_AddItemToObject(root, "motion", motion);
+
+    cJSON *pipeline = cJSON_CreateObject();
+    cJSON_AddNumberToObject(pipeline, "captured", pipeline_stats.captured);
+    cJSON_AddNumberToObject(pipeline, "encoded", pipeline_stats.encoded);
+    cJSON_AddNumberToObject(pipeline, "published", pipeline_stats.published);
+    cJSON_AddNumberToObject(pipeline, "consumers", pipeline_stats.consumers);
+    cJSON_AddNumberToObject(pipeline, "mask_encoded", pipeline_stats.mask_encoded);
+    cJSON_AddNumberToObject(pipeline, "mask_consumers", pipeline_stats.mask_consumers);
+    cJSON_AddNumberToObject(pipeline, "mask_us", pipeline_stats.mask_us);
+    cJSON_AddItemToObject(root, "pipeline", pipeline);
+
+    cJSON *stream = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stream, "clients", stream_stats.clients);
+    cJSON_AddNumberToObject(stream, "frames_sent", stream_stats.frames_sent);
+    cJSON_AddNumberToObject(stream, "frames_dropped", stream_stats.frames_dropped);
+    cJSON_AddNumberToObject(stream, "latency_us", stream_stats.latency_us);
+    cJSON *stream_clients = cJSON_CreateArray();
+    for (int i = 0; i < stream_stats.clients; i++) {
+        cJSON *c = cJSON_CreateObject();
+        cJSON_AddNumberToObject(c, "fd", stream_stats.client[i].fd);
+        cJSON_AddBoolToObject(c, "websocket", stream_stats.client[i].websocket);
+        cJSON_AddStringToObject(c, "view", stream_stats.client[i].view == PIPELINE_VIEW_MASK ? "mask" : "color");
+        cJSON_AddNumberToObject(c, "credits", stream_stats.client[i].credits);
+        cJSON_AddNumberToObject(c, "frames_sent", stream_stats.client[i].frames_sent);
+        cJSON_AddNumberToObject(c, "frames_dropped", stream_stats.client[i].frames_dropped);
+        cJSON_AddNumberToObject(c, "backlog", stream_stats.client[i].backlog);
+        cJSON_AddItemToArray(stream_clients, c);
+    }
+    cJSON_AddItemToObject(stream, "client", stream_clients);
+    cJSON_AddItemToObject(root, "stream", stream);
+
+    cJSON *rtsp = cJSON_CreateObject();
+    cJSON_AddNumberToObject(rtsp, "sessions", rtsp_stats.sessions);
+    cJSON_AddNumberToObject(rtsp, "frames_sent", rtsp_stats.frames_sent);
+    cJSON_AddNumberToObject(rtsp, "frames_dropped", rtsp_stats.frames_dropped);
+    cJSON_AddNumberToObject(rtsp, "frames_unsupported", rtsp_stats.frames_unsupported);
+    cJSON_AddNumberToObject(rtsp, "packets_sent", rtsp_stats.packets_sent);
+    cJSON_AddNumberToObject(rtsp, "bytes_sent", rtsp_stats.bytes_sent);
+    cJSON_AddNumberToObject(rtsp, "latency_us", rtsp_stats.latency_us);
+    cJSON_AddItemToObject(root, "rtsp", rtsp);
+
+    cJSON *mqtt = cJSON_CreateObject();
+    cJSON_AddBoolToObject(mqtt, "connected", mqtt_stats.connected);
+    cJSON_AddNumberToObject(mqtt, "queued", mqtt_stats.queued);
+    cJSON_AddNumberToObject(mqtt, "published", mqtt_stats.published);
+    cJSON_AddNumberToObject(mqtt, "batches", mqtt_stats.batches);
+    cJSON_AddNumberToObject(mqtt, "dropped", mqtt_stats.dropped);
+    cJSON_AddNumberToObject(mqtt, "latency_us", mqtt_stats.latency_us);
+    cJSON_AddNumberToObject(mqtt, "max_latency_us", mqtt_stats.max_latency_us);
+    cJSON_AddItemToObject(root, "mqtt", mqtt);
+
+    cJSON *clips = cJSON_CreateObject();
+    cJSON_AddBoolToObject(clips, "enabled", clip_stats.enabled);
+    cJSON_AddNumberToObject(clips, "rolling_bytes", clip_stats.rolling_bytes);
+    cJSON_AddNumberToObject(clips, "rolling_used", clip_stats.rolling_used);
+    cJSON_AddNumberToObject(clips, "rolling_frames", clip_stats.rolling_frames);
+    cJSON_AddNumberToObject(clips, "rolling_ms", clip_stats.rolling_ms);
+    cJSON_AddNumberToObject(clips, "store_bytes", clip_stats.store_bytes);
+    cJSON_AddNumberToObject(clips, "store_used", clip_stats.store_used);
+    cJSON_AddNumberToObject(clips, "frames_recorded", clip_stats.frames_recorded);
+    cJSON_AddNumberToObject(clips, "frames_skipped", clip_stats.frames_skipped);
+    cJSON_AddNumberToObject(clips, "clips_recorded", clip_stats.clips_recorded);
+    cJSON_AddNumberToObject(clips, "clips_flushed", clip_stats.clips_flushed);
+    cJSON_AddNumberToObject(clips, "flush_failed", clip_stats.flush_failed);
+    cJSON_AddNumberToObject(clips, "flush_bytes", clip_stats.flush_bytes);
+    cJSON_AddNumberToObject(clips, "flush_kbps", clip_stats.flush_kbps);
+    cJSON_AddItemToObject(root, "clips", clips);
+
+    static const char *const led_states[] = { "idle", "tracking", "lost" };
+    cJSON *led = cJSON_CreateObject();
+    cJSON_AddStringToObject(led, "state", led_states[led_stats.state]);
+    cJSON_AddNumberToObject(led, "updates", led_stats.updates);
+    cJSON_AddNumberToObject(led, "refreshes", led_stats.refreshes);
+    cJSON_AddBoolToObject(led, "dma", led_stats.dma);
+    cJSON_AddItemToObject(root, "led", led);
+
+    cJSON *jpeg = cJSON_CreateObject();
+    cJSON_AddNumberToObject(jpeg, "frames", jpeg_stats.frames);
+    cJSON_AddNumberToObject(jpeg, "last_us", jpeg_stats.last_us);
+    cJSON_AddNumberToObject(jpeg, "avg_us", jpeg_stats.avg_us);
+    cJSON_AddNumberToObject(jpeg, "last_bytes", jpeg_stats.last_bytes);
+    cJSON_AddItemToObject(root, "jpeg", jpeg);
+
+    cJSON *cpu = cJSON_CreateObject();
+    cJSON_AddNumberToObject(cpu, "interval_ms", cpu_stats.interval_ms);
+    cJSON *cores = cJSON_CreateArray();
+    for (int c = 0; c < CPU_LOAD_CORES; c++) {
+        cJSON_AddItemToArray(cores, cJSON_CreateNumber(cpu_stats.core_load[c]));
+    }
+    cJSON_AddItemToObject(cpu, "cores", cores);
+    cJSON *tasks = cJSON_CreateArray();
+    for (int i = 0; i < cpu_stats.tasks; i++) {
+        cJSON *task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", cpu_stats.task[i].name);
+        cJSON_AddNumberToObject(task, "core", cpu_stats.task[i].core);
+        cJSON_AddNumberToObject(task, "load", cpu_stats.task[i].load);
+        cJSON_AddItemToArray(tasks, task);
+    }
+    cJSON_AddItemToObject(cpu, "tasks", tasks);
+    cJSON_AddItemToObject(root, "cpu", cpu);
+
+    cJSON *logs = cJSON_CreateObject();
+    cJSON_AddNumberToObject(logs, "records", log_stats.records);
+    cJSON_AddNumberToObject(logs, "written", log_stats.written);
+    cJSON_AddNumberToObject(logs, "dropped", log_stats.dropped);
+    cJSON_AddNumberToObject(logs, "limited", log_stats.limited);
+    cJSON *limited_tags = cJSON_CreateObject();
+    for (int i = 0; i < log_stats.tags; i++) {
+        cJSON_AddNumberToObject(limited_tags, log_stats.tag[i].tag, log_stats.tag[i].limited);
+    }
+    cJSON_AddItemToObject(logs, "limited_tags", limited_tags);
+    cJSON_AddItemToObject(root, "logs", logs);
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for GET /api/boot
+// Phases not started yet are omitted; running ones have no end_us.
+static esp_err_t boot_handler(httpd_req_t *req)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "uptime_us", esp_timer_get_time());
+
+    cJSON *phases = cJSON_CreateArray();
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        boot_phase_info_t info;
+        boot_profile_get(i, &info);
+        if (!info.start_us) {
+            continue;
+        }
+        cJSON *phase = cJSON_CreateObject();
+        cJSON_AddStringToObject(phase, "name", info.name);
+        cJSON_AddNumberToObject(phase, "start_us", info.start_us);
+        if (info.end_us) {
+            cJSON_AddNumberToObject(phase, "end_us", info.end_us);
+            cJSON_AddNumberToObject(phase, "duration_us", info.end_us - info.start_us);
+        }
+        cJSON_AddItemToArray(phases, phase);
+    }
+    cJSON_AddItemToObject(root, "phases", phases);
+
+    // Headline numbers: from reset (esp_timer start) to the milestone
+    boot_phase_info_t scan, detection, http;
+    boot_profile_get(BOOT_PHASE_FIRST_SCAN, &scan);
+    boot_profile_get(BOOT_PHASE_FIRST_DETECTION, &detection);
+    boot_profile_get(BOOT_PHASE_HTTP, &http);
+    if (scan.end_us) {
+        cJSON_AddNumberToObject(root, "first_scan_us", scan.end_us);
+    }
+    if (detection.end_us) {
+        cJSON_AddNumberToObject(root, "first_detection_us", detection.end_us);
+    }
+    if (http.end_us) {
+        cJSON_AddNumberToObject(root, "http_ready_us", http.end_us);
+    }
+
+    char *json_str = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_str);
+
+    free(json_str);
+    cJSON_Delete(root);
+
+    return ESP_OK;
+}
+
+// Handler for POST /api/perf (runtime switches for performance comparisons)
+static esp_err_t perf_post_handler(httpd_req_t *req)
+{
+    char buf[128];
+    int ret, remaining = req->content_len;
+
+    if (remaining >= sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
+        return ESP_FAIL;
+    }
+
+    ret = httpd_req_recv(req, buf, remaining);
+    if (ret <= 0) {
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            httpd_resp_send_408(req);
+        }
+        return ESP_FAIL;
+    }
+    buf[ret] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (root == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *item;
+    if ((item = cJSON_GetObjectItem(root, "parallel")) && cJSON_IsBool(item)) {
+        color_detect_set_parallel(cJSON_IsTrue(item));
+    }
+    if ((item = cJSON_GetObjectItem(root, "strips")) && cJSON_IsBool(item)) {
+        color_detect_set_strips(cJSON_IsTrue(item));
+    }
+
+    cJSON_Delete(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+
+    return ESP_OK;
+}
+
+esp_err_t http_server_start(void)
+{
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = 80;
+    config.ctrl_port = 32768;
+    config.max_uri_handlers = 30;
+    config.max_resp_headers = 8;
+    config.stack_size = 8192;
+    // Streams are served by the sender task; keep API requests ahead of
+    // the capture pipeline and leave sockets for them while streams run
+    config.task_priority = 6;
+    config.max_open_sockets = STREAM_MAX_CLIENTS + 6;
+    config.close_fn = session_close;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    ESP_LOGI(TAG, "Starting HTTP server on port %d", config.server_port);
+
+    if (stream_sender_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start stream sender");
+        return ESP_FAIL;
+    }
+
+    if (httpd_start(&server, &config) == ESP_OK) {
+        httpd_uri_t root_uri = {
+            .uri = "/",
+            .method = HTTP_GET,
+            .handler = root_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &root_uri);
+
+        httpd_uri_t stream_uri = {
+            .uri = "/stream",
+            .method = HTTP_GET,
+            .handler = stream_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &stream_uri);
+
+        // The sender is the only writer on WebSocket sockets, so httpd must
+        // not answer control frames itself
+        httpd_uri_t ws_uri = {
+            .uri = "/ws",
+            .method = HTTP_GET,
+            .handler = ws_handler,
+            .user_ctx = NULL,
+            .is_websocket = true,
+            .handle_ws_control_frames = true
+        };
+        httpd_register_uri_handler(server, &ws_uri);
+
+        httpd_uri_t config_get_uri = {
+            .uri = "/api/config",
+            .method = HTTP_GET,
+            .handler = config_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &config_get_uri);
+
+        httpd_uri_t config_post_uri = {
+            .uri = "/api/config",
+            .method = HTTP_POST,
+            .handler = config_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &config_post_uri);
+
+        httpd_uri_t stats_uri = {
+            .uri = "/api/stats",
+            .method = HTTP_GET,
+            .handler = stats_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &stats_uri);
+
+        httpd_uri_t perf_post_uri = {
+            .uri = "/api/perf",
+            .method = HTTP_POST,
+            .handler = perf_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &perf_post_uri);
+
+        httpd_uri_t mqtt_get_uri = {
+            .uri = "/api/mqtt",
+            .method = HTTP_GET,
+            .handler = mqtt_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &mqtt_get_uri);
+
+        httpd_uri_t mqtt_post_uri = {
+            .uri = "/api/mqtt",
+            .method = HTTP_POST,
+            .handler = mqtt_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &mqtt_post_uri);
+
+        httpd_uri_t detections_uri = {
+            .uri = "/api/detections",
+            .method = HTTP_GET,
+            .handler = detections_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &detections_uri);
+
+        httpd_uri_t clips_get_uri = {
+            .uri = "/api/clips",
+            .method = HTTP_GET,
+            .handler = clips_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &clips_get_uri);
+
+        httpd_uri_t clips_post_uri = {
+            .uri = "/api/clips",
+            .method = HTTP_POST,
+            .handler = clips_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &clips_post_uri);
+
+        httpd_uri_t clip_stream_uri = {
+            .uri = "/api/clips/*",
+            .method = HTTP_GET,
+            .handler = clip_stream_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &clip_stream_uri);
+
+        httpd_uri_t source_get_uri = {
+            .uri = "/api/source",
+            .method = HTTP_GET,
+            .handler = source_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &source_get_uri);
+
+        httpd_uri_t source_post_uri = {
+            .uri = "/api/source",
+            .method = HTTP_POST,
+            .handler = source_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &source_post_uri);
+
+        httpd_uri_t capture_uri = {
+            .uri = "/capture",
+            .method = HTTP_GET,
+            .handler = capture_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &capture_uri);
+
+        httpd_uri_t benchmark_get_uri = {
+            .uri = "/api/benchmark",
+            .method = HTTP_GET,
+            .handler = benchmark_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &benchmark_get_uri);
+
+        httpd_uri_t benchmark_post_uri = {
+            .uri = "/api/benchmark",
+            .method = HTTP_POST,
+            .handler = benchmark_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &benchmark_post_uri);
+
+        httpd_uri_t kernel_bench_uri = {
+            .uri = "/api/bench",
+            .method = HTTP_GET,
+            .handler = kernel_bench_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &kernel_bench_uri);
+
+        httpd_uri_t logs_uri = {
+            .uri = "/api/logs",
+            .method = HTTP_GET,
+            .handler = logs_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &logs_uri);
+
+        httpd_uri_t boot_uri = {
+            .uri = "/api/boot",
+            .method = HTTP_GET,
+            .handler = boot_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &boot_uri);
+
+        httpd_uri_t pattern_get_uri = {
+            .uri = "/api/pattern",
+            .method = HTTP_GET,
+            .handler = pattern_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &pattern_get_uri);
+
+        httpd_uri_t pattern_post_uri = {
+            .uri = "/api/pattern",
+            .method = HTTP_POST,
+            .handler = pattern_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &pattern_post_uri);
+
+        httpd_uri_t histogram_uri = {
+            .uri = "/api/histogram",
+            .method = HTTP_GET,
+            .handler = histogram_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &histogram_uri);
+
+        httpd_uri_t config_preview_uri = {
+            .uri = "/api/config/preview",
+            .method = HTTP_POST,
+            .handler = config_preview_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &config_preview_uri);
+
+        httpd_uri_t profiles_get_uri = {
+            .uri = "/api/profiles",
+            .method = HTTP_GET,
+            .handler = profiles_get_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &profiles_get_uri);
+
+        httpd_uri_t profile_post_uri = {
+            .uri = "/api/profile/*",
+            .method = HTTP_POST,
+            .handler = profile_post_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &profile_post_uri);
+
+        httpd_uri_t profile_put_uri = {
+            .uri = "/api/profile/*",
+            .method = HTTP_PUT,
+            .handler = profile_put_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &profile_put_uri);
+
+        httpd_uri_t profile_delete_uri = {
+            .uri = "/api/profile/*",
+            .method = HTTP_DELETE,
+            .handler = profile_delete_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &profile_delete_uri);
 
         ESP_LOGI(TAG, "HTTP server started successfully");
         return ESP_OK;
@@ -0,0 +1,621 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Strip-parallel baseline JPEG encoder implementation
+ */
+
+#include "jpeg_encoder.h"
+#include "parallel_worker.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "jpeg_enc";
+
+#define MCU_SIZE            16
+#define HEADER_MAX_BYTES    1024
+#define PART_INITIAL_BYTES  (32 * 1024)
+// Worst case for one 4:2:0 MCU (6 blocks) including 0xFF byte stuffing
+#define MCU_WORST_BYTES     2560
+
+// Zigzag position -> natural (row-major) coefficient index
+static const uint8_t natural_order[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// ITU-T T.81 Annex K quantization tables (natural order)
+static const uint8_t std_luma_qt[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99
+};
+
+static const uint8_t std_chroma_qt[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// ITU-T T.81 Annex K Huffman tables
+static const uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_vals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t ac_luma_vals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_vals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+// AAN scale factors for the float forward DCT
+static const float aan_scale[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+    1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+typedef struct {
+    uint16_t code[256];
+    uint8_t size[256];
+} huff_table_t;
+
+// Entropy-coded output of one strip
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t cap;
+    uint32_t bit_acc;
+    int bit_cnt;
+    bool failed;
+} strip_out_t;
+
+typedef struct {
+    const uint8_t *pixels;
+    uint16_t width;
+    uint16_t height;
+    uint16_t mcu_cols;
+    uint16_t mcu_rows;
+} encode_job_t;
+
+static huff_table_t huff_dc_luma, huff_ac_luma, huff_dc_chroma, huff_ac_chroma;
+static uint8_t qt_luma[64], qt_chroma[64];
+static float fdtbl_luma[64], fdtbl_chroma[64];
+static int current_quality = -1;
+
+static strip_out_t strips[PARALLEL_WORKER_COUNT];
+static SemaphoreHandle_t encode_mutex = NULL;
+static jpeg_encoder_stats_t stats;
+
+static void build_huff_table(huff_table_t *t, const uint8_t *bits, const uint8_t *vals)
+{
+    uint16_t code = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++) {
+            t->code[vals[k]] = code++;
+            t->size[vals[k]] = len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+static void build_quant_tables(int quality)
+{
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    int scale = (quality < 50) ? (5000 / quality) : (200 - quality * 2);
+
+    for (int i = 0; i < 64; i++) {
+        int l = (std_luma_qt[i] * scale + 50) / 100;
+        int c = (std_chroma_qt[i] * scale + 50) / 100;
+        qt_luma[i] = (l < 1) ? 1 : (l > 255) ? 255 : l;
+        qt_chroma[i] = (c < 1) ? 1 : (c > 255) ? 255 : c;
+    }
+
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            int i = row * 8 + col;
+            float s = aan_scale[row] * aan_scale[col] * 8.0f;
+            fdtbl_luma[i] = 1.0f / (qt_luma[i] * s);
+            fdtbl_chroma[i] = 1.0f / (qt_chroma[i] * s);
+        }
+    }
+
+    current_quality = quality;
+}
+
+// Float AAN forward DCT (in place, output scaled by aan_scale * 8)
+static void fdct_float(float *data)
+{
+    float *p = data;
+    for (int i = 0; i < 8; i++, p += 8) {
+        float tmp0 = p[0] + p[7], tmp7 = p[0] - p[7];
+        float tmp1 = p[1] + p[6], tmp6 = p[1] - p[6];
+        float tmp2 = p[2] + p[5], tmp5 = p[2] - p[5];
+        float tmp3 = p[3] + p[4], tmp4 = p[3] - p[4];
+
+        float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        p[0] = tmp10 + tmp11;
+        p[4] = tmp10 - tmp11;
+        float z1 = (tmp12 + tmp13) * 0.707106781f;
+        p[2] = tmp13 + z1;
+        p[6] = tmp13 - z1;
+
+        tmp10 = tmp4 + tmp5;
+        tmp11 = tmp5 + tmp6;
+        tmp12 = tmp6 + tmp7;
+        float z5 = (tmp10 - tmp12) * 0.382683433f;
+        float z2 = 0.541196100f * tmp10 + z5;
+        float z4 = 1.306562965f * tmp12 + z5;
+        float z3 = tmp11 * 0.707106781f;
+        float z11 = tmp7 + z3, z13 = tmp7 - z3;
+
+        p[5] = z13 + z2;
+        p[3] = z13 - z2;
+        p[1] = z11 + z4;
+        p[7] = z11 - z4;
+    }
+
+    p = data;
+    for (int i = 0; i < 8; i++, p++) {
+        float tmp0 = p[0] + p[56], tmp7 = p[0] - p[56];
+        float tmp1 = p[8] + p[48], tmp6 = p[8] - p[48];
+        float tmp2 = p[16] + p[40], tmp5 = p[16] - p[40];
+        float tmp3 = p[24] + p[32], tmp4 = p[24] - p[32];
+
+        float tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+        float tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+
+        p[0] = tmp10 + tmp11;
+        p[32] = tmp10 - tmp11;
+        float z1 = (tmp12 + tmp13) * 0.707106781f;
+        p[16] = tmp13 + z1;
+        p[48] = tmp13 - z1;
+
+        tmp10 = tmp4 + tmp5;
+        tmp11 = tmp5 + tmp6;
+        tmp12 = tmp6 + tmp7;
+        float z5 = (tmp10 - tmp12) * 0.382683433f;
+        float z2 = 0.541196100f * tmp10 + z5;
+        float z4 = 1.306562965f * tmp12 + z5;
+        float z3 = tmp11 * 0.707106781f;
+        float z11 = tmp7 + z3, z13 = tmp7 - z3;
+
+        p[40] = z13 + z2;
+        p[24] = z13 - z2;
+        p[8] = z11 + z4;
+        p[56] = z11 - z4;
+    }
+}
+
+static inline void put_byte(strip_out_t *o, uint8_t b)
+{
+    o->buf[o->len++] = b;
+}
+
+static inline void put_bits(strip_out_t *o, uint32_t bits, int size)
+{
+    o->bit_acc = (o->bit_acc << size) | (bits & ((1u << size) - 1));
+    o->bit_cnt += size;
+    while (o->bit_cnt >= 8) {
+        uint8_t b = (uint8_t)(o->bit_acc >> (o->bit_cnt - 8));
+        put_byte(o, b);
+        if (b == 0xFF) {
+            put_byte(o, 0x00);
+        }
+        o->bit_cnt -= 8;
+    }
+}
+
+// Pad the last byte with 1-bits, as required before a marker
+static void flush_bits(strip_out_t *o)
+{
+    if (o->bit_cnt > 0) {
+        put_bits(o, 0x7F, 8 - o->bit_cnt);
+    }
+    o->bit_acc = 0;
+    o->bit_cnt = 0;
+}
+
+static bool ensure_capacity(strip_out_t *o, size_t extra)
+{
+    if (o->len + extra <= o->cap) {
+        return true;
+    }
+
+    size_t new_cap = o->cap ? o->cap * 2 : PART_INITIAL_BYTES;
+    while (new_cap < o->len + extra) {
+        new_cap *= 2;
+    }
+
+    uint8_t *p = heap_caps_realloc(o->buf, new_cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!p) {
+        p = realloc(o->buf, new_cap);
+    }
+    if (!p) {
+        return false;
+    }
+    o->buf = p;
+    o->cap = new_cap;
+    return true;
+}
+
+static inline int bit_length(int v)
+{
+    int n = 0;
+    while (v) {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static void encode_block(strip_out_t *o, float *data, const float *fdtbl, int *prev_dc,
+                         const huff_table_t *dc, const huff_table_t *ac)
+{
+    int q[64];
+
+    fdct_float(data);
+    for (int i = 0; i < 64; i++) {
+        float v = data[i] * fdtbl[i];
+        q[i] = (int)(v + 16384.5f) - 16384;
+    }
+
+    // DC coefficient: difference to previous block of the same component
+    int diff = q[0] - *prev_dc;
+    *prev_dc = q[0];
+    int mag = diff < 0 ? -diff : diff;
+    int nbits = bit_length(mag);
+    put_bits(o, dc->code[nbits], dc->size[nbits]);
+    if (nbits) {
+        put_bits(o, diff < 0 ? diff - 1 : diff, nbits);
+    }
+
+    // AC coefficients in zigzag order
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int v = q[natural_order[k]];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            put_bits(o, ac->code[0xF0], ac->size[0xF0]);
+            run -= 16;
+        }
+        mag = v < 0 ? -v : v;
+        nbits = bit_length(mag);
+        int sym = (run << 4) | nbits;
+        put_bits(o, ac->code[sym], ac->size[sym]);
+        put_bits(o, v < 0 ? v - 1 : v, nbits);
+        run = 0;
+    }
+    if (run > 0) {
+        put_bits(o, ac->code[0x00], ac->size[0x00]);
+    }
+}
+
+// Encode MCU rows [row_start, row_end) into one strip
+static void encode_strip(const encode_job_t *job, strip_out_t *o, int row_start, int row_end)
+{
+    float y_blk[4][64];
+    float cb_blk[64], cr_blk[64];
+
+    o->len = 0;
+    o->bit_acc = 0;
+    o->bit_cnt = 0;
+    o->failed = false;
+
+    for (int my = row_start; my < row_end; my++) {
+        int dc_y = 0, dc_cb = 0, dc_cr = 0;
+
+        // Restart marker RSTm precedes every MCU row but the first
+        if (my > 0) {
+            if (!ensure_capacity(o, 2)) {
+                o->failed = true;
+                return;
+            }
+            put_byte(o, 0xFF);
+            put_byte(o, 0xD0 + ((my - 1) & 7));
+        }
+
+        for (int mx = 0; mx < job->mcu_cols; mx++) {
+            if (!ensure_capacity(o, MCU_WORST_BYTES)) {
+                o->failed = true;
+                return;
+            }
+
+            memset(cb_blk, 0, sizeof(cb_blk));
+            memset(cr_blk, 0, sizeof(cr_blk));
+
+            for (int py = 0; py < MCU_SIZE; py++) {
+                int y = my * MCU_SIZE + py;
+                if (y >= job->height) y = job->height - 1;
+                const uint8_t *row = job->pixels + (size_t)y * job->width * 2;
+
+                for (int px = 0; px < MCU_SIZE; px++) {
+                    int x = mx * MCU_SIZE + px;
+                    if (x >= job->width) x = job->width - 1;
+
+                    // RGB565 big-endian: RRRRRGGG GGGBBBBB
+                    uint8_t hb = row[x * 2];
+                    uint8_t lb = row[x * 2 + 1];
+                    float r = hb & 0xF8;
+                    float g = ((hb & 0x07) << 5) | ((lb & 0xE0) >> 3);
+                    float b = (lb & 0x1F) << 3;
+
+                    int blk = ((py >> 3) << 1) | (px >> 3);
+                    y_blk[blk][((py & 7) << 3) | (px & 7)] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+
+                    int ci = ((py >> 1) << 3) | (px >> 1);
+                    cb_blk[ci] += -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    cr_blk[ci] += 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+
+            for (int i = 0; i < 64; i++) {
+                cb_blk[i] *= 0.25f;
+                cr_blk[i] *= 0.25f;
+            }
+
+            for (int blk = 0; blk < 4; blk++) {
+                encode_block(o, y_blk[blk], fdtbl_luma, &dc_y, &huff_dc_luma, &huff_ac_luma);
+            }
+            encode_block(o, cb_blk, fdtbl_chroma, &dc_cb, &huff_dc_chroma, &huff_ac_chroma);
+            encode_block(o, cr_blk, fdtbl_chroma, &dc_cr, &huff_dc_chroma, &huff_ac_chroma);
+        }
+
+        flush_bits(o);
+    }
+}
+
+static void encode_part(void *ctx, int part, int num_parts)
+{
+    const encode_job_t *job = (const encode_job_t *)ctx;
+    int row_start = job->mcu_rows * part / num_parts;
+    int row_end = job->mcu_rows * (part + 1) / num_parts;
+    encode_strip(job, &strips[part], row_start, row_end);
+}
+
+static void put_marker_segment(uint8_t **p, uint8_t marker, uint16_t len)
+{
+    *(*p)++ = 0xFF;
+    *(*p)++ = marker;
+    *(*p)++ = len >> 8;
+    *(*p)++ = len & 0xFF;
+}
+
+static void put_dht(uint8_t **p, uint8_t class_id, const uint8_t *bits, const uint8_t *vals)
+{
+    int count = 0;
+    *(*p)++ = class_id;
+    for (int i = 0; i < 16; i++) {
+        *(*p)++ = bits[i];
+        count += bits[i];
+    }
+    memcpy(*p, vals, count);
+    *p += count;
+}
+
+static size_t write_header(uint8_t *buf, uint16_t width, uint16_t height, uint16_t restart_interval)
+{
+    uint8_t *p = buf;
+
+    // SOI
+    *p++ = 0xFF;
+    *p++ = 0xD8;
+
+    // APP0 JFIF
+    static const uint8_t jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    put_marker_segment(&p, 0xE0, 2 + sizeof(jfif));
+    memcpy(p, jfif, sizeof(jfif));
+    p += sizeof(jfif);
+
+    // DQT: luma (0) and chroma (1), zigzag order
+    put_marker_segment(&p, 0xDB, 2 + 2 * 65);
+    *p++ = 0;
+    for (int i = 0; i < 64; i++) *p++ = qt_luma[natural_order[i]];
+    *p++ = 1;
+    for (int i = 0; i < 64; i++) *p++ = qt_chroma[natural_order[i]];
+
+    // SOF0: 3 components, Y 2x2, Cb/Cr 1x1
+    put_marker_segment(&p, 0xC0, 17);
+    *p++ = 8;
+    *p++ = height >> 8;
+    *p++ = height & 0xFF;
+    *p++ = width >> 8;
+    *p++ = width & 0xFF;
+    *p++ = 3;
+    *p++ = 1; *p++ = 0x22; *p++ = 0;
+    *p++ = 2; *p++ = 0x11; *p++ = 1;
+    *p++ = 3; *p++ = 0x11; *p++ = 1;
+
+    // DHT: all four standard tables in one segment
+    put_marker_segment(&p, 0xC4, 2 + 4 * 17 + 12 + 162 + 12 + 162);
+    put_dht(&p, 0x00, dc_luma_bits, dc_vals);
+    put_dht(&p, 0x10, ac_luma_bits, ac_luma_vals);
+    put_dht(&p, 0x01, dc_chroma_bits, dc_vals);
+    put_dht(&p, 0x11, ac_chroma_bits, ac_chroma_vals);
+
+    // DRI
+    put_marker_segment(&p, 0xDD, 4);
+    *p++ = restart_interval >> 8;
+    *p++ = restart_interval & 0xFF;
+
+    // SOS
+    put_marker_segment(&p, 0xDA, 12);
+    *p++ = 3;
+    *p++ = 1; *p++ = 0x00;
+    *p++ = 2; *p++ = 0x11;
+    *p++ = 3; *p++ = 0x11;
+    *p++ = 0;
+    *p++ = 63;
+    *p++ = 0;
+
+    return p - buf;
+}
+
+esp_err_t jpeg_encoder_init(void)
+{
+    if (encode_mutex) {
+        return ESP_OK;
+    }
+
+    build_huff_table(&huff_dc_luma, dc_luma_bits, dc_vals);
+    build_huff_table(&huff_ac_luma, ac_luma_bits, ac_luma_vals);
+    build_huff_table(&huff_dc_chroma, dc_chroma_bits, dc_vals);
+    build_huff_table(&huff_ac_chroma, ac_chroma_bits, ac_chroma_vals);
+
+    encode_mutex = xSemaphoreCreateMutex();
+    if (!encode_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        if (!ensure_capacity(&strips[i], PART_INITIAL_BYTES)) {
+            ESP_LOGE(TAG, "Failed to allocate strip buffer");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_err_t ret = parallel_worker_init();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "JPEG encoder initialized (%d strips)", PARALLEL_WORKER_COUNT);
+    return ESP_OK;
+}
+
+bool jpeg_encode_rgb565(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len)
+{
+    if (!fb || !out || !out_len || !encode_mutex) {
+        return false;
+    }
+
+    if (fb->format != PIXFORMAT_RGB565 || fb->width == 0 || fb->height == 0) {
+        ESP_LOGE(TAG, "Unsupported frame format");
+        return false;
+    }
+
+    int64_t start = esp_timer_get_time();
+    bool ok = true;
+
+    xSemaphoreTake(encode_mutex, portMAX_DELAY);
+
+    if (quality != current_quality) {
+        build_quant_tables(quality);
+    }
+
+    encode_job_t job = {
+        .pixels = fb->buf,
+        .width = fb->width,
+        .height = fb->height,
+        .mcu_cols = (fb->width + MCU_SIZE - 1) / MCU_SIZE,
+        .mcu_rows = (fb->height + MCU_SIZE - 1) / MCU_SIZE,
+    };
+
+    parallel_worker_run(encode_part, &job);
+
+    uint8_t header[HEADER_MAX_BYTES];
+    size_t header_len = write_header(header, job.width, job.height, job.mcu_cols);
+    size_t total = header_len + 2;
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        if (strips[i].failed) {
+            ok = false;
+        }
+        total += strips[i].len;
+    }
+
+    uint8_t *jpg = ok ? malloc(total) : NULL;
+    if (jpg) {
+        uint8_t *p = jpg;
+        memcpy(p, header, header_len);
+        p += header_len;
+        for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+            memcpy(p, strips[i].buf, strips[i].len);
+            p += strips[i].len;
+        }
+        *p++ = 0xFF;
+        *p++ = 0xD9;
+        *out = jpg;
+        *out_len = total;
+    } else {
+        ESP_LOGE(TAG, "Out of memory encoding %dx%d frame", job.width, job.height);
+        ok = false;
+    }
+
+    // Still under the lock: concurrent encodes would race on the average
+    if (ok) {
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+        stats.frames++;
+        stats.last_us = elapsed;
+        stats.avg_us = (stats.frames == 1) ? elapsed : (stats.avg_us * 7 + elapsed) / 8;
+        stats.last_bytes = total;
+    }
+
+    xSemaphoreGive(encode_mutex);
+
+    return ok;
+}
+
+void jpeg_encoder_get_stats(jpeg_encoder_stats_t *out)
+{
+    if (!out) {
+        return;
+    }
+    if (encode_mutex) {
+        xSemaphoreTake(encode_mutex, portMAX_DELAY);
+    }
+    memcpy(out, &stats, sizeof(jpeg_encoder_stats_t));
+    if (encode_mutex) {
+        xSemaphoreGive(encode_mutex);
+    }
+}
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Strip-parallel baseline JPEG encoder for RGB565 frames
+ */
+
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include "esp_camera.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Encoder statistics
+typedef struct {
+    uint32_t frames;        // Frames encoded since boot
+    uint32_t last_us;       // Encode time of the last frame
+    uint32_t avg_us;        // Running average encode time
+    uint32_t last_bytes;    // Size of the last encoded frame
+} jpeg_encoder_stats_t;
+
+/**
+ * @brief Initialize the encoder and its worker pool
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t jpeg_encoder_init(void);
+
+/**
+ * @brief Encode an RGB565 frame to a baseline JPEG (4:2:0)
+ *
+ * The frame is split into horizontal strips of 16-pixel MCU rows which are
+ * entropy-coded on both cores. A restart marker is placed after every MCU
+ * row so the strips concatenate into one valid JPEG.
+ *
+ * Same contract as frame2jpg(): on success *out is allocated with malloc()
+ * and must be released by the caller with free().
+ *
+ * @param fb Frame buffer (RGB565, big-endian as delivered by the camera)
+ * @param quality JPEG quality (1-100)
+ * @param out Pointer to store the JPEG buffer
+ * @param out_len Pointer to store the JPEG length
+ * @return true on success, false otherwise
+ */
+bool jpeg_encode_rgb565(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+
+/**
+ * @brief Get encoder statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void jpeg_encoder_get_stats(jpeg_encoder_stats_t *stats);
+
+#endif // JPEG_ENCODER_H
@@ -0,0 +1,353 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Kernel benchmark implementation
+ */
+
+#include "kernel_bench.h"
+#include "color_detect.h"
+#include "color_kernels.h"
+#include "config_store.h"
+#include "jpeg_encoder.h"
+#include "img_converters.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+static const char *TAG = "kernel_bench";
+
+#define BENCH_STACK_SIZE    4096
+#define BENCH_PRIORITY      6       // Above the pipeline and workers
+#define BENCH_CORE          1       // Away from the Wi-Fi task
+#define BENCH_JPEG_QUALITY  80      // Same as the pipeline
+#define JSON_RESULT_SIZE    256     // Upper bound of one formatted result
+
+static const struct {
+    const char *name;
+    uint16_t width;
+    uint16_t height;
+} sizes[KERNEL_BENCH_SIZES] = {
+    { "QVGA", 320, 240 },
+    { "VGA", 640, 480 },
+    { "SVGA", 800, 600 },
+};
+
+// Buffers of one frame size. Per-pixel kernels run over one row in internal
+// RAM, repeated for every row, so they time computation only; the classify
+// loop, the overlay and the encoder work on the whole frame in PSRAM like the
+// pipeline does.
+typedef struct {
+    camera_fb_t fb;
+    uint16_t *row;              // RGB565 row (internal RAM)
+    uint8_t *rgb;               // RGB888 row
+    uint8_t *hsv;               // HSV row
+    uint8_t *match;             // Class index per pixel (255 = none)
+    color_pattern_t *pattern;   // Default R-G-B pattern (internal RAM)
+    detection_result_t bbox;
+    uint32_t sink;              // Keeps results alive
+} bench_ctx_t;
+
+typedef void (*kernel_fn_t)(bench_ctx_t *ctx);
+
+// Keep the compiler from hoisting a row pass out of the row loop
+#define ROW_BARRIER()   __asm__ __volatile__("" ::: "memory")
+
+static void kernel_rgb565_to_rgb888(bench_ctx_t *ctx)
+{
+    uint16_t width = ctx->fb.width;
+    for (uint16_t y = 0; y < ctx->fb.height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            rgb565_to_rgb888(ctx->row[x], &ctx->rgb[x * 3], &ctx->rgb[x * 3 + 1], &ctx->rgb[x * 3 + 2]);
+        }
+        ROW_BARRIER();
+    }
+    ctx->sink += ctx->rgb[0];
+}
+
+static void kernel_rgb_to_hsv(bench_ctx_t *ctx)
+{
+    uint16_t width = ctx->fb.width;
+    for (uint16_t y = 0; y < ctx->fb.height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            const uint8_t *p = &ctx->rgb[x * 3];
+            rgb_to_hsv(p[0], p[1], p[2], &ctx->hsv[x * 3], &ctx->hsv[x * 3 + 1], &ctx->hsv[x * 3 + 2]);
+        }
+        ROW_BARRIER();
+    }
+    ctx->sink += ctx->hsv[0];
+}
+
+static void kernel_hsv_classify(bench_ctx_t *ctx)
+{
+    uint16_t width = ctx->fb.width;
+    for (uint16_t y = 0; y < ctx->fb.height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            const uint8_t *p = &ctx->hsv[x * 3];
+            ctx->match[x] = hsv_classify(p[0], p[1], p[2], ctx->pattern);
+        }
+        ROW_BARRIER();
+    }
+    ctx->sink += ctx->match[0];
+}
+
+static void kernel_classify(bench_ctx_t *ctx)
+{
+    frame_stats_t stats;
+    frame_stats_init(&stats, ctx->fb.width, ctx->fb.height);
+    color_detect_scan_rows((const uint16_t *)ctx->fb.buf, ctx->fb.width, 0, ctx->fb.height,
+                           ctx->pattern, NULL, &stats, NULL);
+    ctx->sink += stats.color[1].pixels;
+}
+
+static void kernel_draw_bbox(bench_ctx_t *ctx)
+{
+    color_detect_draw_bbox(&ctx->fb, &ctx->bbox);
+}
+
+static void kernel_frame2jpg(bench_ctx_t *ctx)
+{
+    uint8_t *jpeg = NULL;
+    size_t len = 0;
+    if (frame2jpg(&ctx->fb, BENCH_JPEG_QUALITY, &jpeg, &len)) {
+        ctx->sink += len;
+    }
+    free(jpeg);
+}
+
+// The strip-parallel encoder runs on both cores while this task waits, so
+// its cycles are elapsed time on the benchmark core, like frame2jpg's
+static void kernel_jpeg_encode_rgb565(bench_ctx_t *ctx)
+{
+    uint8_t *jpeg = NULL;
+    size_t len = 0;
+    if (jpeg_encode_rgb565(&ctx->fb, BENCH_JPEG_QUALITY, &jpeg, &len)) {
+        ctx->sink += len;
+    }
+    free(jpeg);
+}
+
+static const struct {
+    const char *name;
+    kernel_fn_t fn;
+} kernels[KERNEL_BENCH_KERNELS] = {
+    { "rgb565_to_rgb888", kernel_rgb565_to_rgb888 },
+    { "rgb_to_hsv", kernel_rgb_to_hsv },
+    { "hsv_classify", kernel_hsv_classify },
+    { "classify", kernel_classify },
+    { "draw_bbox", kernel_draw_bbox },
+    { "frame2jpg", kernel_frame2jpg },
+    { "jpeg_encode_rgb565", kernel_jpeg_encode_rgb565 },
+};
+
+// Gray frame with red, green and blue bands across the middle, big-endian
+// like camera frames
+static void fill_frame(uint16_t *pixels, uint16_t width, uint16_t height)
+{
+    static const uint16_t bands[] = { 0x00F8, 0xE007, 0x1F00 };
+    const int band_count = sizeof(bands) / sizeof(bands[0]);
+    uint16_t band_w = width / 8;
+    uint16_t x0 = (width - band_w * band_count) / 2;
+
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            uint16_t pixel = 0x1084;
+            if (y >= height / 4 && y < height * 3 / 4 && x >= x0 && x < x0 + band_w * band_count) {
+                pixel = bands[(x - x0) / band_w];
+            }
+            pixels[y * width + x] = pixel;
+        }
+    }
+}
+
+static void ctx_free(bench_ctx_t *ctx)
+{
+    heap_caps_free(ctx->fb.buf);
+    heap_caps_free(ctx->row);
+    heap_caps_free(ctx->rgb);
+    heap_caps_free(ctx->hsv);
+    heap_caps_free(ctx->match);
+    heap_caps_free(ctx->pattern);
+}
+
+static bool ctx_alloc(bench_ctx_t *ctx, uint16_t width, uint16_t height)
+{
+    memset(ctx, 0, sizeof(bench_ctx_t));
+    ctx->fb.width = width;
+    ctx->fb.height = height;
+    ctx->fb.format = PIXFORMAT_RGB565;
+    ctx->fb.len = (size_t)width * height * 2;
+    ctx->fb.buf = heap_caps_malloc(ctx->fb.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    ctx->row = heap_caps_malloc(width * 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ctx->rgb = heap_caps_malloc(width * 3, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ctx->hsv = heap_caps_malloc(width * 3, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ctx->match = heap_caps_malloc(width, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    ctx->pattern = heap_caps_malloc(sizeof(color_pattern_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!ctx->fb.buf || !ctx->row || !ctx->rgb || !ctx->hsv || !ctx->match || !ctx->pattern) {
+        ctx_free(ctx);
+        return false;
+    }
+
+    fill_frame((uint16_t *)ctx->fb.buf, width, height);
+    // Middle row: gray on both sides of the three bands
+    memcpy(ctx->row, ctx->fb.buf + (height / 2) * width * 2, width * 2);
+    for (uint16_t x = 0; x < width; x++) {
+        rgb565_to_rgb888(ctx->row[x], &ctx->rgb[x * 3], &ctx->rgb[x * 3 + 1], &ctx->rgb[x * 3 + 2]);
+        rgb_to_hsv(ctx->rgb[x * 3], ctx->rgb[x * 3 + 1], ctx->rgb[x * 3 + 2],
+                   &ctx->hsv[x * 3], &ctx->hsv[x * 3 + 1], &ctx->hsv[x * 3 + 2]);
+    }
+
+    color_config_t config;
+    pattern_config_t pattern;
+    config_get_defaults(&config);
+    config_get_pattern_defaults(&pattern, &config);
+    color_pattern_compile(&pattern, ctx->pattern);
+    ctx->bbox.rgb_detected = true;
+    ctx->bbox.bbox_x = width / 4;
+    ctx->bbox.bbox_y = height / 4;
+    ctx->bbox.bbox_w = width / 2;
+    ctx->bbox.bbox_h = height / 2;
+    return true;
+}
+
+typedef struct {
+    uint32_t iterations;
+    kernel_bench_report_t *report;
+    esp_err_t err;
+    TaskHandle_t caller;
+} bench_run_t;
+
+static void bench_task(void *arg)
+{
+    bench_run_t *run = arg;
+    kernel_bench_report_t *report = run->report;
+    run->err = ESP_OK;
+
+    for (int s = 0; s < KERNEL_BENCH_SIZES && run->err == ESP_OK; s++) {
+        bench_ctx_t ctx;
+        if (!ctx_alloc(&ctx, sizes[s].width, sizes[s].height)) {
+            run->err = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        for (int k = 0; k < KERNEL_BENCH_KERNELS; k++) {
+            uint32_t cycles_min = UINT32_MAX;
+            uint64_t cycles_total = 0, us_total = 0;
+
+            for (uint32_t i = 0; i < run->iterations; i++) {
+                // Let the idle task run between passes
+                vTaskDelay(1);
+                int64_t start_us = esp_timer_get_time();
+                uint32_t start = esp_cpu_get_cycle_count();
+                kernels[k].fn(&ctx);
+                uint32_t cycles = esp_cpu_get_cycle_count() - start;
+                us_total += esp_timer_get_time() - start_us;
+
+                cycles_total += cycles;
+                if (cycles < cycles_min) {
+                    cycles_min = cycles;
+                }
+            }
+
+            kernel_bench_result_t *r = &report->results[report->count++];
+            r->kernel = kernels[k].name;
+            r->size = sizes[s].name;
+            r->width = sizes[s].width;
+            r->height = sizes[s].height;
+            r->iterations = run->iterations;
+            r->cycles_min = cycles_min;
+            r->cycles_mean = cycles_total / run->iterations;
+            r->us_mean = us_total / run->iterations;
+        }
+
+        ESP_LOGD(TAG, "%s done (sink %lu)", sizes[s].name, (unsigned long)ctx.sink);
+        ctx_free(&ctx);
+    }
+
+    xTaskNotifyGive(run->caller);
+    vTaskDelete(NULL);
+}
+
+static portMUX_TYPE run_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool running = false;
+
+esp_err_t kernel_bench_run(uint32_t iterations, kernel_bench_report_t *report)
+{
+    if (!report || iterations == 0 || iterations > KERNEL_BENCH_MAX_ITERATIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&run_lock);
+    bool busy = running;
+    running = true;
+    taskEXIT_CRITICAL(&run_lock);
+    if (busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(report, 0, sizeof(kernel_bench_report_t));
+    report->cpu_mhz = esp_rom_get_cpu_ticks_per_us();
+    report->core = BENCH_CORE;
+
+    bench_run_t run = {
+        .iterations = iterations,
+        .report = report,
+        .err = ESP_OK,
+        .caller = xTaskGetCurrentTaskHandle(),
+    };
+
+    ESP_LOGI(TAG, "Running kernel benchmark, %lu iterations", (unsigned long)iterations);
+    if (xTaskCreatePinnedToCore(bench_task, "kernel_bench", BENCH_STACK_SIZE, &run,
+                                BENCH_PRIORITY, NULL, BENCH_CORE) != pdPASS) {
+        run.err = ESP_ERR_NO_MEM;
+    } else {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    taskENTER_CRITICAL(&run_lock);
+    running = false;
+    taskEXIT_CRITICAL(&run_lock);
+
+    return run.err;
+}
+
+char *kernel_bench_to_json(const kernel_bench_report_t *report)
+{
+    // Formatted directly rather than with cJSON so the host runner has no
+    // dependency beyond libc; names are fixed identifiers that need no escaping
+    size_t size = (report->count + 1) * JSON_RESULT_SIZE;
+    char *json = malloc(size);
+    if (!json) {
+        return NULL;
+    }
+
+    size_t len = snprintf(json, size, "{\"platform\":\"%s\",\"cpu_mhz\":%lu,\"core\":%d,\"results\":[",
+                          CONFIG_IDF_TARGET, (unsigned long)report->cpu_mhz, report->core);
+    for (size_t i = 0; i < report->count && len < size; i++) {
+        const kernel_bench_result_t *r = &report->results[i];
+        uint32_t pixels = (uint32_t)r->width * r->height;
+
+        len += snprintf(json + len, size - len,
+                        "%s\n{\"kernel\":\"%s\",\"size\":\"%s\",\"width\":%u,\"height\":%u,"
+                        "\"iterations\":%lu,\"cycles_min\":%lu,\"cycles_mean\":%lu,"
+                        "\"cycles_per_pixel\":%.3f,\"us_mean\":%lu}",
+                        i ? "," : "", r->kernel, r->size, r->width, r->height,
+                        (unsigned long)r->iterations, (unsigned long)r->cycles_min,
+                        (unsigned long)r->cycles_mean, (double)r->cycles_min / pixels,
+                        (unsigned long)r->us_mean);
+    }
+    if (len < size) {
+        len += snprintf(json + len, size - len, "]}\n");
+    }
+    if (len >= size) {
+        free(json);
+        return NULL;
+    }
+    return json;
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Cycle-count micro-benchmarks of the pixel kernels
+ */
+
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Kernels timed at each frame size
+#define KERNEL_BENCH_KERNELS        7
+
+// Frame sizes: QVGA, VGA, SVGA
+#define KERNEL_BENCH_SIZES          3
+
+#define KERNEL_BENCH_RESULTS        (KERNEL_BENCH_KERNELS * KERNEL_BENCH_SIZES)
+
+#define KERNEL_BENCH_MAX_ITERATIONS 50
+
+// Timing of one kernel at one frame size
+typedef struct {
+    const char *kernel;
+    const char *size;
+    uint16_t width;
+    uint16_t height;
+    uint32_t iterations;
+    uint32_t cycles_min;        // Fastest pass over the frame
+    uint32_t cycles_mean;
+    uint32_t us_mean;
+} kernel_bench_result_t;
+
+typedef struct {
+    uint32_t cpu_mhz;
+    int core;                   // Core the kernels ran on
+    size_t count;
+    kernel_bench_result_t results[KERNEL_BENCH_RESULTS];
+} kernel_bench_report_t;
+
+/**
+ * @brief Time every kernel at every frame size
+ *
+ * Runs in a task pinned to one core above the pipeline's priority, so the
+ * cycle counter stays on one core, and blocks the caller until it is done
+ * (a few seconds). Detection and encoding stall meanwhile. Only one run at a time.
+ *
+ * @param iterations Passes per kernel and size (1 to KERNEL_BENCH_MAX_ITERATIONS)
+ * @param report Report to fill
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a run is in progress,
+ *         ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM
+ */
+esp_err_t kernel_bench_run(uint32_t iterations, kernel_bench_report_t *report);
+
+/**
+ * @brief Format a report as JSON
+ *
+ * The body of GET /api/bench, and the output of the host runner (host/), so
+ * device and host runs compare field by field.
+ *
+ * @param report Report filled by kernel_bench_run()
+ * @return JSON text to free() with free(), NULL if out of memory
+ */
+char *kernel_bench_to_json(const kernel_bench_report_t *report);
+
+#endif // KERNEL_BENCH_H
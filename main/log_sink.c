@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Asynchronous log sink implementation
+ */
+
+#include "log_sink.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <sys/param.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "log_sink";
+
+#define RING_MASK           (LOG_SINK_SIZE - 1)
+#define WRITER_STACK_SIZE   3072
+#define WRITER_PRIORITY     1
+#define WRITER_POLL_MS      10
+#define STALL_TIMEOUT_US    100000  // A reserved line not published by then is skipped
+
+// Any task may log: a writer reserves a slot by advancing head with a
+// compare-and-swap, fills it and publishes it by storing its seq last. The
+// console task follows behind (written); a writer that would overtake it
+// drops its line instead of waiting. Readers check seq before and after
+// copying a slot, like the detection log.
+static log_record_t *ring = NULL;
+static uint32_t head = 0;           // Sequence number of the newest reserved line
+static uint32_t written = 0;        // Sequence number of the last line sent to the console
+static vprintf_like_t console = NULL;
+
+static uint32_t dropped = 0;
+static uint32_t limited = 0;
+
+typedef struct {
+    char tag[16];
+    uint32_t tokens;                // Lines allowed, times 1000
+    int64_t refill_us;
+    uint32_t limited;
+} tag_bucket_t;
+
+static portMUX_TYPE bucket_lock = portMUX_INITIALIZER_UNLOCKED;
+static tag_bucket_t buckets[LOG_SINK_TAGS];
+static int bucket_count = 0;
+
+// Split "I (1234) tag: message" (optionally colored) into level and tag
+static char parse_line(const char *line, size_t len, char *tag, size_t tag_size)
+{
+    size_t i = 0;
+    if (len > 0 && line[0] == '\033') {
+        while (i < len && line[i] != 'm') {
+            i++;
+        }
+        i++;
+    }
+    char level = i < len ? line[i] : '?';
+
+    tag[0] = '\0';
+    const char *open = memchr(line + i, ')', len - MIN(i, len));
+    if (open && open + 2 < line + len) {
+        const char *start = open + 2;
+        const char *end = memchr(start, ':', line + len - start);
+        if (end) {
+            size_t n = MIN((size_t)(end - start), tag_size - 1);
+            memcpy(tag, start, n);
+            tag[n] = '\0';
+        }
+    }
+    return level;
+}
+
+// Token bucket per tag; true if the line may be logged
+static bool rate_allow(const char *tag)
+{
+    int64_t now = esp_timer_get_time();
+    bool allow = true;
+
+    taskENTER_CRITICAL(&bucket_lock);
+    tag_bucket_t *b = NULL;
+    for (int i = 0; i < bucket_count; i++) {
+        if (strcmp(buckets[i].tag, tag) == 0) {
+            b = &buckets[i];
+            break;
+        }
+    }
+    if (!b && bucket_count < LOG_SINK_TAGS) {
+        b = &buckets[bucket_count++];
+        strlcpy(b->tag, tag, sizeof(b->tag));
+        b->tokens = LOG_SINK_TAG_BURST * 1000;
+        b->refill_us = now;
+    }
+    if (b) {
+        uint64_t refill = (uint64_t)(now - b->refill_us) * LOG_SINK_TAG_RATE / 1000;
+        if (b->tokens + refill >= LOG_SINK_TAG_BURST * 1000) {
+            b->tokens = LOG_SINK_TAG_BURST * 1000;
+            b->refill_us = now;
+        } else {
+            // Keep the remainder for the next line
+            b->tokens += refill;
+            b->refill_us += refill * 1000 / LOG_SINK_TAG_RATE;
+        }
+        if (b->tokens >= 1000) {
+            b->tokens -= 1000;
+        } else {
+            b->limited++;
+            allow = false;
+        }
+    }
+    taskEXIT_CRITICAL(&bucket_lock);
+
+    return allow;
+}
+
+// Store one vprintf call: a line longer than a record is formatted again
+// in full and split over consecutive records, reserved together
+static int sink_vprintf(const char *format, va_list args)
+{
+    char line[LOG_SINK_LINE + 1];
+    va_list again;
+    va_copy(again, args);
+    int ret = vsnprintf(line, sizeof(line), format, args);
+    if (ret < 0) {
+        va_end(again);
+        return ret;
+    }
+
+    char *text = line;
+    size_t len = MIN((size_t)ret, LOG_SINK_LINE);
+    bool newline = false;
+    if (ret > LOG_SINK_LINE) {
+        text = malloc(ret + 1);
+        if (text) {
+            vsnprintf(text, ret + 1, format, again);
+            len = ret;
+        } else {
+            // Cut short: end the line
+            text = line;
+            newline = true;
+        }
+    }
+    va_end(again);
+
+    while (len > 0 && (text[len - 1] == '\n' || text[len - 1] == '\r')) {
+        len--;
+        newline = true;
+    }
+    if (len == 0 && !newline) {
+        return ret;
+    }
+
+    char tag[16];
+    char level = parse_line(text, len, tag, sizeof(tag));
+    uint32_t count = len ? (len + LOG_SINK_LINE - 1) / LOG_SINK_LINE : 1;
+    if (level != 'E' && level != 'W' && !rate_allow(tag)) {
+        __atomic_add_fetch(&limited, 1, __ATOMIC_RELAXED);
+        count = 0;
+    }
+
+    uint32_t last = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    while (count > 0) {
+        if (last + count - __atomic_load_n(&written, __ATOMIC_ACQUIRE) > LOG_SINK_SIZE) {
+            __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+            count = 0;
+            break;
+        }
+        if (__atomic_compare_exchange_n(&head, &last, last + count, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t seq = last + 1 + i;
+        log_record_t *rec = &ring[(seq - 1) & RING_MASK];
+        size_t offset = i * LOG_SINK_LINE;
+        size_t n = MIN(len - offset, LOG_SINK_LINE);
+
+        __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        memcpy(rec->text, text + offset, n);
+        rec->len = n;
+        rec->level = level;
+        rec->flags = (i + 1 < count) ? LOG_SINK_MORE : (newline ? LOG_SINK_NEWLINE : 0);
+
+        __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+    }
+
+    if (text != line) {
+        free(text);
+    }
+    return ret;
+}
+
+static int console_printf(vprintf_like_t out, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int ret = out(format, args);
+    va_end(args);
+    return ret;
+}
+
+static void writer_task(void *arg)
+{
+    int64_t stalled_since = 0;
+
+    while (1) {
+        uint32_t seq = written + 1;
+        vprintf_like_t out = __atomic_load_n(&console, __ATOMIC_ACQUIRE);
+        if (!out || seq - 1 == __atomic_load_n(&head, __ATOMIC_ACQUIRE)) {
+            vTaskDelay(pdMS_TO_TICKS(WRITER_POLL_MS));
+            continue;
+        }
+
+        const log_record_t *rec = &ring[(seq - 1) & RING_MASK];
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq) {
+            // Reserved but not published yet; skip it if its writer never finishes
+            int64_t now = esp_timer_get_time();
+            if (!stalled_since) {
+                stalled_since = now;
+            } else if (now - stalled_since > STALL_TIMEOUT_US) {
+                __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&written, seq, __ATOMIC_RELEASE);
+                stalled_since = 0;
+                continue;
+            }
+            vTaskDelay(1);
+            continue;
+        }
+        stalled_since = 0;
+
+        // Parts of a line are written back to back; only the end of what
+        // was logged with a newline gets one
+        console_printf(out, "%.*s%s", rec->len, rec->text, (rec->flags & LOG_SINK_NEWLINE) ? "\n" : "");
+        __atomic_store_n(&written, seq, __ATOMIC_RELEASE);
+    }
+}
+
+esp_err_t log_sink_init(void)
+{
+    if (ring) {
+        return ESP_OK;
+    }
+
+    ring = heap_caps_calloc(LOG_SINK_SIZE, sizeof(log_record_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!ring) {
+        ESP_LOGE(TAG, "Failed to allocate %d lines", LOG_SINK_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(writer_task, "log_sink", WRITER_STACK_SIZE, NULL,
+                    WRITER_PRIORITY, NULL) != pdPASS) {
+        heap_caps_free(ring);
+        ring = NULL;
+        ESP_LOGE(TAG, "Failed to create console task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    __atomic_store_n(&console, esp_log_set_vprintf(sink_vprintf), __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "Log sink: %d lines (%d bytes)", LOG_SINK_SIZE,
+             (int)(LOG_SINK_SIZE * sizeof(log_record_t)));
+    return ESP_OK;
+}
+
+size_t log_sink_read(uint32_t since, log_record_t *out, size_t max, uint32_t *last_seq)
+{
+    uint32_t newest = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    if (last_seq) {
+        *last_seq = newest;
+    }
+    if (!ring || since >= newest) {
+        return 0;
+    }
+
+    uint32_t first = since + 1;
+    if (newest - since > LOG_SINK_SIZE) {
+        first = newest - LOG_SINK_SIZE + 1;
+    }
+
+    size_t n = 0;
+    for (uint32_t seq = first; seq <= newest && n < max; seq++) {
+        const log_record_t *rec = &ring[(seq - 1) & RING_MASK];
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq) {
+            continue;
+        }
+        memcpy(&out[n], rec, sizeof(log_record_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&rec->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        out[n].seq = seq;
+        n++;
+    }
+    return n;
+}
+
+void log_sink_get_stats(log_sink_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(log_sink_stats_t));
+    stats->records = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    stats->written = __atomic_load_n(&written, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    stats->limited = __atomic_load_n(&limited, __ATOMIC_RELAXED);
+
+    taskENTER_CRITICAL(&bucket_lock);
+    for (int i = 0; i < bucket_count; i++) {
+        if (buckets[i].limited) {
+            log_tag_stats_t *t = &stats->tag[stats->tags++];
+            strlcpy(t->tag, buckets[i].tag, sizeof(t->tag));
+            t->limited = buckets[i].limited;
+        }
+    }
+    taskEXIT_CRITICAL(&bucket_lock);
+}
@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Asynchronous log sink: ESP_LOGx output goes to a lock-free ring in PSRAM
+ * and a low-priority task writes it to the console
+ */
+
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Ring capacity in records (power of two)
+#define LOG_SINK_SIZE       256
+
+// Text per record; longer lines continue in the following records
+#define LOG_SINK_LINE       120
+
+// Record flags
+#define LOG_SINK_MORE       0x01    // Text continues in the next record
+#define LOG_SINK_NEWLINE    0x02    // Output ended with a newline here
+
+// Per-tag rate limit of info/debug/verbose lines: bursts of LOG_SINK_TAG_BURST,
+// then LOG_SINK_TAG_RATE lines per second; warnings and errors always pass
+#define LOG_SINK_TAG_BURST  20
+#define LOG_SINK_TAG_RATE   10
+
+// Tags tracked by the rate limiter; further tags are not limited
+#define LOG_SINK_TAGS       16
+
+// One logged line, or one part of a longer one
+typedef struct {
+    uint32_t seq;               // Sequence number, starting at 1 (0 = slot being written)
+    uint16_t len;
+    char level;                 // 'E', 'W', 'I', 'D', 'V' or '?'
+    uint8_t flags;              // LOG_SINK_* flags
+    char text[LOG_SINK_LINE];   // Not terminated, newline stripped
+} log_record_t;
+
+typedef struct {
+    char tag[16];
+    uint32_t limited;           // Lines dropped by the rate limit
+} log_tag_stats_t;
+
+typedef struct {
+    uint32_t records;           // Records stored
+    uint32_t written;           // Records written to the console
+    uint32_t dropped;           // Lines lost because the console fell a full ring behind
+    uint32_t limited;           // Lines dropped by the per-tag rate limit
+    uint8_t tags;
+    log_tag_stats_t tag[LOG_SINK_TAGS];
+} log_sink_stats_t;
+
+/**
+ * @brief Allocate the ring, start the console task and install the sink
+ *
+ * From here on ESP_LOGx calls format into the ring and return without
+ * waiting for the UART.
+ *
+ * @return ESP_OK on success, error code otherwise (logging stays synchronous)
+ */
+esp_err_t log_sink_init(void);
+
+/**
+ * @brief Copy lines newer than a sequence number
+ *
+ * If lines after since have already been overwritten, the copy starts at
+ * the oldest line still kept.
+ *
+ * @param since Sequence number of the last line already seen (0 for all)
+ * @param out Array to fill
+ * @param max Capacity of out
+ * @param last_seq Set to the sequence number of the newest line (may be NULL)
+ * @return Number of lines copied
+ */
+size_t log_sink_read(uint32_t since, log_record_t *out, size_t max, uint32_t *last_seq);
+
+/**
+ * @brief Get log sink statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void log_sink_get_stats(log_sink_stats_t *stats);
+
+#endif // LOG_SINK_H
@@ -0,0 +1,105 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Change detection implementation
+ */
+
+#include "motion_gate.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "motion_gate";
+
+static uint8_t gate_threshold = 0;
+static uint16_t gate_refresh_interval = 1;
+static motion_gate_stats_t gate_stats;
+
+// Luma (0-255) of a big-endian RGB565 pixel
+static inline uint8_t pixel_luma(const uint8_t *p)
+{
+    uint8_t r = p[0] & 0xF8;
+    uint8_t g = ((p[0] & 0x07) << 5) | ((p[1] & 0xE0) >> 3);
+    uint8_t b = (p[1] & 0x1F) << 3;
+    return (uint8_t)((77 * r + 150 * g + 29 * b) >> 8);
+}
+
+// Average 2x2 pixel samples at the centre of each thumbnail cell
+static void build_thumbnail(const camera_fb_t *fb, uint8_t *thumb)
+{
+    const uint8_t *buf = fb->buf;
+    size_t stride = fb->width * 2;
+    size_t cell_w = fb->width / MOTION_THUMB_W;
+    size_t cell_h = fb->height / MOTION_THUMB_H;
+
+    for (int ty = 0; ty < MOTION_THUMB_H; ty++) {
+        size_t y = ty * cell_h + cell_h / 2;
+        const uint8_t *row0 = buf + y * stride;
+        const uint8_t *row1 = (y + 1 < fb->height) ? row0 + stride : row0;
+
+        for (int tx = 0; tx < MOTION_THUMB_W; tx++) {
+            size_t x = tx * cell_w + cell_w / 2;
+            size_t x1 = (x + 1 < fb->width) ? x + 1 : x;
+            uint16_t sum = pixel_luma(row0 + x * 2) + pixel_luma(row0 + x1 * 2) +
+                           pixel_luma(row1 + x * 2) + pixel_luma(row1 + x1 * 2);
+            thumb[ty * MOTION_THUMB_W + tx] = sum >> 2;
+        }
+    }
+}
+
+void motion_gate_configure(uint8_t threshold, uint16_t refresh_interval)
+{
+    gate_threshold = threshold;
+    gate_refresh_interval = refresh_interval ? refresh_interval : 1;
+    ESP_LOGI(TAG, "Threshold: %d, refresh interval: %d", gate_threshold, gate_refresh_interval);
+}
+
+void motion_gate_init(motion_gate_t *gate)
+{
+    if (gate) {
+        gate->valid = false;
+        gate->frames_skipped = 0;
+    }
+}
+
+bool motion_gate_check(motion_gate_t *gate, const camera_fb_t *fb)
+{
+    if (!gate || !fb || fb->format != PIXFORMAT_RGB565 ||
+        fb->width < MOTION_THUMB_W || fb->height < MOTION_THUMB_H) {
+        return true;
+    }
+
+    gate_stats.frames++;
+
+    if (gate_threshold == 0) {
+        return true;
+    }
+
+    uint8_t thumb[MOTION_THUMB_W * MOTION_THUMB_H];
+    build_thumbnail(fb, thumb);
+
+    uint32_t sad = 0;
+    for (int i = 0; i < MOTION_THUMB_W * MOTION_THUMB_H; i++) {
+        sad += abs((int)thumb[i] - (int)gate->thumb[i]);
+    }
+    uint8_t diff = sad / (MOTION_THUMB_W * MOTION_THUMB_H);
+    gate_stats.last_diff = diff;
+
+    if (gate->valid && diff < gate_threshold && gate->frames_skipped + 1 < gate_refresh_interval) {
+        gate->frames_skipped++;
+        gate_stats.skipped++;
+        return false;
+    }
+
+    memcpy(gate->thumb, thumb, sizeof(thumb));
+    gate->valid = true;
+    gate->frames_skipped = 0;
+    return true;
+}
+
+void motion_gate_get_stats(motion_gate_stats_t *stats)
+{
+    if (stats) {
+        memcpy(stats, &gate_stats, sizeof(motion_gate_stats_t));
+    }
+}
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Change detection on downsampled luma thumbnails to skip static frames
+ */
+
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include "esp_camera.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Thumbnail resolution used for change detection
+#define MOTION_THUMB_W  40
+#define MOTION_THUMB_H  30
+
+// Change detection state of one frame consumer
+typedef struct {
+    uint8_t thumb[MOTION_THUMB_W * MOTION_THUMB_H];
+    bool valid;                 // thumb holds the last processed frame
+    uint16_t frames_skipped;    // Consecutive frames skipped since the last refresh
+} motion_gate_t;
+
+// Gating statistics (all consumers)
+typedef struct {
+    uint32_t frames;            // Frames checked
+    uint32_t skipped;           // Frames found static and skipped
+    uint8_t last_diff;          // Mean luma difference of the last check
+} motion_gate_stats_t;
+
+/**
+ * @brief Set gating parameters
+ *
+ * @param threshold Mean thumbnail luma difference (0-255) that counts as a change; 0 disables gating
+ * @param refresh_interval Process at least every Nth frame even when static
+ */
+void motion_gate_configure(uint8_t threshold, uint16_t refresh_interval);
+
+/**
+ * @brief Reset a gate so the next frame is always processed
+ *
+ * @param gate Gate state
+ */
+void motion_gate_init(motion_gate_t *gate);
+
+/**
+ * @brief Compare a frame with the last processed one
+ *
+ * When the frame has to be processed its thumbnail becomes the new reference.
+ *
+ * @param gate Gate state
+ * @param fb RGB565 frame buffer
+ * @return true if the frame changed (or a refresh is due) and must be processed,
+ *         false if the previous results can be reused
+ */
+bool motion_gate_check(motion_gate_t *gate, const camera_fb_t *fb);
+
+/**
+ * @brief Get gating statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void motion_gate_get_stats(motion_gate_stats_t *stats);
+
+#endif // MOTION_GATE_H
@@ -0,0 +1,335 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * MQTT publisher implementation
+ */
+
+#include "mqtt_publisher.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "mqtt_client.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cJSON.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "mqtt_pub";
+
+#define PUBLISHER_STACK_SIZE    4096
+#define PUBLISHER_PRIORITY      2
+#define NETWORK_TIMEOUT_MS      2000
+#define MAX_WAIT_MS             1000
+
+typedef enum {
+    MSG_STATE = 0,              // Detection state changed
+    MSG_SUMMARY,                // Periodic summary
+} msg_type_t;
+
+typedef struct {
+    msg_type_t type;
+    int64_t queued_us;          // Time the message entered the queue
+    int64_t timestamp_us;       // Capture time (state) or end of the window (summary)
+    detection_result_t detection;   // Current result (state) or last detection (summary)
+    uint32_t frames;            // Summary: frames processed in the window
+    uint32_t detections;        // Summary: frames with a detection
+    uint8_t mean_confidence;    // Summary: mean confidence of the detections
+} mqtt_message_t;
+
+static QueueHandle_t queue = NULL;
+static SemaphoreHandle_t client_mutex = NULL;   // Guards client, topic and config
+static esp_mqtt_client_handle_t client = NULL;
+static mqtt_config_t current;
+static char topic[sizeof(current.topic) + 16];
+static volatile bool connected = false;
+static volatile bool enabled = false;
+static volatile uint16_t summary_interval = 0;
+
+// Summary window, updated from the detection path
+static portMUX_TYPE summary_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t window_frames = 0;
+static uint32_t window_detections = 0;
+static uint32_t window_confidence = 0;
+static detection_result_t window_last;
+static bool last_detected = false;
+
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static mqtt_publisher_stats_t stats;
+
+static void count_dropped(uint32_t n)
+{
+    taskENTER_CRITICAL(&stats_lock);
+    stats.dropped += n;
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+static void mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "Connected to broker");
+        connected = true;
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        ESP_LOGW(TAG, "Disconnected from broker");
+        connected = false;
+        break;
+    default:
+        break;
+    }
+}
+
+static cJSON *message_json(const mqtt_message_t *msg)
+{
+    const detection_result_t *d = &msg->detection;
+    cJSON *root = cJSON_CreateObject();
+
+    cJSON_AddStringToObject(root, "type", msg->type == MSG_STATE ? "state" : "summary");
+    cJSON_AddNumberToObject(root, "ts", (double)msg->timestamp_us);
+    if (msg->type == MSG_STATE) {
+        cJSON_AddBoolToObject(root, "detected", d->rgb_detected);
+        cJSON_AddNumberToObject(root, "confidence", d->confidence);
+    } else {
+        cJSON_AddNumberToObject(root, "frames", msg->frames);
+        cJSON_AddNumberToObject(root, "count", msg->detections);
+        cJSON_AddNumberToObject(root, "mean_confidence", msg->mean_confidence);
+    }
+    if (d->rgb_detected) {
+        cJSON *bbox = cJSON_CreateArray();
+        cJSON_AddItemToArray(bbox, cJSON_CreateNumber(d->bbox_x));
+        cJSON_AddItemToArray(bbox, cJSON_CreateNumber(d->bbox_y));
+        cJSON_AddItemToArray(bbox, cJSON_CreateNumber(d->bbox_w));
+        cJSON_AddItemToArray(bbox, cJSON_CreateNumber(d->bbox_h));
+        cJSON_AddItemToObject(root, "bbox", bbox);
+        cJSON_AddNumberToObject(root, "sequence", d->sequence);
+        cJSON_AddNumberToObject(root, "angle", d->angle);
+    }
+    return root;
+}
+
+// Publish messages as one payload: an object, or an array for a batch
+static void publish_batch(const mqtt_message_t *batch, int n)
+{
+    bool ok = false;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    if (client && connected) {
+        cJSON *payload;
+        if (n == 1) {
+            payload = message_json(&batch[0]);
+        } else {
+            payload = cJSON_CreateArray();
+            for (int i = 0; i < n; i++) {
+                cJSON_AddItemToArray(payload, message_json(&batch[i]));
+            }
+        }
+        char *json = cJSON_PrintUnformatted(payload);
+        cJSON_Delete(payload);
+        if (json) {
+            ok = esp_mqtt_client_publish(client, topic, json, 0, 0, 0) >= 0;
+            free(json);
+        }
+    }
+    xSemaphoreGive(client_mutex);
+
+    if (!ok) {
+        count_dropped(n);
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&stats_lock);
+    stats.published += n;
+    stats.batches++;
+    for (int i = 0; i < n; i++) {
+        uint32_t latency = now - batch[i].queued_us;
+        stats.latency_us = stats.latency_us ? (stats.latency_us * 7 + latency) / 8 : latency;
+        if (latency > stats.max_latency_us) {
+            stats.max_latency_us = latency;
+        }
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+// Close the current summary window into msg
+static void summary_take(mqtt_message_t *msg, int64_t now)
+{
+    memset(msg, 0, sizeof(*msg));
+    msg->type = MSG_SUMMARY;
+    msg->queued_us = now;
+    msg->timestamp_us = now;
+
+    taskENTER_CRITICAL(&summary_lock);
+    msg->frames = window_frames;
+    msg->detections = window_detections;
+    msg->mean_confidence = window_detections ? window_confidence / window_detections : 0;
+    msg->detection = window_last;
+    window_frames = 0;
+    window_detections = 0;
+    window_confidence = 0;
+    memset(&window_last, 0, sizeof(window_last));
+    taskEXIT_CRITICAL(&summary_lock);
+}
+
+static void publisher_task(void *arg)
+{
+    mqtt_message_t batch[MQTT_BATCH_MAX];
+    uint16_t interval = 0;
+    int64_t next_summary = 0;
+
+    while (1) {
+        int64_t now = esp_timer_get_time();
+        if (interval != summary_interval) {
+            interval = summary_interval;
+            next_summary = now + interval * 1000000LL;
+        }
+
+        int64_t wait_ms = MAX_WAIT_MS;
+        if (interval && (next_summary - now) / 1000 < wait_ms) {
+            wait_ms = next_summary > now ? (next_summary - now) / 1000 : 0;
+        }
+
+        int n = 0;
+        if (xQueueReceive(queue, &batch[0], pdMS_TO_TICKS(wait_ms)) == pdTRUE) {
+            n = 1;
+            // Combine a burst into a single publish
+            while (n < MQTT_BATCH_MAX && xQueueReceive(queue, &batch[n], 0) == pdTRUE) {
+                n++;
+            }
+        }
+
+        now = esp_timer_get_time();
+        if (interval && now >= next_summary) {
+            if (n == MQTT_BATCH_MAX) {
+                publish_batch(batch, n);
+                n = 0;
+            }
+            if (enabled) {
+                summary_take(&batch[n++], now);
+            }
+            next_summary = now + interval * 1000000LL;
+        }
+
+        if (n > 0) {
+            publish_batch(batch, n);
+        }
+    }
+}
+
+esp_err_t mqtt_publisher_configure(const mqtt_config_t *config)
+{
+    if (!config || !client_mutex) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(client_mutex, portMAX_DELAY);
+    if (client) {
+        esp_mqtt_client_destroy(client);
+        client = NULL;
+        connected = false;
+    }
+
+    memcpy(&current, config, sizeof(mqtt_config_t));
+    snprintf(topic, sizeof(topic), "%s/detection", current.topic);
+
+    if (current.enabled && current.uri[0]) {
+        esp_mqtt_client_config_t mqtt_cfg = {
+            .broker.address.uri = current.uri,
+            .network.timeout_ms = NETWORK_TIMEOUT_MS,
+        };
+        client = esp_mqtt_client_init(&mqtt_cfg);
+        if (!client) {
+            ret = ESP_FAIL;
+        } else {
+            esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+            ret = esp_mqtt_client_start(client);
+            if (ret != ESP_OK) {
+                esp_mqtt_client_destroy(client);
+                client = NULL;
+            }
+        }
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "Publishing to %s on %s", topic, current.uri);
+        } else {
+            ESP_LOGE(TAG, "Failed to start MQTT client for %s", current.uri);
+        }
+    }
+
+    enabled = client != NULL;
+    summary_interval = current.summary_interval;
+    xSemaphoreGive(client_mutex);
+
+    return ret;
+}
+
+esp_err_t mqtt_publisher_start(const mqtt_config_t *config)
+{
+    if (!queue) {
+        queue = xQueueCreate(MQTT_QUEUE_LENGTH, sizeof(mqtt_message_t));
+        client_mutex = xSemaphoreCreateMutex();
+        if (!queue || !client_mutex) {
+            ESP_LOGE(TAG, "Failed to create queue");
+            return ESP_ERR_NO_MEM;
+        }
+
+        if (xTaskCreate(publisher_task, "mqtt_pub", PUBLISHER_STACK_SIZE, NULL,
+                        PUBLISHER_PRIORITY, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create publisher task");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    return mqtt_publisher_configure(config);
+}
+
+void mqtt_publisher_report(const detection_result_t *result, int64_t timestamp_us)
+{
+    if (!enabled || !result) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&summary_lock);
+    window_frames++;
+    if (result->rgb_detected) {
+        window_detections++;
+        window_confidence += result->confidence;
+        window_last = *result;
+    }
+    bool changed = result->rgb_detected != last_detected;
+    last_detected = result->rgb_detected;
+    taskEXIT_CRITICAL(&summary_lock);
+
+    if (!changed) {
+        return;
+    }
+
+    mqtt_message_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = MSG_STATE;
+    msg.queued_us = esp_timer_get_time();
+    msg.timestamp_us = timestamp_us;
+    msg.detection = *result;
+
+    if (xQueueSend(queue, &msg, 0) == pdTRUE) {
+        taskENTER_CRITICAL(&stats_lock);
+        stats.queued++;
+        taskEXIT_CRITICAL(&stats_lock);
+    } else {
+        count_dropped(1);
+    }
+}
+
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(out, &stats, sizeof(mqtt_publisher_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+        out->connected = connected;
+    }
+}
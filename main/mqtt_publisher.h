@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Optional MQTT publisher for detection state changes and periodic summaries
+ */
+
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include "color_detect.h"
+#include "config_store.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Outbound queue depth and maximum messages combined into one publish
+#define MQTT_QUEUE_LENGTH   16
+#define MQTT_BATCH_MAX      8
+
+// Publisher statistics
+typedef struct {
+    bool connected;             // Connected to the broker
+    uint32_t queued;            // Messages accepted into the outbound queue
+    uint32_t published;         // Messages published
+    uint32_t batches;           // Publishes (one per batch)
+    uint32_t dropped;           // Messages lost to a full queue or an unavailable broker
+    uint32_t latency_us;        // Running average report-to-publish latency
+    uint32_t max_latency_us;    // Largest report-to-publish latency
+} mqtt_publisher_stats_t;
+
+/**
+ * @brief Start the publisher task and connect if enabled
+ *
+ * @param config MQTT configuration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publisher_start(const mqtt_config_t *config);
+
+/**
+ * @brief Apply a new configuration, reconnecting to the broker if needed
+ *
+ * @param config MQTT configuration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t mqtt_publisher_configure(const mqtt_config_t *config);
+
+/**
+ * @brief Report the result of a processed frame
+ *
+ * Called from the detection path: only updates the summary and, when the
+ * detection state changed, queues an event without waiting. Messages that
+ * do not fit in the queue are dropped and counted.
+ *
+ * @param result Detection result
+ * @param timestamp_us Capture time of the frame
+ */
+void mqtt_publisher_report(const detection_result_t *result, int64_t timestamp_us);
+
+/**
+ * @brief Get publisher statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void mqtt_publisher_get_stats(mqtt_publisher_stats_t *stats);
+
+#endif // MQTT_PUBLISHER_H
@@ -0,0 +1,118 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Dual-core worker pool implementation
+ */
+
+#include "parallel_worker.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static const char *TAG = "parallel";
+
+#define WORKER_STACK_SIZE   4096
+#define WORKER_PRIORITY     5
+
+static TaskHandle_t workers[PARALLEL_WORKER_COUNT];
+static EventGroupHandle_t done_group = NULL;
+static SemaphoreHandle_t run_mutex = NULL;
+static bool initialized = false;    // All workers running; jobs run inline until then
+
+// Current job, written by parallel_worker_run before the workers are notified
+static parallel_job_fn_t job_fn;
+static void *job_ctx;
+
+static void worker_task(void *arg)
+{
+    int part = (int)(intptr_t)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        job_fn(job_ctx, part, PARALLEL_WORKER_COUNT);
+        xEventGroupSetBits(done_group, 1 << part);
+    }
+}
+
+// Undo a partial init so a later call can start over
+static void worker_cleanup(void)
+{
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        if (workers[i]) {
+            vTaskDelete(workers[i]);
+            workers[i] = NULL;
+        }
+    }
+    if (done_group) {
+        vEventGroupDelete(done_group);
+        done_group = NULL;
+    }
+    if (run_mutex) {
+        vSemaphoreDelete(run_mutex);
+        run_mutex = NULL;
+    }
+}
+
+esp_err_t parallel_worker_init(void)
+{
+    if (initialized) {
+        return ESP_OK;
+    }
+
+    done_group = xEventGroupCreate();
+    run_mutex = xSemaphoreCreateMutex();
+    if (!done_group || !run_mutex) {
+        ESP_LOGE(TAG, "Failed to create synchronization objects");
+        worker_cleanup();
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        char name[12];
+        snprintf(name, sizeof(name), "worker%d", i);
+        if (xTaskCreatePinnedToCore(worker_task, name, WORKER_STACK_SIZE, (void *)(intptr_t)i,
+                                    WORKER_PRIORITY, &workers[i], i) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create worker task %d", i);
+            workers[i] = NULL;
+            worker_cleanup();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    initialized = true;
+    ESP_LOGI(TAG, "%d workers started", PARALLEL_WORKER_COUNT);
+    return ESP_OK;
+}
+
+esp_err_t parallel_worker_run(parallel_job_fn_t fn, void *ctx)
+{
+    if (!fn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!initialized) {
+        for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+            fn(ctx, i, PARALLEL_WORKER_COUNT);
+        }
+        return ESP_OK;
+    }
+
+    const EventBits_t all_bits = (1 << PARALLEL_WORKER_COUNT) - 1;
+
+    xSemaphoreTake(run_mutex, portMAX_DELAY);
+    job_fn = fn;
+    job_ctx = ctx;
+    xEventGroupClearBits(done_group, all_bits);
+    for (int i = 0; i < PARALLEL_WORKER_COUNT; i++) {
+        xTaskNotifyGive(workers[i]);
+    }
+    xEventGroupWaitBits(done_group, all_bits, pdTRUE, pdTRUE, portMAX_DELAY);
+    xSemaphoreGive(run_mutex);
+
+    return ESP_OK;
+}
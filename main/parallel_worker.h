@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Dual-core worker pool for splitting frame work across both ESP32-S3 cores
+ */
+
+#ifndef PARALLEL_WORKER_H
+#define PARALLEL_WORKER_H
+
+#include "esp_err.h"
+
+// One worker task pinned to each core
+#define PARALLEL_WORKER_COUNT   2
+
+/**
+ * @brief Job function executed once on every worker
+ *
+ * @param ctx Job context passed to parallel_worker_run
+ * @param part Index of this worker (0 .. num_parts-1)
+ * @param num_parts Total number of workers running the job
+ */
+typedef void (*parallel_job_fn_t)(void *ctx, int part, int num_parts);
+
+/**
+ * @brief Create the worker tasks (one pinned to each core)
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t parallel_worker_init(void);
+
+/**
+ * @brief Run a job on all workers and wait for every part to finish
+ *
+ * Calls from different tasks are serialized. If the pool is not initialized
+ * the job runs sequentially on the calling task.
+ *
+ * @param fn Job function
+ * @param ctx Job context
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t parallel_worker_run(parallel_job_fn_t fn, void *ctx);
+
+#endif // PARALLEL_WORKER_H
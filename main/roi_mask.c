@@ -0,0 +1,194 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Region of interest masks compiled into per-row pixel spans
+ */
+
+#include "roi_mask.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+esp_err_t roi_mask_validate(const mask_config_t *config)
+{
+    if (!config || config->region_count > MASK_MAX_REGIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < config->region_count; i++) {
+        const mask_region_t *r = &config->regions[i];
+        if (r->mode > MASK_INCLUDE || r->shape > MASK_POLYGON ||
+            (r->shape == MASK_RECT && r->point_count != 2) ||
+            (r->shape == MASK_POLYGON && (r->point_count < 3 || r->point_count > MASK_MAX_POINTS))) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (int p = 0; p < r->point_count; p++) {
+            if (r->points[p].x > MASK_SCALE || r->points[p].y > MASK_SCALE) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// Set the pixels whose centers lie in [xa, xb)
+static void mark(uint8_t *line, uint16_t width, float xa, float xb, uint8_t value)
+{
+    int x0 = ceilf(xa - 0.5f), x1 = ceilf(xb - 0.5f);
+    if (x0 < 0) x0 = 0;
+    if (x1 > width) x1 = width;
+    if (x1 > x0) {
+        memset(line + x0, value, x1 - x0);
+    }
+}
+
+// Mark the pixels of one row covered by a region, sampled at the row center
+static void mark_region(uint8_t *line, const mask_region_t *r, uint16_t width, uint16_t height,
+                        float yc, uint8_t value)
+{
+    float sx = (float)width / MASK_SCALE, sy = (float)height / MASK_SCALE;
+
+    if (r->shape == MASK_RECT) {
+        float ya = fminf(r->points[0].y, r->points[1].y) * sy;
+        float yb = fmaxf(r->points[0].y, r->points[1].y) * sy;
+        if (yc >= ya && yc < yb) {
+            mark(line, width, fminf(r->points[0].x, r->points[1].x) * sx,
+                 fmaxf(r->points[0].x, r->points[1].x) * sx, value);
+        }
+        return;
+    }
+
+    // Even-odd rule: edges crossing the row, paired left to right
+    float xs[MASK_MAX_POINTS];
+    int n = 0;
+    for (int i = 0; i < r->point_count; i++) {
+        const mask_point_t *a = &r->points[i];
+        const mask_point_t *b = &r->points[(i + 1) % r->point_count];
+        float ay = a->y * sy, by = b->y * sy;
+        if ((ay <= yc) != (by <= yc)) {
+            xs[n++] = (a->x + (yc - ay) / (by - ay) * (b->x - a->x)) * sx;
+        }
+    }
+    qsort(xs, n, sizeof(float), compare_float);
+    for (int i = 0; i + 1 < n; i += 2) {
+        mark(line, width, xs[i], xs[i + 1], value);
+    }
+}
+
+static void rasterize_row(const mask_config_t *config, uint16_t width, uint16_t height,
+                          uint16_t y, uint8_t *line)
+{
+    bool has_include = false;
+    for (int i = 0; i < config->region_count; i++) {
+        has_include |= config->regions[i].mode == MASK_INCLUDE;
+    }
+
+    float yc = y + 0.5f;
+    memset(line, has_include ? 0 : 1, width);
+    for (int i = 0; i < config->region_count; i++) {
+        if (config->regions[i].mode == MASK_INCLUDE) {
+            mark_region(line, &config->regions[i], width, height, yc, 1);
+        }
+    }
+    for (int i = 0; i < config->region_count; i++) {
+        if (config->regions[i].mode == MASK_EXCLUDE) {
+            mark_region(line, &config->regions[i], width, height, yc, 0);
+        }
+    }
+}
+
+// Runs of active pixels in a row; spans may be NULL to count them only
+static uint32_t row_spans(const uint8_t *line, uint16_t width, mask_span_t *spans, uint32_t *pixels)
+{
+    uint32_t count = 0;
+    for (int x = 0; x < width;) {
+        if (!line[x]) {
+            x++;
+            continue;
+        }
+        int x0 = x;
+        while (x < width && line[x]) {
+            x++;
+        }
+        if (spans) {
+            spans[count] = (mask_span_t){ .x0 = x0, .x1 = x };
+        }
+        *pixels += x - x0;
+        count++;
+    }
+    return count;
+}
+
+void roi_mask_free(roi_mask_t *mask)
+{
+    heap_caps_free(mask->row_start);
+    heap_caps_free(mask->spans);
+    memset(mask, 0, sizeof(roi_mask_t));
+}
+
+esp_err_t roi_mask_compile(const mask_config_t *config, uint16_t width, uint16_t height,
+                           roi_mask_t *mask)
+{
+    if (roi_mask_validate(config) != ESP_OK || config->region_count == 0 || !mask) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    roi_mask_free(mask);
+
+    // The scan loop reads the spans of every row: keep them in internal RAM
+    uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    uint8_t *line = malloc(width);
+    mask->row_start = heap_caps_malloc((height + 1) * sizeof(uint32_t), caps);
+    if (!line || !mask->row_start) {
+        free(line);
+        roi_mask_free(mask);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Count the spans, then rasterize again to fill them in
+    uint32_t total = 0, pixels = 0;
+    for (uint16_t y = 0; y < height; y++) {
+        rasterize_row(config, width, height, y, line);
+        mask->row_start[y] = total;
+        total += row_spans(line, width, NULL, &pixels);
+    }
+    mask->row_start[height] = total;
+
+    mask->spans = heap_caps_malloc((total ? total : 1) * sizeof(mask_span_t), caps);
+    if (!mask->spans) {
+        free(line);
+        roi_mask_free(mask);
+        return ESP_ERR_NO_MEM;
+    }
+
+    mask->first_row = height;
+    mask->end_row = 0;
+    for (uint16_t y = 0; y < height; y++) {
+        if (mask->row_start[y + 1] == mask->row_start[y]) {
+            continue;
+        }
+        uint32_t unused = 0;
+        rasterize_row(config, width, height, y, line);
+        row_spans(line, width, mask->spans + mask->row_start[y], &unused);
+        if (mask->first_row == height) {
+            mask->first_row = y;
+        }
+        mask->end_row = y + 1;
+    }
+    free(line);
+
+    mask->width = width;
+    mask->height = height;
+    mask->active_pixels = pixels;
+    if (mask->first_row > mask->end_row) {
+        mask->first_row = mask->end_row;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Region of interest masks compiled into per-row pixel spans
+ */
+
+#ifndef ROI_MASK_H
+#define ROI_MASK_H
+
+#include "config_store.h"
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Active pixels [x0, x1) of one row
+typedef struct {
+    uint16_t x0;
+    uint16_t x1;
+} mask_span_t;
+
+// Compiled mask for one frame size. Row y's spans are
+// spans[row_start[y]] .. spans[row_start[y + 1] - 1], left to right.
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint16_t first_row;         // Rows outside [first_row, end_row) have no spans
+    uint16_t end_row;
+    uint32_t active_pixels;
+    uint32_t *row_start;        // height + 1 entries
+    mask_span_t *spans;
+} roi_mask_t;
+
+/**
+ * @brief Check a mask description
+ *
+ * Needs up to MASK_MAX_REGIONS regions: rectangles with 2 corners and
+ * polygons with 3..MASK_MAX_POINTS vertices, coordinates 0..MASK_SCALE.
+ *
+ * @param config Mask description
+ * @return ESP_OK if valid, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t roi_mask_validate(const mask_config_t *config);
+
+/**
+ * @brief Compile a mask description for a frame size
+ *
+ * A pixel is active when its center lies inside an include region (or
+ * there are none) and inside no exclude region. Replaces the spans of a
+ * previous compilation.
+ *
+ * @param config Mask description with at least one region
+ * @param width Frame width
+ * @param height Frame height
+ * @param mask Compiled mask (zero-initialized before the first call)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if the description is
+ *         invalid, ESP_ERR_NO_MEM if the spans cannot be allocated
+ */
+esp_err_t roi_mask_compile(const mask_config_t *config, uint16_t width, uint16_t height,
+                           roi_mask_t *mask);
+
+/**
+ * @brief Release the spans of a compiled mask
+ *
+ * @param mask Compiled mask
+ */
+void roi_mask_free(roi_mask_t *mask);
+
+#endif // ROI_MASK_H
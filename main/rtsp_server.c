@@ -0,0 +1,816 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * RTSP server implementation
+ */
+
+#include "rtsp_server.h"
+#include "frame_pipeline.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "rtsp_server";
+
+#define RTSP_STACK_SIZE     6144
+#define RTSP_PRIORITY       4
+#define POLL_TIMEOUT_MS     5
+
+#define RTSP_RX_SIZE        1024
+#define RTSP_TX_SIZE        768
+#define SESSION_TIMEOUT_S   60
+#define SEND_TIMEOUT_MS     500         // RTSP replies only; RTP never blocks
+
+#define RTP_PORT_BASE       6970        // Server RTP/RTCP port pair per session slot
+#define RTP_PAYLOAD_JPEG    26
+#define RTP_MAX_PACKET      1400        // RTP header and payload, fits one Wi-Fi frame
+#define RTP_HEADER_SIZE     12
+#define UDP_SEND_RETRIES    3
+
+// JPEG markers used by the RTP/JPEG packetizer
+#define M_SOF0  0xC0
+#define M_SOI   0xD8
+#define M_EOI   0xD9
+#define M_SOS   0xDA
+#define M_DQT   0xDB
+#define M_DRI   0xDD
+
+// Scan and parameters of a baseline JPEG as carried by RFC 2435
+typedef struct {
+    uint8_t type;               // 0: 4:2:2, 1: 4:2:0 (+64 with restart markers)
+    uint8_t width8;             // Width / 8
+    uint8_t height8;            // Height / 8
+    uint16_t dri;               // Restart interval in MCUs, 0 if none
+    const uint8_t *qt[2];       // Luma/chroma quantization tables (zigzag order)
+    const uint8_t *scan;        // Entropy-coded data after the SOS header
+    size_t scan_len;            // Without the trailing EOI
+} rtp_jpeg_t;
+
+typedef struct {
+    bool active;
+    int fd;                     // RTSP connection
+    char rx[RTSP_RX_SIZE];
+    size_t rx_len;
+    uint32_t session_id;
+    bool setup;
+    bool playing;
+    bool tcp;                   // RTP interleaved on the RTSP connection
+    uint8_t channel;            // Interleaved RTP channel
+    uint8_t pending[4 + RTP_MAX_PACKET];    // Rest of a packet the socket took only part of
+    size_t pending_off;
+    size_t pending_len;
+    int rtp_fd;                 // UDP sockets (-1 when interleaved)
+    int rtcp_fd;
+    uint16_t rtp_seq;
+    uint32_t ssrc;
+    uint32_t frame_seq;         // Pipeline sequence of the last frame taken
+    int64_t last_timestamp;     // Capture time of the last frame sent
+    int64_t last_activity_us;
+} rtsp_session_t;
+
+typedef enum {
+    RTP_SENT,
+    RTP_BUSY,                   // Transmit queue full: the rest of the frame is dropped
+    RTP_FAILED,                 // Connection lost
+} rtp_result_t;
+
+static rtsp_session_t sessions[RTSP_MAX_SESSIONS];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static rtsp_server_stats_t stats;
+static uint8_t packet[4 + RTP_MAX_PACKET];     // Interleave prefix + RTP packet
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+// Locate the parameters and scan data of a baseline JPEG. Only what RFC 2435
+// can describe without in-band headers is accepted: 8-bit tables, three
+// components and 2x1 or 2x2 luma sampling.
+static bool jpeg_parse(const uint8_t *data, size_t len, rtp_jpeg_t *j)
+{
+    memset(j, 0, sizeof(*j));
+
+    if (len < 4 || data[0] != 0xFF || data[1] != M_SOI) {
+        return false;
+    }
+
+    bool have_sof = false;
+    size_t pos = 2;
+    while (pos + 4 <= len) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        size_t seg_len = get_u16(data + pos + 2);
+        const uint8_t *seg = data + pos + 4;
+        if (seg_len < 2 || pos + 2 + seg_len > len) {
+            return false;
+        }
+        size_t n = seg_len - 2;
+
+        switch (marker) {
+        case M_DQT:
+            for (size_t i = 0; i + 65 <= n; i += 65) {
+                uint8_t id = seg[i] & 0x0F;
+                if ((seg[i] >> 4) != 0 || id > 1) {
+                    return false;
+                }
+                j->qt[id] = seg + i + 1;
+            }
+            break;
+
+        case M_SOF0: {
+            if (n < 15 || seg[0] != 8 || seg[5] != 3) {
+                return false;
+            }
+            uint16_t height = get_u16(seg + 1);
+            uint16_t width = get_u16(seg + 3);
+            if (width == 0 || height == 0 || width > 2040 || height > 2040) {
+                return false;
+            }
+            if (seg[7] == 0x21) {
+                j->type = 0;
+            } else if (seg[7] == 0x22) {
+                j->type = 1;
+            } else {
+                return false;
+            }
+            if (seg[10] != 0x11 || seg[13] != 0x11) {
+                return false;
+            }
+            j->width8 = (width + 7) / 8;
+            j->height8 = (height + 7) / 8;
+            have_sof = true;
+            break;
+        }
+
+        case M_DRI:
+            if (n < 2) {
+                return false;
+            }
+            j->dri = get_u16(seg);
+            break;
+
+        case M_SOS:
+            if (!have_sof || !j->qt[0] || !j->qt[1]) {
+                return false;
+            }
+            j->scan = seg + n;
+            j->scan_len = len - (j->scan - data);
+            if (j->scan_len >= 2 && j->scan[j->scan_len - 2] == 0xFF &&
+                j->scan[j->scan_len - 1] == M_EOI) {
+                j->scan_len -= 2;
+            }
+            return true;
+
+        default:
+            if (marker >= 0xC1 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 &&
+                marker != 0xCC) {
+                return false;       // Not baseline
+            }
+            break;
+        }
+
+        pos += 2 + seg_len;
+    }
+
+    return false;
+}
+
+static bool send_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, 0);
+        if (n < 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Finish an interleaved packet the socket took only part of, without blocking
+static rtp_result_t tcp_flush(rtsp_session_t *s)
+{
+    while (s->pending_len) {
+        ssize_t n = send(s->fd, s->pending + s->pending_off, s->pending_len, MSG_DONTWAIT);
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? RTP_BUSY : RTP_FAILED;
+        }
+        s->pending_off += n;
+        s->pending_len -= n;
+    }
+    return RTP_SENT;
+}
+
+// RTSP replies share the connection with interleaved RTP, so a packet
+// already started goes out first
+static bool send_reply(rtsp_session_t *s, const char *tx, size_t len)
+{
+    if (s->pending_len && !send_all(s->fd, s->pending + s->pending_off, s->pending_len)) {
+        return false;
+    }
+    s->pending_len = 0;
+    return send_all(s->fd, tx, len);
+}
+
+static rtp_result_t send_rtp(rtsp_session_t *s, size_t len)
+{
+    if (s->tcp) {
+        // Like the stream sender: one slow viewer must not hold up the
+        // others, so a full socket drops the frame instead of waiting
+        rtp_result_t result = tcp_flush(s);
+        if (result != RTP_SENT) {
+            return result;
+        }
+        packet[0] = '$';
+        packet[1] = s->channel;
+        packet[2] = len >> 8;
+        packet[3] = len;
+        ssize_t n = send(s->fd, packet, len + 4, MSG_DONTWAIT);
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? RTP_BUSY : RTP_FAILED;
+        }
+        if ((size_t)n < len + 4) {
+            memcpy(s->pending, packet + n, len + 4 - n);
+            s->pending_off = 0;
+            s->pending_len = len + 4 - n;
+        }
+        return RTP_SENT;
+    }
+
+    // lwIP reports a full transmit queue as ENOMEM rather than blocking
+    for (int retry = 0; retry < UDP_SEND_RETRIES; retry++) {
+        if (send(s->rtp_fd, packet + 4, len, 0) >= 0) {
+            return RTP_SENT;
+        }
+        if (errno != ENOMEM && errno != EAGAIN) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    return RTP_BUSY;
+}
+
+// Packetize one frame. Returns false only if the session must be closed.
+static bool send_frame(rtsp_session_t *s, const pipeline_frame_t *frame)
+{
+    rtp_jpeg_t j;
+    if (!jpeg_parse(frame->jpeg, frame->jpeg_len, &j)) {
+        taskENTER_CRITICAL(&stats_lock);
+        stats.frames_unsupported++;
+        taskEXIT_CRITICAL(&stats_lock);
+        return true;
+    }
+
+    // Repeated frames keep their capture time, so the RTP clock follows the
+    // send time to keep every frame distinct for the receiver
+    uint32_t rtp_ts = (uint32_t)(esp_timer_get_time() * 9 / 100);
+    uint32_t packets = 0, bytes = 0;
+    size_t offset = 0;
+
+    while (offset < j.scan_len) {
+        uint8_t *p = packet + 4;
+
+        p[0] = 0x80;                            // V=2
+        p[1] = RTP_PAYLOAD_JPEG;
+        p[2] = s->rtp_seq >> 8;
+        p[3] = s->rtp_seq;
+        p[4] = rtp_ts >> 24;
+        p[5] = rtp_ts >> 16;
+        p[6] = rtp_ts >> 8;
+        p[7] = rtp_ts;
+        p[8] = s->ssrc >> 24;
+        p[9] = s->ssrc >> 16;
+        p[10] = s->ssrc >> 8;
+        p[11] = s->ssrc;
+
+        // Main JPEG header, Q=255: quantization tables sent in-band
+        uint8_t *h = p + RTP_HEADER_SIZE;
+        h[0] = 0;
+        h[1] = offset >> 16;
+        h[2] = offset >> 8;
+        h[3] = offset;
+        h[4] = j.type | (j.dri ? 64 : 0);
+        h[5] = 255;
+        h[6] = j.width8;
+        h[7] = j.height8;
+        size_t hlen = RTP_HEADER_SIZE + 8;
+
+        if (j.dri) {
+            // Packets may start inside a restart interval: F=L=1, count 0x3FFF
+            p[hlen++] = j.dri >> 8;
+            p[hlen++] = j.dri;
+            p[hlen++] = 0xFF;
+            p[hlen++] = 0xFF;
+        }
+
+        if (offset == 0) {
+            p[hlen++] = 0;                      // MBZ
+            p[hlen++] = 0;                      // 8-bit tables
+            p[hlen++] = 0;
+            p[hlen++] = 128;
+            memcpy(p + hlen, j.qt[0], 64);
+            memcpy(p + hlen + 64, j.qt[1], 64);
+            hlen += 128;
+        }
+
+        size_t chunk = j.scan_len - offset;
+        if (chunk > RTP_MAX_PACKET - hlen) {
+            chunk = RTP_MAX_PACKET - hlen;
+        }
+        memcpy(p + hlen, j.scan + offset, chunk);
+        offset += chunk;
+        if (offset == j.scan_len) {
+            p[1] |= 0x80;                       // Marker: last packet of the frame
+        }
+
+        // Packets not sent take no sequence number, so receivers only
+        // see an unfinished frame, not loss
+        rtp_result_t result = send_rtp(s, hlen + chunk);
+        if (result != RTP_SENT) {
+            taskENTER_CRITICAL(&stats_lock);
+            stats.frames_dropped++;
+            stats.packets_sent += packets;
+            stats.bytes_sent += bytes;
+            taskEXIT_CRITICAL(&stats_lock);
+            return result != RTP_FAILED;
+        }
+        s->rtp_seq++;
+        packets++;
+        bytes += hlen + chunk;
+    }
+
+    int64_t now = esp_timer_get_time();
+    taskENTER_CRITICAL(&stats_lock);
+    stats.frames_sent++;
+    stats.packets_sent += packets;
+    stats.bytes_sent += bytes;
+    if (frame->timestamp_us != s->last_timestamp) {
+        uint32_t latency = now - frame->timestamp_us;
+        stats.latency_us = stats.latency_us ? (stats.latency_us * 7 + latency) / 8 : latency;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+    s->last_timestamp = frame->timestamp_us;
+
+    return true;
+}
+
+static void session_close(rtsp_session_t *s)
+{
+    if (s->playing) {
+        frame_pipeline_remove_consumer(PIPELINE_VIEW_COLOR);
+        taskENTER_CRITICAL(&stats_lock);
+        stats.sessions--;
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+    if (s->rtp_fd >= 0) {
+        close(s->rtp_fd);
+    }
+    if (s->rtcp_fd >= 0) {
+        close(s->rtcp_fd);
+    }
+    close(s->fd);
+
+    ESP_LOGI(TAG, "Session %08lX closed", (unsigned long)s->session_id);
+    s->active = false;
+}
+
+// Value of a request header (case-insensitive name), copied into out
+static bool header_value(const char *req, const char *name, char *out, size_t out_len)
+{
+    size_t name_len = strlen(name);
+    const char *line = strstr(req, "\r\n");
+
+    while (line && line[2] != '\r') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *v = line + name_len + 1;
+            while (*v == ' ') {
+                v++;
+            }
+            size_t n = strcspn(v, "\r\n");
+            if (n >= out_len) {
+                n = out_len - 1;
+            }
+            memcpy(out, v, n);
+            out[n] = '\0';
+            return true;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return false;
+}
+
+static int open_udp(uint16_t local_port, const struct sockaddr_in *peer, uint16_t peer_port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(local_port);
+
+    struct sockaddr_in dest = *peer;
+    dest.sin_port = htons(peer_port);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        connect(fd, (struct sockaddr *)&dest, sizeof(dest)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool setup_transport(rtsp_session_t *s, const char *transport, char *reply, size_t reply_len)
+{
+    int a, b;
+    const char *p;
+
+    if (strstr(transport, "RTP/AVP/TCP")) {
+        a = 0;
+        b = 1;
+        if ((p = strstr(transport, "interleaved="))) {
+            sscanf(p, "interleaved=%d-%d", &a, &b);
+        }
+        s->tcp = true;
+        s->channel = a;
+        snprintf(reply, reply_len, "RTP/AVP/TCP;unicast;interleaved=%d-%d", a, b);
+        return true;
+    }
+
+    if (!(p = strstr(transport, "client_port=")) || sscanf(p, "client_port=%d-%d", &a, &b) != 2) {
+        return false;
+    }
+
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(s->fd, (struct sockaddr *)&peer, &peer_len) != 0) {
+        return false;
+    }
+
+    uint16_t server_port = RTP_PORT_BASE + 2 * (s - sessions);
+    s->rtp_fd = open_udp(server_port, &peer, a);
+    s->rtcp_fd = open_udp(server_port + 1, &peer, b);
+    if (s->rtp_fd < 0 || s->rtcp_fd < 0) {
+        ESP_LOGE(TAG, "Failed to open RTP ports %u-%u", server_port, server_port + 1);
+        return false;
+    }
+
+    s->tcp = false;
+    snprintf(reply, reply_len, "RTP/AVP;unicast;client_port=%d-%d;server_port=%u-%u;ssrc=%08lX",
+             a, b, server_port, server_port + 1, (unsigned long)s->ssrc);
+    return true;
+}
+
+// Handle one complete request. Returns false if the connection must be closed.
+static bool handle_request(rtsp_session_t *s, char *req)
+{
+    char method[16], url[256], cseq[16], transport[128];
+    char tx[RTSP_TX_SIZE];
+    int len;
+
+    if (sscanf(req, "%15s %255s", method, url) != 2) {
+        return false;
+    }
+    if (!header_value(req, "CSeq", cseq, sizeof(cseq))) {
+        strcpy(cseq, "0");
+    }
+
+    len = snprintf(tx, sizeof(tx), "RTSP/1.0 200 OK\r\nCSeq: %s\r\n", cseq);
+    if (s->setup) {
+        len += snprintf(tx + len, sizeof(tx) - len, "Session: %08lX;timeout=%d\r\n",
+                        (unsigned long)s->session_id, SESSION_TIMEOUT_S);
+    }
+
+    if (strcmp(method, "OPTIONS") == 0) {
+        len += snprintf(tx + len, sizeof(tx) - len,
+                        "Public: OPTIONS, DESCRIBE, SETUP, PLAY, GET_PARAMETER, TEARDOWN\r\n\r\n");
+    } else if (strcmp(method, "DESCRIBE") == 0) {
+        struct sockaddr_in local;
+        socklen_t local_len = sizeof(local);
+        char ip[16] = "0.0.0.0";
+        if (getsockname(s->fd, (struct sockaddr *)&local, &local_len) == 0) {
+            inet_ntoa_r(local.sin_addr, ip, sizeof(ip));
+        }
+
+        char sdp[256];
+        int sdp_len = snprintf(sdp, sizeof(sdp),
+                               "v=0\r\n"
+                               "o=- %lu 1 IN IP4 %s\r\n"
+                               "s=ESP32-S3 Camera\r\n"
+                               "c=IN IP4 0.0.0.0\r\n"
+                               "t=0 0\r\n"
+                               "m=video 0 RTP/AVP %d\r\n"
+                               "a=control:track1\r\n",
+                               (unsigned long)s->session_id, ip, RTP_PAYLOAD_JPEG);
+        const char *slash = url[strlen(url) - 1] == '/' ? "" : "/";
+        len += snprintf(tx + len, sizeof(tx) - len,
+                        "Content-Base: %s%s\r\n"
+                        "Content-Type: application/sdp\r\n"
+                        "Content-Length: %d\r\n\r\n%s",
+                        url, slash, sdp_len, sdp);
+    } else if (strcmp(method, "SETUP") == 0) {
+        char reply[128];
+        if (s->setup) {
+            len = snprintf(tx, sizeof(tx), "RTSP/1.0 459 Aggregate Operation Not Allowed\r\n"
+                           "CSeq: %s\r\n\r\n", cseq);
+        } else if (!header_value(req, "Transport", transport, sizeof(transport)) ||
+                   !setup_transport(s, transport, reply, sizeof(reply))) {
+            len = snprintf(tx, sizeof(tx), "RTSP/1.0 461 Unsupported Transport\r\n"
+                           "CSeq: %s\r\n\r\n", cseq);
+        } else {
+            s->setup = true;
+            len += snprintf(tx + len, sizeof(tx) - len,
+                            "Session: %08lX;timeout=%d\r\nTransport: %s\r\n\r\n",
+                            (unsigned long)s->session_id, SESSION_TIMEOUT_S, reply);
+        }
+    } else if (strcmp(method, "PLAY") == 0) {
+        if (!s->setup) {
+            len = snprintf(tx, sizeof(tx), "RTSP/1.0 455 Method Not Valid in This State\r\n"
+                           "CSeq: %s\r\n\r\n", cseq);
+        } else {
+            if (!s->playing) {
+                s->playing = true;
+                frame_pipeline_add_consumer(PIPELINE_VIEW_COLOR);
+                taskENTER_CRITICAL(&stats_lock);
+                stats.sessions++;
+                taskEXIT_CRITICAL(&stats_lock);
+                ESP_LOGI(TAG, "Session %08lX playing over %s", (unsigned long)s->session_id,
+                         s->tcp ? "TCP" : "UDP");
+            }
+            len += snprintf(tx + len, sizeof(tx) - len, "Range: npt=0.000-\r\n\r\n");
+        }
+    } else if (strcmp(method, "GET_PARAMETER") == 0) {
+        len += snprintf(tx + len, sizeof(tx) - len, "\r\n");
+    } else if (strcmp(method, "TEARDOWN") == 0) {
+        len += snprintf(tx + len, sizeof(tx) - len, "\r\n");
+        send_reply(s, tx, len);
+        return false;
+    } else {
+        len = snprintf(tx, sizeof(tx), "RTSP/1.0 501 Not Implemented\r\nCSeq: %s\r\n\r\n", cseq);
+    }
+
+    return send_reply(s, tx, len);
+}
+
+// Consume buffered requests and interleaved packets from the client
+static bool session_read(rtsp_session_t *s)
+{
+    ssize_t n = recv(s->fd, s->rx + s->rx_len, sizeof(s->rx) - 1 - s->rx_len, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return false;
+    }
+    if (n < 0) {
+        return true;
+    }
+    s->rx_len += n;
+    s->rx[s->rx_len] = '\0';
+    s->last_activity_us = esp_timer_get_time();
+
+    while (s->rx_len > 0) {
+        size_t used;
+
+        if (s->rx[0] == '$') {
+            // Interleaved RTCP from the client
+            if (s->rx_len < 4) {
+                break;
+            }
+            used = 4 + get_u16((uint8_t *)s->rx + 2);
+            if (used > s->rx_len) {
+                if (used >= sizeof(s->rx)) {
+                    return false;
+                }
+                break;
+            }
+        } else {
+            char *end = strstr(s->rx, "\r\n\r\n");
+            if (!end) {
+                if (s->rx_len >= sizeof(s->rx) - 1) {
+                    ESP_LOGW(TAG, "Request too long");
+                    return false;
+                }
+                break;
+            }
+            used = end + 4 - s->rx;
+
+            char content_len[12];
+            size_t body = 0;
+            if (header_value(s->rx, "Content-Length", content_len, sizeof(content_len))) {
+                body = atoi(content_len);
+            }
+            if (used + body > s->rx_len) {
+                if (used + body >= sizeof(s->rx)) {
+                    return false;
+                }
+                break;
+            }
+
+            *end = '\0';
+            if (!handle_request(s, s->rx)) {
+                return false;
+            }
+            used += body;
+        }
+
+        memmove(s->rx, s->rx + used, s->rx_len - used);
+        s->rx_len -= used;
+        s->rx[s->rx_len] = '\0';
+    }
+    return true;
+}
+
+static void session_accept(int listen_fd)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    rtsp_session_t *s = NULL;
+    for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+        if (!sessions[i].active) {
+            s = &sessions[i];
+            break;
+        }
+    }
+    if (!s) {
+        ESP_LOGW(TAG, "Too many RTSP sessions");
+        close(fd);
+        return;
+    }
+
+    struct timeval tv = { .tv_sec = 0, .tv_usec = SEND_TIMEOUT_MS * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    memset(s, 0, sizeof(*s));
+    s->active = true;
+    s->fd = fd;
+    s->rtp_fd = -1;
+    s->rtcp_fd = -1;
+    s->session_id = esp_random();
+    s->ssrc = esp_random();
+    s->rtp_seq = esp_random();
+    s->last_activity_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Session %08lX connected", (unsigned long)s->session_id);
+}
+
+static void rtsp_task(void *arg)
+{
+    int listen_fd = (int)(intptr_t)arg;
+
+    while (1) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        FD_SET(listen_fd, &read_fds);
+        int max_fd = listen_fd;
+
+        for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+            rtsp_session_t *s = &sessions[i];
+            if (!s->active) {
+                continue;
+            }
+            FD_SET(s->fd, &read_fds);
+            if (s->fd > max_fd) {
+                max_fd = s->fd;
+            }
+            if (s->rtcp_fd >= 0) {
+                FD_SET(s->rtcp_fd, &read_fds);
+                if (s->rtcp_fd > max_fd) {
+                    max_fd = s->rtcp_fd;
+                }
+            }
+        }
+
+        struct timeval tv = { .tv_sec = 0, .tv_usec = POLL_TIMEOUT_MS * 1000 };
+        int n = select(max_fd + 1, &read_fds, NULL, NULL, &tv);
+        if (n < 0) {
+            ESP_LOGE(TAG, "select failed: %d", errno);
+            vTaskDelay(pdMS_TO_TICKS(POLL_TIMEOUT_MS));
+            continue;
+        }
+
+        if (n > 0 && FD_ISSET(listen_fd, &read_fds)) {
+            session_accept(listen_fd);
+        }
+
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < RTSP_MAX_SESSIONS; i++) {
+            rtsp_session_t *s = &sessions[i];
+            if (!s->active) {
+                continue;
+            }
+
+            if (n > 0 && FD_ISSET(s->fd, &read_fds) && !session_read(s)) {
+                session_close(s);
+                continue;
+            }
+
+            // RTCP receiver reports only serve as keepalive
+            if (n > 0 && s->rtcp_fd >= 0 && FD_ISSET(s->rtcp_fd, &read_fds)) {
+                char rtcp[128];
+                if (recv(s->rtcp_fd, rtcp, sizeof(rtcp), MSG_DONTWAIT) > 0) {
+                    s->last_activity_us = now;
+                }
+            }
+
+            if (!s->tcp && now - s->last_activity_us > SESSION_TIMEOUT_S * 1000000LL) {
+                ESP_LOGW(TAG, "Session %08lX timed out", (unsigned long)s->session_id);
+                session_close(s);
+                continue;
+            }
+
+            if (!s->playing) {
+                continue;
+            }
+            if (s->pending_len && tcp_flush(s) == RTP_FAILED) {
+                session_close(s);
+                continue;
+            }
+
+            uint32_t prev_seq = s->frame_seq;
+            pipeline_frame_t *frame = frame_pipeline_acquire(PIPELINE_VIEW_COLOR, &s->frame_seq);
+            if (!frame) {
+                continue;
+            }
+            if (prev_seq != 0 && s->frame_seq - prev_seq > 1) {
+                taskENTER_CRITICAL(&stats_lock);
+                stats.frames_dropped += s->frame_seq - prev_seq - 1;
+                taskEXIT_CRITICAL(&stats_lock);
+            }
+
+            bool ok = send_frame(s, frame);
+            frame_pipeline_release(frame);
+            if (!ok) {
+                session_close(s);
+            }
+        }
+    }
+}
+
+esp_err_t rtsp_server_start(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: %d", errno);
+        return ESP_FAIL;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(RTSP_PORT);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 2) != 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %d: %d", RTSP_PORT, errno);
+        close(fd);
+        return ESP_FAIL;
+    }
+
+    if (xTaskCreate(rtsp_task, "rtsp", RTSP_STACK_SIZE, (void *)(intptr_t)fd,
+                    RTSP_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create RTSP task");
+        close(fd);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "RTSP server started on port %d", RTSP_PORT);
+    return ESP_OK;
+}
+
+void rtsp_server_get_stats(rtsp_server_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(out, &stats, sizeof(rtsp_server_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+}
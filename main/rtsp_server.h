@@ -0,0 +1,50 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * RTSP server streaming pipeline frames as RTP/JPEG (RFC 2435)
+ */
+
+#ifndef RTSP_SERVER_H
+#define RTSP_SERVER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+// RTSP control port (the host build listens on an unprivileged one)
+#ifndef RTSP_PORT
+#define RTSP_PORT           554
+#endif
+
+// Maximum simultaneous RTSP sessions
+#define RTSP_MAX_SESSIONS   2
+
+// Server statistics
+typedef struct {
+    uint32_t sessions;          // Sessions currently playing
+    uint32_t frames_sent;       // Frames completely sent
+    uint32_t frames_dropped;    // Frames skipped or cut short by a full send buffer
+    uint32_t frames_unsupported;// Frames that are not baseline 4:2:2/4:2:0 JPEG
+    uint32_t packets_sent;      // RTP packets sent
+    uint32_t bytes_sent;        // RTP bytes sent (headers included)
+    uint32_t latency_us;        // Running average capture-to-last-packet latency
+} rtsp_server_stats_t;
+
+/**
+ * @brief Start the RTSP server task
+ *
+ * Serves OPTIONS, DESCRIBE, SETUP, PLAY, GET_PARAMETER and TEARDOWN on
+ * RTSP_PORT for any URL, with RTP over UDP or interleaved on the RTSP
+ * connection (RTP/AVP/TCP).
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t rtsp_server_start(void);
+
+/**
+ * @brief Get server statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void rtsp_server_get_stats(rtsp_server_stats_t *stats);
+
+#endif // RTSP_SERVER_H
@@ -0,0 +1,467 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Multiplexed MJPEG/WebSocket sender implementation
+ */
+
+#include "stream_sender.h"
+#include "frame_pipeline.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "stream_sender";
+
+#define SENDER_STACK_SIZE   4096
+#define SENDER_PRIORITY     4
+#define SELECT_TIMEOUT_MS   5
+
+#define PART_BOUNDARY "123456789000000000000987654321"
+static const char* _STREAM_RESPONSE = "HTTP/1.1 200 OK\r\n"
+                                      "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+                                      "Access-Control-Allow-Origin: *\r\n"
+                                      "Cache-Control: no-cache\r\n"
+                                      "Connection: close\r\n";
+static const char* _STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+static const char* _STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
+static const char* _WS_DETECTION = "{\"type\":\"detection\",\"seq\":%lu,\"ts\":%lld,\"detected\":%s,"
+                                   "\"confidence\":%u,\"bbox\":[%u,%u,%u,%u],\"angle\":%d}";
+
+// Largest control frame payload allowed by RFC 6455
+#define WS_CONTROL_MAX      125
+
+typedef enum {
+    CLIENT_FREE = 0,
+    CLIENT_MJPEG,                   // Detached /stream request
+    CLIENT_WS,                      // WebSocket session owned by httpd
+} client_type_t;
+
+typedef struct {
+    client_type_t type;
+    pipeline_view_t view;           // View the client is sent
+    httpd_req_t *req;               // Detached request (MJPEG only)
+    httpd_handle_t hd;
+    int fd;
+    pipeline_frame_t *frame;        // Frame being written, NULL if none
+    uint32_t seq;                   // Sequence of the last frame taken
+    int64_t last_timestamp;         // Capture time of the last frame sent
+    bool response_sent;             // HTTP response header already queued
+    uint32_t credits;               // Frames the WebSocket client accepts
+    bool pong_pending;              // Ping received, pong not yet queued
+    uint8_t pong[WS_CONTROL_MAX];
+    size_t pong_len;
+    uint8_t header[384];            // Headers/messages preceding the JPEG data
+    size_t header_len;              // 0 when the client is idle
+    size_t offset;                  // Bytes of header + JPEG already written
+    uint32_t frames_sent;
+    uint32_t frames_dropped;
+} stream_client_t;
+
+// The table is shared with the httpd task (new clients, WebSocket messages
+// and session close); the sender holds the mutex while it touches sockets
+// so an fd is never written after httpd has closed it.
+static stream_client_t clients[STREAM_MAX_CLIENTS];
+static SemaphoreHandle_t clients_mutex = NULL;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static stream_sender_stats_t stats;
+static uint32_t closed_sent = 0;        // Totals of clients that have disconnected
+static uint32_t closed_dropped = 0;
+static uint32_t latency_us = 0;         // Running average capture-to-sent latency
+
+static stream_client_t *client_find(int fd, client_type_t type)
+{
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        if (clients[i].type == type && clients[i].fd == fd) {
+            return &clients[i];
+        }
+    }
+    return NULL;
+}
+
+static stream_client_t *client_alloc(client_type_t type, pipeline_view_t view, httpd_handle_t hd, int fd)
+{
+    stream_client_t *c = NULL;
+    for (int i = 0; !c && i < STREAM_MAX_CLIENTS; i++) {
+        if (clients[i].type == CLIENT_FREE) {
+            c = &clients[i];
+        }
+    }
+    if (!c) {
+        return NULL;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->type = type;
+    c->view = view;
+    c->hd = hd;
+    c->fd = fd;
+    frame_pipeline_add_consumer(view);
+    ESP_LOGI(TAG, "%s client %d connected%s", type == CLIENT_WS ? "WebSocket" : "Stream", fd,
+             view == PIPELINE_VIEW_MASK ? " (mask view)" : "");
+    return c;
+}
+
+// Free the slot; the socket itself is closed by the caller
+static void client_free(stream_client_t *c)
+{
+    frame_pipeline_release(c->frame);
+    frame_pipeline_remove_consumer(c->view);
+
+    ESP_LOGI(TAG, "%s client %d closed (%lu sent, %lu dropped)",
+             c->type == CLIENT_WS ? "WebSocket" : "Stream", c->fd,
+             (unsigned long)c->frames_sent, (unsigned long)c->frames_dropped);
+
+    closed_sent += c->frames_sent;
+    closed_dropped += c->frames_dropped;
+    c->type = CLIENT_FREE;
+    c->req = NULL;
+    c->frame = NULL;
+}
+
+static void client_remove(stream_client_t *c)
+{
+    httpd_handle_t hd = c->hd;
+    httpd_req_t *req = c->req;
+    int fd = c->fd;
+
+    client_free(c);
+    if (req) {
+        httpd_req_async_handler_complete(req);
+    }
+    httpd_sess_trigger_close(hd, fd);
+}
+
+static size_t ws_frame_header(uint8_t *out, httpd_ws_type_t type, size_t len)
+{
+    out[0] = 0x80 | type;           // FIN, server frames are not masked
+    if (len < 126) {
+        out[1] = len;
+        return 2;
+    }
+    if (len <= 0xFFFF) {
+        out[1] = 126;
+        out[2] = len >> 8;
+        out[3] = len;
+        return 4;
+    }
+    out[1] = 127;
+    for (int i = 0; i < 8; i++) {
+        out[2 + i] = (uint64_t)len >> (56 - 8 * i);
+    }
+    return 10;
+}
+
+// Queue the text message describing a frame followed by the header of the
+// binary message carrying its JPEG data
+static size_t ws_frame_messages(uint8_t *out, uint32_t seq, const pipeline_frame_t *frame)
+{
+    char text[160];
+    const detection_result_t *d = &frame->detection;
+    int text_len = snprintf(text, sizeof(text), _WS_DETECTION, (unsigned long)seq,
+                            (long long)frame->timestamp_us, d->rgb_detected ? "true" : "false",
+                            d->confidence, d->bbox_x, d->bbox_y, d->bbox_w, d->bbox_h, d->angle);
+
+    size_t len = ws_frame_header(out, HTTPD_WS_TYPE_TEXT, text_len);
+    memcpy(out + len, text, text_len);
+    len += text_len;
+    len += ws_frame_header(out + len, HTTPD_WS_TYPE_BINARY, frame->jpeg_len);
+    return len;
+}
+
+// Prepare the next write of an idle client: a pending pong and/or the newest
+// frame. Frames published while the client was still writing the previous
+// one, or had no credit left, are dropped for that client.
+static void client_next(stream_client_t *c)
+{
+    size_t len = 0;
+
+    if (c->pong_pending) {
+        len = ws_frame_header(c->header, HTTPD_WS_TYPE_PONG, c->pong_len);
+        memcpy(c->header + len, c->pong, c->pong_len);
+        len += c->pong_len;
+        c->pong_pending = false;
+    }
+
+    pipeline_frame_t *frame = NULL;
+    if (c->type == CLIENT_MJPEG || c->credits > 0) {
+        uint32_t prev_seq = c->seq;
+        frame = frame_pipeline_acquire(c->view, &c->seq);
+        if (frame && prev_seq != 0 && c->seq - prev_seq > 1) {
+            c->frames_dropped += c->seq - prev_seq - 1;
+        }
+    }
+
+    if (frame && c->type == CLIENT_MJPEG) {
+        char *h = (char *)c->header;
+        if (!c->response_sent) {
+            len = snprintf(h, sizeof(c->header), "%s", _STREAM_RESPONSE);
+            c->response_sent = true;
+        }
+        len += snprintf(h + len, sizeof(c->header) - len, "%s", _STREAM_BOUNDARY);
+        len += snprintf(h + len, sizeof(c->header) - len, _STREAM_PART, (unsigned)frame->jpeg_len);
+    } else if (frame) {
+        len += ws_frame_messages(c->header + len, c->seq, frame);
+        c->credits--;
+    }
+
+    c->frame = frame;
+    c->header_len = len;
+    c->offset = 0;
+}
+
+// Write as much as the socket accepts without blocking
+static bool client_write(stream_client_t *c)
+{
+    while (c->header_len) {
+        size_t total = c->header_len + (c->frame ? c->frame->jpeg_len : 0);
+        const uint8_t *data;
+        size_t len;
+
+        if (c->offset < c->header_len) {
+            data = c->header + c->offset;
+            len = c->header_len - c->offset;
+        } else {
+            size_t pos = c->offset - c->header_len;
+            data = c->frame->jpeg + pos;
+            len = c->frame->jpeg_len - pos;
+        }
+
+        ssize_t n = send(c->fd, data, len, MSG_DONTWAIT);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        c->offset += n;
+        if (c->offset == total) {
+            if (c->frame) {
+                // Repeated frames keep their capture time and are not counted
+                if (c->frame->timestamp_us != c->last_timestamp) {
+                    uint32_t latency = esp_timer_get_time() - c->frame->timestamp_us;
+                    latency_us = latency_us ? (latency_us * 7 + latency) / 8 : latency;
+                    c->last_timestamp = c->frame->timestamp_us;
+                }
+                frame_pipeline_release(c->frame);
+                c->frame = NULL;
+                c->frames_sent++;
+            }
+            client_next(c);
+        }
+    }
+    return true;
+}
+
+// Drain anything a stream client sends; returns false once the peer has
+// closed. WebSocket sockets are read by httpd and never drained here.
+static bool client_read(stream_client_t *c)
+{
+    char buf[64];
+    ssize_t n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n == 0) {
+        return false;
+    }
+    return n > 0 || errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// Publish a snapshot of the client table for stream_sender_get_stats
+static void update_stats(void)
+{
+    stream_sender_stats_t s;
+    memset(&s, 0, sizeof(s));
+    s.frames_sent = closed_sent;
+    s.frames_dropped = closed_dropped;
+    s.latency_us = latency_us;
+
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+        stream_client_t *c = &clients[i];
+        if (c->type == CLIENT_FREE) {
+            continue;
+        }
+        stream_client_stats_t *cs = &s.client[s.clients++];
+        cs->fd = c->fd;
+        cs->websocket = c->type == CLIENT_WS;
+        cs->view = c->view;
+        cs->credits = c->credits;
+        cs->frames_sent = c->frames_sent;
+        cs->frames_dropped = c->frames_dropped;
+        cs->backlog = c->header_len + (c->frame ? c->frame->jpeg_len : 0) - c->offset;
+        s.frames_sent += c->frames_sent;
+        s.frames_dropped += c->frames_dropped;
+    }
+
+    taskENTER_CRITICAL(&stats_lock);
+    memcpy(&stats, &s, sizeof(stats));
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+static void sender_task(void *arg)
+{
+    while (1) {
+        fd_set read_fds, write_fds;
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        int max_fd = -1;
+
+        xSemaphoreTake(clients_mutex, portMAX_DELAY);
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            stream_client_t *c = &clients[i];
+            if (c->type == CLIENT_FREE) {
+                continue;
+            }
+            if (!c->header_len) {
+                client_next(c);
+            }
+            if (c->type == CLIENT_MJPEG) {
+                FD_SET(c->fd, &read_fds);
+            }
+            if (c->header_len) {
+                FD_SET(c->fd, &write_fds);
+            }
+            if (c->fd > max_fd) {
+                max_fd = c->fd;
+            }
+        }
+        update_stats();
+        xSemaphoreGive(clients_mutex);
+
+        if (max_fd < 0) {
+            vTaskDelay(pdMS_TO_TICKS(SELECT_TIMEOUT_MS * 4));
+            continue;
+        }
+
+        // A WebSocket session closed by httpd while we wait shows up as EBADF
+        struct timeval tv = { .tv_sec = 0, .tv_usec = SELECT_TIMEOUT_MS * 1000 };
+        int n = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+        if (n < 0) {
+            if (errno != EBADF) {
+                ESP_LOGE(TAG, "select failed: %d", errno);
+            }
+            vTaskDelay(pdMS_TO_TICKS(SELECT_TIMEOUT_MS));
+            continue;
+        }
+
+        xSemaphoreTake(clients_mutex, portMAX_DELAY);
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++) {
+            stream_client_t *c = &clients[i];
+            if (c->type == CLIENT_FREE) {
+                continue;
+            }
+            bool ok = true;
+            if (c->type == CLIENT_MJPEG && FD_ISSET(c->fd, &read_fds)) {
+                ok = client_read(c);
+            }
+            if (ok && FD_ISSET(c->fd, &write_fds)) {
+                ok = client_write(c);
+            }
+            if (!ok) {
+                client_remove(c);
+            }
+        }
+        xSemaphoreGive(clients_mutex);
+    }
+}
+
+esp_err_t stream_sender_start(void)
+{
+    clients_mutex = xSemaphoreCreateMutex();
+    if (!clients_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(sender_task, "stream_tx", SENDER_STACK_SIZE, NULL,
+                    SENDER_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create sender task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t stream_sender_add(httpd_req_t *req, pipeline_view_t view)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    xSemaphoreTake(clients_mutex, portMAX_DELAY);
+    stream_client_t *c = client_alloc(CLIENT_MJPEG, view, req->handle, httpd_req_to_sockfd(req));
+    if (c) {
+        ret = httpd_req_async_handler_begin(req, &c->req);
+        if (ret != ESP_OK) {
+            client_free(c);
+        }
+    }
+    xSemaphoreGive(clients_mutex);
+
+    if (!c) {
+        ESP_LOGW(TAG, "Too many stream clients");
+    }
+    return ret;
+}
+
+esp_err_t stream_sender_add_ws(httpd_handle_t hd, int fd)
+{
+    xSemaphoreTake(clients_mutex, portMAX_DELAY);
+    stream_client_t *c = client_alloc(CLIENT_WS, PIPELINE_VIEW_COLOR, hd, fd);
+    xSemaphoreGive(clients_mutex);
+
+    if (!c) {
+        ESP_LOGW(TAG, "Too many stream clients");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void stream_sender_ws_credit(int fd, uint32_t credits)
+{
+    xSemaphoreTake(clients_mutex, portMAX_DELAY);
+    stream_client_t *c = client_find(fd, CLIENT_WS);
+    if (c) {
+        c->credits += credits;
+        if (c->credits > STREAM_WS_MAX_CREDITS) {
+            c->credits = STREAM_WS_MAX_CREDITS;
+        }
+    }
+    xSemaphoreGive(clients_mutex);
+}
+
+void stream_sender_ws_ping(int fd, const uint8_t *payload, size_t len)
+{
+    if (len > WS_CONTROL_MAX) {
+        return;
+    }
+
+    xSemaphoreTake(clients_mutex, portMAX_DELAY);
+    stream_client_t *c = client_find(fd, CLIENT_WS);
+    if (c) {
+        memcpy(c->pong, payload, len);
+        c->pong_len = len;
+        c->pong_pending = true;
+    }
+    xSemaphoreGive(clients_mutex);
+}
+
+void stream_sender_socket_closed(int fd)
+{
+    // Stream sessions are held open by their async request and only close
+    // through client_remove, so only WebSocket slots can be left here
+    xSemaphoreTake(clients_mutex, portMAX_DELAY);
+    stream_client_t *c = client_find(fd, CLIENT_WS);
+    if (c) {
+        client_free(c);
+    }
+    xSemaphoreGive(clients_mutex);
+}
+
+void stream_sender_get_stats(stream_sender_stats_t *out)
+{
+    if (out) {
+        taskENTER_CRITICAL(&stats_lock);
+        memcpy(out, &stats, sizeof(stream_sender_stats_t));
+        taskEXIT_CRITICAL(&stats_lock);
+    }
+}
@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Single-task sender driving all MJPEG and WebSocket stream clients with
+ * non-blocking sockets
+ */
+
+#ifndef STREAM_SENDER_H
+#define STREAM_SENDER_H
+
+#include "frame_pipeline.h"
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Maximum simultaneous stream clients (MJPEG and WebSocket together)
+#define STREAM_MAX_CLIENTS  4
+
+// Upper bound on the frames a WebSocket client may have outstanding
+#define STREAM_WS_MAX_CREDITS   8
+
+// Per-client statistics
+typedef struct {
+    int fd;                 // Client socket
+    bool websocket;         // WebSocket client (otherwise MJPEG)
+    pipeline_view_t view;   // View the client is sent
+    uint32_t credits;       // Frames the WebSocket client still accepts
+    uint32_t frames_sent;   // Frames completely sent
+    uint32_t frames_dropped;// Frames skipped because the client was still busy
+    uint32_t backlog;       // Bytes of the current frame not yet written
+} stream_client_stats_t;
+
+// Sender statistics
+typedef struct {
+    uint32_t clients;
+    uint32_t frames_sent;
+    uint32_t frames_dropped;
+    uint32_t latency_us;    // Running average capture-to-sent latency
+    stream_client_stats_t client[STREAM_MAX_CLIENTS];
+} stream_sender_stats_t;
+
+/**
+ * @brief Start the sender task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t stream_sender_start(void);
+
+/**
+ * @brief Hand a /stream request over to the sender task
+ *
+ * The request is detached from the httpd worker (async request handling),
+ * so the handler can return immediately.
+ *
+ * @param req Stream request
+ * @param view View to stream
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all client slots are in use
+ */
+esp_err_t stream_sender_add(httpd_req_t *req, pipeline_view_t view);
+
+/**
+ * @brief Register a WebSocket session that completed its handshake on /ws
+ *
+ * Every frame is sent as a text message with the detection result followed
+ * by a binary message with the JPEG data, and only while the client has
+ * credit left (see stream_sender_ws_credit). The socket stays owned by
+ * httpd, which keeps receiving the client's messages.
+ *
+ * @param hd Server handle
+ * @param fd Session socket
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if all client slots are in use
+ */
+esp_err_t stream_sender_add_ws(httpd_handle_t hd, int fd);
+
+/**
+ * @brief Grant frames to a WebSocket client
+ *
+ * Each frame sent consumes one credit, so a client that grants one credit
+ * per decoded frame never has more than it can display in flight.
+ *
+ * @param fd Session socket
+ * @param credits Number of additional frames the client accepts
+ */
+void stream_sender_ws_credit(int fd, uint32_t credits);
+
+/**
+ * @brief Answer a WebSocket ping
+ *
+ * The pong is sent by the sender task between two frames.
+ *
+ * @param fd Session socket
+ * @param payload Ping payload
+ * @param len Payload length (at most 125 bytes)
+ */
+void stream_sender_ws_ping(int fd, const uint8_t *payload, size_t len);
+
+/**
+ * @brief Notify the sender that httpd is closing a session
+ *
+ * Must be called from the server's close callback before the socket is
+ * closed.
+ *
+ * @param fd Session socket
+ */
+void stream_sender_socket_closed(int fd);
+
+/**
+ * @brief Get sender statistics
+ *
+ * @param stats Pointer to stats structure to fill
+ */
+void stream_sender_get_stats(stream_sender_stats_t *stats);
+
+#endif // STREAM_SENDER_H
@@ -34,6 +34,10 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "        .status { padding: 10px; margin: 10px 0; border-radius: 4px; }\n"
 "        .status.success { background: #d4edda; color: #155724; }\n"
 "        .status.error { background: #f8d7da; color: #721c24; }\n"
+"        .detection { margin: 10px 0; font-weight: bold; color: #666; }\n"
+"        .detection.found { color: #155724; }\n"
+"        .view { position: relative; display: inline-block; }\n"
+"        .view canvas { position: absolute; pointer-events: none; }\n"
 "    </style>\n"
 "</head>\n"
 "<body>\n"
@@ -41,8 +45,23 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "        <h1>ESP32-S3 Camera - Rilevamento Bande RGB</h1>\n"
 "        \n"
 "        <div class=\"stream-container\">\n"
-"            <h2>Stream Video MJPEG</h2>\n"
-"            <img id=\"stream\" src=\"/stream\" alt=\"Camera Stream\">\n"
+"            <h2>Stream Video</h2>\n"
+"            <div class=\"view\">\n"
+"                <img id=\"stream\" alt=\"Camera Stream\">\n"
+"                <canvas id=\"mask_overlay\"></canvas>\n"
+"            </div>\n"
+"            <div id=\"detection\" class=\"detection\"></div>\n"
+"            <label style=\"width: auto\"><input type=\"checkbox\" id=\"show_masks\" onchange=\"drawMasks()\"> Mostra maschere ROI</label>\n"
+"            <label style=\"width: auto\"><input type=\"checkbox\" id=\"show_classes\" onchange=\"toggleClassView()\"> Mostra classi</label>\n"
+"            <div><img id=\"class_view\" alt=\"Classi\" style=\"display: none; width: 640px; image-rendering: pixelated\"></div>\n"
+"            <div class=\"config-section\">\n"
+"                <h2>Calibrazione</h2>\n"
+"                <p>Trascina un riquadro su una banda dello stream per proporre le soglie.</p>\n"
+"                <label>Classe:</label>\n"
+"                <select id=\"cal_class\"><option value=\"red\">Rosso</option><option value=\"green\">Verde</option><option value=\"blue\">Blu</option></select>\n"
+"                <button id=\"cal_apply\" class=\"button-secondary\" onclick=\"applySuggestion()\" disabled>Applica Proposta</button>\n"
+"                <div id=\"cal_result\"></div>\n"
+"            </div>\n"
 "        </div>\n"
 "        \n"
 "        <div class=\"config-section\">\n"
@@ -84,10 +103,27 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "                <label>Area Minima (px):</label><input type=\"number\" id=\"min_area\" min=\"100\" max=\"5000\" value=\"900\"><br>\n"
 "                <label>Confidenza Min (%):</label><input type=\"number\" id=\"min_confidence\" min=\"0\" max=\"100\" value=\"60\"><br>\n"
 "                <label>Decimazione Frame:</label><input type=\"number\" id=\"frame_decimation\" min=\"1\" max=\"60\" value=\"15\"><br>\n"
+"                <label>Soglia Movimento:</label><input type=\"number\" id=\"motion_threshold\" min=\"0\" max=\"255\" value=\"4\"><br>\n"
+"                <label>Refresh Forzato (frame):</label><input type=\"number\" id=\"refresh_interval\" min=\"1\" max=\"1000\" value=\"30\"><br>\n"
+"                <label>Confidenza da Riempimento:</label><input type=\"checkbox\" id=\"window_scoring\" checked><br>\n"
 "            </div>\n"
 "            \n"
 "            <button onclick=\"loadConfig()\">Carica Configurazione</button>\n"
 "            <button onclick=\"saveConfig()\" class=\"button-secondary\">Salva Configurazione</button>\n"
+"            <button onclick=\"previewConfig(false)\">Anteprima</button>\n"
+"            <button onclick=\"previewConfig(true)\">Anteprima su Nuovo Frame</button>\n"
+"            <div id=\"preview_result\"></div>\n"
+"        </div>\n"
+"        \n"
+"        <div class=\"config-section\">\n"
+"            <h2>Profili</h2>\n"
+"            <label>Profilo:</label>\n"
+"            <select id=\"profile_list\"></select>\n"
+"            <button onclick=\"switchProfile()\">Attiva</button>\n"
+"            <button onclick=\"deleteProfile()\" class=\"button-secondary\">Elimina</button><br>\n"
+"            <label>Nome:</label><input type=\"text\" id=\"profile_name\" maxlength=\"15\">\n"
+"            <button onclick=\"saveProfile()\" class=\"button-secondary\">Salva Configurazione come Profilo</button>\n"
+"            <div id=\"profile_status\"></div>\n"
 "        </div>\n"
 "    </div>\n"
 "    \n"
@@ -99,6 +135,58 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "            setTimeout(() => statusDiv.textContent = '', 3000);\n"
 "        }\n"
 "        \n"
+"        // Regions of interest from /api/config, coordinates 0-1000\n"
+"        let masks = [];\n"
+"        // Calibration box in displayed pixels and the last proposal\n"
+"        let calBox = null;\n"
+"        let suggestion = null;\n"
+"\n"
+"        function maskPath(ctx, m, w, h) {\n"
+"            ctx.beginPath();\n"
+"            if (m.rect) {\n"
+"                const [x0, y0, x1, y1] = m.rect;\n"
+"                ctx.rect(x0 * w / 1000, y0 * h / 1000, (x1 - x0) * w / 1000, (y1 - y0) * h / 1000);\n"
+"            } else {\n"
+"                m.polygon.forEach(([x, y], i) => i ? ctx.lineTo(x * w / 1000, y * h / 1000)\n"
+"                                                   : ctx.moveTo(x * w / 1000, y * h / 1000));\n"
+"                ctx.closePath();\n"
+"            }\n"
+"        }\n"
+"\n"
+"        // Shade the pixels the detector skips: everything outside the include\n"
+"        // regions (if any) and everything inside the exclude regions\n"
+"        function drawMasks() {\n"
+"            const img = document.getElementById('stream');\n"
+"            const canvas = document.getElementById('mask_overlay');\n"
+"            const w = img.clientWidth, h = img.clientHeight;\n"
+"            if (canvas.width !== w || canvas.height !== h) {\n"
+"                canvas.width = w;\n"
+"                canvas.height = h;\n"
+"            }\n"
+"            canvas.style.left = (img.offsetLeft + img.clientLeft) + 'px';\n"
+"            canvas.style.top = (img.offsetTop + img.clientTop) + 'px';\n"
+"            const ctx = canvas.getContext('2d');\n"
+"            ctx.clearRect(0, 0, w, h);\n"
+"            if (calBox) {\n"
+"                ctx.strokeStyle = '#00e5ff';\n"
+"                ctx.lineWidth = 2;\n"
+"                ctx.strokeRect(calBox.x, calBox.y, calBox.w, calBox.h);\n"
+"                ctx.lineWidth = 1;\n"
+"            }\n"
+"            if (!document.getElementById('show_masks').checked || !masks.length) return;\n"
+"\n"
+"            ctx.fillStyle = 'rgba(0, 0, 0, 0.55)';\n"
+"            if (masks.some(m => m.mode === 'include')) {\n"
+"                ctx.fillRect(0, 0, w, h);\n"
+"                ctx.globalCompositeOperation = 'destination-out';\n"
+"                masks.filter(m => m.mode === 'include').forEach(m => { maskPath(ctx, m, w, h); ctx.fill(); });\n"
+"                ctx.globalCompositeOperation = 'source-over';\n"
+"            }\n"
+"            masks.filter(m => m.mode === 'exclude').forEach(m => { maskPath(ctx, m, w, h); ctx.fill(); });\n"
+"            ctx.strokeStyle = '#ffeb3b';\n"
+"            masks.forEach(m => { maskPath(ctx, m, w, h); ctx.stroke(); });\n"
+"        }\n"
+"\n"
 "        function loadConfig() {\n"
 "            fetch('/api/config')\n"
 "                .then(response => response.json())\n"
@@ -127,14 +215,19 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "                    document.getElementById('min_area').value = data.min_area;\n"
 "                    document.getElementById('min_confidence').value = data.min_confidence;\n"
 "                    document.getElementById('frame_decimation').value = data.frame_decimation;\n"
+"                    document.getElementById('motion_threshold').value = data.motion_threshold;\n"
+"                    document.getElementById('refresh_interval').value = data.refresh_interval;\n"
+"                    document.getElementById('window_scoring').checked = data.window_scoring;\n"
+"                    masks = data.masks || [];\n"
+"                    drawMasks();\n"
 "                    \n"
 "                    showStatus('Configurazione caricata con successo!', false);\n"
 "                })\n"
 "                .catch(err => showStatus('Errore nel caricamento: ' + err, true));\n"
 "        }\n"
 "        \n"
-"        function saveConfig() {\n"
-"            const config = {\n"
+"        function formConfig() {\n"
+"            return {\n"
 "                red: {\n"
 "                    h_min: parseInt(document.getElementById('red_h_min').value),\n"
 "                    h_max: parseInt(document.getElementById('red_h_max').value),\n"
@@ -161,21 +254,216 @@ static const char web_ui_html[] = "<!DOCTYPE html>\n"
 "                },\n"
 "                min_area: parseInt(document.getElementById('min_area').value),\n"
 "                min_confidence: parseInt(document.getElementById('min_confidence').value),\n"
-"                frame_decimation: parseInt(document.getElementById('frame_decimation').value)\n"
+"                frame_decimation: parseInt(document.getElementById('frame_decimation').value),\n"
+"                motion_threshold: parseInt(document.getElementById('motion_threshold').value),\n"
+"                refresh_interval: parseInt(document.getElementById('refresh_interval').value),\n"
+"                window_scoring: document.getElementById('window_scoring').checked\n"
 "            };\n"
-"            \n"
+"        }\n"
+"        \n"
+"        function saveConfig() {\n"
 "            fetch('/api/config', {\n"
 "                method: 'POST',\n"
 "                headers: { 'Content-Type': 'application/json' },\n"
-"                body: JSON.stringify(config)\n"
+"                body: JSON.stringify(formConfig())\n"
 "            })\n"
 "            .then(response => response.json())\n"
 "            .then(data => showStatus('Configurazione salvata con successo!', false))\n"
 "            .catch(err => showStatus('Errore nel salvataggio: ' + err, true));\n"
 "        }\n"
 "        \n"
-"        // Load config on page load\n"
-"        window.onload = loadConfig;\n"
+"        // Dry run of the form on the frame held by the device; nothing is saved\n"
+"        function previewConfig(refresh) {\n"
+"            const config = formConfig();\n"
+"            config.refresh = refresh;\n"
+"            const result = document.getElementById('preview_result');\n"
+"            fetch('/api/config/preview', {\n"
+"                method: 'POST',\n"
+"                headers: { 'Content-Type': 'application/json' },\n"
+"                body: JSON.stringify(config)\n"
+"            })\n"
+"            .then(response => response.ok ? response.json() : response.text().then(t => Promise.reject(t)))\n"
+"            .then(data => {\n"
+"                const d = data.detection;\n"
+"                const classes = data.classes.map(c => c.name + ' ' + c.pixels + ' px').join(', ');\n"
+"                result.textContent = (d.detected ? 'Rilevato (' + d.confidence + '%) in ' + d.bbox.join(',') : 'Nessun rilevamento') +\n"
+"                                     '; ' + classes + '; scansione ' + (data.timing.scan_us / 1000).toFixed(1) + ' ms';\n"
+"            })\n"
+"            .catch(err => { result.textContent = 'Errore anteprima: ' + err; });\n"
+"        }\n"
+"        \n"
+"        // Video over WebSocket: one credit is granted per decoded frame, so\n"
+"        // the server never sends more than this tab can display.\n"
+"        // Falls back to the MJPEG stream if WebSockets are unavailable.\n"
+"        function startVideo() {\n"
+"            const img = document.getElementById('stream');\n"
+"            let opened = false;\n"
+"            let ws;\n"
+"            try {\n"
+"                ws = new WebSocket('ws://' + location.host + '/ws');\n"
+"            } catch (e) {\n"
+"                img.src = '/stream';\n"
+"                return;\n"
+"            }\n"
+"            ws.binaryType = 'blob';\n"
+"            ws.onopen = () => {\n"
+"                opened = true;\n"
+"                ws.send(JSON.stringify({ credit: 2 }));\n"
+"            };\n"
+"            ws.onmessage = (event) => {\n"
+"                if (typeof event.data === 'string') {\n"
+"                    showDetection(JSON.parse(event.data));\n"
+"                    return;\n"
+"                }\n"
+"                const url = URL.createObjectURL(event.data);\n"
+"                img.onload = img.onerror = () => {\n"
+"                    URL.revokeObjectURL(url);\n"
+"                    if (ws.readyState === WebSocket.OPEN) ws.send('{\"credit\":1}');\n"
+"                };\n"
+"                img.src = url;\n"
+"            };\n"
+"            ws.onclose = () => {\n"
+"                img.onload = img.onerror = null;\n"
+"                if (opened) {\n"
+"                    setTimeout(startVideo, 1000);\n"
+"                } else {\n"
+"                    img.src = '/stream';\n"
+"                }\n"
+"            };\n"
+"        }\n"
+"        \n"
+"        // Class map of the detector (/stream?view=mask); the device only\n"
+"        // draws it while this stream is open\n"
+"        function toggleClassView() {\n"
+"            const img = document.getElementById('class_view');\n"
+"            if (document.getElementById('show_classes').checked) {\n"
+"                img.src = '/stream?view=mask';\n"
+"                img.style.display = '';\n"
+"            } else {\n"
+"                img.removeAttribute('src');\n"
+"                img.style.display = 'none';\n"
+"            }\n"
+"        }\n"
+"        \n"
+"        // Drag a box over the stream, then ask the device for the histograms\n"
+"        // of that region of the frame and a threshold proposal\n"
+"        function startCalibration() {\n"
+"            const img = document.getElementById('stream');\n"
+"            let origin = null;\n"
+"            const pos = (e) => {\n"
+"                const r = img.getBoundingClientRect();\n"
+"                return { x: Math.max(0, Math.min(e.clientX - r.left, img.clientWidth)),\n"
+"                         y: Math.max(0, Math.min(e.clientY - r.top, img.clientHeight)) };\n"
+"            };\n"
+"            img.addEventListener('mousedown', (e) => {\n"
+"                e.preventDefault();\n"
+"                origin = pos(e);\n"
+"                calBox = { x: origin.x, y: origin.y, w: 0, h: 0 };\n"
+"            });\n"
+"            window.addEventListener('mousemove', (e) => {\n"
+"                if (!origin) return;\n"
+"                const p = pos(e);\n"
+"                calBox = { x: Math.min(origin.x, p.x), y: Math.min(origin.y, p.y),\n"
+"                           w: Math.abs(p.x - origin.x), h: Math.abs(p.y - origin.y) };\n"
+"                drawMasks();\n"
+"            });\n"
+"            window.addEventListener('mouseup', () => {\n"
+"                if (!origin) return;\n"
+"                origin = null;\n"
+"                if (calBox.w >= 4 && calBox.h >= 4) requestHistogram();\n"
+"            });\n"
+"        }\n"
+"        \n"
+"        function requestHistogram() {\n"
+"            const img = document.getElementById('stream');\n"
+"            const scale = img.naturalWidth / img.clientWidth;\n"
+"            const cls = document.getElementById('cal_class').value;\n"
+"            const q = 'x=' + Math.round(calBox.x * scale) + '&y=' + Math.round(calBox.y * scale) +\n"
+"                      '&w=' + Math.round(calBox.w * scale) + '&h=' + Math.round(calBox.h * scale) + '&class=' + cls;\n"
+"            const result = document.getElementById('cal_result');\n"
+"            fetch('/api/histogram?' + q)\n"
+"                .then(response => response.ok ? response.json() : response.text().then(t => Promise.reject(t)))\n"
+"                .then(data => {\n"
+"                    suggestion = data.suggestion ? { cls: cls, t: data.suggestion } : null;\n"
+"                    document.getElementById('cal_apply').disabled = !suggestion;\n"
+"                    if (!suggestion) {\n"
+"                        result.textContent = 'Nessun colore saturo nel riquadro';\n"
+"                        return;\n"
+"                    }\n"
+"                    const t = data.suggestion, c = data.current;\n"
+"                    const fmt = (t) => 'H ' + t.h_min + '-' + t.h_max + ', S ' + t.s_min + '-' + t.s_max + ', V ' + t.v_min + '-' + t.v_max;\n"
+"                    result.textContent = 'Proposta: ' + fmt(t) + ' (' + Math.round(100 * t.pixels / data.pixels) +\n"
+"                                         '% del riquadro)' + (c ? '; attuale: ' + fmt(c) : '');\n"
+"                })\n"
+"                .catch(err => { result.textContent = 'Errore istogramma: ' + err; });\n"
+"        }\n"
+"        \n"
+"        function applySuggestion() {\n"
+"            if (!suggestion) return;\n"
+"            ['h_min', 'h_max', 's_min', 's_max', 'v_min', 'v_max'].forEach(k =>\n"
+"                document.getElementById(suggestion.cls + '_' + k).value = suggestion.t[k]);\n"
+"            saveConfig();\n"
+"        }\n"
+"        \n"
+"        function showDetection(d) {\n"
+"            const div = document.getElementById('detection');\n"
+"            div.className = 'detection' + (d.detected ? ' found' : '');\n"
+"            div.textContent = d.detected\n"
+"                ? 'Bande RGB rilevate (confidenza ' + d.confidence + '%, angolo ' + d.angle + '\\u00b0)'\n"
+"                : 'Nessuna banda rilevata';\n"
+"        }\n"
+"        \n"
+"        function loadProfiles() {\n"
+"            fetch('/api/profiles')\n"
+"                .then(response => response.json())\n"
+"                .then(data => {\n"
+"                    const list = document.getElementById('profile_list');\n"
+"                    list.innerHTML = '';\n"
+"                    data.profiles.forEach(name => list.add(new Option(name + (name === data.active ? ' (attivo)' : ''), name)));\n"
+"                    list.value = data.active;\n"
+"                    const s = data.last_switch;\n"
+"                    document.getElementById('profile_status').textContent = (data.active ? 'Attivo: ' + data.active : 'Nessun profilo attivo') +\n"
+"                        (data.standby ? ', pronto: ' + data.standby : '') +\n"
+"                        (s ? '; ultimo cambio ' + (s.total_us / 1000).toFixed(1) + ' ms' : '');\n"
+"                });\n"
+"        }\n"
+"        \n"
+"        function profileRequest(method, name) {\n"
+"            return fetch('/api/profile/' + encodeURIComponent(name), { method: method })\n"
+"                .then(response => response.ok ? response.json() : response.text().then(t => Promise.reject(t)));\n"
+"        }\n"
+"        \n"
+"        function switchProfile() {\n"
+"            const name = document.getElementById('profile_list').value;\n"
+"            if (!name) return;\n"
+"            profileRequest('POST', name)\n"
+"                .then(() => { loadConfig(); loadProfiles(); })\n"
+"                .catch(err => showStatus('Errore nel cambio profilo: ' + err, true));\n"
+"        }\n"
+"        \n"
+"        function saveProfile() {\n"
+"            const name = document.getElementById('profile_name').value;\n"
+"            profileRequest('PUT', name)\n"
+"                .then(() => loadProfiles())\n"
+"                .catch(err => showStatus('Errore nel salvataggio del profilo: ' + err, true));\n"
+"        }\n"
+"        \n"
+"        function deleteProfile() {\n"
+"            const name = document.getElementById('profile_list').value;\n"
+"            if (!name) return;\n"
+"            profileRequest('DELETE', name)\n"
+"                .then(() => loadProfiles())\n"
+"                .catch(err => showStatus('Errore nell\\'eliminazione del profilo: ' + err, true));\n"
+"        }\n"
+"        \n"
+"        // Load config and start video on page load\n"
+"        window.onload = () => {\n"
+"            loadConfig();\n"
+"            loadProfiles();\n"
+"            startVideo();\n"
+"            startCalibration();\n"
+"            document.getElementById('stream').addEventListener('load', drawMasks);\n"
+"        };\n"
 "    </script>\n"
 "</body>\n"
 "</html>";
@@ -1,16 +1,95 @@
 /*
  * SPDX-License-Identifier: MIT
- * 
+ *
  * WS2812B LED driver implementation
  */
 
 #include "ws2812_led.h"
 #include "pin_config.h"
 #include "led_strip.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 
 static const char *TAG = "ws2812";
+
+#define LED_STACK_SIZE      3072
+#define LED_PRIORITY        2
+
+#define LOST_HOLD_MS        2000    // Blink after the bands disappear, then idle
+#define LOST_BLINK_MS       200     // On and off time while lost
+#define TRACKING_MIN_LEVEL  48      // Red level at confidence 0
+#define CONFIDENCE_STEP     10      // Brightness steps, so noise does not rewrite the strip
+
+// Packed report: detected flag and quantized confidence
+#define REPORT_DETECTED     0x100
+
+#define RGB(r, g, b)        (((uint32_t)(r) << 16) | ((uint32_t)(g) << 8) | (b))
+#define COLOR_IDLE          RGB(0, 255, 0)
+#define COLOR_LOST          RGB(255, 96, 0)
+#define COLOR_OFF           RGB(0, 0, 0)
+
 static led_strip_handle_t led_strip = NULL;
+static TaskHandle_t led_task_handle = NULL;
+static uint32_t report = 0;
+static ws2812_stats_t stats;
+
+static void show(uint32_t rgb)
+{
+    led_strip_set_pixel(led_strip, 0, (rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+    led_strip_refresh(led_strip);
+    stats.refreshes++;
+}
+
+static void led_task(void *arg)
+{
+    uint32_t shown = COLOR_OFF;
+    bool was_detected = false;
+    int64_t lost_since = 0;
+    ws2812_state_t state = WS2812_STATE_IDLE;
+
+    while (1) {
+        uint32_t value = __atomic_load_n(&report, __ATOMIC_RELAXED);
+        bool detected = value & REPORT_DETECTED;
+        int64_t now = esp_timer_get_time();
+
+        if (detected) {
+            state = WS2812_STATE_TRACKING;
+        } else if (was_detected) {
+            state = WS2812_STATE_LOST;
+            lost_since = now;
+        } else if (state == WS2812_STATE_LOST && now - lost_since >= LOST_HOLD_MS * 1000LL) {
+            state = WS2812_STATE_IDLE;
+        }
+        was_detected = detected;
+        stats.state = state;
+
+        uint32_t color;
+        TickType_t wait = portMAX_DELAY;
+        if (state == WS2812_STATE_TRACKING) {
+            uint32_t confidence = value & 0xff;
+            color = RGB(TRACKING_MIN_LEVEL + (255 - TRACKING_MIN_LEVEL) * confidence / 100, 0, 0);
+        } else if (state == WS2812_STATE_LOST) {
+            // Wake at the next blink edge (or the end of the hold)
+            uint32_t elapsed_ms = (now - lost_since) / 1000;
+            color = (elapsed_ms / LOST_BLINK_MS) & 1 ? COLOR_OFF : COLOR_LOST;
+            wait = pdMS_TO_TICKS(LOST_BLINK_MS - elapsed_ms % LOST_BLINK_MS);
+            if (wait == 0) {
+                wait = 1;
+            }
+        } else {
+            color = COLOR_IDLE;
+        }
+
+        if (color != shown) {
+            show(color);
+            shown = color;
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
 
 esp_err_t ws2812_init(void)
 {
@@ -22,39 +101,58 @@ esp_err_t ws2812_init(void)
         .flags.invert_out = false,
     };
 
+    // DMA moves the bit stream, so a refresh does not depend on the RMT
+    // interrupt refilling channel memory
     led_strip_rmt_config_t rmt_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .resolution_hz = 10 * 1000 * 1000, // 10MHz
-        .flags.with_dma = false,
+        .flags.with_dma = true,
     };
 
     esp_err_t ret = led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "RMT DMA not available (%s), using channel memory", esp_err_to_name(ret));
+        rmt_config.flags.with_dma = false;
+        ret = led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip);
+    }
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create LED strip: %s", esp_err_to_name(ret));
         return ret;
     }
+    stats.dma = rmt_config.flags.with_dma;
 
     // Clear LED on init
     led_strip_clear(led_strip);
-    
-    ESP_LOGI(TAG, "WS2812B LED initialized on GPIO%d", LED_GPIO);
+
+    if (xTaskCreate(led_task, "led", LED_STACK_SIZE, NULL, LED_PRIORITY,
+                    &led_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create LED task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "WS2812B LED initialized on GPIO%d%s", LED_GPIO, stats.dma ? " (DMA)" : "");
     return ESP_OK;
 }
 
-esp_err_t ws2812_set_detection_status(bool objects_detected)
+void ws2812_set_detection(bool objects_detected, uint8_t confidence)
 {
-    if (led_strip == NULL) {
-        ESP_LOGE(TAG, "LED strip not initialized");
-        return ESP_FAIL;
+    uint32_t value = 0;
+    if (objects_detected) {
+        if (confidence > 100) {
+            confidence = 100;
+        }
+        value = REPORT_DETECTED | (confidence / CONFIDENCE_STEP * CONFIDENCE_STEP);
     }
 
-    if (objects_detected) {
-        // Red for objects detected
-        led_strip_set_pixel(led_strip, 0, 255, 0, 0);
-    } else {
-        // Green for no objects
-        led_strip_set_pixel(led_strip, 0, 0, 255, 0);
+    if (__atomic_exchange_n(&report, value, __ATOMIC_RELAXED) != value && led_task_handle) {
+        stats.updates++;
+        xTaskNotifyGive(led_task_handle);
     }
+}
 
-    return led_strip_refresh(led_strip);
+void ws2812_get_stats(ws2812_stats_t *out)
+{
+    if (out) {
+        *out = stats;
+    }
 }
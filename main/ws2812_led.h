@@ -1,6 +1,6 @@
 /*
  * SPDX-License-Identifier: MIT
- * 
+ *
  * WS2812B LED driver for object detection indication
  */
 
@@ -9,20 +9,46 @@
 
 #include "esp_err.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+// LED states
+typedef enum {
+    WS2812_STATE_IDLE = 0,      // No bands: green
+    WS2812_STATE_TRACKING,      // Bands detected: red, brighter with confidence
+    WS2812_STATE_LOST,          // Bands just lost: blinking amber for a moment
+} ws2812_state_t;
+
+// LED statistics
+typedef struct {
+    ws2812_state_t state;
+    uint32_t updates;           // Reports that changed the shown detection
+    uint32_t refreshes;         // Strip writes
+    bool dma;                   // RMT transmits through DMA
+} ws2812_stats_t;
 
 /**
- * @brief Initialize the WS2812B LED
- * 
+ * @brief Initialize the WS2812B LED and start its output task
+ *
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t ws2812_init(void);
 
 /**
- * @brief Set LED color based on object detection
- * 
- * @param objects_detected true if one or more objects detected (red), false otherwise (green)
- * @return ESP_OK on success, error code otherwise
+ * @brief Report the current detection
+ *
+ * Never blocks: stores the state and wakes the LED task if it changed; the
+ * strip is written only when the shown color changes.
+ *
+ * @param objects_detected true if one or more objects detected
+ * @param confidence Detection confidence (0-100), sets the red brightness
+ */
+void ws2812_set_detection(bool objects_detected, uint8_t confidence);
+
+/**
+ * @brief Get LED statistics
+ *
+ * @param stats Pointer to stats structure to fill
  */
-esp_err_t ws2812_set_detection_status(bool objects_detected);
+void ws2812_get_stats(ws2812_stats_t *stats);
 
 #endif // WS2812_LED_H
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Put kernel benchmark reports side by side.
+
+Reads reports in the format of GET /api/bench: from a file, from a device
+(host:port or address) or by running the host build's runner. Prints the
+fastest pass in cycles per pixel and the mean time of each kernel at each
+frame size, one column per report, and the time ratio to the first one.
+
+    build-host/kernel_bench > host.json
+    tools/bench_compare.py 192.168.4.1 host.json
+    tools/bench_compare.py --iterations 10 192.168.4.1 build-host/kernel_bench
+
+The host runner counts nanoseconds as cycles of a nominal 1000 MHz clock, so
+its cycles per pixel are nanoseconds per pixel.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+from load_gen import request
+
+
+def load(source, iterations):
+    if os.path.isfile(source) and os.access(source, os.X_OK):
+        out = subprocess.run([source, str(iterations)], check=True, capture_output=True).stdout
+        return json.loads(out)
+    if os.path.isfile(source):
+        with open(source) as f:
+            return json.load(f)
+    # A device: the run blocks for a few seconds per iteration
+    return json.loads(request(source, "/api/bench?iterations=%d" % iterations,
+                              timeout=30 + 10 * iterations))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("reports", nargs="+",
+                        help="report file, device address or host runner executable")
+    parser.add_argument("--iterations", type=int, default=5,
+                        help="passes per kernel when running a benchmark (default 5)")
+    parser.add_argument("--json", help="also write the reports to this file")
+    args = parser.parse_args()
+
+    reports = []
+    for source in args.reports:
+        try:
+            reports.append(load(source, args.iterations))
+        except (OSError, ValueError, subprocess.CalledProcessError) as e:
+            print("error: %s: %s" % (source, e), file=sys.stderr)
+            return 1
+
+    names = ["%s %dMHz" % (r["platform"], r["cpu_mhz"]) for r in reports]
+    rows = {}
+    for i, report in enumerate(reports):
+        for r in report["results"]:
+            rows.setdefault((r["kernel"], r["size"]), [None] * len(reports))[i] = r
+
+    print("%-18s %-5s" % ("kernel", "size") +
+          "".join("  %24s" % n for n in names))
+    print("%-18s %-5s" % ("", "") +
+          "".join("  %10s %8s %4s" % ("cyc/px", "us", "x") for _ in names))
+    for (kernel, size), results in rows.items():
+        base = results[0]["us_mean"] if results[0] else None
+        line = "%-18s %-5s" % (kernel, size)
+        for r in results:
+            if not r:
+                line += "  %24s" % "-"
+                continue
+            ratio = "%4.1f" % (r["us_mean"] / base) if base else "   -"
+            line += "  %10.2f %8d %4s" % (r["cycles_per_pixel"], r["us_mean"], ratio)
+        print(line)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(dict(zip(args.reports, reports)), f, indent=1)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
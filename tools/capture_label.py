@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Capture frames from a running device and label R-G-B band positions.
+
+capture saves clean JPEGs from /capture (or /stream) into a directory, with the
+device's own detections as proposals in proposals.json. label walks through
+the frames and writes the ground truth to labels.json, which
+tools/replay_pack.py --labels packs into the replay image.
+
+    tools/capture_label.py capture --host 192.168.4.1 --count 200 --interval 0.5 frames/
+    tools/capture_label.py label frames/
+    tools/replay_pack.py -o replay.bin --labels frames/labels.json frames/
+    tools/capture_label.py bench --host 192.168.4.1 -o report.json
+
+Labelling needs OpenCV (python3 -m pip install opencv-python): Enter or Space
+accepts the shown box, d draws a new one, n marks the frame as having no
+bands, s skips it, q saves and quits. Without OpenCV, --accept copies the
+proposals to labels.json for editing by hand.
+
+bench runs /api/benchmark over the labelled recording on the device and
+saves the report as JSON.
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+import time
+import urllib.request
+
+PROPOSALS = "proposals.json"
+LABELS = "labels.json"
+
+
+def load_json(path):
+    if os.path.exists(path):
+        with open(path) as f:
+            return json.load(f)
+    return {}
+
+
+def save_json(path, data):
+    with open(path, "w") as f:
+        json.dump(data, f, indent=1, sort_keys=True)
+
+
+def parse_detection(value):
+    """X-Detection header ("x,y,w,h,confidence" or "none") to a label."""
+    if not value or value == "none":
+        return {"present": False}
+    x, y, w, h, _ = (int(v) for v in value.split(","))
+    return {"present": True, "bbox": [x, y, w, h]}
+
+
+def next_index(outdir):
+    names = [n for n in os.listdir(outdir) if re.match(r"frame_\d+\.jpg$", n)]
+    return max((int(n[6:-4]) for n in names), default=-1) + 1
+
+
+def capture_single(args, proposals):
+    """Poll /capture: every frame comes with the detector's proposal."""
+    index = next_index(args.outdir)
+    for _ in range(args.count):
+        with urllib.request.urlopen("http://%s/capture" % args.host, timeout=10) as resp:
+            data = resp.read()
+            detection = resp.headers.get("X-Detection")
+        name = "frame_%04d.jpg" % index
+        with open(os.path.join(args.outdir, name), "wb") as f:
+            f.write(data)
+        proposals[name] = parse_detection(detection)
+        print("%s: %s" % (name, detection))
+        index += 1
+        time.sleep(args.interval)
+
+
+def capture_stream(args):
+    """Save every n-th frame of /stream. No proposals; frames with a detection
+    have the bounding box drawn in."""
+    index = next_index(args.outdir)
+    buf = b""
+    seen = saved = 0
+    with urllib.request.urlopen("http://%s/stream" % args.host, timeout=10) as resp:
+        while saved < args.count:
+            chunk = resp.read(16384)
+            if not chunk:
+                break
+            buf += chunk
+            while True:
+                start = buf.find(b"\xff\xd8")
+                end = buf.find(b"\xff\xd9", start) if start >= 0 else -1
+                if end < 0:
+                    break
+                jpeg, buf = buf[start:end + 2], buf[end + 2:]
+                if seen % args.every == 0 and saved < args.count:
+                    name = "frame_%04d.jpg" % index
+                    with open(os.path.join(args.outdir, name), "wb") as f:
+                        f.write(jpeg)
+                    print(name)
+                    index += 1
+                    saved += 1
+                seen += 1
+
+
+def cmd_capture(args):
+    os.makedirs(args.outdir, exist_ok=True)
+    path = os.path.join(args.outdir, PROPOSALS)
+    proposals = load_json(path)
+    try:
+        if args.stream:
+            capture_stream(args)
+        else:
+            capture_single(args, proposals)
+    finally:
+        save_json(path, proposals)
+
+
+def cmd_label(args):
+    proposals = load_json(os.path.join(args.outdir, PROPOSALS))
+    labels_path = os.path.join(args.outdir, LABELS)
+    labels = load_json(labels_path)
+    frames = sorted(n for n in os.listdir(args.outdir) if n.endswith(".jpg"))
+
+    if args.accept:
+        for name in frames:
+            if name in proposals and (args.relabel or name not in labels):
+                labels[name] = proposals[name]
+        save_json(labels_path, labels)
+        print("%s: %d of %d frames labelled" % (labels_path, len(labels), len(frames)))
+        return
+
+    try:
+        import cv2
+    except ImportError:
+        sys.exit("OpenCV is not installed; use --accept and edit %s by hand" % LABELS)
+
+    todo = [n for n in frames if args.relabel or n not in labels]
+    for count, name in enumerate(todo):
+        image = cv2.imread(os.path.join(args.outdir, name))
+        label = labels.get(name) or proposals.get(name) or {"present": False}
+        while True:
+            shown = image.copy()
+            if label.get("present"):
+                x, y, w, h = label["bbox"]
+                cv2.rectangle(shown, (x, y), (x + w - 1, y + h - 1), (0, 255, 255), 2)
+            text = "%s (%d/%d) %s" % (name, count + 1, len(todo),
+                                      "bands" if label.get("present") else "no bands")
+            cv2.putText(shown, text, (8, 20), cv2.FONT_HERSHEY_SIMPLEX, 0.6, (255, 255, 255), 2)
+            cv2.imshow("label", shown)
+            key = cv2.waitKey(0) & 0xFF
+            if key in (13, 32):
+                labels[name] = label
+                break
+            if key == ord("d"):
+                x, y, w, h = cv2.selectROI("label", image, showCrosshair=False)
+                if w and h:
+                    label = {"present": True, "bbox": [int(x), int(y), int(w), int(h)]}
+            elif key == ord("n"):
+                label = {"present": False}
+            elif key == ord("s"):
+                break
+            elif key == ord("q"):
+                save_json(labels_path, labels)
+                cv2.destroyAllWindows()
+                return
+        save_json(labels_path, labels)
+    cv2.destroyAllWindows()
+    print("%s: %d of %d frames labelled" % (labels_path, len(labels), len(frames)))
+
+
+def cmd_bench(args):
+    body = json.dumps({"engines": args.engines} if args.engines else {}).encode()
+    request = urllib.request.Request("http://%s/api/benchmark" % args.host, data=body,
+                                     headers={"Content-Type": "application/json"})
+    urllib.request.urlopen(request, timeout=10).close()
+
+    while True:
+        time.sleep(1)
+        with urllib.request.urlopen("http://%s/api/benchmark" % args.host, timeout=10) as resp:
+            report = json.load(resp)
+        if report["state"] != "running":
+            break
+        print("%d/%d frames" % (report["progress"], report["frames"]), end="\r", flush=True)
+
+    if report["state"] != "done":
+        sys.exit("benchmark %s" % report["state"])
+    save_json(args.output, report)
+    for engine in report["engines"]:
+        print("%-16s precision %.3f recall %.3f IoU %.3f p50 %d us p99 %d us" % (
+            engine["name"], engine["precision"], engine["recall"], engine["mean_iou"],
+            engine["latency_us"]["p50"], engine["latency_us"]["p99"]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    capture = sub.add_parser("capture", help="save frames from a device")
+    capture.add_argument("outdir", help="directory for frames and proposals")
+    capture.add_argument("--host", required=True, help="device address")
+    capture.add_argument("--count", type=int, default=100, help="frames to save (default 100)")
+    capture.add_argument("--interval", type=float, default=0.5,
+                         help="seconds between /capture requests (default 0.5)")
+    capture.add_argument("--stream", action="store_true",
+                         help="read /stream instead of polling /capture")
+    capture.add_argument("--every", type=int, default=5,
+                         help="with --stream, keep every n-th frame (default 5)")
+    capture.set_defaults(func=cmd_capture)
+
+    label = sub.add_parser("label", help="label captured frames")
+    label.add_argument("outdir", help="directory of captured frames")
+    label.add_argument("--accept", action="store_true",
+                       help="take the device's proposals as labels without review")
+    label.add_argument("--relabel", action="store_true", help="revisit labelled frames")
+    label.set_defaults(func=cmd_label)
+
+    bench = sub.add_parser("bench", help="run the detection benchmark on a device")
+    bench.add_argument("--host", required=True, help="device address")
+    bench.add_argument("-o", "--output", default="report.json", help="report file (default report.json)")
+    bench.add_argument("--engines", nargs="+", help="engines to run (default all)")
+    bench.set_defaults(func=cmd_bench)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Load a device with concurrent /stream viewers and API requests.
+
+Opens N /stream consumers and M API clients for a fixed time, then reports
+per-client frame rate and inter-frame jitter, API latency percentiles per
+endpoint and the device's CPU load (sampled from /api/stats once a second).
+
+    tools/load_gen.py --host 192.168.4.1 --streams 4 --api-clients 2 --duration 30
+    tools/load_gen.py --host 192.168.4.1 --streams 6 --synthetic 15 --json load.json
+
+--synthetic FPS switches the device to the synthetic frame source at that
+rate for the run (restoring the previous source afterwards), so runs do not
+depend on what the camera sees. The run then also checks that the detector
+finds the synthetic bands (from /api/detections) and exits with status 1 if
+it never does; --streams 0 --api-clients 0 makes a quick check of it. The
+bands are pure red, green and blue (hues 0, 85 and 170 on the detector's
+0-255 scale), outside the default green (40-80) and blue (100-140) ranges,
+so the run also widens those two ranges and restores them afterwards. API
+clients only send requests without
+lasting effects: GET /api/config, GET /api/stats and POST /api/perf with the
+current settings.
+"""
+
+import argparse
+import json
+import statistics
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+
+SOURCE_KEYS = ("type", "fps", "timestamps", "loop", "width", "height")
+
+# Green and blue ranges around the synthetic bands' hues
+SYNTHETIC_THRESHOLDS = {"green": {"h_min": 65, "h_max": 105}, "blue": {"h_min": 150, "h_max": 190}}
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+def request(host, path, body=None, timeout=10):
+    data = json.dumps(body).encode() if body is not None else None
+    req = urllib.request.Request("http://%s%s" % (host, path), data=data,
+                                 headers={"Content-Type": "application/json"} if data else {})
+    with urllib.request.urlopen(req, timeout=timeout) as resp:
+        return resp.read()
+
+
+def synthetic_start(host, fps):
+    """Feed the pipeline from the synthetic source, with green and blue
+    ranges that cover its bands. Returns what synthetic_stop() restores."""
+    source = json.loads(request(host, "/api/source"))
+    config = json.loads(request(host, "/api/config"))
+    request(host, "/api/config", SYNTHETIC_THRESHOLDS)
+    request(host, "/api/source", {"type": "synthetic", "fps": fps, "timestamps": "capture"})
+    return source, config
+
+
+def synthetic_stop(host, saved):
+    source, config = saved
+    request(host, "/api/source", {k: source[k] for k in SOURCE_KEYS})
+    request(host, "/api/config", {k: config[k] for k in SYNTHETIC_THRESHOLDS})
+
+
+def detected_frames(host, since):
+    """Detection records logged after sequence number since, newest last."""
+    records = []
+    while True:
+        page = json.loads(request(host, "/api/detections?since=%d&limit=200" % since))
+        records += [dict(zip(page["fields"], r)) for r in page["records"]]
+        if not page["more"]:
+            return [r for r in records if r["flags"] & 1]
+        since = page["next"]
+
+
+class StreamClient(threading.Thread):
+    """Reads /stream and records the arrival time of every complete JPEG."""
+
+    def __init__(self, host, deadline):
+        super().__init__(daemon=True)
+        self.host = host
+        self.deadline = deadline
+        self.arrivals = []
+        self.bytes = 0
+        self.error = None
+
+    def run(self):
+        try:
+            with urllib.request.urlopen("http://%s/stream" % self.host, timeout=10) as resp:
+                buf = b""
+                while time.monotonic() < self.deadline:
+                    chunk = resp.read1(16384)
+                    if not chunk:
+                        self.error = "closed"
+                        break
+                    self.bytes += len(chunk)
+                    buf += chunk
+                    while True:
+                        start = buf.find(b"\xff\xd8")
+                        end = buf.find(b"\xff\xd9", start) if start >= 0 else -1
+                        if end < 0:
+                            break
+                        self.arrivals.append(time.monotonic())
+                        buf = buf[end + 2:]
+        except urllib.error.HTTPError as e:
+            self.error = "HTTP %d" % e.code
+        except OSError as e:
+            self.error = str(e)
+
+    def report(self, duration):
+        intervals = [(b - a) * 1000 for a, b in zip(self.arrivals, self.arrivals[1:])]
+        span = self.arrivals[-1] - self.arrivals[0] if len(self.arrivals) > 1 else 0
+        return {
+            "frames": len(self.arrivals),
+            "fps": (len(self.arrivals) - 1) / span if span > 0 else 0.0,
+            "kbps": self.bytes * 8 / 1000 / duration,
+            "interval_ms_mean": statistics.mean(intervals) if intervals else 0.0,
+            "jitter_ms": statistics.pstdev(intervals) if intervals else 0.0,
+            "interval_ms_p99": percentile(intervals, 99),
+            "interval_ms_max": max(intervals) if intervals else 0.0,
+            "error": self.error,
+        }
+
+
+class ApiClient(threading.Thread):
+    """Sends API requests back to back and records their latency."""
+
+    def __init__(self, host, deadline, perf):
+        super().__init__(daemon=True)
+        self.host = host
+        self.deadline = deadline
+        self.calls = [("GET /api/config", "/api/config", None),
+                      ("GET /api/stats", "/api/stats", None),
+                      ("POST /api/perf", "/api/perf", perf)]
+        self.latency = {name: [] for name, _, _ in self.calls}
+        self.errors = 0
+
+    def run(self):
+        i = 0
+        while time.monotonic() < self.deadline:
+            name, path, body = self.calls[i % len(self.calls)]
+            i += 1
+            start = time.monotonic()
+            try:
+                request(self.host, path, body)
+                self.latency[name].append((time.monotonic() - start) * 1000)
+            except OSError:
+                self.errors += 1
+
+
+class CpuSampler(threading.Thread):
+    """Polls /api/stats once a second for the device's CPU load."""
+
+    def __init__(self, host, deadline):
+        super().__init__(daemon=True)
+        self.host = host
+        self.deadline = deadline
+        self.cores = []
+        self.tasks = []
+        self.stream = None
+
+    def run(self):
+        while time.monotonic() < self.deadline:
+            time.sleep(1)
+            try:
+                stats = json.loads(request(self.host, "/api/stats"))
+            except (OSError, ValueError):
+                continue
+            cpu = stats.get("cpu", {})
+            if cpu.get("interval_ms"):
+                self.cores.append(cpu["cores"])
+                self.tasks = cpu["tasks"]
+            self.stream = stats.get("stream")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", required=True, help="device address")
+    parser.add_argument("--streams", type=int, default=4, help="/stream consumers (default 4)")
+    parser.add_argument("--api-clients", type=int, default=1, help="API clients (default 1)")
+    parser.add_argument("--duration", type=float, default=30, help="seconds (default 30)")
+    parser.add_argument("--synthetic", type=int, metavar="FPS",
+                        help="feed the pipeline from the synthetic source at FPS")
+    parser.add_argument("--json", help="also write the report to this file")
+    args = parser.parse_args()
+
+    stats = json.loads(request(args.host, "/api/stats"))
+    perf = {"parallel": stats["detect"]["parallel"], "strips": stats["detect"]["strips"]}
+
+    source = None
+    if args.synthetic is not None:
+        source = synthetic_start(args.host, args.synthetic)
+        log_start = json.loads(request(args.host, "/api/detections?limit=1"))["last"]
+
+    try:
+        deadline = time.monotonic() + args.duration
+        streams = [StreamClient(args.host, deadline) for _ in range(args.streams)]
+        apis = [ApiClient(args.host, deadline, perf) for _ in range(args.api_clients)]
+        sampler = CpuSampler(args.host, deadline)
+        for t in streams + apis + [sampler]:
+            t.start()
+        for t in streams + apis + [sampler]:
+            t.join(args.duration + 15)
+    finally:
+        if source is not None:
+            synthetic_stop(args.host, source)
+
+    report = {"streams": [s.report(args.duration) for s in streams], "api": {}, "cpu": {}}
+    for name in apis[0].latency if apis else []:
+        latency = [v for a in apis for v in a.latency[name]]
+        report["api"][name] = {
+            "requests": len(latency),
+            "p50_ms": percentile(latency, 50),
+            "p90_ms": percentile(latency, 90),
+            "p99_ms": percentile(latency, 99),
+            "max_ms": max(latency) if latency else 0.0,
+        }
+    report["api_errors"] = sum(a.errors for a in apis)
+    if sampler.cores:
+        report["cpu"] = {
+            "samples": len(sampler.cores),
+            "mean": [statistics.mean(c[i] for c in sampler.cores) for i in range(len(sampler.cores[0]))],
+            "max": [max(c[i] for c in sampler.cores) for i in range(len(sampler.cores[0]))],
+            "tasks": sampler.tasks,
+        }
+    report["device_stream"] = sampler.stream
+    if source is not None:
+        report["synthetic_detections"] = len(detected_frames(args.host, log_start))
+
+    for i, s in enumerate(report["streams"]):
+        print("stream %d: %5.1f fps  jitter %6.1f ms  p99 %6.1f ms  max %6.1f ms  %6.0f kbps%s" % (
+            i, s["fps"], s["jitter_ms"], s["interval_ms_p99"], s["interval_ms_max"], s["kbps"],
+            "  (%s)" % s["error"] if s["error"] else ""))
+    for name, a in report["api"].items():
+        print("%-16s %5d req  p50 %6.1f ms  p90 %6.1f ms  p99 %6.1f ms  max %6.1f ms" % (
+            name, a["requests"], a["p50_ms"], a["p90_ms"], a["p99_ms"], a["max_ms"]))
+    if report["api_errors"]:
+        print("API errors: %d" % report["api_errors"])
+    if report["cpu"]:
+        cpu = report["cpu"]
+        print("CPU: " + "  ".join("core%d mean %.0f%% max %.0f%%" % (i, m, x)
+                                  for i, (m, x) in enumerate(zip(cpu["mean"], cpu["max"]))))
+        print("busiest: " + ", ".join("%s %.0f%%" % (t["name"], t["load"]) for t in cpu["tasks"][:6]))
+
+    if source is not None:
+        print("synthetic bands detected in %d frames" % report["synthetic_detections"])
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=1)
+
+    if source is not None and not report["synthetic_detections"]:
+        print("error: the synthetic bands were never detected", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Check the MQTT publisher of a device against a local mosquitto broker.
+
+Starts mosquitto on this machine and subscribes to <topic>/detection with
+mosquitto_sub, switches the device to the synthetic frame source (moving
+R-G-B bands, visible 60 of every 80 frames, so the detection state changes
+twice per cycle) and points /api/mqtt at the broker. It then checks:
+
+- state-change payloads: alternating "detected", confidence, bbox, sequence
+  and angle only while detected;
+- summary payloads: frames, count <= frames, mean confidence and bbox, about
+  one per summary interval;
+- batch payloads (arrays, sent when messages queue up between two publishes)
+  hold valid messages;
+- the queued, published, batches and latency counters of /api/stats match
+  what the broker delivered;
+- with the broker stopped, messages are dropped and counted while
+  published stays unchanged and the pipeline keeps running.
+
+    tools/mqtt_check.py --host 192.168.4.1 --broker 192.168.4.2
+    tools/mqtt_check.py --host 192.168.4.1 --broker 192.168.4.2 --port 1884 --duration 60
+
+--broker is this machine's address as seen from the device. The green and
+blue ranges are widened to cover the synthetic bands, as tools/load_gen.py
+--synthetic does. The device's MQTT settings, frame source and ranges are
+restored afterwards. Exits with status 1 if a check fails.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+import load_gen
+
+SUMMARY_INTERVAL = 5
+
+
+def request(host, path, body=None, timeout=10):
+    return json.loads(load_gen.request(host, path, body, timeout))
+
+
+def mqtt_stats(host):
+    return request(host, "/api/stats")["mqtt"]
+
+
+class Subscriber(threading.Thread):
+    """Runs mosquitto_sub and keeps every payload with its arrival time."""
+
+    def __init__(self, port, topic):
+        super().__init__(daemon=True)
+        self.proc = subprocess.Popen(["mosquitto_sub", "-h", "127.0.0.1", "-p", str(port),
+                                      "-t", topic, "-v"],
+                                     stdout=subprocess.PIPE, text=True)
+        self.payloads = []
+
+    def run(self):
+        for line in self.proc.stdout:
+            _, _, payload = line.rstrip("\n").partition(" ")
+            self.payloads.append((time.monotonic(), payload))
+
+    def stop(self):
+        self.proc.terminate()
+        self.proc.wait()
+        self.join(5)
+
+
+class Checker:
+    def __init__(self):
+        self.failures = 0
+
+    def check(self, ok, what):
+        print("%s %s" % ("ok  " if ok else "FAIL", what))
+        if not ok:
+            self.failures += 1
+        return ok
+
+
+def check_message(msg, frame):
+    """Problems with one state or summary message, as a list of strings."""
+    problems = []
+    if msg.get("type") not in ("state", "summary"):
+        return ["unknown type %r" % msg.get("type")]
+    if not isinstance(msg.get("ts"), (int, float)) or msg["ts"] <= 0:
+        problems.append("bad ts")
+
+    if msg["type"] == "state":
+        if not isinstance(msg.get("detected"), bool):
+            problems.append("state without detected")
+        if not 0 <= msg.get("confidence", -1) <= 100:
+            problems.append("confidence out of range")
+        has_bbox = msg.get("detected") is True
+    else:
+        frames, count = msg.get("frames", -1), msg.get("count", -1)
+        if frames < 0 or not 0 <= count <= frames:
+            problems.append("summary count %r of %r frames" % (count, frames))
+        if not 0 <= msg.get("mean_confidence", -1) <= 100 or (count == 0) != (msg.get("mean_confidence") == 0):
+            problems.append("mean_confidence %r with count %r" % (msg.get("mean_confidence"), count))
+        has_bbox = count > 0
+
+    if has_bbox:
+        bbox = msg.get("bbox")
+        if not (isinstance(bbox, list) and len(bbox) == 4 and bbox[2] > 0 and bbox[3] > 0 and
+                bbox[0] + bbox[2] <= frame[0] and bbox[1] + bbox[3] <= frame[1]):
+            problems.append("bad bbox %r" % bbox)
+        if "sequence" not in msg or "angle" not in msg:
+            problems.append("detection without sequence or angle")
+    elif "bbox" in msg:
+        problems.append("bbox without a detection")
+    return problems
+
+
+def check_delivery(c, args, payloads, before, after, frame):
+    messages, batches = [], 0
+    for _, payload in payloads:
+        try:
+            data = json.loads(payload)
+        except ValueError:
+            c.check(False, "payload is JSON: %r" % payload[:80])
+            continue
+        if isinstance(data, list):
+            batches += 1
+            c.check(1 < len(data) <= 8, "batch of %d messages (2-8)" % len(data))
+            messages += data
+        else:
+            messages.append(data)
+
+    bad = [(m, p) for m in messages for p in check_message(m, frame)]
+    for m, p in bad[:5]:
+        print("     %s: %s" % (p, json.dumps(m)))
+    c.check(not bad, "%d messages well formed" % len(messages))
+
+    states = [m for m in messages if m.get("type") == "state"]
+    summaries = [m for m in messages if m.get("type") == "summary"]
+    c.check(any(m.get("detected") for m in states), "state change to detected")
+    c.check(any(m.get("detected") is False for m in states), "state change to not detected")
+    c.check(all(a.get("detected") != b.get("detected") for a, b in zip(states, states[1:])),
+            "%d state changes alternate" % len(states))
+    c.check(all(a["ts"] < b["ts"] for a, b in zip(states, states[1:])), "state timestamps increase")
+
+    expected = args.duration / SUMMARY_INTERVAL
+    c.check(expected - 2 <= len(summaries) <= expected + 2,
+            "%d summaries in %ds (every %ds)" % (len(summaries), args.duration, SUMMARY_INTERVAL))
+    gaps = [(b["ts"] - a["ts"]) / 1e6 for a, b in zip(summaries, summaries[1:])]
+    c.check(all(abs(g - SUMMARY_INTERVAL) < 1 for g in gaps), "summary spacing %s s" %
+            ", ".join("%.1f" % g for g in gaps))
+    c.check(sum(m["frames"] for m in summaries) > 0 and sum(m["count"] for m in summaries) > 0,
+            "summaries count processed frames and detections")
+    print("     %d payloads, %d batches" % (len(payloads), batches))
+
+    delta = {k: after[k] - before[k] for k in ("queued", "published", "batches", "dropped")}
+    c.check(delta["dropped"] == 0, "nothing dropped with the broker up (%d)" % delta["dropped"])
+    c.check(delta["queued"] == len(states), "queued %d = state changes received %d" %
+            (delta["queued"], len(states)))
+    c.check(delta["published"] == len(messages), "published %d = messages received %d" %
+            (delta["published"], len(messages)))
+    c.check(delta["batches"] == len(payloads), "batches %d = payloads received %d" %
+            (delta["batches"], len(payloads)))
+    c.check(0 < after["latency_us"] <= after["max_latency_us"] < args.max_latency * 1000,
+            "latency %d us, max %d us (< %d ms)" % (after["latency_us"], after["max_latency_us"],
+                                                   args.max_latency))
+
+
+def check_broker_down(c, args, host, uri, topic):
+    request(host, "/api/mqtt", {"enabled": True, "uri": uri, "topic": topic,
+                                "summary_interval": SUMMARY_INTERVAL})
+    time.sleep(3)
+    before = mqtt_stats(host)
+    captured = request(host, "/api/stats")["pipeline"]["captured"]
+    c.check(not before["connected"], "not connected with the broker stopped")
+
+    time.sleep(args.duration / 2)
+    after = mqtt_stats(host)
+    delta = {k: after[k] - before[k] for k in ("queued", "published", "batches", "dropped")}
+    c.check(delta["dropped"] > 0, "dropped %d messages" % delta["dropped"])
+    c.check(delta["queued"] > 0, "state changes still queued (%d)" % delta["queued"])
+    c.check(delta["published"] == 0 and delta["batches"] == 0, "nothing published")
+    c.check(after["latency_us"] == before["latency_us"] and
+            after["max_latency_us"] == before["max_latency_us"], "latency unchanged")
+    c.check(request(host, "/api/stats")["pipeline"]["captured"] > captured, "pipeline keeps running")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", required=True, help="device address")
+    parser.add_argument("--broker", required=True, help="this machine's address as seen from the device")
+    parser.add_argument("--port", type=int, default=1883, help="broker port (default 1883)")
+    parser.add_argument("--topic", default="mqttcheck", help="topic prefix (default mqttcheck)")
+    parser.add_argument("--duration", type=int, default=30, help="seconds per phase (default 30)")
+    parser.add_argument("--synthetic", type=int, default=15, metavar="FPS",
+                        help="synthetic source rate (default 15)")
+    parser.add_argument("--max-latency", type=int, default=500, metavar="MS",
+                        help="largest accepted report-to-publish latency (default 500)")
+    args = parser.parse_args()
+
+    c = Checker()
+    uri = "mqtt://%s:%d" % (args.broker, args.port)
+    mqtt = request(args.host, "/api/mqtt")
+    source = request(args.host, "/api/source")
+    frame = (source["width"], source["height"])
+    saved = None
+
+    conf = tempfile.NamedTemporaryFile("w", suffix=".conf", delete=False)
+    conf.write("listener %d\nallow_anonymous true\n" % args.port)
+    conf.close()
+    broker = subprocess.Popen(["mosquitto", "-c", conf.name], stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+    subscriber = None
+    try:
+        time.sleep(1)
+        if broker.poll() is not None:
+            print("error: mosquitto did not start on port %d" % args.port, file=sys.stderr)
+            return 1
+        subscriber = Subscriber(args.port, "%s/detection" % args.topic)
+        subscriber.start()
+
+        saved = load_gen.synthetic_start(args.host, args.synthetic)
+        before = mqtt_stats(args.host)
+        request(args.host, "/api/mqtt", {"enabled": True, "uri": uri, "topic": args.topic,
+                                         "summary_interval": SUMMARY_INTERVAL})
+        for _ in range(10):
+            time.sleep(0.5)
+            if mqtt_stats(args.host)["connected"]:
+                break
+        c.check(mqtt_stats(args.host)["connected"], "connected to %s" % uri)
+
+        print("-- broker up, %d s" % args.duration)
+        time.sleep(args.duration)
+        # Stop publishing before reading the counters so they match delivery
+        request(args.host, "/api/mqtt", {"enabled": False})
+        time.sleep(1)
+        after = mqtt_stats(args.host)
+        subscriber.stop()
+        check_delivery(c, args, subscriber.payloads, before, after, frame)
+
+        print("-- broker stopped, %d s" % (args.duration / 2))
+        broker.terminate()
+        broker.wait()
+        check_broker_down(c, args, args.host, uri, args.topic)
+    finally:
+        if subscriber and subscriber.proc.poll() is None:
+            subscriber.stop()
+        if broker.poll() is None:
+            broker.terminate()
+            broker.wait()
+        os.unlink(conf.name)
+        request(args.host, "/api/mqtt", mqtt)
+        if saved:
+            load_gen.synthetic_stop(args.host, saved)
+
+    print("%d checks failed" % c.failures if c.failures else "all checks passed")
+    return 1 if c.failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Pack frames into a replay image for the "replay" flash partition.
+
+Inputs are JPEG files, raw RGB565 (big endian) or YUV422 (YUYV) frames, or
+MJPEG captures such as /stream or /api/clips/<id>.mjpeg saved with curl.
+Directories are expanded in name order. Ground truth written by
+tools/capture_label.py is packed as a label table with --labels.
+
+    tools/replay_pack.py -o replay.bin frames/
+    tools/replay_pack.py -o replay.bin --labels frames/labels.json frames/
+    tools/replay_pack.py -o replay.bin --size 640x480 --format rgb565 raw/
+    parttool.py write_partition --partition-name replay --input replay.bin
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x594C5052      # "RPLY"
+VERSION = 1
+FORMATS = {"rgb565": 0, "yuv422": 1, "jpeg": 4}    # pixformat_t
+HEADER = struct.Struct("<IHHHHII12x")
+FRAME_HEADER = struct.Struct("<IIq")
+LABEL = struct.Struct("<HHHHHH")
+LABEL_LABELLED = 0x01
+LABEL_PRESENT = 0x02
+
+
+def jpeg_size(data):
+    """Return (width, height) from the first SOF marker."""
+    i = 2
+    while i + 9 < len(data):
+        if data[i] != 0xFF:
+            i += 1
+            continue
+        marker = data[i + 1]
+        if marker in (0xC0, 0xC1, 0xC2):
+            h, w = struct.unpack(">HH", data[i + 5:i + 9])
+            return w, h
+        if marker in (0xD8, 0x01) or 0xD0 <= marker <= 0xD7:
+            i += 2
+            continue
+        i += 2 + struct.unpack(">H", data[i + 2:i + 4])[0]
+    raise ValueError("no SOF marker")
+
+
+def mjpeg_frames(data):
+    """Split a multipart MJPEG capture into (jpeg, timestamp_ms or None)."""
+    frames = []
+    pos = 0
+    while True:
+        start = data.find(b"\xff\xd8", pos)
+        if start < 0:
+            break
+        end = data.find(b"\xff\xd9", start)
+        if end < 0:
+            break
+        headers = data[pos:start]
+        m = re.search(rb"X-Timestamp:\s*(\d+)", headers)
+        frames.append((data[start:end + 2], int(m.group(1)) if m else None))
+        pos = end + 2
+    return frames
+
+
+def pack_label(label):
+    """Pack a labels.json entry: null/missing, {"present": false} or
+    {"present": true, "bbox": [x, y, w, h]}."""
+    if label is None:
+        return LABEL.pack(0, 0, 0, 0, 0, 0)
+    if not label.get("present"):
+        return LABEL.pack(LABEL_LABELLED, 0, 0, 0, 0, 0)
+    x, y, w, h = label["bbox"]
+    return LABEL.pack(LABEL_LABELLED | LABEL_PRESENT, x, y, w, h, 0)
+
+
+def expand(paths):
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                full = os.path.join(path, name)
+                if os.path.isfile(full):
+                    yield full
+        else:
+            yield path
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("inputs", nargs="+", help="frame files, directories or MJPEG captures")
+    parser.add_argument("-o", "--output", required=True, help="replay image to write")
+    parser.add_argument("--format", choices=FORMATS, default="jpeg",
+                        help="format of raw (non-JPEG) inputs and of the image (default jpeg)")
+    parser.add_argument("--size", help="WxH of raw frames")
+    parser.add_argument("--fps", type=float, default=25.0,
+                        help="frame rate for frames without a recorded timestamp (default 25)")
+    parser.add_argument("--labels", help="labels.json keyed by file name (name#index for MJPEG frames)")
+    parser.add_argument("--max-bytes", type=int, default=0x2F0000,
+                        help="partition size (default 0x2F0000)")
+    args = parser.parse_args()
+
+    frames = []     # (data, timestamp_us or None, label key)
+    for path in expand(args.inputs):
+        name = os.path.basename(path)
+        if name.endswith(".json"):
+            continue
+        with open(path, "rb") as f:
+            data = f.read()
+        if path.endswith((".mjpeg", ".mjpg")):
+            frames += [(jpeg, ts * 1000 if ts is not None else None, "%s#%d" % (name, i))
+                       for i, (jpeg, ts) in enumerate(mjpeg_frames(data))]
+        else:
+            frames.append((data, None, name))
+    if not frames:
+        sys.exit("no frames")
+
+    labels = None
+    if args.labels:
+        with open(args.labels) as f:
+            labels = json.load(f)
+
+    is_jpeg = frames[0][0][:2] == b"\xff\xd8"
+    if is_jpeg != (args.format == "jpeg"):
+        sys.exit("inputs do not match --format %s" % args.format)
+
+    if is_jpeg:
+        width, height = jpeg_size(frames[0][0])
+    else:
+        if not args.size:
+            sys.exit("--size is required for raw frames")
+        width, height = (int(v) for v in args.size.lower().split("x"))
+
+    out = bytearray(HEADER.pack(MAGIC, VERSION, FORMATS[args.format], width, height, len(frames), 0))
+    period = int(1e6 / args.fps)
+    for index, (data, ts, _) in enumerate(frames):
+        if is_jpeg and jpeg_size(data) != (width, height):
+            sys.exit("frame %d: size differs from the first frame" % index)
+        if not is_jpeg and len(data) != width * height * 2:
+            sys.exit("frame %d: %d bytes, expected %d" % (index, len(data), width * height * 2))
+        if ts is None:
+            ts = index * period
+        out += FRAME_HEADER.pack(len(data), 0xFFFFFFFF, ts)
+        out += data + b"\xff" * (-len(data) % 4)
+
+    labelled = 0
+    if labels is not None:
+        HEADER.pack_into(out, 0, MAGIC, VERSION, FORMATS[args.format], width, height,
+                         len(frames), len(out))
+        for _, _, key in frames:
+            label = labels.get(key)
+            labelled += label is not None
+            out += pack_label(label)
+
+    if len(out) > args.max_bytes:
+        sys.exit("image is %d bytes, partition holds %d" % (len(out), args.max_bytes))
+
+    with open(args.output, "wb") as f:
+        f.write(out)
+    print("%s: %d frames %dx%d %s, %d labelled, %d bytes" % (
+        args.output, len(frames), width, height, args.format, labelled, len(out)))
+
+
+if __name__ == "__main__":
+    main()
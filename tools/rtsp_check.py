@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+"""Receive the RTSP stream of a device and compare it with /stream.
+
+Plays rtsp://<host>/ over UDP or interleaved TCP for a fixed time, checks
+every RTP/JPEG packet (RFC 2435 header, in-band tables on the first packet,
+contiguous fragment offsets) and reports the packet and frame rate, lost
+packets, incomplete frames and how long a frame takes to arrive from its
+first packet to its marker. /stream viewers run alongside, and the device's
+own capture-to-send latency for both (rtsp.latency_us, stream.latency_us in
+/api/stats) is printed next to them.
+
+    tools/rtsp_check.py --host 192.168.4.1
+    tools/rtsp_check.py --host 192.168.4.1 --transport udp --streams 2 --duration 30
+    tools/rtsp_check.py --host 192.168.4.1 --stalled 1 --json rtsp.json
+    tools/rtsp_check.py --host 127.0.0.1:8080 --port 8554     # host_server
+
+--stalled N also opens N interleaved sessions that stop reading after PLAY,
+like a viewer on a bad link: the measured session and /stream should keep
+their rate while the device drops frames for the stalled ones. Exits with
+status 1 if no frame arrives or a packet is malformed.
+"""
+
+import argparse
+import json
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+from load_gen import StreamClient, percentile, request
+
+RTP_PAYLOAD_JPEG = 26
+CLIENT_PORT = 50000
+
+
+class RtspSession:
+    """One RTSP connection: requests and replies, then RTP packets."""
+
+    def __init__(self, host, port, transport, client_port=CLIENT_PORT):
+        self.url = "rtsp://%s:%d/" % (host, port)
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.buf = b""
+        self.cseq = 0
+        self.transport = transport
+        self.udp = None
+        if transport == "udp":
+            self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self.udp.bind(("", client_port))
+            self.udp.settimeout(5)
+        self.session = None
+
+    def _recv(self):
+        chunk = self.sock.recv(65536)
+        if not chunk:
+            raise OSError("connection closed")
+        self.buf += chunk
+
+    def _skip_interleaved(self):
+        while self.buf[:1] == b"$":
+            while len(self.buf) < 4:
+                self._recv()
+            n = 4 + struct.unpack(">H", self.buf[2:4])[0]
+            while len(self.buf) < n:
+                self._recv()
+            self.buf = self.buf[n:]
+
+    def request(self, method, headers=""):
+        self.cseq += 1
+        if self.session:
+            headers += "Session: %s\r\n" % self.session
+        self.sock.sendall(("%s %s RTSP/1.0\r\nCSeq: %d\r\n%s\r\n" %
+                           (method, self.url, self.cseq, headers)).encode())
+        while True:
+            self._skip_interleaved()
+            if b"\r\n\r\n" in self.buf:
+                break
+            self._recv()
+        head, _, self.buf = self.buf.partition(b"\r\n\r\n")
+        lines = head.decode().split("\r\n")
+        fields = dict(l.split(":", 1) for l in lines[1:] if ":" in l)
+        fields = {k.strip().lower(): v.strip() for k, v in fields.items()}
+        length = int(fields.get("content-length", 0))
+        while len(self.buf) < length:
+            self._recv()
+        body, self.buf = self.buf[:length], self.buf[length:]
+        if " 200 " not in lines[0] + " ":
+            raise OSError("%s: %s" % (method, lines[0]))
+        return fields, body.decode()
+
+    def play(self):
+        self.request("OPTIONS")
+        self.request("DESCRIBE", "Accept: application/sdp\r\n")
+        if self.transport == "tcp":
+            transport = "RTP/AVP/TCP;unicast;interleaved=0-1"
+        else:
+            port = self.udp.getsockname()[1]
+            transport = "RTP/AVP;unicast;client_port=%d-%d" % (port, port + 1)
+        fields, _ = self.request("SETUP", "Transport: %s\r\n" % transport)
+        self.session = fields["session"].split(";")[0]
+        self.request("PLAY", "Range: npt=0.000-\r\n")
+
+    def packet(self):
+        if self.udp:
+            return self.udp.recv(65536)
+        while True:
+            while len(self.buf) < 4:
+                self._recv()
+            if self.buf[:1] != b"$":
+                # A reply to a keepalive
+                self._skip_reply()
+                continue
+            n = struct.unpack(">H", self.buf[2:4])[0]
+            while len(self.buf) < 4 + n:
+                self._recv()
+            channel, p = self.buf[1], self.buf[4:4 + n]
+            self.buf = self.buf[4 + n:]
+            if channel == 0:
+                return p
+
+    def _skip_reply(self):
+        while b"\r\n\r\n" not in self.buf:
+            self._recv()
+        self.buf = self.buf.partition(b"\r\n\r\n")[2]
+
+    def close(self):
+        try:
+            self.request("TEARDOWN")
+        except OSError:
+            pass
+        self.sock.close()
+        if self.udp:
+            self.udp.close()
+
+
+class RtspClient(threading.Thread):
+    """Receives RTP/JPEG and records packets, frames and their timing."""
+
+    def __init__(self, session, deadline):
+        super().__init__(daemon=True)
+        self.session = session
+        self.deadline = deadline
+        self.packets = 0
+        self.bytes = 0
+        self.lost = 0
+        self.incomplete = 0
+        self.arrivals = []          # Arrival of the marker packet of each frame
+        self.transfer_ms = []       # First packet to marker packet
+        self.errors = []
+
+    def check(self, ok, what):
+        if not ok and len(self.errors) < 5:
+            self.errors.append(what)
+        return ok
+
+    def run(self):
+        seq = None
+        frame_ts = None
+        offset = 0
+        first = 0.0
+        try:
+            while time.monotonic() < self.deadline:
+                try:
+                    p = self.session.packet()
+                except socket.timeout:
+                    self.check(False, "no packet for 5 s")
+                    break
+                now = time.monotonic()
+                self.packets += 1
+                self.bytes += len(p)
+                if not self.check(len(p) >= 20 and p[0] >> 6 == 2 and (p[1] & 0x7F) == RTP_PAYLOAD_JPEG,
+                                  "not RTP/JPEG: %r" % p[:12]):
+                    continue
+                pseq, ts = struct.unpack(">HI", p[2:8])
+                if seq is not None and pseq != (seq + 1) & 0xFFFF:
+                    self.lost += (pseq - seq - 1) & 0xFFFF
+                seq = pseq
+
+                j = p[12:]
+                frag = int.from_bytes(j[1:4], "big")
+                typ, q = j[4], j[5]
+                k = 12 if typ >= 64 else 8
+                if frag == 0:
+                    if frame_ts is not None:
+                        self.incomplete += 1
+                    self.check(q == 255 and j[k:k + 4] == b"\x00\x00\x00\x80",
+                               "first packet without in-band tables (Q=%d)" % q)
+                    k += 132
+                    frame_ts, offset, first = ts, 0, now
+                if frame_ts is None:
+                    continue                # Joined or resumed mid-frame
+                if ts != frame_ts or frag != offset:
+                    self.incomplete += 1
+                    frame_ts = None
+                    continue
+                offset += len(j) - k
+                if p[1] & 0x80:
+                    self.arrivals.append(now)
+                    self.transfer_ms.append((now - first) * 1000)
+                    frame_ts = None
+        except OSError as e:
+            self.check(False, str(e))
+
+    def report(self, duration):
+        intervals = [(b - a) * 1000 for a, b in zip(self.arrivals, self.arrivals[1:])]
+        span = self.arrivals[-1] - self.arrivals[0] if len(self.arrivals) > 1 else 0
+        return {
+            "frames": len(self.arrivals),
+            "fps": (len(self.arrivals) - 1) / span if span > 0 else 0.0,
+            "packets_per_s": self.packets / duration,
+            "kbps": self.bytes * 8 / 1000 / duration,
+            "lost_packets": self.lost,
+            "incomplete_frames": self.incomplete,
+            "jitter_ms": statistics.pstdev(intervals) if intervals else 0.0,
+            "transfer_ms_p50": percentile(self.transfer_ms, 50),
+            "transfer_ms_p99": percentile(self.transfer_ms, 99),
+            "errors": self.errors,
+        }
+
+
+def device_stats(host):
+    try:
+        return json.loads(request(host, "/api/stats"))
+    except (OSError, ValueError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", required=True, help="device address, with :port if HTTP is not on 80")
+    parser.add_argument("--port", type=int, default=554, help="RTSP port (default 554)")
+    parser.add_argument("--transport", choices=("tcp", "udp"), default="tcp",
+                        help="RTP transport (default tcp)")
+    parser.add_argument("--streams", type=int, default=1, help="/stream viewers alongside (default 1)")
+    parser.add_argument("--stalled", type=int, default=0,
+                        help="extra TCP sessions that stop reading after PLAY (default 0)")
+    parser.add_argument("--duration", type=float, default=20, help="seconds (default 20)")
+    parser.add_argument("--json", help="also write the report to this file")
+    args = parser.parse_args()
+
+    address = args.host.rsplit(":", 1)[0]
+    before = device_stats(args.host)
+    stalled = []
+    for i in range(args.stalled):
+        s = RtspSession(address, args.port, "tcp")
+        s.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+        s.play()
+        stalled.append(s)
+
+    session = RtspSession(address, args.port, args.transport)
+    session.play()
+    deadline = time.monotonic() + args.duration
+    rtsp = RtspClient(session, deadline)
+    streams = [StreamClient(args.host, deadline) for _ in range(args.streams)]
+    for t in [rtsp] + streams:
+        t.start()
+    for t in [rtsp] + streams:
+        t.join(args.duration + 15)
+    after = device_stats(args.host)
+    session.close()
+    for s in stalled:
+        s.sock.close()
+
+    report = {"transport": args.transport, "stalled": args.stalled,
+              "rtsp": rtsp.report(args.duration),
+              "streams": [s.report(args.duration) for s in streams]}
+    if before and after:
+        report["device"] = {
+            "rtsp_latency_us": after["rtsp"]["latency_us"],
+            "rtsp_frames_sent": after["rtsp"]["frames_sent"] - before["rtsp"]["frames_sent"],
+            "rtsp_frames_dropped": after["rtsp"]["frames_dropped"] - before["rtsp"]["frames_dropped"],
+            "stream_latency_us": after["stream"]["latency_us"],
+        }
+
+    r = report["rtsp"]
+    print("rtsp/%s: %5.1f fps  %6.1f pkt/s  %6.0f kbps  jitter %6.1f ms  transfer p50 %5.1f ms  "
+          "p99 %5.1f ms  lost %d  incomplete %d" % (
+              args.transport, r["fps"], r["packets_per_s"], r["kbps"], r["jitter_ms"],
+              r["transfer_ms_p50"], r["transfer_ms_p99"], r["lost_packets"], r["incomplete_frames"]))
+    for i, s in enumerate(report["streams"]):
+        print("stream %d:  %5.1f fps  %6.0f kbps  jitter %6.1f ms%s" % (
+            i, s["fps"], s["kbps"], s["jitter_ms"], "  (%s)" % s["error"] if s["error"] else ""))
+    if "device" in report:
+        d = report["device"]
+        print("device latency: rtsp %.1f ms, stream %.1f ms; rtsp frames sent %d, dropped %d" % (
+            d["rtsp_latency_us"] / 1000, d["stream_latency_us"] / 1000,
+            d["rtsp_frames_sent"], d["rtsp_frames_dropped"]))
+    else:
+        print("device stats unavailable")
+    for e in r["errors"]:
+        print("error: %s" % e, file=sys.stderr)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(report, f, indent=1)
+
+    if not r["frames"] or r["errors"]:
+        print("error: %s" % ("no RTSP frame received" if not r["frames"] else "malformed packets"),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())